@@ -0,0 +1,66 @@
+# NOTE: The two-stage profile-guided build, run by the pgo target as
+# cmake -P. Builds an instrumented ray in BINARY_DIR, renders the canonical
+# benchmark scenes with it, then rebuilds the same tree with the profile. The
+# result is BINARY_DIR/ray.
+#
+# The training renders are small; what matters is that they go down the
+# same kernels and branches as real ones, and every scene the regression
+# suite covers is in the mix. They're run single-threaded so the counters
+# aren't fought over. Their images land in BINARY_DIR/training.
+
+foreach(Variable SOURCE_DIR BINARY_DIR CXX_COMPILER CXX_COMPILER_ID)
+	if(NOT DEFINED ${Variable})
+		message(FATAL_ERROR "pgo.cmake needs -D${Variable}=...")
+	endif()
+endforeach()
+
+set(PGO_DATA_DIR "${BINARY_DIR}/pgo-data")
+set(TRAINING_DIR "${BINARY_DIR}/training")
+set(TRAINING_SCENES spheres forest swarm lanterns)
+set(TRAINING_ARGS -size 160 90 -spp 8 -threads 1)
+
+function(RunStep)
+	execute_process(COMMAND ${ARGN} WORKING_DIRECTORY ${TRAINING_DIR} RESULT_VARIABLE Result)
+	if(NOT Result EQUAL 0)
+		message(FATAL_ERROR "PGO step failed (${Result}): ${ARGN}")
+	endif()
+endfunction()
+
+function(BuildStage Stage)
+	message(STATUS "PGO: building the ${Stage} stage")
+	RunStep(${CMAKE_COMMAND} -S ${SOURCE_DIR} -B ${BINARY_DIR}
+	        -DCMAKE_BUILD_TYPE=Release
+	        -DCMAKE_CXX_COMPILER=${CXX_COMPILER}
+	        -DRAY_PGO=${Stage}
+	        -DRAY_PGO_DIR=${PGO_DATA_DIR})
+	RunStep(${CMAKE_COMMAND} --build ${BINARY_DIR} --target ray)
+endfunction()
+
+file(MAKE_DIRECTORY ${TRAINING_DIR})
+BuildStage(generate)
+
+# NOTE: GCC adds to whatever counts are already there, so a stale profile
+# from an earlier run (or older source) has to go first.
+file(GLOB_RECURSE OldProfiles "${BINARY_DIR}/*.gcda")
+if(OldProfiles)
+	file(REMOVE ${OldProfiles})
+endif()
+file(REMOVE_RECURSE ${PGO_DATA_DIR})
+file(MAKE_DIRECTORY ${PGO_DATA_DIR})
+
+foreach(Scene ${TRAINING_SCENES})
+	message(STATUS "PGO: training on ${Scene}")
+	RunStep(${BINARY_DIR}/ray -scene ${Scene} ${TRAINING_ARGS})
+endforeach()
+
+if(NOT CXX_COMPILER_ID STREQUAL "GNU")
+	find_program(LLVM_PROFDATA NAMES llvm-profdata)
+	if(NOT LLVM_PROFDATA)
+		message(FATAL_ERROR "PGO with ${CXX_COMPILER_ID} needs llvm-profdata")
+	endif()
+	file(GLOB RawProfiles "${PGO_DATA_DIR}/*.profraw")
+	RunStep(${LLVM_PROFDATA} merge -output=${PGO_DATA_DIR}/ray.profdata ${RawProfiles})
+endif()
+
+BuildStage(use)
+message(STATUS "PGO: done, ${BINARY_DIR}/ray")
@@ -6,7 +6,7 @@
 @echo off
 
 set CommonCompilerFlags=-O2 -MTd -nologo -Gm- -GR- -EHa- -Oi -WX -W4 -wd4127 -wd4201 -wd4100 -wd4189 -wd4505 -FC -Z7 -F0x1000000
-set CommonCompilerFlags=-D_CRT_SECURE_NO_WARNINGS -DRAY_DEBUG=1 %CommonCompilerFlags%
+set CommonCompilerFlags=-D_CRT_SECURE_NO_WARNINGS -DRAY_DEBUG=1 -DRAY_SIMD_MATH=1 -DRAY_FAST_RSQRT=1 -DRAY_PROFILE=0 %CommonCompilerFlags%
 set CommonLinkerFlags= -incremental:no -opt:ref user32.lib gdi32.lib winmm.lib opengl32.lib
 
 IF NOT EXIST W:\ray\build mkdir W:\ray\build
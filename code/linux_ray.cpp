@@ -0,0 +1,588 @@
+/*@H
+* File: linux_ray.cpp
+* Author: Jesse Calvert
+* Created: October 19, 2026, 12:52
+* Last modified: October 19, 2026, 15:46
+*/
+
+#include <pthread.h>
+#include <semaphore.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <poll.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include <fcntl.h>
+#include <errno.h>
+
+extern char **environ;
+
+typedef int platform_socket;
+#define InvalidSocket -1
+
+internal void RenderTile(work_queue *WorkOrder);
+internal void BindWorkerThread(work_queue *WorkQueue);
+
+internal u32
+LockedAddAndReturnPreviousValue(volatile u32 *Value, u32 Add)
+{
+	u32 Result = __sync_fetch_and_add(Value, Add);
+	return Result;
+}
+
+internal u64
+LockedAddAndReturnPreviousValue64(volatile u64 *Value, u64 Add)
+{
+	u64 Result = __sync_fetch_and_add(Value, Add);
+	return Result;
+}
+
+// NOTE: Stores New only if Value still holds Expected, and returns what
+// it held either way.
+internal u64
+LockedCompareExchange64(volatile u64 *Value, u64 New, u64 Expected)
+{
+	u64 Result = __sync_val_compare_and_swap(Value, Expected, New);
+	return Result;
+}
+
+internal void *
+ThreadDoWork(void *Param)
+{
+	work_queue *WorkQueue = (work_queue *)Param;
+	BindWorkerThread(WorkQueue);
+
+	for(;;)
+	{
+		if(WorkQueue->NextWorkIndex < WorkQueue->OnePastLastWorkIndex)
+		{
+			RenderTile(WorkQueue);
+		}
+		else
+		{
+			// NOTE: Park until the next batch of tiles is posted.
+			sem_wait((sem_t *)WorkQueue->SemaphoreHandle);
+		}
+	}
+
+	return 0;
+}
+
+internal void
+ThreadStart(work_queue *WorkQueue, u32 ThreadCount)
+{
+	WorkQueue->ThreadCount = ThreadCount;
+	sem_t *Semaphore = (sem_t *)malloc(sizeof(sem_t));
+	sem_init(Semaphore, 0, 0);
+	WorkQueue->SemaphoreHandle = Semaphore;
+
+	for(u32 ThreadIndex = 0;
+		ThreadIndex < ThreadCount;
+		++ThreadIndex)
+	{
+		pthread_t Thread;
+		pthread_create(&Thread, 0, ThreadDoWork, WorkQueue);
+		pthread_detach(Thread);
+	}
+}
+
+internal void
+WakeWorkerThreads(work_queue *WorkQueue)
+{
+	for(u32 ThreadIndex = 0;
+		ThreadIndex < WorkQueue->ThreadCount;
+		++ThreadIndex)
+	{
+		sem_post((sem_t *)WorkQueue->SemaphoreHandle);
+	}
+}
+
+internal f64
+GetWallClock()
+{
+	timespec Time;
+	clock_gettime(CLOCK_MONOTONIC, &Time);
+	f64 Result = (f64)Time.tv_sec + 1.0e-9*(f64)Time.tv_nsec;
+	return Result;
+}
+
+internal void
+SleepMS(u32 Milliseconds)
+{
+	usleep(1000*Milliseconds);
+}
+
+// NOTE: Zeroed memory straight from the OS, page aligned. Big blocks get
+// explicit huge pages if the system has any reserved, and otherwise ask for
+// transparent ones, which cuts TLB misses across framebuffers and scene
+// arrays. Pages are only backed once touched.
+inline memory_index
+GetAllocationSize(memory_index Size)
+{
+	memory_index Result = (Size >= HUGE_PAGE_SIZE) ? AlignPow2(Size, HUGE_PAGE_SIZE) : Size;
+	return Result;
+}
+
+internal void *
+AllocateMemory(memory_index Size)
+{
+	memory_index AllocationSize = GetAllocationSize(Size);
+	void *Result = MAP_FAILED;
+	if(AllocationSize >= HUGE_PAGE_SIZE)
+	{
+		Result = mmap(0, AllocationSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	}
+	if(Result == MAP_FAILED)
+	{
+		Result = mmap(0, AllocationSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if((Result != MAP_FAILED) && (AllocationSize >= HUGE_PAGE_SIZE))
+		{
+			madvise(Result, AllocationSize, MADV_HUGEPAGE);
+		}
+	}
+
+	if(Result == MAP_FAILED)
+	{
+		Result = 0;
+	}
+	return Result;
+}
+
+internal void
+DeallocateMemory(void *Memory, memory_index Size)
+{
+	if(Memory)
+	{
+		munmap(Memory, GetAllocationSize(Size));
+	}
+}
+
+// NOTE: Nodes come from /sys/devices/system/node, each listing its CPUs as
+// ranges like "0-3,8-11". Nodes with memory but no CPUs are left out. A
+// kernel without NUMA support has no node directory, and then every online
+// CPU goes into node 0.
+internal void
+GetNUMATopology(numa_topology *Topology)
+{
+	memset(Topology, 0, sizeof(*Topology));
+	for(u32 OSNode = 0;
+		(OSNode < 256) && (Topology->NodeCount < MAX_NUMA_NODES);
+		++OSNode)
+	{
+		char Path[128];
+		snprintf(Path, sizeof(Path), "/sys/devices/system/node/node%u/cpulist", OSNode);
+		FILE *File = fopen(Path, "r");
+		if(File)
+		{
+			char List[4096] = {};
+			if(!fgets(List, sizeof(List), File))
+			{
+				List[0] = 0;
+			}
+			fclose(File);
+
+			u32 Node = Topology->NodeCount;
+			char *At = List;
+			while((*At >= '0') && (*At <= '9'))
+			{
+				u32 FirstCPU = (u32)strtoul(At, &At, 10);
+				u32 LastCPU = FirstCPU;
+				if(*At == '-')
+				{
+					LastCPU = (u32)strtoul(At + 1, &At, 10);
+				}
+				for(u32 CPU = FirstCPU;
+					CPU <= LastCPU;
+					++CPU)
+				{
+					AddNUMACPU(Topology, CPU, Node);
+				}
+				if(*At == ',')
+				{
+					++At;
+				}
+			}
+
+			if(Topology->NodeCPUCount[Node])
+			{
+				++Topology->NodeCount;
+			}
+		}
+	}
+
+	if(!Topology->NodeCount)
+	{
+		s32 CPUCount = (s32)sysconf(_SC_NPROCESSORS_ONLN);
+		for(s32 CPU = 0;
+			CPU < Maximum(CPUCount, 1);
+			++CPU)
+		{
+			AddNUMACPU(Topology, CPU, 0);
+		}
+		Topology->NodeCount = 1;
+	}
+}
+
+internal b32
+PinThreadToNode(numa_topology *Topology, u32 Node)
+{
+	cpu_set_t Set;
+	CPU_ZERO(&Set);
+	for(u32 CPUIndex = 0;
+		CPUIndex < Topology->CPUCount;
+		++CPUIndex)
+	{
+		if(Topology->CPUNode[CPUIndex] == Node)
+		{
+			CPU_SET(Topology->CPUs[CPUIndex], &Set);
+		}
+	}
+
+	b32 Result = (pthread_setaffinity_np(pthread_self(), sizeof(Set), &Set) == 0);
+	return Result;
+}
+
+// NOTE: Maps Size bytes of named memory that other processes can map too,
+// creating it if asked to. Returns 0 on failure.
+internal void *
+MapSharedMemory(char *Name, u32 Size, b32 Create)
+{
+	void *Result = 0;
+
+	char Path[256];
+	snprintf(Path, sizeof(Path), "/%s", Name);
+	s32 File = shm_open(Path, Create ? (O_RDWR | O_CREAT) : O_RDWR, 0644);
+	if(File >= 0)
+	{
+		if(!Create || (ftruncate(File, Size) == 0))
+		{
+			void *Memory = mmap(0, Size, PROT_READ | PROT_WRITE, MAP_SHARED, File, 0);
+			if(Memory != MAP_FAILED)
+			{
+				Result = Memory;
+			}
+		}
+		close(File);
+	}
+
+	return Result;
+}
+
+struct perf_counter_group
+{
+	s32 Leader;
+	u32 MemberCount;
+	u32 Members[PerfCounter_Count];
+};
+
+struct thread_perf_counters
+{
+	b32 Opened;
+	u32 Available;
+	perf_counter_group Groups[3];
+};
+
+global_variable thread_local thread_perf_counters ThreadPerfCounters;
+
+internal s32
+OpenPerfEvent(u32 Type, u64 Config, s32 GroupLeader)
+{
+	perf_event_attr Attributes = {};
+	Attributes.size = sizeof(Attributes);
+	Attributes.type = Type;
+	Attributes.config = Config;
+	// NOTE: Unprivileged processes may only count user mode hardware events;
+	// the software ones are kernel bookkeeping to begin with.
+	Attributes.exclude_kernel = (Type != PERF_TYPE_SOFTWARE);
+	Attributes.exclude_hv = 1;
+	Attributes.read_format = (PERF_FORMAT_GROUP |
+	                          PERF_FORMAT_TOTAL_TIME_ENABLED |
+	                          PERF_FORMAT_TOTAL_TIME_RUNNING);
+
+	// NOTE: Counts only the calling thread, on whatever CPU it runs.
+	s32 Result = (s32)syscall(SYS_perf_event_open, &Attributes, 0, -1, GroupLeader, 0);
+	return Result;
+}
+
+// NOTE: Opens the calling thread's counters and returns a mask of the
+// perf_counter values it got. Hardware and software events go in separate
+// groups so a PMU that can't schedule the hardware group doesn't take the
+// software counts down with it. Containers and VMs often have no PMU at all;
+// HardwareError then says why.
+internal u32
+OpenThreadCounters(char **HardwareError)
+{
+	thread_perf_counters *Counters = &ThreadPerfCounters;
+	if(!Counters->Opened)
+	{
+		u32 Types[PerfCounter_Count] =
+		{
+			PERF_TYPE_HARDWARE,
+			PERF_TYPE_HARDWARE,
+			PERF_TYPE_HW_CACHE,
+			PERF_TYPE_HARDWARE,
+			PERF_TYPE_HARDWARE,
+			PERF_TYPE_HW_CACHE,
+			PERF_TYPE_HW_CACHE,
+			PERF_TYPE_SOFTWARE,
+			PERF_TYPE_SOFTWARE,
+			PERF_TYPE_SOFTWARE,
+		};
+		u64 Configs[PerfCounter_Count] =
+		{
+			PERF_COUNT_HW_CPU_CYCLES,
+			PERF_COUNT_HW_INSTRUCTIONS,
+			PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+			PERF_COUNT_HW_CACHE_MISSES,
+			PERF_COUNT_HW_BRANCH_MISSES,
+			PERF_COUNT_HW_CACHE_NODE | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_ACCESS << 16),
+			PERF_COUNT_HW_CACHE_NODE | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+			PERF_COUNT_SW_TASK_CLOCK,
+			PERF_COUNT_SW_CONTEXT_SWITCHES,
+			PERF_COUNT_SW_PAGE_FAULTS,
+		};
+
+		Counters->Opened = true;
+		Counters->Groups[0].Leader = -1;
+		Counters->Groups[1].Leader = -1;
+		Counters->Groups[2].Leader = -1;
+		for(u32 Counter = 0;
+			Counter < PerfCounter_Count;
+			++Counter)
+		{
+			// NOTE: A group is only scheduled if all of it fits on the PMU at
+			// once, so the node events get their own rather than risk the
+			// main group.
+			u32 GroupIndex = 2;
+			if(Counter < PERF_COUNTER_HARDWARE_COUNT) {GroupIndex = 0;}
+			else if(Counter < PERF_COUNTER_NODE_END) {GroupIndex = 1;}
+			perf_counter_group *Group = Counters->Groups + GroupIndex;
+			s32 File = OpenPerfEvent(Types[Counter], Configs[Counter], Group->Leader);
+			if(File >= 0)
+			{
+				if(Group->Leader < 0)
+				{
+					Group->Leader = File;
+				}
+				Group->Members[Group->MemberCount++] = Counter;
+				Counters->Available |= (1 << Counter);
+			}
+			else if((Counter < PERF_COUNTER_HARDWARE_COUNT) && HardwareError && !*HardwareError)
+			{
+				*HardwareError = strerror(errno);
+			}
+		}
+	}
+
+	u32 Result = Counters->Available;
+	return Result;
+}
+
+// NOTE: Fills Values with the running totals for the calling thread,
+// scaled up if the kernel had to multiplex the group.
+internal void
+ReadThreadCounters(u64 *Values)
+{
+	thread_perf_counters *Counters = &ThreadPerfCounters;
+	for(u32 GroupIndex = 0;
+		GroupIndex < ArrayCount(Counters->Groups);
+		++GroupIndex)
+	{
+		perf_counter_group *Group = Counters->Groups + GroupIndex;
+		u64 Buffer[3 + PerfCounter_Count];
+		if((Group->Leader >= 0) &&
+		   (read(Group->Leader, Buffer, sizeof(Buffer)) >= (ssize_t)(3*sizeof(u64))))
+		{
+			u64 MemberCount = Minimum(Buffer[0], (u64)Group->MemberCount);
+			u64 Enabled = Buffer[1];
+			u64 Running = Buffer[2];
+			for(u32 MemberIndex = 0;
+				MemberIndex < MemberCount;
+				++MemberIndex)
+			{
+				u64 Value = Buffer[3 + MemberIndex];
+				if(Running && (Running < Enabled))
+				{
+					Value = (u64)((f64)Value*(f64)Enabled / (f64)Running);
+				}
+				Values[Group->Members[MemberIndex]] = Value;
+			}
+		}
+	}
+}
+
+internal b32
+SpawnSelf(char **Arguments)
+{
+	// NOTE: Arguments[0] is only the name the child sees; the image is always
+	// the executable that is running right now.
+	pid_t ChildID;
+	b32 Result = (posix_spawn(&ChildID, "/proc/self/exe", 0, 0, Arguments, environ) == 0);
+	return Result;
+}
+
+internal platform_socket
+ListenOnPort(u16 Port, b32 LoopbackOnly, u16 *BoundPort)
+{
+	platform_socket Result = socket(AF_INET, SOCK_STREAM, 0);
+	if(Result != InvalidSocket)
+	{
+		s32 Reuse = 1;
+		setsockopt(Result, SOL_SOCKET, SO_REUSEADDR, &Reuse, sizeof(Reuse));
+
+		sockaddr_in Address = {};
+		Address.sin_family = AF_INET;
+		Address.sin_addr.s_addr = htonl(LoopbackOnly ? INADDR_LOOPBACK : INADDR_ANY);
+		Address.sin_port = htons(Port);
+
+		socklen_t AddressSize = sizeof(Address);
+		if((bind(Result, (sockaddr *)&Address, sizeof(Address)) == 0) &&
+		   (listen(Result, 64) == 0) &&
+		   (getsockname(Result, (sockaddr *)&Address, &AddressSize) == 0))
+		{
+			*BoundPort = ntohs(Address.sin_port);
+		}
+		else
+		{
+			close(Result);
+			Result = InvalidSocket;
+		}
+	}
+
+	return Result;
+}
+
+internal void
+ConfigureConnection(platform_socket Socket, u32 ReceiveTimeoutMS)
+{
+	s32 NoDelay = 1;
+	setsockopt(Socket, IPPROTO_TCP, TCP_NODELAY, &NoDelay, sizeof(NoDelay));
+
+	timeval Timeout = {};
+	Timeout.tv_sec = ReceiveTimeoutMS / 1000;
+	Timeout.tv_usec = 1000*(ReceiveTimeoutMS % 1000);
+	setsockopt(Socket, SOL_SOCKET, SO_RCVTIMEO, &Timeout, sizeof(Timeout));
+}
+
+internal platform_socket
+AcceptConnection(platform_socket Listener, u32 ReceiveTimeoutMS)
+{
+	platform_socket Result = accept(Listener, 0, 0);
+	if(Result != InvalidSocket)
+	{
+		ConfigureConnection(Result, ReceiveTimeoutMS);
+	}
+	return Result;
+}
+
+internal platform_socket
+ConnectToHost(char *Host, u16 Port, u32 ReceiveTimeoutMS)
+{
+	platform_socket Result = InvalidSocket;
+
+	char PortName[16];
+	snprintf(PortName, sizeof(PortName), "%u", Port);
+
+	addrinfo Hints = {};
+	Hints.ai_family = AF_INET;
+	Hints.ai_socktype = SOCK_STREAM;
+	addrinfo *Addresses = 0;
+	if(getaddrinfo(Host, PortName, &Hints, &Addresses) == 0)
+	{
+		Result = socket(AF_INET, SOCK_STREAM, 0);
+		if(Result != InvalidSocket)
+		{
+			if(connect(Result, Addresses->ai_addr, Addresses->ai_addrlen) == 0)
+			{
+				ConfigureConnection(Result, ReceiveTimeoutMS);
+			}
+			else
+			{
+				close(Result);
+				Result = InvalidSocket;
+			}
+		}
+		freeaddrinfo(Addresses);
+	}
+
+	return Result;
+}
+
+internal void
+CloseConnection(platform_socket Socket)
+{
+	close(Socket);
+}
+
+internal b32
+SendAll(platform_socket Socket, void *Data, u32 Size)
+{
+	u8 *At = (u8 *)Data;
+	while(Size)
+	{
+		// NOTE: MSG_NOSIGNAL turns a vanished peer into an error instead of
+		// a SIGPIPE that would take the whole process down.
+		ssize_t Sent = send(Socket, At, Size, MSG_NOSIGNAL);
+		if(Sent <= 0)
+		{
+			break;
+		}
+		At += Sent;
+		Size -= (u32)Sent;
+	}
+
+	b32 Result = (Size == 0);
+	return Result;
+}
+
+internal b32
+ReceiveAll(platform_socket Socket, void *Data, u32 Size)
+{
+	u8 *At = (u8 *)Data;
+	while(Size)
+	{
+		ssize_t Received = recv(Socket, At, Size, 0);
+		if(Received <= 0)
+		{
+			break;
+		}
+		At += Received;
+		Size -= (u32)Received;
+	}
+
+	b32 Result = (Size == 0);
+	return Result;
+}
+
+internal u32
+WaitForReadable(platform_socket *Sockets, b32 *Readable, u32 SocketCount, u32 TimeoutMS)
+{
+	pollfd Polls[128];
+	Assert(SocketCount <= ArrayCount(Polls));
+	for(u32 SocketIndex = 0;
+		SocketIndex < SocketCount;
+		++SocketIndex)
+	{
+		Polls[SocketIndex].fd = Sockets[SocketIndex];
+		Polls[SocketIndex].events = POLLIN;
+		Polls[SocketIndex].revents = 0;
+	}
+
+	s32 ReadyCount = poll(Polls, SocketCount, (s32)TimeoutMS);
+	for(u32 SocketIndex = 0;
+		SocketIndex < SocketCount;
+		++SocketIndex)
+	{
+		// NOTE: Hangups and errors count as readable so the caller's next
+		// receive sees them and drops the connection.
+		Readable[SocketIndex] = (Polls[SocketIndex].revents != 0);
+	}
+
+	u32 Result = (ReadyCount > 0) ? (u32)ReadyCount : 0;
+	return Result;
+}
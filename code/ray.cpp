@@ -2,15 +2,27 @@
 * File: ray.cpp
 * Author: Jesse Calvert
 * Created: October 22, 2017, 16:18
-* Last modified: November 2, 2017, 18:15
+* Last modified: October 19, 2026, 17:37
 */
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
+#include <string.h>
 #include "ray.h"
 
+#if _WIN32
 #include "win32_ray.cpp"
+#else
+#include "linux_ray.cpp"
+#endif
+#include "ray_profile.cpp"
+#include "ray_timeline.cpp"
+#include "ray_counters.cpp"
+#include "ray_bvh.cpp"
+#include "ray_lights.cpp"
+#include "ray_caustics.cpp"
+#include "ray_radiance_cache.cpp"
 
 internal image
 AllocateImage(u32 Width, u32 Height)
@@ -18,18 +30,78 @@ AllocateImage(u32 Width, u32 Height)
 	image Result = {};
 	Result.Width = Width;
 	Result.Height = Height;
+	Result.Stride = AlignPow2(Width, IMAGE_ROW_ALIGNMENT_PIXELS);
+	Result.PixelCount = Result.Width * Result.Height;
+	Result.PixelsSize = sizeof(u32) * Result.Stride * Result.Height;
+	Result.Pixels = (u32 *)AllocateMemory(Result.PixelsSize);
+	return Result;
+}
+
+// NOTE: Wraps pixels that are already packed row after row with no padding,
+// like the preview's shared buffer. Not for FreeImage.
+internal image
+PackedImage(u32 *Pixels, u32 Width, u32 Height)
+{
+	image Result = {};
+	Result.Width = Width;
+	Result.Height = Height;
+	Result.Stride = Width;
 	Result.PixelCount = Result.Width * Result.Height;
 	Result.PixelsSize = sizeof(u32) * Result.PixelCount;
-	Result.Pixels = (u32 *)calloc(Result.PixelsSize, 1);
+	Result.Pixels = Pixels;
 	return Result;
 }
 
+// NOTE: Rows are padded out to whole blocks whatever the layout, so the
+// size doesn't depend on it.
+inline u32
+GetRadianceCount(image *Image)
+{
+	u32 Result = Image->Stride * AlignPow2(Image->Height, RADIANCE_BLOCK_DIM);
+	return Result;
+}
+
+inline u32
+GetRadianceIndex(image *Image, u32 X, u32 Y)
+{
+	u32 Result = Y*Image->Stride + X;
+	if(Image->RadianceLayout == RadianceLayout_Blocked)
+	{
+		u32 BlockRow = (Y / RADIANCE_BLOCK_DIM)*Image->Stride*RADIANCE_BLOCK_DIM;
+		u32 Block = (X / RADIANCE_BLOCK_DIM)*RADIANCE_BLOCK_DIM*RADIANCE_BLOCK_DIM;
+		Result = BlockRow + Block + (Y % RADIANCE_BLOCK_DIM)*RADIANCE_BLOCK_DIM + (X % RADIANCE_BLOCK_DIM);
+	}
+	return Result;
+}
+
+internal void
+AllocateImageRadiance(image *Image, u32 Layout)
+{
+	Image->RadianceLayout = Layout;
+	Image->Radiance = (v3 *)AllocateMemory(sizeof(v3) * GetRadianceCount(Image));
+}
+
+internal void
+FreeImage(image *Image)
+{
+	DeallocateMemory(Image->Pixels, Image->PixelsSize);
+	if(Image->Radiance)
+	{
+		DeallocateMemory(Image->Radiance, sizeof(v3) * GetRadianceCount(Image));
+	}
+	image Empty = {};
+	*Image = Empty;
+}
+
 internal void
 WriteImage(image *Image, char *Filename)
 {
+	u32 RowSize = sizeof(u32) * Image->Width;
+	u32 ImageSize = RowSize * Image->Height;
+
 	bitmap_file_header FileHeader = {};
 	FileHeader.MagicValue = 0x4D42;
-	FileHeader.Size = sizeof(bitmap_file_header) + sizeof(bitmap_information_header) + Image->PixelsSize;
+	FileHeader.Size = sizeof(bitmap_file_header) + sizeof(bitmap_information_header) + ImageSize;
 	FileHeader.ImageDataOffset = sizeof(bitmap_file_header) + sizeof(bitmap_information_header);
 
 	bitmap_information_header InfoHeader = {};
@@ -39,7 +111,7 @@ WriteImage(image *Image, char *Filename)
 	InfoHeader.ColorPlanes = 1;
 	InfoHeader.BitsPerPixel = 32;
 	InfoHeader.Compression = 3;
-	InfoHeader.ImageSize = Image->PixelsSize;
+	InfoHeader.ImageSize = ImageSize;
 	InfoHeader.RedMask = 0x00FF0000;
 	InfoHeader.GreenMask = 0x0000FF00;
 	InfoHeader.BlueMask = 0x000000FF;
@@ -51,28 +123,81 @@ WriteImage(image *Image, char *Filename)
 	{
 		fwrite(&FileHeader, sizeof(bitmap_file_header), 1, OutFile);
 		fwrite(&InfoHeader, sizeof(bitmap_information_header), 1, OutFile);
-		fwrite(Image->Pixels, Image->PixelsSize, 1, OutFile);
+		for(u32 Y = 0;
+			Y < Image->Height;
+			++Y)
+		{
+			fwrite(Image->Pixels + Y*Image->Stride, RowSize, 1, OutFile);
+		}
 		fclose(OutFile);
 	}
 }
 
-inline f32
-LinearToSRGB(f32 L)
+// NOTE: Reads back the kind of bitmap WriteImage writes, which is also what
+// the reference renders are. Anything else is refused.
+#define MAX_READ_IMAGE_DIM 16384
+
+internal b32
+ReadImage(char *Filename, image *Result)
 {
-	L = Clamp01(L);
-	f32 Result = L < 0.0031308f ? L*12.92f : 1.055f*Pow(L, 1.0f / 2.4f) - 0.055f;
-	return Result;
+	b32 Valid = false;
+	FILE *InFile = fopen(Filename, "rb");
+	if(InFile)
+	{
+		bitmap_file_header FileHeader = {};
+		bitmap_information_header InfoHeader = {};
+		if((fread(&FileHeader, sizeof(bitmap_file_header), 1, InFile) == 1) &&
+		   (fread(&InfoHeader, sizeof(bitmap_information_header), 1, InFile) == 1) &&
+		   (FileHeader.MagicValue == 0x4D42) &&
+		   (InfoHeader.BitsPerPixel == 32) &&
+		   (InfoHeader.Compression == 3) &&
+		   (InfoHeader.RedMask == 0x00FF0000) &&
+		   (InfoHeader.GreenMask == 0x0000FF00) &&
+		   (InfoHeader.BlueMask == 0x000000FF) &&
+		   (InfoHeader.Width > 0) && (InfoHeader.Width <= MAX_READ_IMAGE_DIM) &&
+		   (InfoHeader.Height > 0) && (InfoHeader.Height <= MAX_READ_IMAGE_DIM) &&
+		   (fseek(InFile, FileHeader.ImageDataOffset, SEEK_SET) == 0))
+		{
+			*Result = AllocateImage(InfoHeader.Width, InfoHeader.Height);
+			u32 RowSize = sizeof(u32) * Result->Width;
+			Valid = true;
+			for(u32 Y = 0;
+				Valid && (Y < Result->Height);
+				++Y)
+			{
+				Valid = (fread(Result->Pixels + Y*Result->Stride, RowSize, 1, InFile) == 1);
+			}
+
+			if(!Valid)
+			{
+				FreeImage(Result);
+			}
+		}
+		fclose(InFile);
+	}
+	return Valid;
 }
 
-inline u32
-PackLinear01ToSRGBU32(v3 Color)
+// NOTE: FNV-1a over the visible pixels, a row at a time so the padding
+// doesn't count. Pass the last result back in to hash several images as one.
+#define IMAGE_HASH_BASIS 0xCBF29CE484222325ull
+
+internal u64
+HashImage(image *Image, u64 Hash)
 {
-	u32 R = RoundReal32ToUInt32(255.0f*LinearToSRGB(Color.r));
-	u32 G = RoundReal32ToUInt32(255.0f*LinearToSRGB(Color.g));
-	u32 B = RoundReal32ToUInt32(255.0f*LinearToSRGB(Color.b));
-	u32 A = RoundReal32ToUInt32(255.0f);
-	u32 Result = (A << 24) | (R << 16) | (G << 8) | (B << 0);
-	return Result;
+	for(u32 Y = 0;
+		Y < Image->Height;
+		++Y)
+	{
+		u8 *Byte = (u8 *)(Image->Pixels + Y*Image->Stride);
+		u8 *OnePastLastByte = Byte + sizeof(u32)*Image->Width;
+		while(Byte < OnePastLastByte)
+		{
+			Hash ^= *Byte++;
+			Hash *= 0x100000001B3ull;
+		}
+	}
+	return Hash;
 }
 
 inline f32
@@ -89,381 +214,1327 @@ RandomBilateral()
 	return Result;
 }
 
-struct ray_cast_result
+#include "ray_environment.cpp"
+#include "ray_scenes.cpp"
+
+inline u32 *
+GetPixelPointer(image *Image, u32 X, u32 Y)
 {
-	f32 ClosestHit;
-	material *MaterialHit;
-	v3 HitNormal;
+	u32 *Result = Image->Pixels + Y*Image->Stride + X;
+	return Result;
+}
+
+#include "ray_microbench.cpp"
+
+#define KERNEL_ISA KERNEL_ISA_SSE2
+#define KERNEL_NAMESPACE kernel_sse2
+#include "ray_kernel.cpp"
+
+#define KERNEL_ISA KERNEL_ISA_SSE4
+#define KERNEL_NAMESPACE kernel_sse4
+#include "ray_kernel.cpp"
+
+#define KERNEL_ISA KERNEL_ISA_AVX2
+#define KERNEL_NAMESPACE kernel_avx2
+#include "ray_kernel.cpp"
+
+#define KERNEL_ISA KERNEL_ISA_AVX512
+#define KERNEL_NAMESPACE kernel_avx512
+#include "ray_kernel.cpp"
+
+global_variable char *KernelISANames[KERNEL_ISA_COUNT] =
+{
+	"sse2",
+	"sse4",
+	"avx2",
+	"avx512",
 };
 
-internal ray_cast_result
-SingleRayCast(world *World, v3 RayOrigin, v3 RayDirection)
+global_variable tile_kernel *TileKernels[KERNEL_ISA_COUNT] =
 {
-	Assert(LengthSq(RayDirection) != 0.0f);
+	kernel_sse2::RenderTileKernel,
+	kernel_sse4::RenderTileKernel,
+	kernel_avx2::RenderTileKernel,
+	kernel_avx512::RenderTileKernel,
+};
 
-	ray_cast_result Result = {};
-	Result.ClosestHit = Real32Maximum;
+global_variable tile_kernel *CausticKernels[KERNEL_ISA_COUNT] =
+{
+	kernel_sse2::TraceCausticsKernel,
+	kernel_sse4::TraceCausticsKernel,
+	kernel_avx2::TraceCausticsKernel,
+	kernel_avx512::TraceCausticsKernel,
+};
 
-	f32 Tolerance = 0.0001f;
+global_variable tile_kernel *RadianceCacheKernels[KERNEL_ISA_COUNT] =
+{
+	kernel_sse2::FillRadianceCacheKernel,
+	kernel_sse4::FillRadianceCacheKernel,
+	kernel_avx2::FillRadianceCacheKernel,
+	kernel_avx512::FillRadianceCacheKernel,
+};
 
-	for(u32 ObjectIndex = 0;
-		ObjectIndex < World->ObjectCount;
-		++ObjectIndex)
-	{
-		object *Object = World->Objects + ObjectIndex;
-		switch(Object->Type)
-		{
-			case Object_Plane:
-			{
-				plane *Plane = &Object->Plane;
-				f32 Denom = Inner(Plane->Normal, RayDirection);
-				if((Denom > Tolerance) || (Denom < -Tolerance))
-				{
-					f32 DistanceToHit = (Plane->Offset - Inner(Plane->Normal, RayOrigin))/Denom;
-					if((DistanceToHit > Tolerance) && (DistanceToHit < Result.ClosestHit))
-					{
-						Result.ClosestHit = DistanceToHit;
-						Result.MaterialHit = &Object->Material;
-						Result.HitNormal = Plane->Normal;
-					}
-				}
-			} break;
-
-			case Object_Sphere:
-			{
-				sphere *Sphere = &Object->Sphere;
+global_variable resolve_kernel *ResolveKernels[KERNEL_ISA_COUNT] =
+{
+	kernel_sse2::ResolveAccumulatedKernel,
+	kernel_sse4::ResolveAccumulatedKernel,
+	kernel_avx2::ResolveAccumulatedKernel,
+	kernel_avx512::ResolveAccumulatedKernel,
+};
 
-				v3 SphereRelativeCenter = RayOrigin - Sphere->Center;
+global_variable microbench_kernels *KernelMicrobenches[KERNEL_ISA_COUNT] =
+{
+	kernel_sse2::RunKernelMicrobenches,
+	kernel_sse4::RunKernelMicrobenches,
+	kernel_avx2::RunKernelMicrobenches,
+	kernel_avx512::RunKernelMicrobenches,
+};
 
-				f32 a = Inner(RayDirection, RayDirection);
-				f32 b = 2.0f*Inner(RayDirection, SphereRelativeCenter);
-				f32 c = Inner(SphereRelativeCenter, SphereRelativeCenter) - Square(Sphere->Radius);
-				f32 Determinant = Square(b) - 4.0f*a*c;
-				if(Determinant > Tolerance)
-				{
-					f32 DistanceToHitPos = (-b + SquareRoot(Determinant)) / (2.0f*a);
-					f32 DistanceToHitNeg = (-b - SquareRoot(Determinant)) / (2.0f*a);
+internal u32
+GetSupportedKernelISA()
+{
+	cpu_features Features = GetCPUFeatures();
+	u32 Result = KERNEL_ISA_SSE2;
+	if(Features.SSE42) {Result = KERNEL_ISA_SSE4;}
+	if(Features.SSE42 && Features.AVX2) {Result = KERNEL_ISA_AVX2;}
+	if(Features.SSE42 && Features.AVX2 && Features.AVX512) {Result = KERNEL_ISA_AVX512;}
+	return Result;
+}
 
-					f32 DistanceToHit = DistanceToHitPos;
-					if((DistanceToHitNeg > Tolerance) && (DistanceToHitNeg < DistanceToHitPos))
-					{
-						DistanceToHit = DistanceToHitNeg;
-					}
+global_variable thread_local u32 ThreadNode;
 
-					if((DistanceToHit > Tolerance) && (DistanceToHit < Result.ClosestHit))
-					{
-						Result.ClosestHit = DistanceToHit;
-						Result.MaterialHit = &Object->Material;
-						Result.HitNormal = NOZ(RayOrigin + Result.ClosestHit*RayDirection - Sphere->Center);
-					}
-				}
-			} break;
+// NOTE: Redeems a ticket from this thread's own node first, then from the
+// others in turn. Holding a ticket means some node still has a tile left,
+// and a node that has run out stays out until the next batch, so one pass
+// always finds it.
+internal u32
+TakeNodeTile(work_queue *WorkQueue)
+{
+	u32 Result = 0;
+	for(u32 NodeOffset = 0;
+		NodeOffset < WorkQueue->NodeCount;
+		++NodeOffset)
+	{
+		work_queue_node *Node = WorkQueue->Nodes + ((ThreadNode + NodeOffset) % WorkQueue->NodeCount);
+		if(Node->NextWorkIndex < Node->OnePastLastWorkIndex)
+		{
+			u32 WorkOrderIndex = LockedAddAndReturnPreviousValue(&Node->NextWorkIndex, 1);
+			if(WorkOrderIndex < Node->OnePastLastWorkIndex)
+			{
+				LockedAddAndReturnPreviousValue(NodeOffset ? &Node->RemoteTiles : &Node->LocalTiles, 1);
+				Result = WorkOrderIndex;
+				break;
+			}
 		}
 	}
+	return Result;
+}
 
+inline u64
+PackWorkRange(u32 NextWorkIndex, u32 OnePastLastWorkIndex)
+{
+	u64 Result = ((u64)OnePastLastWorkIndex << 32) | NextWorkIndex;
 	return Result;
 }
 
-internal v3
-RayCast(world *World, v3 RayOrigin, v3 RayDirection, u32 MaxBounces, volatile u32 *RaysCast)
+// NOTE: Claims NextWorkIndex only while it is still below the end of the
+// range it was read with. The cursor never runs past the end, so a thread
+// that stalls mid-claim can't wake up inside a later batch and take a tile
+// that batch will hand out again.
+internal b32
+TakeWorkIndex(work_queue *WorkQueue, u32 *WorkOrderIndex)
 {
-	v3 Result = {};
-	v3 Attenuation = V3(1.0f, 1.0f, 1.0f);
-	b32 InsideObject = false;
-	u32 RayCount = 0;
+	b32 Result = false;
+	for(;;)
+	{
+		u64 Range = WorkQueue->WorkRange;
+		u32 NextWorkIndex = (u32)Range;
+		u32 OnePastLastWorkIndex = (u32)(Range >> 32);
+		if(NextWorkIndex >= OnePastLastWorkIndex)
+		{
+			break;
+		}
+		if(LockedCompareExchange64(&WorkQueue->WorkRange, Range + 1, Range) == Range)
+		{
+			*WorkOrderIndex = NextWorkIndex;
+			Result = true;
+			break;
+		}
+	}
+	return Result;
+}
 
-	for(u32 BounceIndex = 0;
-		BounceIndex < MaxBounces;
-		++BounceIndex)
+// NOTE: Empties the range, and returns where its cursor stopped: every tile
+// below that is taken, and none above it will be.
+internal u32
+CloseWorkRange(work_queue *WorkQueue)
+{
+	u64 Range;
+	do
 	{
-		++RayCount;
-		ray_cast_result RayCastResult = SingleRayCast(World, RayOrigin, RayDirection);
+		Range = WorkQueue->WorkRange;
+	} while(LockedCompareExchange64(&WorkQueue->WorkRange, PackWorkRange((u32)Range, (u32)Range), Range) != Range);
 
-		f32 ClosestHit = RayCastResult.ClosestHit;
-		material *MaterialHit = RayCastResult.MaterialHit;
-		v3 HitNormal = RayCastResult.HitNormal;
+	u32 Result = (u32)Range;
+	return Result;
+}
+
+// NOTE: Both ends are stored at once, after everything else the batch
+// needs, so a thread that sees the range sees the rest of it too.
+internal void
+PostWorkRange(work_queue *WorkQueue, u32 FirstTile, u32 OnePastLastTile)
+{
+	WorkQueue->TilesCompleted = 0;
+	WorkQueue->RaysCast = 0;
+
+	// TODO: complete previous writes
+	LockedAddAndReturnPreviousValue64(&WorkQueue->WorkRange, 0);
+	WorkQueue->WorkRange = PackWorkRange(FirstTile, OnePastLastTile);
+	WakeWorkerThreads(WorkQueue);
+}
 
-		if(MaterialHit)
+internal void
+RenderTile(work_queue *WorkQueue)
+{
+	u32 WorkOrderIndex;
+	if(TakeWorkIndex(WorkQueue, &WorkOrderIndex))
+	{
+		TIMED_ZONE(ProfileZone_RenderTile);
+		tile_work_order *WorkOrder = WorkQueue->TileWorkQueue + WorkOrderIndex;
+		tile_work_order NodeWorkOrder;
+		if(WorkQueue->SplitByNode)
 		{
-			v3 NewRayOrigin = RayOrigin + ClosestHit*RayDirection;
-			f32 CosIncidentAngle = Inner(-RayDirection, HitNormal);
-			if(CosIncidentAngle < 0.0f) {CosIncidentAngle = -CosIncidentAngle;}
-			v3 PureBounce = RayDirection + 2.0f*CosIncidentAngle*HitNormal;
+			WorkOrderIndex = TakeNodeTile(WorkQueue);
+			WorkOrder = WorkQueue->TileWorkQueue + WorkOrderIndex;
 
-			if(MaterialHit->Transparent)
+			// NOTE: Traced against the scene replica on this thread's node.
+			world *NodeWorld = WorkQueue->Nodes[ThreadNode].World;
+			if(NodeWorld)
 			{
-				f32 RefractionIndexRatio = InsideObject ? MaterialHit->RefractionIndex : 1.0f/MaterialHit->RefractionIndex;
-				f32 Radical = 1.0f - Square(RefractionIndexRatio)*(1.0f - Square(CosIncidentAngle));
-				if(Radical < 0.0f)
-				{
-					// NOTE: Total internal reflection;
-					RayOrigin = NewRayOrigin;
-					RayDirection = PureBounce;
-				}
-				else
-				{
-					v3 Refraction = RefractionIndexRatio*RayDirection +
-						(RefractionIndexRatio*CosIncidentAngle - SquareRoot(Radical))*HitNormal;
-					f32 CosRefractionAngle = Inner(-Refraction, HitNormal);
-					f32 OldRefIndex = InsideObject ? MaterialHit->RefractionIndex : 1.0f;
-					f32 NewRefIndex = InsideObject ? 1.0f : MaterialHit->RefractionIndex;
-					f32 FresnelParallel = Square((NewRefIndex*CosIncidentAngle - OldRefIndex*CosRefractionAngle)/(NewRefIndex*CosIncidentAngle + OldRefIndex*CosRefractionAngle));
-					f32 FresnelPerp = Square((OldRefIndex*CosRefractionAngle - NewRefIndex*CosIncidentAngle)/(OldRefIndex*CosRefractionAngle + NewRefIndex*CosIncidentAngle));
-
-					f32 ReflectRatio = 0.5f*(FresnelParallel + FresnelPerp);
-					b32 Reflected = (RandomUnilateral() < ReflectRatio);
-
-					if(Reflected)
-					{
-						RayOrigin = NewRayOrigin;
-						RayDirection = PureBounce;
-					}
-					else
-					{
-						RayOrigin = NewRayOrigin;
-						RayDirection = Refraction;
-						InsideObject = !InsideObject;
-					}
-				}
+				NodeWorkOrder = *WorkOrder;
+				NodeWorkOrder.World = NodeWorld;
+				WorkOrder = &NodeWorkOrder;
 			}
-			else
+		}
+		f64 Start = Timeline ? GetWallClock() : 0.0;
+		tile_counters Counters;
+		if(CountersEnabled)
+		{
+			BeginTileCounters(&Counters);
+		}
+
+		// NOTE: Rays are counted per tile and added to the queue's total once,
+		// which keeps the kernels off the shared counter.
+		volatile u32 RaysCast = 0;
+		WorkQueue->TileKernel(WorkOrder, WorkQueue->FrameIndex, &RaysCast);
+		LockedAddAndReturnPreviousValue(&WorkQueue->RaysCast, RaysCast);
+
+		if(CountersEnabled)
+		{
+			EndTileCounters(&Counters);
+		}
+		if(Timeline)
+		{
+			RecordTileEvent(Start, GetWallClock(), WorkOrderIndex, RaysCast);
+		}
+
+		WorkQueue->TileWorkQueue[WorkOrderIndex].Finished = true;
+		LockedAddAndReturnPreviousValue(&WorkQueue->TilesCompleted, 1);
+	}
+}
+
+// NOTE: Gives each node a contiguous run of the batch, sized by its share of
+// the pool. The queue is in Hilbert order, so each run is a compact patch.
+internal void
+SplitTilesByNode(work_queue *WorkQueue, u32 FirstTile, u32 OnePastLastTile)
+{
+	u32 TileCount = OnePastLastTile - FirstTile;
+	u32 PoolSize = WorkQueue->ThreadCount + 1;
+	u32 ThreadsBefore = 0;
+	for(u32 NodeIndex = 0;
+		NodeIndex < WorkQueue->NodeCount;
+		++NodeIndex)
+	{
+		work_queue_node *Node = WorkQueue->Nodes + NodeIndex;
+		Node->NextWorkIndex = FirstTile + (TileCount*ThreadsBefore) / PoolSize;
+		ThreadsBefore += Node->ThreadCount;
+		Node->OnePastLastWorkIndex = FirstTile + (TileCount*ThreadsBefore) / PoolSize;
+	}
+}
+
+internal void
+RenderTiles(work_queue *WorkQueue, u32 FirstTile, u32 OnePastLastTile, b32 ShowProgress)
+{
+	WorkQueue->SplitByNode = (WorkQueue->NodeCount > 1);
+	if(WorkQueue->SplitByNode)
+	{
+		SplitTilesByNode(WorkQueue, FirstTile, OnePastLastTile);
+	}
+	PostWorkRange(WorkQueue, FirstTile, OnePastLastTile);
+
+	u32 TileCount = OnePastLastTile - FirstTile;
+	while(WorkQueue->TilesCompleted < TileCount)
+	{
+		RenderTile(WorkQueue);
+
+		if(ShowProgress)
+		{
+			u32 Progress = WorkQueue->TilesCompleted;
+			printf("\rRaycasting... %d%%", (u32)((100.0f*(Progress)) / TileCount));
+			fflush(stdout);
+		}
+	}
+}
+
+// NOTE: Like RenderTiles, but stops handing out tiles once the wall clock
+// passes Deadline and waits only for the ones already taken. Tiles go out in
+// order, so the rendered ones are always FirstTile up to the returned index.
+// At least one tile is always rendered, however tight the deadline.
+internal u32
+RenderTilesUntil(work_queue *WorkQueue, u32 FirstTile, u32 OnePastLastTile, f64 Deadline)
+{
+	// NOTE: Tiles have to go out in order here, so the queue isn't split by
+	// node.
+	WorkQueue->SplitByNode = false;
+	PostWorkRange(WorkQueue, FirstTile, OnePastLastTile);
+
+	// NOTE: The main thread is the one that has to call time, so it only
+	// starts tiles it expects to finish before the deadline.
+	f64 MainTileSeconds = 0.0;
+	u32 TileCount = OnePastLastTile - FirstTile;
+	while(WorkQueue->TilesCompleted < TileCount)
+	{
+		f64 Now = GetWallClock();
+		b32 AnyTaken = (WorkQueue->NextWorkIndex > FirstTile);
+		if(!AnyTaken || ((Now + MainTileSeconds) < Deadline))
+		{
+			RenderTile(WorkQueue);
+			MainTileSeconds = Maximum(MainTileSeconds, GetWallClock() - Now);
+		}
+		else if(Now >= Deadline)
+		{
+			// NOTE: Closing the range makes every later grab fail; whatever
+			// was taken before it closed is already being rendered.
+			TileCount = CloseWorkRange(WorkQueue) - FirstTile;
+			while(WorkQueue->TilesCompleted < TileCount)
 			{
-				Attenuation = Hadamard(Attenuation, CosIncidentAngle*MaterialHit->ReflectionColor);
-
-				// NOTE: Shadow ray
-				++RayCount;
-				v3 RandomDirection = NOZ(V3(RandomBilateral(), RandomBilateral(), RandomBilateral()));
-				v3 LightDirection = NOZ(-World->LightDirection + 0.1f*RandomDirection);
-				ray_cast_result ShadowRayCast = SingleRayCast(World, NewRayOrigin, LightDirection);
-				if(!ShadowRayCast.MaterialHit)
-				{
-					Result += Hadamard(Attenuation, World->LightColor);
-				}
-				Result += Hadamard(Attenuation, MaterialHit->EmitColor);
-
-				RayOrigin = NewRayOrigin;
-				v3 RandomBounce = NOZ(V3(RandomBilateral(), RandomBilateral(), RandomBilateral()));
-				if(Inner(RandomBounce, HitNormal) < 0)
-				{
-					RandomBounce = -RandomBounce;
-				}
-				RayDirection = NOZ(Lerp(RandomBounce, MaterialHit->Specularity, PureBounce));
+				SleepMS(0);
 			}
 		}
 		else
 		{
-			Result += Hadamard(Attenuation, World->NullMaterial.EmitColor);
-			break;
+			SleepMS(0);
 		}
 	}
 
-	Clamp01(Result.r);
-	Clamp01(Result.g);
-	Clamp01(Result.b);
+	u32 Result = FirstTile + TileCount;
+	return Result;
+}
+
+internal void
+RenderFrame(work_queue *WorkQueue, b32 ShowProgress)
+{
+	RenderTiles(WorkQueue, 0, WorkQueue->TileQueueSize, ShowProgress);
+}
+
+// NOTE: The seed rand() starts from in a fresh process. Scenes scatter their
+// objects with RandomUnilateral, so BuildScene starts each one from here, and
+// the server, workers, NUMA replicas and regress all build the scene main
+// does, whatever ran before.
+#define SCENE_SEED 1
 
-	LockedAddAndReturnPreviousValue(RaysCast, RayCount);
+internal void
+BuildScene(world *World, memory_arena *SceneArena, char *SceneName, u32 Width, u32 Height)
+{
+	srand(SCENE_SEED);
+	if(strcmp(SceneName, "forest") == 0)
+	{
+		BuildForestScene(World, SceneArena, Width, Height);
+	}
+	else if(strcmp(SceneName, "swarm") == 0)
+	{
+		BuildSwarmScene(World, SceneArena, Width, Height);
+	}
+	else if(strcmp(SceneName, "beacon") == 0)
+	{
+		BuildBeaconScene(World, SceneArena, Width, Height);
+	}
+	else if(strncmp(SceneName, "lanterns", 8) == 0)
+	{
+		// NOTE: "lanterns-N" asks for N lights.
+		u32 LightCount = LANTERNS_DEFAULT_LIGHT_COUNT;
+		if((SceneName[8] == '-') && (atoi(SceneName + 9) > 0))
+		{
+			LightCount = atoi(SceneName + 9);
+		}
+		BuildLanternsScene(World, SceneArena, LightCount, Width, Height);
+	}
+	else
+	{
+		BuildSpheresScene(World, SceneArena, Width, Height);
+	}
 
+	FindEmitters(World);
+}
+
+// NOTE: Column edges are rounded to whole cache lines of pixels, so two
+// tiles never write the same line of a row, as long as the tiles are at
+// least a line wide. Widths then differ by up to a line between columns.
+inline u32
+GetTileColumnEdge(u32 ImageWidth, u32 TileDim, u32 TileX)
+{
+	u32 Result = (TileX*ImageWidth) / TileDim;
+	if((ImageWidth / TileDim) >= IMAGE_ROW_ALIGNMENT_PIXELS)
+	{
+		u32 Aligned = AlignPow2(Result, IMAGE_ROW_ALIGNMENT_PIXELS);
+		Result = Minimum(Aligned, ImageWidth);
+	}
 	return Result;
 }
 
-inline u32 *
-GetPixelPointer(image *Image, u32 X, u32 Y)
+inline u32
+GetMaxTileWidth(u32 ImageWidth, u32 TileDim)
 {
-	u32 *Result = Image->Pixels + Y*Image->Width + X;
+	u32 Result = (ImageWidth + TileDim - 1) / TileDim + IMAGE_ROW_ALIGNMENT_PIXELS;
+	return Result;
+}
+
+// NOTE: The cell a distance along the Hilbert curve reaches, on a Side x
+// Side grid with Side a power of two.
+internal v2i
+GetHilbertCell(u32 Side, u32 Distance)
+{
+	u32 X = 0;
+	u32 Y = 0;
+	for(u32 SubSide = 1;
+		SubSide < Side;
+		SubSide *= 2)
+	{
+		u32 RightHalf = 1 & (Distance / 2);
+		u32 TopHalf = 1 & (Distance ^ RightHalf);
+		if(!TopHalf)
+		{
+			if(RightHalf)
+			{
+				X = SubSide - 1 - X;
+				Y = SubSide - 1 - Y;
+			}
+			u32 Swap = X;
+			X = Y;
+			Y = Swap;
+		}
+		X += SubSide*RightHalf;
+		Y += SubSide*TopHalf;
+		Distance /= 4;
+	}
+
+	v2i Result = V2i(X, Y);
 	return Result;
 }
 
 internal void
-RenderTile(work_queue *WorkQueue)
+BuildTileWorkOrders(work_queue *WorkQueue, image *Image, world *World, u32 TileDim,
+                    u32 RaysPerPixel, u32 MaxBounces, u32 LaneWidth)
 {
-	u32 WorkOrderIndex = LockedAddAndReturnPreviousValue(&WorkQueue->NextWorkIndex, 1);
-	if(WorkOrderIndex < WorkQueue->TileQueueSize)
+	// NOTE: Workers in a distributed render rebuild this from the job
+	// description, so the layout must depend on nothing else.
+	u32 TileHeight = (Image->Height + TileDim - 1) / TileDim;
+
+	// NOTE: Tiles are queued along a Hilbert curve, so the ones handed out
+	// around the same time are neighbours and share scene data, and any run
+	// of the queue covers a compact patch of the image. Grids that aren't a
+	// power of two walk the next one up and skip the cells off the edge.
+	u32 Side = 1;
+	while(Side < TileDim)
 	{
-		tile_work_order *WorkOrder = WorkQueue->TileWorkQueue + WorkOrderIndex;
-		world *World = WorkOrder->World;
-		image *Image = WorkOrder->Image;
-		u32 MinX = WorkOrder->MinX;
-		u32 MinY = WorkOrder->MinY;
-		u32 OnePastMaxX = WorkOrder->OnePastMaxX;
-		u32 OnePastMaxY= WorkOrder->OnePastMaxY;
-		u32 RaysPerPixel = WorkOrder->RaysPerPixel;
-
-		for(u32 Y = MinY;
-			Y < OnePastMaxY;
-			++Y)
+		Side *= 2;
+	}
+
+	WorkQueue->TileQueueSize = 0;
+	for(u32 Distance = 0;
+		Distance < Side*Side;
+		++Distance)
+	{
+		v2i Cell = GetHilbertCell(Side, Distance);
+		u32 TileX = (u32)Cell.x;
+		u32 TileY = (u32)Cell.y;
+		if((TileX < TileDim) && (TileY < TileDim))
 		{
-			u32 *Dest = GetPixelPointer(Image, MinX, Y);
+			tile_work_order *Work = WorkQueue->TileWorkQueue + WorkQueue->TileQueueSize++;
+			Work->Image = Image;
+			Work->World = World;
+			Work->MinX = GetTileColumnEdge(Image->Width, TileDim, TileX);
+			Work->OnePastMaxX = GetTileColumnEdge(Image->Width, TileDim, TileX + 1);
+			Work->MinY = Minimum(TileY*TileHeight, Image->Height);
+			Work->OnePastMaxY = Minimum(Work->MinY + TileHeight, Image->Height);
+			Work->FirstSample = 0;
+			Work->RaysPerPixel = RaysPerPixel;
+			Work->MaxBounces = MaxBounces;
+			Work->LaneWidth = LaneWidth;
+			Work->Finished = false;
+		}
+	}
+}
 
-			for(u32 X = MinX;
-				X < OnePastMaxX;
+internal TILE_KERNEL(PrefaultTileKernel)
+{
+	image *Image = WorkOrder->Image;
+	u32 Width = WorkOrder->OnePastMaxX - WorkOrder->MinX;
+	for(u32 Y = WorkOrder->MinY;
+		Y < WorkOrder->OnePastMaxY;
+		++Y)
+	{
+		memset(GetPixelPointer(Image, WorkOrder->MinX, Y), 0, Width*sizeof(u32));
+		if(Image->Radiance)
+		{
+			for(u32 X = WorkOrder->MinX;
+				X < WorkOrder->OnePastMaxX;
 				++X)
 			{
-				v3 Color = {};
-				f32 Contrib = 1.0f/RaysPerPixel;
+				Image->Radiance[GetRadianceIndex(Image, X, Y)] = V3(0, 0, 0);
+			}
+		}
+	}
+}
 
-				for(u32 RayIndex = 0;
-					RayIndex < RaysPerPixel;
-					++RayIndex)
-				{
-					f32 XRatio = -1.0f + 2.0f*((((f32)X) + 0.5f*RandomBilateral())/(f32)Image->Width);
-					f32 YRatio = -1.0f + 2.0f*((((f32)Y) + 0.5f*RandomBilateral())/(f32)Image->Height);
-					v3 FilmPoint = World->FilmP + XRatio*World->HalfFilmW*World->CameraX + YRatio*World->HalfFilmH*World->CameraY;
+// NOTE: Freshly mapped pages are backed on first write, by the node of the
+// thread that writes them. Running a clearing pass through the pool gives
+// every tile its pages up front, from a thread that will be rendering into
+// them, instead of taking the faults in the middle of the first frame.
+internal void
+PrefaultImage(work_queue *WorkQueue)
+{
+	tile_kernel *TileKernel = WorkQueue->TileKernel;
+	WorkQueue->TileKernel = PrefaultTileKernel;
+	RenderTiles(WorkQueue, 0, WorkQueue->TileQueueSize, false);
+	WorkQueue->TileKernel = TileKernel;
+
+	for(u32 NodeIndex = 0;
+		NodeIndex < WorkQueue->NodeCount;
+		++NodeIndex)
+	{
+		WorkQueue->Nodes[NodeIndex].LocalTiles = 0;
+		WorkQueue->Nodes[NodeIndex].RemoteTiles = 0;
+	}
+}
 
-					v3 RayOrigin = World->CameraP;
-					v3 RayDirection = NOZ(FilmPoint - RayOrigin);
+// NOTE: Traces a pass of caustic photons through the thread pool, the same
+// way PrefaultImage runs its pass, seeded from the queue's frame index.
+internal void
+BuildCausticMap(work_queue *WorkQueue, world *World, tile_kernel *CausticKernel)
+{
+	caustic_map *Map = World->Caustics;
+	for(u32 NodeIndex = 0;
+		NodeIndex < WorkQueue->NodeCount;
+		++NodeIndex)
+	{
+		WorkQueue->Nodes[NodeIndex].World->Caustics = Map;
+	}
 
-					Color += Contrib*RayCast(World, RayOrigin, RayDirection, WorkOrder->MaxBounces, &WorkQueue->RaysCast);
-				}
+	Map->NextBatch = 0;
+	tile_kernel *TileKernel = WorkQueue->TileKernel;
+	WorkQueue->TileKernel = CausticKernel;
+	RenderTiles(WorkQueue, 0, WorkQueue->TileQueueSize, false);
+	WorkQueue->TileKernel = TileKernel;
 
-				*Dest++ = PackLinear01ToSRGBU32(Color);
-			}
-		}
+	SortCausticPhotons(Map);
+}
 
-		LockedAddAndReturnPreviousValue(&WorkQueue->TilesCompleted, 1);
+// NOTE: Empties the radiance cache and runs its fill pass through the
+// thread pool, like BuildCausticMap. The fill traces the first samples of
+// the queue's frame index, which that frame then skips.
+internal void
+BuildRadianceCache(work_queue *WorkQueue, world *World, tile_kernel *FillKernel)
+{
+	radiance_cache *Cache = World->RadianceCache;
+	for(u32 NodeIndex = 0;
+		NodeIndex < WorkQueue->NodeCount;
+		++NodeIndex)
+	{
+		WorkQueue->Nodes[NodeIndex].World->RadianceCache = Cache;
 	}
+
+	ClearRadianceCache(Cache);
+	Cache->FillFrameIndex = WorkQueue->FrameIndex;
+	Cache->Filling = true;
+	tile_kernel *TileKernel = WorkQueue->TileKernel;
+	WorkQueue->TileKernel = FillKernel;
+	RenderTiles(WorkQueue, 0, WorkQueue->TileQueueSize, false);
+	WorkQueue->TileKernel = TileKernel;
+	Cache->Filling = false;
 }
 
+#include "ray_numa.cpp"
+
+#include "ray_distributed.cpp"
+#include "ray_server.cpp"
+#include "ray_preview.cpp"
+#include "ray_deadline.cpp"
+#include "ray_regress.cpp"
+#include "ray_convergence.cpp"
+
 s32 main(s32 ArgumentCount, char **Arguments)
 {
-	printf("Raycasting...");
-	fflush(stdout);
+	// NOTE: A -deadline counts from here, so setup comes out of the budget too.
+	f64 JobStart = GetWallClock();
 
-	// image Image = AllocateImage(640, 480);
-	image Image = AllocateImage(1280, 720);
+	u32 ImageWidth = 1280;
+	u32 ImageHeight = 720;
 	u32 RaysPerPixel = 64;
 	u32 MaxBounces = 8;
 
-	world World = {};
+	char *SceneName = "spheres";
+	u32 FrameCount = 1;
+	f32 FrameDeltaTime = 1.0f/30.0f;
+	f32 RebuildThreshold = 1.5f;
+	u32 LaneWidth = LANE_WIDTH;
+	char *KernelISAName = 0;
+	u32 TileDim = 8;
+	u32 ThreadCount = 3;
 
-	World.NullMaterial.EmitColor = V3(0.1f, 0.1f, 0.1f);
-	World.LightDirection = NOZ(V3(1.0f, -1.0f, -1.0f));
-	World.LightColor = V3(0.7f, 0.7f, 0.7f);
-
-	object *Plane = World.Objects + World.ObjectCount++;
-	Plane->Type = Object_Plane;
-	Plane->Plane.Normal = V3(0.0f, 1.0f, 0.0f);
-	Plane->Plane.Offset = 0.0f;
-	Plane->Material.ReflectionColor = V3(0.1f, 0.1f, 0.1f);
-	Plane->Material.Specularity = 0.05f;
-
-	f32 Radius = 1.0f;
-	v3 Start = V3(-4.0f, 1.0f, -4.0f);
-	v3 End = V3(4.0f, 1.0f, 4.0f);
-	u32 Rows = 3;
-	u32 Columns = 4;
-	u32 SphereCount = Rows*Columns;
-	f32 dX = (End.x - Start.x) / (Columns - 1);
-	f32 dZ = (End.z - Start.z) / (Rows - 1);
-
-	u32 Index = 0;
-	for(u32 Z = 0;
-		Z < Rows;
-		++Z)
-	{
-		for(u32 X = 0;
-			X < Columns;
-			++X)
-		{
-			f32 T = (f32)Index/(SphereCount - 1);
-
-			object *Sphere = World.Objects + World.ObjectCount++;
-			Sphere->Type = Object_Sphere;
-			Sphere->Sphere.Center = Start + V3(X*dX, 0.0f, Z*dZ);
-			Sphere->Sphere.Radius = Radius;
-			Sphere->Material.ReflectionColor = Lerp(V3(0.9f, 0.1f, 0.1f), T, V3(0.5f, 0.5f, 0.1f));
-			Sphere->Material.Specularity = Lerp(1.0f, T, 0.00f);
-
-			if(Z == 1 && X == 2)
-			{
-				Sphere->Sphere.Center.y += 0.6f;
-				Sphere->Material.ReflectionColor = V3(0.1f, 0.1f, 0.6f);
-				Sphere->Material.Specularity = 1.0f;
-				Sphere->Material.Transparent = true;
-				Sphere->Material.RefractionIndex = 1.52f; // NOTE: Glass
-			}
-			if(Z == 1 && X == 1)
+	char *WorkerAddress = 0;
+	b32 Distributed = false;
+	u32 LocalWorkerCount = 0;
+	u16 ListenPort = 0;
+	u32 TileFormat = TileFormat_SRGB8;
+	u32 RangeSize = 2;
+	f64 WorkerTimeout = 30.0;
+	u32 TestWorkerExitAfter = 0;
+
+	b32 Serve = false;
+	u16 ServePort = 0;
+	b32 Client = false;
+	u16 ClientPort = 0;
+	u32 RequestCount = 1;
+	b32 ShutdownServer = false;
+	b32 HasCamera = false;
+	v3 CameraP = {};
+	v3 CameraLookAt = {};
+
+	b32 Preview = false;
+	b32 PreviewSnapshot = false;
+	f64 PreviewBudgetMS = 50.0;
+	u32 PreviewOrbitEvery = 0;
+	char *PreviewName = "ray_preview";
+	b32 FrameCountGiven = false;
+
+	f64 DeadlineMS = 0.0;
+	u32 RadianceLayout = RadianceLayout_Linear;
+	b32 RaysPerPixelGiven = false;
+	char *TraceFilename = 0;
+	b32 Counters = false;
+	b32 NUMA = false;
+	u32 NUMASplitNodeCount = 0;
+
+	b32 Regress = false;
+	b32 RegressUpdate = false;
+	char *RegressDirectory = ".";
+	char *RegressLogFilename = 0;
+	b32 Microbench = false;
+	u32 ConvergenceMaxSamples = 0;
+	u32 ConvergenceReferenceSamples = 1024;
+	char *ConvergenceCSVFilename = 0;
+	u32 CausticPhotons = 0;
+	f32 CausticRadius = CAUSTIC_DEFAULT_RADIUS;
+	u32 RadianceCacheBounce = 0;
+	f32 RadianceCacheCellDim = RADIANCE_CACHE_DEFAULT_CELL_DIM;
+	u32 RadianceCacheMinSamples = RADIANCE_CACHE_DEFAULT_MIN_SAMPLES;
+	u32 RadianceCacheFillSamples = RADIANCE_CACHE_DEFAULT_FILL_SAMPLES;
+	clock_t RadianceCacheTicks = 0;
+	f64 RadianceCacheSeconds = 0.0;
+	u64 RadianceCacheRaysCast = 0;
+	char *EnvironmentFilename = 0;
+	for(s32 ArgumentIndex = 1;
+		ArgumentIndex < ArgumentCount;
+		++ArgumentIndex)
+	{
+		if((strcmp(Arguments[ArgumentIndex], "-scene") == 0) &&
+		   (ArgumentIndex + 1 < ArgumentCount))
+		{
+			SceneName = Arguments[++ArgumentIndex];
+		}
+		else if((strcmp(Arguments[ArgumentIndex], "-size") == 0) &&
+		        (ArgumentIndex + 2 < ArgumentCount))
+		{
+			s32 Width = atoi(Arguments[++ArgumentIndex]);
+			s32 Height = atoi(Arguments[++ArgumentIndex]);
+			ImageWidth = (u32)Maximum(Width, 1);
+			ImageHeight = (u32)Maximum(Height, 1);
+		}
+		else if((strcmp(Arguments[ArgumentIndex], "-spp") == 0) &&
+		        (ArgumentIndex + 1 < ArgumentCount))
+		{
+			s32 Samples = atoi(Arguments[++ArgumentIndex]);
+			RaysPerPixel = (u32)Maximum(Samples, 1);
+			RaysPerPixelGiven = true;
+		}
+		else if((strcmp(Arguments[ArgumentIndex], "-frames") == 0) &&
+		        (ArgumentIndex + 1 < ArgumentCount))
+		{
+			s32 Frames = atoi(Arguments[++ArgumentIndex]);
+			FrameCount = (u32)Maximum(Frames, 1);
+			FrameCountGiven = true;
+		}
+		else if((strcmp(Arguments[ArgumentIndex], "-rebuild-threshold") == 0) &&
+		        (ArgumentIndex + 1 < ArgumentCount))
+		{
+			RebuildThreshold = (f32)atof(Arguments[++ArgumentIndex]);
+		}
+		else if((strcmp(Arguments[ArgumentIndex], "-lanes") == 0) &&
+		        (ArgumentIndex + 1 < ArgumentCount))
+		{
+			// NOTE: 1 traces one path per call, anything else packs
+			// LANE_WIDTH paths together.
+			LaneWidth = (atoi(Arguments[++ArgumentIndex]) == 1) ? 1 : LANE_WIDTH;
+		}
+		else if((strcmp(Arguments[ArgumentIndex], "-isa") == 0) &&
+		        (ArgumentIndex + 1 < ArgumentCount))
+		{
+			KernelISAName = Arguments[++ArgumentIndex];
+		}
+		else if((strcmp(Arguments[ArgumentIndex], "-threads") == 0) &&
+		        (ArgumentIndex + 1 < ArgumentCount))
+		{
+			// NOTE: Helper threads; the main thread renders as well.
+			s32 Threads = atoi(Arguments[++ArgumentIndex]);
+			ThreadCount = (u32)Maximum(Threads, 0);
+		}
+		else if((strcmp(Arguments[ArgumentIndex], "-tiles") == 0) &&
+		        (ArgumentIndex + 1 < ArgumentCount))
+		{
+			s32 Tiles = atoi(Arguments[++ArgumentIndex]);
+			TileDim = (u32)Maximum(Minimum(Tiles, MAX_TILE_DIM), 1);
+		}
+		else if((strcmp(Arguments[ArgumentIndex], "-worker") == 0) &&
+		        (ArgumentIndex + 1 < ArgumentCount))
+		{
+			WorkerAddress = Arguments[++ArgumentIndex];
+		}
+		else if((strcmp(Arguments[ArgumentIndex], "-distribute") == 0) &&
+		        (ArgumentIndex + 1 < ArgumentCount))
+		{
+			s32 Workers = atoi(Arguments[++ArgumentIndex]);
+			LocalWorkerCount = (u32)Maximum(Minimum(Workers, MAX_DISTRIBUTED_WORKERS), 0);
+			Distributed = true;
+		}
+		else if((strcmp(Arguments[ArgumentIndex], "-listen") == 0) &&
+		        (ArgumentIndex + 1 < ArgumentCount))
+		{
+			ListenPort = (u16)atoi(Arguments[++ArgumentIndex]);
+			Distributed = true;
+		}
+		else if((strcmp(Arguments[ArgumentIndex], "-tile-format") == 0) &&
+		        (ArgumentIndex + 1 < ArgumentCount))
+		{
+			TileFormat = (strcmp(Arguments[++ArgumentIndex], "half") == 0) ? TileFormat_Half : TileFormat_SRGB8;
+		}
+		else if((strcmp(Arguments[ArgumentIndex], "-range-size") == 0) &&
+		        (ArgumentIndex + 1 < ArgumentCount))
+		{
+			s32 Tiles = atoi(Arguments[++ArgumentIndex]);
+			RangeSize = (u32)Maximum(Tiles, 1);
+		}
+		else if((strcmp(Arguments[ArgumentIndex], "-worker-timeout") == 0) &&
+		        (ArgumentIndex + 1 < ArgumentCount))
+		{
+			WorkerTimeout = atof(Arguments[++ArgumentIndex]);
+		}
+		else if((strcmp(Arguments[ArgumentIndex], "-test-worker-exit") == 0) &&
+		        (ArgumentIndex + 1 < ArgumentCount))
+		{
+			// NOTE: Makes a worker quit after this many ranges, or the first
+			// local worker when given to a coordinator.
+			s32 Ranges = atoi(Arguments[++ArgumentIndex]);
+			TestWorkerExitAfter = (u32)Maximum(Ranges, 0);
+		}
+		else if((strcmp(Arguments[ArgumentIndex], "-serve") == 0) &&
+		        (ArgumentIndex + 1 < ArgumentCount))
+		{
+			ServePort = (u16)atoi(Arguments[++ArgumentIndex]);
+			Serve = true;
+		}
+		else if((strcmp(Arguments[ArgumentIndex], "-client") == 0) &&
+		        (ArgumentIndex + 1 < ArgumentCount))
+		{
+			ClientPort = (u16)atoi(Arguments[++ArgumentIndex]);
+			Client = true;
+		}
+		else if((strcmp(Arguments[ArgumentIndex], "-requests") == 0) &&
+		        (ArgumentIndex + 1 < ArgumentCount))
+		{
+			s32 Requests = atoi(Arguments[++ArgumentIndex]);
+			RequestCount = (u32)Maximum(Requests, 1);
+		}
+		else if(strcmp(Arguments[ArgumentIndex], "-shutdown-server") == 0)
+		{
+			ShutdownServer = true;
+		}
+		else if((strcmp(Arguments[ArgumentIndex], "-camera") == 0) &&
+		        (ArgumentIndex + 6 < ArgumentCount))
+		{
+			// NOTE: Position, then the point to look at.
+			CameraP.x = (f32)atof(Arguments[++ArgumentIndex]);
+			CameraP.y = (f32)atof(Arguments[++ArgumentIndex]);
+			CameraP.z = (f32)atof(Arguments[++ArgumentIndex]);
+			CameraLookAt.x = (f32)atof(Arguments[++ArgumentIndex]);
+			CameraLookAt.y = (f32)atof(Arguments[++ArgumentIndex]);
+			CameraLookAt.z = (f32)atof(Arguments[++ArgumentIndex]);
+			HasCamera = true;
+		}
+		else if(strcmp(Arguments[ArgumentIndex], "-preview") == 0)
+		{
+			Preview = true;
+		}
+		else if((strcmp(Arguments[ArgumentIndex], "-budget") == 0) &&
+		        (ArgumentIndex + 1 < ArgumentCount))
+		{
+			f64 Budget = atof(Arguments[++ArgumentIndex]);
+			PreviewBudgetMS = Maximum(Budget, 1.0);
+		}
+		else if((strcmp(Arguments[ArgumentIndex], "-preview-orbit") == 0) &&
+		        (ArgumentIndex + 1 < ArgumentCount))
+		{
+			// NOTE: Moves the camera every this many frames, standing in for
+			// a user dragging it around.
+			s32 Frames = atoi(Arguments[++ArgumentIndex]);
+			PreviewOrbitEvery = (u32)Maximum(Frames, 0);
+		}
+		else if((strcmp(Arguments[ArgumentIndex], "-preview-name") == 0) &&
+		        (ArgumentIndex + 1 < ArgumentCount))
+		{
+			PreviewName = Arguments[++ArgumentIndex];
+		}
+		else if(strcmp(Arguments[ArgumentIndex], "-preview-snapshot") == 0)
+		{
+			PreviewSnapshot = true;
+		}
+		else if((strcmp(Arguments[ArgumentIndex], "-deadline") == 0) &&
+		        (ArgumentIndex + 1 < ArgumentCount))
+		{
+			f64 Deadline = atof(Arguments[++ArgumentIndex]);
+			DeadlineMS = Maximum(Deadline, 0.0);
+		}
+		else if((strcmp(Arguments[ArgumentIndex], "-radiance-layout") == 0) &&
+		        (ArgumentIndex + 1 < ArgumentCount))
+		{
+			// NOTE: Only the deadline render accumulates radiance locally.
+			RadianceLayout = (strcmp(Arguments[++ArgumentIndex], "blocked") == 0) ?
+				RadianceLayout_Blocked : RadianceLayout_Linear;
+		}
+		else if((strcmp(Arguments[ArgumentIndex], "-trace") == 0) &&
+		        (ArgumentIndex + 1 < ArgumentCount))
+		{
+			TraceFilename = Arguments[++ArgumentIndex];
+		}
+		else if(strcmp(Arguments[ArgumentIndex], "-counters") == 0)
+		{
+			Counters = true;
+		}
+		else if(strcmp(Arguments[ArgumentIndex], "-numa") == 0)
+		{
+			NUMA = true;
+		}
+		else if((strcmp(Arguments[ArgumentIndex], "-numa-nodes") == 0) &&
+		        (ArgumentIndex + 1 < ArgumentCount))
+		{
+			// NOTE: Pretends the machine has this many nodes, for trying
+			// -numa out on one that doesn't.
+			s32 Nodes = atoi(Arguments[++ArgumentIndex]);
+			NUMASplitNodeCount = (u32)Maximum(Nodes, 1);
+			NUMA = true;
+		}
+		else if(strcmp(Arguments[ArgumentIndex], "-regress") == 0)
+		{
+			Regress = true;
+		}
+		else if(strcmp(Arguments[ArgumentIndex], "-regress-update") == 0)
+		{
+			Regress = true;
+			RegressUpdate = true;
+		}
+		else if((strcmp(Arguments[ArgumentIndex], "-regress-dir") == 0) &&
+		        (ArgumentIndex + 1 < ArgumentCount))
+		{
+			// NOTE: Where the reference paths start from: the repo's root.
+			RegressDirectory = Arguments[++ArgumentIndex];
+		}
+		else if((strcmp(Arguments[ArgumentIndex], "-regress-log") == 0) &&
+		        (ArgumentIndex + 1 < ArgumentCount))
+		{
+			RegressLogFilename = Arguments[++ArgumentIndex];
+		}
+		else if(strcmp(Arguments[ArgumentIndex], "-microbench") == 0)
+		{
+			Microbench = true;
+		}
+		else if((strcmp(Arguments[ArgumentIndex], "-convergence") == 0) &&
+		        (ArgumentIndex + 1 < ArgumentCount))
+		{
+			s32 Samples = atoi(Arguments[++ArgumentIndex]);
+			ConvergenceMaxSamples = (u32)Maximum(Samples, 1);
+		}
+		else if((strcmp(Arguments[ArgumentIndex], "-convergence-reference") == 0) &&
+		        (ArgumentIndex + 1 < ArgumentCount))
+		{
+			s32 Samples = atoi(Arguments[++ArgumentIndex]);
+			ConvergenceReferenceSamples = (u32)Maximum(Samples, 1);
+		}
+		else if((strcmp(Arguments[ArgumentIndex], "-convergence-csv") == 0) &&
+		        (ArgumentIndex + 1 < ArgumentCount))
+		{
+			ConvergenceCSVFilename = Arguments[++ArgumentIndex];
+		}
+		else if((strcmp(Arguments[ArgumentIndex], "-caustics") == 0) &&
+		        (ArgumentIndex + 1 < ArgumentCount))
+		{
+			// NOTE: Photons traced per frame; see ray_caustics.cpp.
+			s32 Photons = atoi(Arguments[++ArgumentIndex]);
+			CausticPhotons = (u32)Maximum(Photons, 0);
+		}
+		else if((strcmp(Arguments[ArgumentIndex], "-caustic-radius") == 0) &&
+		        (ArgumentIndex + 1 < ArgumentCount))
+		{
+			f32 Radius = (f32)atof(Arguments[++ArgumentIndex]);
+			CausticRadius = Maximum(Radius, 0.001f);
+		}
+		else if((strcmp(Arguments[ArgumentIndex], "-radiance-cache") == 0) &&
+		        (ArgumentIndex + 1 < ArgumentCount))
+		{
+			// NOTE: Matte bounces a path takes before it may stop at the
+			// cache; see ray_radiance_cache.cpp.
+			s32 Bounces = atoi(Arguments[++ArgumentIndex]);
+			RadianceCacheBounce = (u32)Maximum(Bounces, 0);
+		}
+		else if((strcmp(Arguments[ArgumentIndex], "-radiance-cache-cell") == 0) &&
+		        (ArgumentIndex + 1 < ArgumentCount))
+		{
+			f32 CellDim = (f32)atof(Arguments[++ArgumentIndex]);
+			RadianceCacheCellDim = Maximum(CellDim, 0.001f);
+		}
+		else if((strcmp(Arguments[ArgumentIndex], "-radiance-cache-min") == 0) &&
+		        (ArgumentIndex + 1 < ArgumentCount))
+		{
+			s32 Samples = atoi(Arguments[++ArgumentIndex]);
+			RadianceCacheMinSamples = (u32)Maximum(Samples, 1);
+		}
+		else if((strcmp(Arguments[ArgumentIndex], "-radiance-cache-fill") == 0) &&
+		        (ArgumentIndex + 1 < ArgumentCount))
+		{
+			s32 Samples = atoi(Arguments[++ArgumentIndex]);
+			RadianceCacheFillSamples = (u32)Maximum(Samples, 1);
+		}
+		else if((strcmp(Arguments[ArgumentIndex], "-environment") == 0) &&
+		        (ArgumentIndex + 1 < ArgumentCount))
+		{
+			// NOTE: An equirectangular PFM; see ray_environment.cpp.
+			EnvironmentFilename = Arguments[++ArgumentIndex];
+		}
+	}
+
+	if(WorkerAddress)
+	{
+		s32 Result = RunWorker(WorkerAddress, ThreadCount, TestWorkerExitAfter);
+		return Result;
+	}
+
+	if(PreviewSnapshot)
+	{
+		s32 Result = SnapshotPreview(PreviewName, "preview.bmp");
+		return Result;
+	}
+
+	if(Client)
+	{
+		render_request_message Request = {};
+		snprintf(Request.SceneName, sizeof(Request.SceneName), "%s", SceneName);
+		Request.Width = ImageWidth;
+		Request.Height = ImageHeight;
+		Request.TileDim = TileDim;
+		Request.RaysPerPixel = RaysPerPixel;
+		Request.MaxBounces = MaxBounces;
+		Request.TileFormat = TileFormat;
+		if(HasCamera)
+		{
+			world Camera = {};
+			InitializeCamera(&Camera, CameraP, CameraLookAt, ImageWidth, ImageHeight);
+			Request.HasCamera = true;
+			Request.CameraP = Camera.CameraP;
+			Request.CameraX = Camera.CameraX;
+			Request.CameraY = Camera.CameraY;
+			Request.CameraZ = Camera.CameraZ;
+		}
+
+		s32 Result = RunServerClient(ClientPort, &Request, RequestCount, ShutdownServer);
+		return Result;
+	}
+
+	u32 SupportedISA = GetSupportedKernelISA();
+	u32 KernelISA = SupportedISA;
+	if(KernelISAName)
+	{
+		u32 RequestedISA = KERNEL_ISA_COUNT;
+		for(u32 ISAIndex = 0;
+			ISAIndex < KERNEL_ISA_COUNT;
+			++ISAIndex)
+		{
+			if(strcmp(KernelISAName, KernelISANames[ISAIndex]) == 0)
 			{
-				Sphere->Material.EmitColor = 2.0f*Sphere->Material.ReflectionColor;
+				RequestedISA = ISAIndex;
 			}
+		}
 
-			++Index;
+		if(RequestedISA == KERNEL_ISA_COUNT)
+		{
+			printf("Unknown -isa %s, expected sse2, sse4, avx2 or avx512.\n", KernelISAName);
+		}
+		else if(RequestedISA > SupportedISA)
+		{
+			printf("This CPU can't run %s kernels.\n", KernelISAName);
+		}
+		else
+		{
+			KernelISA = RequestedISA;
 		}
 	}
+	printf("Kernels: %s (CPU supports up to %s)\n", KernelISANames[KernelISA], KernelISANames[SupportedISA]);
 
-	World.CameraP = V3(0.0f, 6.0f, 10.0f);
-	World.CameraZ = NOZ(World.CameraP);
-	World.CameraX = NOZ(Cross(V3(0.0f, 1.0f, 0.0f), World.CameraZ));
-	World.CameraY = NOZ(Cross(World.CameraZ, World.CameraX));
+	if(Serve)
+	{
+		s32 Result = RunServer(ServePort, ThreadCount, TileKernels[KernelISA], LaneWidth);
+		return Result;
+	}
 
-	f32 FilmD = 1.0f;
-	World.FilmP = World.CameraP - FilmD*World.CameraZ;
-	f32 FilmW = 1.0f;
-	f32 FilmH = 1.0f;
-	if(Image.Width > Image.Height)
+	if(Microbench)
 	{
-		FilmH = (f32)Image.Height / (f32)Image.Width;
+		RunMicrobenches(KernelMicrobenches, KernelISANames, SupportedISA);
+		return 0;
 	}
 
-	else if(Image.Width < Image.Height)
+	if(Regress)
 	{
-		FilmW = (f32)Image.Width / (f32)Image.Height;
+		s32 Result = RunRegression(RegressDirectory, RegressUpdate, RegressLogFilename, TileDim, ThreadCount,
+		                           TileKernels[KernelISA], LaneWidth);
+		return Result;
 	}
-	World.HalfFilmW = 0.5f * FilmW;
-	World.HalfFilmH = 0.5f * FilmH;
 
-	u32 TileDim = 8;
-	u32 TileWidth = (Image.Width + TileDim - 1) / TileDim;
-	u32 TileHeight = (Image.Height + TileDim - 1) / TileDim;
-	u32 TileCount = (TileDim*TileDim);
+	image Image = AllocateImage(ImageWidth, ImageHeight);
+
+	distributed_coordinator Coordinator = {};
+	if(Distributed)
+	{
+		job_message Job = {};
+		snprintf(Job.SceneName, sizeof(Job.SceneName), "%s", SceneName);
+		Job.Width = Image.Width;
+		Job.Height = Image.Height;
+		Job.TileDim = TileDim;
+		Job.RaysPerPixel = RaysPerPixel;
+		Job.MaxBounces = MaxBounces;
+		Job.LaneWidth = LaneWidth;
+		Job.TileFormat = TileFormat;
+		Job.FrameDeltaTime = FrameDeltaTime;
+		Job.RebuildThreshold = RebuildThreshold;
+
+		Coordinator.WorkerTimeout = WorkerTimeout;
+		Coordinator.RangeSize = RangeSize;
+		if(!StartCoordinator(&Coordinator, &Job, ListenPort, LocalWorkerCount, ThreadCount, TestWorkerExitAfter))
+		{
+			printf("Couldn't listen on port %u.\n", ListenPort);
+			return 1;
+		}
+		printf("Coordinator listening on port %u, %u local workers\n", Coordinator.Port, LocalWorkerCount);
+	}
+
+	numa_topology Topology = {};
+	b32 SplitByNode = false;
+	if(NUMA && !Distributed)
+	{
+		SplitByNode = StartNUMA(&Topology, NUMASplitNodeCount);
+	}
+
+	printf("Raycasting...");
+	fflush(stdout);
+
+	clock_t SetupTick = clock();
+
+	memory_arena SceneArena = {};
+	memory_index SceneArenaSize = Megabytes(64);
+	InitializeArena(&SceneArena, SceneArenaSize, AllocateMemory(SceneArenaSize));
+
+	// NOTE: A coordinator only merges tiles; the workers build their own
+	// scenes.
+	world World = {};
+	if(!Distributed)
+	{
+		BuildScene(&World, &SceneArena, SceneName, Image.Width, Image.Height);
+		if(EnvironmentFilename)
+		{
+			World.Environment = LoadEnvironmentMap(EnvironmentFilename);
+			if(!World.Environment)
+			{
+				printf("\rCouldn't read the environment map %s\n", EnvironmentFilename);
+				return 1;
+			}
+			BuildEnvironmentCDFs(World.Environment);
+		}
+	}
+	f64 SetupMS = 1000.0*(f64)(clock() - SetupTick)/CLOCKS_PER_SEC;
+
+	b32 RenderToDeadlineMode = (!Distributed && (DeadlineMS > 0.0));
+	b32 ConvergenceMode = (!Distributed && ConvergenceMaxSamples);
+	if(RenderToDeadlineMode)
+	{
+		// NOTE: Fine tiles keep the cutoff sharp.
+		TileDim = MAX_TILE_DIM;
+	}
 
 	work_queue WorkQueue = {};
+	WorkQueue.TileKernel = TileKernels[KernelISA];
+	BuildTileWorkOrders(&WorkQueue, &Image, &World, TileDim, RaysPerPixel, MaxBounces, LaneWidth);
 
-	for(u32 TileY = 0;
-		TileY < TileDim;
-		++TileY)
-	{
-		for(u32 TileX = 0;
-			TileX < TileDim;
-			++TileX)
-		{
-			tile_work_order *Work = WorkQueue.TileWorkQueue + WorkQueue.TileQueueSize++;
-			Work->Image = &Image;
-			Work->World = &World;
-			Work->MinX = TileX*TileWidth;
-			Work->OnePastMaxX = Minimum(Work->MinX + TileWidth, Image.Width);
-			Work->MinY = TileY*TileHeight;
-			Work->OnePastMaxY = Minimum(Work->MinY + TileHeight, Image.Height);
-			Work->RaysPerPixel = RaysPerPixel;
-			Work->MaxBounces = MaxBounces;
+	// NOTE: The queue starts out empty; each frame posts its tiles below.
+	WorkQueue.NextWorkIndex = WorkQueue.TileQueueSize;
+
+	if(SplitByNode)
+	{
+		StartNodeQueues(&WorkQueue, &Topology, ThreadCount, &World, SceneName,
+		                Image.Width, Image.Height, SceneArenaSize);
+	}
+
+	if(!Distributed)
+	{
+		ThreadStart(&WorkQueue, ThreadCount);
+
+		if(RenderToDeadlineMode)
+		{
+			AllocateImageRadiance(&Image, RadianceLayout);
+		}
+		else if(ConvergenceMode)
+		{
+			AllocateImageRadiance(&Image, RadianceLayout_Linear);
+		}
+		PrefaultImage(&WorkQueue);
+#if RAY_PROFILE
+		ResetProfile();
+#endif
+
+		if(CausticPhotons)
+		{
+			f64 CausticStart = GetWallClock();
+			World.Caustics = CreateCausticMap(&World, CausticPhotons, CausticRadius);
+			WorkQueue.FrameIndex = 0;
+			BuildCausticMap(&WorkQueue, &World, CausticKernels[KernelISA]);
+			printf("\rCaustics: %u casters, %u beams, %u of %u photons stored in %.2f s\n",
+			       World.Caustics->CasterCount, World.Caustics->BeamCount, World.Caustics->PhotonCount,
+			       World.Caustics->PhotonsPerPass, GetWallClock() - CausticStart);
+		}
+
+		if(RadianceCacheBounce)
+		{
+			clock_t CacheTick = clock();
+			f64 CacheStart = GetWallClock();
+			World.RadianceCache = CreateRadianceCache(&Image, RaysPerPixel, LaneWidth, RadianceCacheBounce,
+			                                          RadianceCacheCellDim, RadianceCacheMinSamples,
+			                                          RadianceCacheFillSamples);
+			WorkQueue.FrameIndex = 0;
+			BuildRadianceCache(&WorkQueue, &World, RadianceCacheKernels[KernelISA]);
+			RadianceCacheTicks = clock() - CacheTick;
+			RadianceCacheSeconds = GetWallClock() - CacheStart;
+			RadianceCacheRaysCast = WorkQueue.RaysCast;
+			printf("\rRadiance cache: %u cells (%u samples dropped), %u rays in %.2f s\n",
+			       World.RadianceCache->EntryCount, World.RadianceCache->DroppedCount, WorkQueue.RaysCast,
+			       RadianceCacheSeconds);
 		}
 	}
+	else if(CausticPhotons || RadianceCacheBounce || EnvironmentFilename)
+	{
+		printf("\r-caustics, -radiance-cache and -environment are ignored with -distribute or -listen.\n");
+	}
 
-	clock_t Tick = clock();
+	// NOTE: Started after the prefault, so it stays out of the trace and the
+	// counter totals.
+	if(TraceFilename)
+	{
+		StartTimeline();
+	}
+	if(Counters)
+	{
+		StartCounters();
+	}
 
-	// TODO: complete previous writes
-	LockedAddAndReturnPreviousValue(&WorkQueue.NextWorkIndex, 0);
+	if(Preview)
+	{
+		printf("\r");
+		s32 Result = RunPreview(&WorkQueue, &World, Image.Width, Image.Height, MaxBounces, LaneWidth,
+		                        RaysPerPixel, PreviewBudgetMS, FrameCountGiven ? FrameCount : 300,
+		                        PreviewOrbitEvery, PreviewName);
+		if(TraceFilename)
+		{
+			WriteTimeline(TraceFilename);
+		}
+		return Result;
+	}
 
-	u32 ThreadCount = 3;
-	ThreadStart(&WorkQueue, ThreadCount);
+	if(RenderToDeadlineMode)
+	{
+		// NOTE: -spp caps the samples; without it the deadline alone decides.
+		printf("\r");
+		s32 Result = RenderToDeadline(&WorkQueue, &Image, JobStart + DeadlineMS/1000.0,
+		                              RaysPerPixelGiven ? RaysPerPixel : 0xFFFF, "test.bmp",
+		                              ResolveKernels[KernelISA]);
+		if(TraceFilename)
+		{
+			WriteTimeline(TraceFilename);
+		}
+		return Result;
+	}
 
-	while(WorkQueue.TilesCompleted < TileCount)
+	if(ConvergenceMode)
 	{
-		RenderTile(&WorkQueue);
+		s32 Result = RunConvergence(&WorkQueue, &Image, ConvergenceMaxSamples, ConvergenceReferenceSamples,
+		                            ConvergenceCSVFilename);
+		return Result;
+	}
 
-		u32 Progress = WorkQueue.TilesCompleted;
-		printf("\rRaycasting... %d%%", (u32)((100.0f*(Progress)) / TileCount));
-		fflush(stdout);
+	// NOTE: The first radiance cache fill traced the first frame's first
+	// samples, so it's part of the render.
+	clock_t Tick = clock() - RadianceCacheTicks;
+	f64 WallClockStart = GetWallClock() - RadianceCacheSeconds;
+	u64 TotalRaysCast = RadianceCacheRaysCast;
+	u32 RefitCount = 0;
+	u32 RebuildCount = 0;
+	f64 UpdateMS = 0.0;
+	u64 ImageHash = IMAGE_HASH_BASIS;
+
+	for(u32 FrameIndex = 0;
+		FrameIndex < FrameCount;
+		++FrameIndex)
+	{
+		clock_t FrameTick = clock();
+		f64 FrameStart = GetWallClock();
+		SetTimelineFrame(FrameIndex);
+		hierarchy_update Update = HierarchyUpdate_None;
+		if(World.Animate && (FrameIndex > 0))
+		{
+			World.Animate(&World, FrameIndex*FrameDeltaTime);
+			Update = UpdateInstanceHierarchy(&World, RebuildThreshold);
+			if(SplitByNode)
+			{
+				AnimateNodeWorlds(&WorkQueue, FrameIndex*FrameDeltaTime, RebuildThreshold);
+			}
+			if(Update == HierarchyUpdate_Refit) {++RefitCount;}
+			if(Update == HierarchyUpdate_Rebuild) {++RebuildCount;}
+		}
+		if(World.Caustics && (Update != HierarchyUpdate_None))
+		{
+			WorkQueue.FrameIndex = FrameIndex;
+			BuildCausticMap(&WorkQueue, &World, CausticKernels[KernelISA]);
+			TotalRaysCast += WorkQueue.RaysCast;
+		}
+		if(World.RadianceCache && (Update != HierarchyUpdate_None))
+		{
+			WorkQueue.FrameIndex = FrameIndex;
+			BuildRadianceCache(&WorkQueue, &World, RadianceCacheKernels[KernelISA]);
+			TotalRaysCast += WorkQueue.RaysCast;
+		}
+		clock_t UpdateTock = clock();
+		UpdateMS += 1000.0*(f64)(UpdateTock - FrameTick)/CLOCKS_PER_SEC;
+
+		if(Distributed)
+		{
+			if(!RenderFrameDistributed(&Coordinator, WorkQueue.TileWorkQueue, WorkQueue.TileQueueSize,
+			                           FrameIndex, &TotalRaysCast, (FrameCount == 1)))
+			{
+				break;
+			}
+		}
+		else
+		{
+			WorkQueue.FrameIndex = FrameIndex;
+			RenderFrame(&WorkQueue, (FrameCount == 1));
+			TotalRaysCast += WorkQueue.RaysCast;
+		}
+		RecordTimelineSpan("frame", FrameIndex, FrameStart, GetWallClock());
+		ImageHash = HashImage(&Image, ImageHash);
+
+		if(FrameCount == 1)
+		{
+			WriteImage(&Image, "test.bmp");
+		}
+		else
+		{
+			char FrameName[64];
+			snprintf(FrameName, sizeof(FrameName), "frame_%04u.bmp", FrameIndex);
+			WriteImage(&Image, FrameName);
+
+			f64 FrameMS = 1000.0*(f64)(clock() - FrameTick)/CLOCKS_PER_SEC;
+			char *UpdateName = "static";
+			if(Update == HierarchyUpdate_Refit) {UpdateName = "refit";}
+			if(Update == HierarchyUpdate_Rebuild) {UpdateName = "rebuild";}
+			printf("\rFrame %u/%u: %.1f ms (%s, BVH cost %.1f)\n",
+			       FrameIndex + 1, FrameCount, FrameMS, UpdateName,
+			       World.InstanceCount ? BVHCost(&World.InstanceHierarchy) : 0.0f);
+		}
 	}
 
 	clock_t Tock = clock();
+	f64 WallSeconds = GetWallClock() - WallClockStart;
 	f64 ElapsedMS = 1000.0*(f64)(Tock - Tick)/CLOCKS_PER_SEC;
-
-	WriteImage(&Image, "test.bmp");
+	if(Distributed)
+	{
+		// NOTE: The coordinator's own CPU time says nothing about the render.
+		ElapsedMS = 1000.0*WallSeconds;
+	}
 
 	printf("\rRaycasting... Done.\n");
 	printf("Time: %f s\n", ElapsedMS/1000.0);
-	printf("Rays: %d\n", WorkQueue.RaysCast);
-	printf("ms/ray: %f ms\n", ElapsedMS/WorkQueue.RaysCast);
+	printf("Rays: %llu\n", (unsigned long long)TotalRaysCast);
+	printf("ms/ray: %f ms\n", ElapsedMS/TotalRaysCast);
+	printf("Lanes: %u\n", LaneWidth);
+	printf("Image hash: %016llx%s\n", (unsigned long long)ImageHash, (FrameCount > 1) ? " (all frames)" : "");
+	if(World.InstanceCount)
+	{
+		printf("Instances: %d, scene memory: %d KB\n", World.InstanceCount, (u32)(SceneArena.Used/1024));
+	}
+	if(FrameCount > 1)
+	{
+		printf("Frames: %u, setup: %f s (%f ms/frame amortized)\n",
+		       FrameCount, SetupMS/1000.0, SetupMS/FrameCount);
+		printf("Hierarchy updates: %u refits, %u rebuilds, %f ms/frame\n",
+		       RefitCount, RebuildCount, UpdateMS/FrameCount);
+	}
+	if(Distributed)
+	{
+		printf("Workers: %u connected at the end, %u lost, %u tiles reassigned\n",
+		       Coordinator.WorkerCount, Coordinator.WorkersLost, Coordinator.TilesReassigned);
+		for(u32 WorkerIndex = 0;
+			WorkerIndex < Coordinator.WorkerCount;
+			++WorkerIndex)
+		{
+			printf("  Worker %u: %u tiles\n", WorkerIndex, Coordinator.Workers[WorkerIndex].TilesRendered);
+		}
+		printf("Received: %llu KB (%s tiles)\n", (unsigned long long)(Coordinator.BytesReceived/1024),
+		       (TileFormat == TileFormat_Half) ? "half" : "8-bit");
+		StopCoordinator(&Coordinator);
+	}
+
+#if RAY_PROFILE
+	PrintProfile(TotalRaysCast);
+#endif
+
+	if(Counters && !Distributed)
+	{
+		PrintCounters(TotalRaysCast, WallSeconds);
+	}
+
+	if(SplitByNode)
+	{
+		PrintNUMAReport(&WorkQueue);
+	}
+
+	if(TraceFilename)
+	{
+		WriteTimeline(TraceFilename);
+	}
 
 	return 0;
 }
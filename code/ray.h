@@ -2,7 +2,7 @@
 * File: ray.h
 * Author: Jesse Calvert
 * Created: October 22, 2017, 16:20
-* Last modified: November 2, 2017, 18:13
+* Last modified: October 19, 2026, 17:27
 */
 
 #pragma once
@@ -49,6 +49,25 @@ typedef r64 f64;
 
 typedef uintptr_t umm;
 
+#if !defined(COMPILER_MSVC)
+#define COMPILER_MSVC 0
+#endif
+
+#if !defined(COMPILER_LLVM)
+#define COMPILER_LLVM 0
+#endif
+
+#if !COMPILER_MSVC && !COMPILER_LLVM
+#if _MSC_VER
+#undef COMPILER_MSVC
+#define COMPILER_MSVC 1
+#else
+// NOTE: GCC takes the same path as Clang.
+#undef COMPILER_LLVM
+#define COMPILER_LLVM 1
+#endif
+#endif
+
 #define Real32Maximum FLT_MAX
 #define Real32Minimum -FLT_MAX
 
@@ -58,6 +77,12 @@ typedef uintptr_t umm;
 #define local_persist static
 #define global_variable static
 
+#if COMPILER_MSVC
+#define inline_force __forceinline
+#else
+#define inline_force inline __attribute__((always_inline))
+#endif
+
 #define Pi32 3.14159265359f
 
 #if RAY_DEBUG
@@ -94,6 +119,34 @@ typedef uintptr_t umm;
 #include "ray_intrinsics.h"
 #include "ray_math.h"
 
+struct memory_arena
+{
+	memory_index Size;
+	u8 *Base;
+	memory_index Used;
+};
+
+inline void
+InitializeArena(memory_arena *Arena, memory_index Size, void *Base)
+{
+	Arena->Size = Size;
+	Arena->Base = (u8 *)Base;
+	Arena->Used = 0;
+}
+
+#define PushStruct(Arena, type) (type *)PushSize_(Arena, sizeof(type))
+#define PushArray(Arena, Count, type) (type *)PushSize_(Arena, (Count)*sizeof(type))
+inline void *
+PushSize_(memory_arena *Arena, memory_index Size)
+{
+	memory_index Alignment = 16;
+	memory_index Start = AlignPow2(((memory_index)Arena->Base + Arena->Used), Alignment) - (memory_index)Arena->Base;
+	Assert((Start + Size) <= Arena->Size);
+	void *Result = Arena->Base + Start;
+	Arena->Used = Start + Size;
+	return Result;
+}
+
 #define LittleEndianTag(A, B, C, D) (((u32) A << 24) | (((u32) B) << 16) | (((u32) C) << 8) | (((u32) D) << 0))
 
 #pragma pack(push, 1)
@@ -133,13 +186,41 @@ struct bitmap_information_header
 };
 #pragma pack(pop)
 
+// NOTE: Rows start on a cache line, so threads writing neighbouring tiles
+// never share one. Stride is the row pitch in pixels, for Pixels and
+// Radiance alike; PixelCount is still just Width*Height.
+#define IMAGE_ROW_ALIGNMENT 64
+#define IMAGE_ROW_ALIGNMENT_PIXELS (IMAGE_ROW_ALIGNMENT / sizeof(u32))
+
+// NOTE: Allocations at least this big ask the OS for huge pages.
+#define HUGE_PAGE_SIZE Megabytes(2)
+
+// NOTE: Radiance can also be kept in RADIANCE_BLOCK_DIM square blocks, each
+// stored row by row, so a tile's samples sit on a handful of pages instead
+// of one page per row. In both layouts a block-aligned run of
+// RADIANCE_BLOCK_DIM pixels along a row is contiguous.
+#define RADIANCE_BLOCK_DIM 8
+
+enum radiance_layout
+{
+	RadianceLayout_Linear,
+	RadianceLayout_Blocked,
+};
+
 struct image
 {
 	u32 Width;
 	u32 Height;
+	u32 Stride;
 	u32 PixelCount;
 	u32 PixelsSize;
 	u32 *Pixels;
+
+	// NOTE: Optional linear color for every pixel, filled alongside Pixels
+	// when allocated. Distributed workers use it to ship float tiles.
+	// Index it with GetRadianceIndex.
+	u32 RadianceLayout;
+	v3 *Radiance;
 };
 
 struct material
@@ -169,6 +250,196 @@ struct object
 	material Material;
 };
 
+struct bvh_node
+{
+	rectangle3 Bounds;
+
+	// NOTE: Interior nodes have Count == 0 and their children at FirstIndex
+	// and FirstIndex + 1. Leaves reference Count entries of bvh::Indices.
+	// Children always come after their parent, so walking the node array
+	// backwards visits every child before its parent.
+	u32 FirstIndex;
+	u32 Count;
+};
+
+struct bvh
+{
+	u32 NodeCount;
+	bvh_node *Nodes;
+
+	u32 IndexCount;
+	u32 *Indices;
+
+	// NOTE: Surface area heuristic cost right after the last full build,
+	// used to decide when refitting has degraded the tree too far.
+	f32 BuildCost;
+};
+
+struct prototype
+{
+	u32 ObjectCount;
+	object *Objects;
+
+	bvh Hierarchy;
+	rectangle3 Bounds;
+};
+
+struct instance
+{
+	prototype *Prototype;
+	mat4 ObjectToWorld;
+	mat4 WorldToObject;
+};
+
+enum light_type
+{
+	Light_Point,
+	Light_Spot,
+};
+
+// NOTE: A light with a position, as opposed to the world's sun. Color is
+// radiant intensity; light arrives falling off with the square of the
+// distance and, for spots, fades out between the inner and outer cones
+// around Direction. Radius is the size of the bulb, for soft shadows.
+struct light
+{
+	light_type Type;
+	v3 P;
+	v3 Color;
+	f32 Radius;
+
+	v3 Direction;
+	f32 CosInner;
+	f32 CosOuter;
+
+	// NOTE: Total emitted luminance, which the light tree weighs clusters by.
+	f32 Power;
+};
+
+// NOTE: A bvh over the lights, with each node's total power alongside.
+// See ray_lights.cpp.
+struct light_tree
+{
+	bvh Hierarchy;
+	f32 *NodePower;
+};
+
+enum caustic_source
+{
+	CausticSource_Sun,
+	CausticSource_Light,
+};
+
+// NOTE: A photon that reached a rough surface by way of glass or a mirror.
+// Normal faces the side it arrived on. Power is already scaled to add up the
+// way the source's shadow rays do; see ray_caustics.cpp.
+struct caustic_photon
+{
+	v3 P;
+	v3 Normal;
+	v3 Power;
+};
+
+// NOTE: The photons from one source aimed at one caustic caster, which get
+// FirstPhoton up to OnePastLastPhoton of each pass.
+struct caustic_beam
+{
+	caustic_source Source;
+	u32 SourceIndex;
+	u32 TargetIndex;
+	u32 FirstPhoton;
+	u32 OnePastLastPhoton;
+};
+
+// NOTE: The caustic photon map. Every pass traces PhotonsPerPass photons
+// into Traced, one slot each, in batches handed out through NextBatch, and
+// the ones that were stored are then sorted into Photons by hashed grid
+// cell; cell i holds Photons[CellStarts[i]] up to Photons[CellStarts[i + 1]].
+// Objects are kept by index, so the map serves every -numa replica too.
+struct caustic_map
+{
+	f32 Radius;
+	f32 InvCellDim;
+
+	u32 CasterCount;
+	u32 CasterIndices[64];
+
+	u32 BeamCount;
+	caustic_beam *Beams;
+
+	u32 PhotonsPerPass;
+	u32 BatchCount;
+	volatile u32 NextBatch;
+	caustic_photon *Traced;
+
+	u32 PhotonCount;
+	caustic_photon *Photons;
+	u32 CellMask;
+	u32 *CellStarts;
+
+	// NOTE: A bit per cell, set if it has any photons, which stays in cache
+	// where CellStarts wouldn't.
+	u32 *CellOccupied;
+
+	// NOTE: Around every stored photon, grown by Radius.
+	rectangle3 Bounds;
+};
+
+// NOTE: One cell of the radiance cache, claimed by swapping its Key in.
+// The sums are fixed point, so adding them up in any order comes out the
+// same; see ray_radiance_cache.cpp.
+struct radiance_cache_entry
+{
+	volatile u64 Key;
+	volatile u64 Sum[3];
+	volatile u32 Count;
+	u32 Reserved;
+};
+
+// NOTE: The radiance cache. A fill pass traces the frame's first FillSamples
+// samples of every pixel as full paths, adds what each matte vertex saw
+// beyond it to its cell, and keeps each pixel's sum in FillColor; the rest
+// of FillFrameIndex's samples in FillImage start from that sum, and paths
+// stop at the first matte vertex, LookupBounce matte bounces in, whose cell
+// has at least MinSamples.
+struct radiance_cache
+{
+	f32 InvCellDim;
+	u32 LookupBounce;
+	u32 MinSamples;
+	u32 FillSamples;
+	b32 Filling;
+
+	image *FillImage;
+	u32 FillFrameIndex;
+	v3 *FillColor;
+
+	u32 EntryMask;
+	radiance_cache_entry *Entries;
+	volatile u32 EntryCount;
+	volatile u32 DroppedCount;
+};
+
+// NOTE: An equirectangular environment, with +y along the top row and -z
+// down the middle column. Each row has a CDF over its texels, and the rows
+// have one over their totals, for picking directions by brightness; row y
+// starts at ConditionalCDF[y*(Width + 1)]. See ray_environment.cpp.
+struct environment_map
+{
+	u32 Width;
+	u32 Height;
+	v3 *Texels;
+
+	f32 *ConditionalCDF;
+	f32 *MarginalCDF;
+};
+
+#define LANE_WIDTH 8
+
+// NOTE: Frames are cut into at most MAX_TILE_DIM x MAX_TILE_DIM tiles.
+#define MAX_TILE_DIM 32
+#define MAX_TILE_COUNT (MAX_TILE_DIM*MAX_TILE_DIM)
+
 struct tile_work_order
 {
 	image *Image;
@@ -179,20 +450,138 @@ struct tile_work_order
 	u32 OnePastMaxX;
 	u32 OnePastMaxY;
 
+	// NOTE: Renders of more than one pass pick up where the last left off,
+	// so each pass draws new samples rather than the same ones again.
+	u32 FirstSample;
 	u32 RaysPerPixel;
 	u32 MaxBounces;
+	u32 LaneWidth;
+
+	// NOTE: Set once the tile's pixels are written, so the server can send
+	// tiles while the rest of the frame is still rendering.
+	volatile b32 Finished;
+};
+
+#define TILE_KERNEL(name) void name(tile_work_order *WorkOrder, u32 FrameIndex, volatile u32 *RaysCast)
+typedef TILE_KERNEL(tile_kernel);
+
+// NOTE: Resolves a deadline render's accumulated radiance into Pixels; see
+// ray_deadline.cpp.
+#define RESOLVE_KERNEL(name) void name(image *Image, v3 *Accumulated, u32 *SampleCount, \
+                                       u32 FirstRow, u32 OnePastLastRow, f32 *SRGBThresholds)
+typedef RESOLVE_KERNEL(resolve_kernel);
+
+// NOTE: Instruction set levels the tracing kernels are compiled for, in
+// increasing order. See ray_kernel.cpp.
+#define KERNEL_ISA_SSE2 0
+#define KERNEL_ISA_SSE4 1
+#define KERNEL_ISA_AVX2 2
+#define KERNEL_ISA_AVX512 3
+#define KERNEL_ISA_COUNT 4
+
+// NOTE: Per-thread event counters the platform layer may be able to read
+// around a tile. The hardware ones come first and need a PMU the OS is
+// willing to hand out; the NUMA ones also need offcore events, so they're
+// counted apart from the rest; see ray_counters.cpp.
+enum perf_counter
+{
+	PerfCounter_Cycles,
+	PerfCounter_Instructions,
+	PerfCounter_L1DMisses,
+	PerfCounter_LLCMisses,
+	PerfCounter_BranchMisses,
+
+	PerfCounter_LocalNodeLoads,
+	PerfCounter_RemoteNodeLoads,
+
+	PerfCounter_TaskClock,
+	PerfCounter_ContextSwitches,
+	PerfCounter_PageFaults,
+
+	PerfCounter_Count,
+};
+#define PERF_COUNTER_HARDWARE_COUNT 5
+#define PERF_COUNTER_NODE_END 7
+
+// NOTE: NUMA nodes as the platform reports them, numbered densely from 0
+// even where the OS skips numbers.
+#define MAX_NUMA_NODES 8
+#define MAX_NUMA_CPUS 1024
+
+struct numa_topology
+{
+	u32 NodeCount;
+	u32 NodeCPUCount[MAX_NUMA_NODES];
+
+	u32 CPUCount;
+	u16 CPUs[MAX_NUMA_CPUS];
+	u8 CPUNode[MAX_NUMA_CPUS];
+};
+
+inline void
+AddNUMACPU(numa_topology *Topology, u32 CPU, u32 Node)
+{
+	if(Topology->CPUCount < MAX_NUMA_CPUS)
+	{
+		Topology->CPUs[Topology->CPUCount] = (u16)CPU;
+		Topology->CPUNode[Topology->CPUCount] = (u8)Node;
+		++Topology->CPUCount;
+		++Topology->NodeCPUCount[Node];
+	}
+}
+
+// NOTE: One node's share of a batch when the pool is split across NUMA
+// nodes. Padded to a cache line so the nodes' cursors don't share one.
+struct work_queue_node
+{
+	volatile u32 NextWorkIndex;
+	volatile u32 OnePastLastWorkIndex;
+	volatile u32 LocalTiles;
+	volatile u32 RemoteTiles;
+	u32 ThreadCount;
+	struct world *World;
+	u8 Pad[64 - 5*sizeof(u32) - sizeof(void *)];
 };
 
 struct work_queue
 {
 	u32 TileQueueSize;
-	tile_work_order TileWorkQueue[256];
+	tile_work_order TileWorkQueue[MAX_TILE_COUNT];
 
-	volatile u32 NextWorkIndex;
+	// NOTE: Threads take tiles from NextWorkIndex up to OnePastLastWorkIndex,
+	// so a batch can be any contiguous range of TileWorkQueue. The two share
+	// WorkRange so a claim can check the end and advance in one exchange.
+	union
+	{
+		volatile u64 WorkRange;
+		struct
+		{
+			volatile u32 NextWorkIndex;
+			volatile u32 OnePastLastWorkIndex;
+		};
+	};
 	volatile u32 TilesCompleted;
 	volatile u32 RaysCast;
+
+	u32 ThreadCount;
+	void *SemaphoreHandle;
+
+	tile_kernel *TileKernel;
+	u32 FrameIndex;
+
+	// NOTE: Only set up by -numa; see ray_numa.cpp. While SplitByNode is on,
+	// NextWorkIndex just hands out tickets, one per tile in the batch, and
+	// each ticket is then redeemed from a node's own range.
+	numa_topology *Topology;
+	u32 NodeCount;
+	work_queue_node Nodes[MAX_NUMA_NODES];
+	volatile u32 ThreadsStarted;
+	b32 SplitByNode;
 };
 
+#define SCENE_ANIMATE(name) void name(struct world *World, f32 Time)
+typedef SCENE_ANIMATE(scene_animate);
+
 struct world
 {
 	v3 CameraP;
@@ -207,6 +596,37 @@ struct world
 	v3 LightDirection;
 	v3 LightColor;
 
+	// NOTE: Lights other than the sun, for direct lighting. Each shading
+	// point picks one, either the sun or one found through LightTree.
+	u32 LightCount;
+	u32 MaxLightCount;
+	light *Lights;
+	light_tree LightTree;
+
+	// NOTE: The opaque emissive spheres among Objects, which rough hits
+	// aim rays at directly. Filled in by FindEmitters.
+	u32 EmitterCount;
+	object *Emitters[64];
+
+	// NOTE: Only set with -caustics; see ray_caustics.cpp.
+	caustic_map *Caustics;
+
+	// NOTE: Only set with -radiance-cache; see ray_radiance_cache.cpp.
+	radiance_cache *RadianceCache;
+
+	// NOTE: Only set with -environment, and then what rays that escape see
+	// in place of NullMaterial's EmitColor; see ray_environment.cpp.
+	environment_map *Environment;
+
 	u32 ObjectCount;
 	object Objects[64];
+
+	u32 InstanceCount;
+	u32 MaxInstanceCount;
+	instance *Instances;
+	rectangle3 *InstanceBounds;
+	bvh InstanceHierarchy;
+
+	scene_animate *Animate;
+	void *AnimationState;
 };
@@ -0,0 +1,416 @@
+/*@H
+* File: ray_bvh.cpp
+* Author: Jesse Calvert
+* Created: October 19, 2026, 12:10
+* Last modified: October 19, 2026, 17:19
+*/
+
+#define BVH_BIN_COUNT 12
+#define BVH_MAX_LEAF_COUNT 4
+#define BVH_MAX_DEPTH 64
+
+struct bvh_bin
+{
+	rectangle3 Bounds;
+	u32 Count;
+};
+
+internal rectangle3
+ObjectBounds(object *Object)
+{
+	rectangle3 Result = InvertedInfinityRectangle3();
+	switch(Object->Type)
+	{
+		case Object_Sphere:
+		{
+			v3 Radius = V3(Object->Sphere.Radius, Object->Sphere.Radius, Object->Sphere.Radius);
+			Result = Rectangle3(Object->Sphere.Center - Radius, Object->Sphere.Center + Radius);
+		} break;
+
+		// NOTE: Planes are unbounded and can't live in a hierarchy.
+		InvalidDefaultCase;
+	}
+
+	return Result;
+}
+
+inline b32
+RayIntersectsBounds(rectangle3 Bounds, v3a RayOrigin, v3a InvRayDirection, f32 MaxDistance)
+{
+#if RAY_SIMD_MATH
+	__m128 T0 = _mm_mul_ps(_mm_sub_ps(_mm_setr_ps(Bounds.Min.x, Bounds.Min.y, Bounds.Min.z, 0.0f), RayOrigin.W), InvRayDirection.W);
+	__m128 T1 = _mm_mul_ps(_mm_sub_ps(_mm_setr_ps(Bounds.Max.x, Bounds.Max.y, Bounds.Max.z, 0.0f), RayOrigin.W), InvRayDirection.W);
+
+	// NOTE: The w lane holds junk; overwrite it with the ray's own extent.
+	__m128 XYZMask = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+	__m128 Near = _mm_and_ps(_mm_min_ps(T0, T1), XYZMask);
+	__m128 Far = _mm_or_ps(_mm_and_ps(_mm_max_ps(T0, T1), XYZMask),
+	                       _mm_andnot_ps(XYZMask, _mm_set1_ps(MaxDistance)));
+
+	Near = _mm_max_ps(Near, _mm_shuffle_ps(Near, Near, _MM_SHUFFLE(2, 3, 0, 1)));
+	Near = _mm_max_ps(Near, _mm_shuffle_ps(Near, Near, _MM_SHUFFLE(1, 0, 3, 2)));
+	Far = _mm_min_ps(Far, _mm_shuffle_ps(Far, Far, _MM_SHUFFLE(2, 3, 0, 1)));
+	Far = _mm_min_ps(Far, _mm_shuffle_ps(Far, Far, _MM_SHUFFLE(1, 0, 3, 2)));
+
+	b32 Result = _mm_comile_ss(Near, Far);
+#else
+	f32 tMin = 0.0f;
+	f32 tMax = MaxDistance;
+	for(u32 Axis = 0;
+		Axis < 3;
+		++Axis)
+	{
+		f32 t0 = (Bounds.Min.E[Axis] - RayOrigin.E[Axis])*InvRayDirection.E[Axis];
+		f32 t1 = (Bounds.Max.E[Axis] - RayOrigin.E[Axis])*InvRayDirection.E[Axis];
+		if(t0 > t1)
+		{
+			f32 Temp = t0;
+			t0 = t1;
+			t1 = Temp;
+		}
+
+		tMin = Maximum(tMin, t0);
+		tMax = Minimum(tMax, t1);
+	}
+
+	b32 Result = (tMin <= tMax);
+#endif
+	return Result;
+}
+
+// NOTE: Traversal walks the tree with a fixed stack of BVH_MAX_DEPTH
+// entries, which holds up to one more than the depth of the deepest leaf.
+// Skewed inputs, like objects whose spacing grows geometrically, split off
+// only one or two primitives a level, so a node that deep is made a leaf
+// however many primitives it still holds.
+internal void
+SubdivideBVHNode(bvh *BVH, u32 NodeIndex, rectangle3 *PrimitiveBounds, u32 Depth)
+{
+	bvh_node *Node = BVH->Nodes + NodeIndex;
+	u32 First = Node->FirstIndex;
+	u32 Count = Node->Count;
+
+	rectangle3 CentroidBounds = InvertedInfinityRectangle3();
+	Node->Bounds = InvertedInfinityRectangle3();
+	for(u32 Index = First;
+		Index < First + Count;
+		++Index)
+	{
+		rectangle3 Bounds = PrimitiveBounds[BVH->Indices[Index]];
+		v3 Centroid = Center(Bounds);
+		Node->Bounds = Combine(Node->Bounds, Bounds);
+		CentroidBounds = Combine(CentroidBounds, Rectangle3(Centroid, Centroid));
+	}
+
+	if((Count <= 2) || (Depth >= (BVH_MAX_DEPTH - 1)))
+	{
+		return;
+	}
+
+	// NOTE: Binned surface area heuristic. Costs are relative to a single
+	// primitive intersection, with traversal costing about the same.
+	f32 BestCost = Real32Maximum;
+	u32 BestAxis = 0;
+	u32 BestSplit = 0;
+	v3 CentroidDim = Dim(CentroidBounds);
+	for(u32 Axis = 0;
+		Axis < 3;
+		++Axis)
+	{
+		if(CentroidDim.E[Axis] <= 0.0f)
+		{
+			continue;
+		}
+
+		bvh_bin Bins[BVH_BIN_COUNT];
+		for(u32 BinIndex = 0;
+			BinIndex < BVH_BIN_COUNT;
+			++BinIndex)
+		{
+			Bins[BinIndex].Bounds = InvertedInfinityRectangle3();
+			Bins[BinIndex].Count = 0;
+		}
+
+		f32 BinScale = (f32)BVH_BIN_COUNT/CentroidDim.E[Axis];
+		for(u32 Index = First;
+			Index < First + Count;
+			++Index)
+		{
+			rectangle3 Bounds = PrimitiveBounds[BVH->Indices[Index]];
+			u32 BinIndex = (u32)((Center(Bounds).E[Axis] - CentroidBounds.Min.E[Axis])*BinScale);
+			BinIndex = Minimum(BinIndex, BVH_BIN_COUNT - 1);
+			Bins[BinIndex].Bounds = Combine(Bins[BinIndex].Bounds, Bounds);
+			++Bins[BinIndex].Count;
+		}
+
+		f32 RightArea[BVH_BIN_COUNT];
+		u32 RightCount[BVH_BIN_COUNT];
+		rectangle3 Accumulated = InvertedInfinityRectangle3();
+		u32 AccumulatedCount = 0;
+		for(u32 BinIndex = BVH_BIN_COUNT - 1;
+			BinIndex > 0;
+			--BinIndex)
+		{
+			Accumulated = Combine(Accumulated, Bins[BinIndex].Bounds);
+			AccumulatedCount += Bins[BinIndex].Count;
+			RightArea[BinIndex] = AccumulatedCount ? SurfaceArea(Accumulated) : 0.0f;
+			RightCount[BinIndex] = AccumulatedCount;
+		}
+
+		Accumulated = InvertedInfinityRectangle3();
+		AccumulatedCount = 0;
+		for(u32 Split = 1;
+			Split < BVH_BIN_COUNT;
+			++Split)
+		{
+			Accumulated = Combine(Accumulated, Bins[Split - 1].Bounds);
+			AccumulatedCount += Bins[Split - 1].Count;
+			if(AccumulatedCount && RightCount[Split])
+			{
+				f32 Cost = AccumulatedCount*SurfaceArea(Accumulated) + RightCount[Split]*RightArea[Split];
+				if(Cost < BestCost)
+				{
+					BestCost = Cost;
+					BestAxis = Axis;
+					BestSplit = Split;
+				}
+			}
+		}
+	}
+
+	f32 LeafCost = Count*SurfaceArea(Node->Bounds);
+	f32 SplitCost = SurfaceArea(Node->Bounds) + BestCost;
+	if((BestSplit == 0) ||
+	   ((Count <= BVH_MAX_LEAF_COUNT) && (LeafCost <= SplitCost)))
+	{
+		return;
+	}
+
+	f32 BinScale = (f32)BVH_BIN_COUNT/CentroidDim.E[BestAxis];
+	u32 *Left = BVH->Indices + First;
+	u32 *Right = BVH->Indices + First + Count - 1;
+	while(Left <= Right)
+	{
+		rectangle3 Bounds = PrimitiveBounds[*Left];
+		u32 BinIndex = (u32)((Center(Bounds).E[BestAxis] - CentroidBounds.Min.E[BestAxis])*BinScale);
+		BinIndex = Minimum(BinIndex, BVH_BIN_COUNT - 1);
+		if(BinIndex < BestSplit)
+		{
+			++Left;
+		}
+		else
+		{
+			Swap(*Left, *Right, u32);
+			--Right;
+		}
+	}
+
+	u32 LeftCount = (u32)(Left - (BVH->Indices + First));
+	Assert((LeftCount > 0) && (LeftCount < Count));
+
+	u32 ChildIndex = BVH->NodeCount;
+	BVH->NodeCount += 2;
+
+	Node->FirstIndex = ChildIndex;
+	Node->Count = 0;
+
+	bvh_node *LeftChild = BVH->Nodes + ChildIndex;
+	LeftChild->FirstIndex = First;
+	LeftChild->Count = LeftCount;
+
+	bvh_node *RightChild = BVH->Nodes + ChildIndex + 1;
+	RightChild->FirstIndex = First + LeftCount;
+	RightChild->Count = Count - LeftCount;
+
+	SubdivideBVHNode(BVH, ChildIndex, PrimitiveBounds, Depth + 1);
+	SubdivideBVHNode(BVH, ChildIndex + 1, PrimitiveBounds, Depth + 1);
+}
+
+internal f32
+BVHCost(bvh *BVH)
+{
+	// NOTE: Expected intersection cost of a random ray that hits the root,
+	// with traversal steps and primitive tests weighted equally.
+	f32 Result = 0.0f;
+	f32 RootArea = SurfaceArea(BVH->Nodes[0].Bounds);
+	if(RootArea > 0.0f)
+	{
+		f32 InvRootArea = 1.0f/RootArea;
+		for(u32 NodeIndex = 0;
+			NodeIndex < BVH->NodeCount;
+			++NodeIndex)
+		{
+			bvh_node *Node = BVH->Nodes + NodeIndex;
+			f32 Cost = Node->Count ? (f32)Node->Count : 1.0f;
+			Result += Cost*SurfaceArea(Node->Bounds)*InvRootArea;
+		}
+	}
+
+	return Result;
+}
+
+internal void
+BuildBVH(memory_arena *Arena, bvh *BVH, u32 PrimitiveCount, rectangle3 *PrimitiveBounds)
+{
+	Assert(PrimitiveCount > 0);
+
+	// NOTE: Rebuilding an existing hierarchy reuses its storage, so only the
+	// first build needs an arena.
+	if(!BVH->Nodes)
+	{
+		BVH->IndexCount = PrimitiveCount;
+		BVH->Indices = PushArray(Arena, PrimitiveCount, u32);
+		BVH->Nodes = PushArray(Arena, 2*PrimitiveCount - 1, bvh_node);
+	}
+	Assert(BVH->IndexCount == PrimitiveCount);
+
+	for(u32 Index = 0;
+		Index < PrimitiveCount;
+		++Index)
+	{
+		BVH->Indices[Index] = Index;
+	}
+
+	BVH->NodeCount = 1;
+	BVH->Nodes[0].FirstIndex = 0;
+	BVH->Nodes[0].Count = PrimitiveCount;
+
+	SubdivideBVHNode(BVH, 0, PrimitiveBounds, 0);
+
+	BVH->BuildCost = BVHCost(BVH);
+}
+
+internal void
+RefitBVH(bvh *BVH, rectangle3 *PrimitiveBounds)
+{
+	for(u32 NodeIndex = BVH->NodeCount;
+		NodeIndex > 0;
+		--NodeIndex)
+	{
+		bvh_node *Node = BVH->Nodes + NodeIndex - 1;
+		if(Node->Count)
+		{
+			Node->Bounds = InvertedInfinityRectangle3();
+			for(u32 Index = Node->FirstIndex;
+				Index < Node->FirstIndex + Node->Count;
+				++Index)
+			{
+				Node->Bounds = Combine(Node->Bounds, PrimitiveBounds[BVH->Indices[Index]]);
+			}
+		}
+		else
+		{
+			Node->Bounds = Combine(BVH->Nodes[Node->FirstIndex].Bounds,
+			                       BVH->Nodes[Node->FirstIndex + 1].Bounds);
+		}
+	}
+}
+
+//
+// NOTE: Prototypes and instances
+//
+
+internal prototype *
+PushPrototype(memory_arena *Arena, u32 MaxObjectCount)
+{
+	prototype *Result = PushStruct(Arena, prototype);
+	*Result = {};
+	Result->Objects = PushArray(Arena, MaxObjectCount, object);
+	return Result;
+}
+
+inline object *
+AddObject(prototype *Prototype)
+{
+	object *Result = Prototype->Objects + Prototype->ObjectCount++;
+	*Result = {};
+	return Result;
+}
+
+internal void
+FinalizePrototype(memory_arena *Arena, prototype *Prototype)
+{
+	rectangle3 *Bounds = PushArray(Arena, Prototype->ObjectCount, rectangle3);
+	Prototype->Bounds = InvertedInfinityRectangle3();
+	for(u32 ObjectIndex = 0;
+		ObjectIndex < Prototype->ObjectCount;
+		++ObjectIndex)
+	{
+		Bounds[ObjectIndex] = ObjectBounds(Prototype->Objects + ObjectIndex);
+		Prototype->Bounds = Combine(Prototype->Bounds, Bounds[ObjectIndex]);
+	}
+
+	BuildBVH(Arena, &Prototype->Hierarchy, Prototype->ObjectCount, Bounds);
+}
+
+internal void
+ReserveInstances(memory_arena *Arena, world *World, u32 MaxInstanceCount)
+{
+	World->InstanceCount = 0;
+	World->MaxInstanceCount = MaxInstanceCount;
+	World->Instances = PushArray(Arena, MaxInstanceCount, instance);
+	World->InstanceBounds = PushArray(Arena, MaxInstanceCount, rectangle3);
+}
+
+internal void
+SetInstanceTransform(world *World, u32 InstanceIndex, mat4 ObjectToWorld)
+{
+	Assert(InstanceIndex < World->InstanceCount);
+	instance *Instance = World->Instances + InstanceIndex;
+	Instance->ObjectToWorld = ObjectToWorld;
+	Instance->WorldToObject = AffineInverse(ObjectToWorld);
+	World->InstanceBounds[InstanceIndex] = TransformBounds(ObjectToWorld, Instance->Prototype->Bounds);
+}
+
+internal instance *
+AddInstance(world *World, prototype *Prototype, mat4 ObjectToWorld)
+{
+	Assert(World->InstanceCount < World->MaxInstanceCount);
+	u32 InstanceIndex = World->InstanceCount++;
+
+	instance *Result = World->Instances + InstanceIndex;
+	Result->Prototype = Prototype;
+	SetInstanceTransform(World, InstanceIndex, ObjectToWorld);
+
+	return Result;
+}
+
+internal void
+BuildInstanceHierarchy(memory_arena *Arena, world *World)
+{
+	if(World->InstanceCount)
+	{
+		BuildBVH(Arena, &World->InstanceHierarchy, World->InstanceCount, World->InstanceBounds);
+	}
+}
+
+enum hierarchy_update
+{
+	HierarchyUpdate_None,
+	HierarchyUpdate_Refit,
+	HierarchyUpdate_Rebuild,
+};
+
+internal hierarchy_update
+UpdateInstanceHierarchy(world *World, f32 RebuildThreshold)
+{
+	// NOTE: Refitting keeps the topology and is linear in the node count,
+	// but quality decays as instances drift away from the siblings they
+	// were grouped with. Once the SAH cost has grown past the threshold
+	// relative to the last build, pay for a full rebuild instead.
+	hierarchy_update Result = HierarchyUpdate_None;
+	if(World->InstanceCount)
+	{
+		bvh *Hierarchy = &World->InstanceHierarchy;
+		RefitBVH(Hierarchy, World->InstanceBounds);
+		Result = HierarchyUpdate_Refit;
+
+		if(BVHCost(Hierarchy) > RebuildThreshold*Hierarchy->BuildCost)
+		{
+			BuildBVH(0, Hierarchy, World->InstanceCount, World->InstanceBounds);
+			Result = HierarchyUpdate_Rebuild;
+		}
+	}
+
+	return Result;
+}
@@ -0,0 +1,418 @@
+/*@H
+* File: ray_caustics.cpp
+* Author: Jesse Calvert
+* Created: October 19, 2026, 15:14
+* Last modified: October 19, 2026, 15:38
+*/
+
+// NOTE: Caustics, with -caustics PHOTONS. Light that reaches a rough surface
+// through glass or off a mirror is out of reach of the shadow rays, which
+// glass blocks, and a path would have to bounce into the sun or a light to
+// find it, which it never can. So without this, glass and mirror spheres
+// only ever cast shadows.
+//
+// Each frame starts by tracing photons from the sun and the lights at each
+// caster: the transparent spheres, and opaque ones too specular to count as
+// rough (see MIS_MAX_SPECULARITY). They refract, reflect and bounce by the
+// same rules paths do, and are stored where they first reach a rough
+// surface. Rough hits then add up the photons within Radius, weighed by a
+// kernel that falls to zero at Radius, as they would a shadow ray's light.
+// That blurs the caustics by about the radius, but leaves next to no noise.
+//
+// The photons are split between (source, caster) beams by about how much
+// light each carries, and each beam's share their total. A shadow ray to
+// the sun brings back its color whatever the angle, so sun photons are
+// divided by the cosine at the surface; lights fall off with the cosine,
+// the way flux per area does, so theirs aren't.
+//
+// Emissive spheres send no photons. Paths hit them, caustics and all, and
+// the glass here isn't reciprocal (a ray leaving a sphere refracts about
+// the outward normal, so it comes out bent and longer than it went in), so
+// photons from them couldn't stand in for what the paths already find.
+//
+// Only spheres among the world's objects cast caustics. The stored photons
+// go in a hashed grid of cells twice the radius across, so a lookup reads
+// the 8 cells around it.
+
+#define CAUSTIC_DEFAULT_RADIUS 0.05f
+#define CAUSTIC_MAX_BOUNCES 8
+#define CAUSTIC_BATCH_SIZE 1024
+
+// NOTE: Photons only count towards a lookup on a surface facing about the
+// same way, so they don't leak around corners or through thin objects.
+#define CAUSTIC_MIN_NORMAL_COS 0.9f
+
+// NOTE: Photons arriving at a grazing angle are divided by no less than this.
+#define CAUSTIC_MIN_COS 0.01f
+
+// NOTE: The sample index the photons' random series are seeded with, which
+// no pixel gets to.
+#define CAUSTIC_SEED_SAMPLE 0xFFFFFFFE
+
+// NOTE: Where a photon starts, and with how much power. Sun photons still
+// have to be checked for a clear view of the sun, back along Direction.
+struct caustic_emission
+{
+	v3 P;
+	v3 Direction;
+	v3 Power;
+};
+
+internal b32
+IsCausticCaster(object *Object)
+{
+	material *Material = &Object->Material;
+	b32 Result = ((Object->Type == Object_Sphere) &&
+	              (Material->Transparent || (Material->Specularity >= MIS_MAX_SPECULARITY)));
+	return Result;
+}
+
+// NOTE: The solid angle of a sphere of radius Radius at distance squared
+// DistanceSq, or zero from inside it.
+inline f32
+GetSphereSolidAngle(f32 DistanceSq, f32 Radius)
+{
+	f32 Result = 0.0f;
+	f32 RadiusSq = Square(Radius);
+	if(DistanceSq > RadiusSq)
+	{
+		f32 SinSq = RadiusSq / DistanceSq;
+		Result = 2.0f*Pi32*SinSq / (1.0f + SquareRoot(1.0f - SinSq));
+	}
+	return Result;
+}
+
+// NOTE: About how much light Source sends at Target, for sharing out the
+// photons; the photons' own power is worked out exactly as they're emitted.
+internal f32
+GetCausticBeamWeight(world *World, caustic_source Source, u32 SourceIndex, u32 TargetIndex)
+{
+	f32 Result = 0.0f;
+	sphere *Sphere = &World->Objects[TargetIndex].Sphere;
+	switch(Source)
+	{
+		case CausticSource_Sun:
+		{
+			Result = Luminance(World->LightColor)*Pi32*Square(Sphere->Radius);
+		} break;
+
+		case CausticSource_Light:
+		{
+			// NOTE: Spots are judged by the cone at the caster's center,
+			// but never written off, since its edge may still be lit.
+			light *Light = World->Lights + SourceIndex;
+			v3 ToTarget = Sphere->Center - Light->P;
+			f32 Falloff = Maximum(GetLightFalloff(Light, ToTarget), 0.05f);
+			Result = Luminance(Light->Color)*Falloff*GetSphereSolidAngle(LengthSq(ToTarget), Sphere->Radius);
+		} break;
+
+		InvalidDefaultCase;
+	}
+	return Result;
+}
+
+internal caustic_map *
+CreateCausticMap(world *World, u32 PhotonsPerPass, f32 Radius)
+{
+	caustic_map *Map = (caustic_map *)AllocateMemory(sizeof(caustic_map));
+	Map->Radius = Radius;
+	Map->InvCellDim = 1.0f / (2.0f*Radius);
+
+	for(u32 ObjectIndex = 0;
+		ObjectIndex < World->ObjectCount;
+		++ObjectIndex)
+	{
+		object *Object = World->Objects + ObjectIndex;
+		if(IsCausticCaster(Object))
+		{
+			Map->CasterIndices[Map->CasterCount++] = ObjectIndex;
+		}
+	}
+
+	u32 SourceCount = 1 + World->LightCount;
+	u32 MaxBeamCount = SourceCount*Map->CasterCount;
+	Map->Beams = (caustic_beam *)AllocateMemory(Maximum(MaxBeamCount, 1)*sizeof(caustic_beam));
+	f32 *Weights = (f32 *)AllocateMemory(Maximum(MaxBeamCount, 1)*sizeof(f32));
+
+	f32 TotalWeight = 0.0f;
+	for(u32 CasterIndex = 0;
+		CasterIndex < Map->CasterCount;
+		++CasterIndex)
+	{
+		for(u32 SourceIndex = 0;
+			SourceIndex < SourceCount;
+			++SourceIndex)
+		{
+			caustic_beam Beam = {};
+			Beam.TargetIndex = Map->CasterIndices[CasterIndex];
+			if(SourceIndex == 0)
+			{
+				Beam.Source = CausticSource_Sun;
+			}
+			else
+			{
+				Beam.Source = CausticSource_Light;
+				Beam.SourceIndex = SourceIndex - 1;
+			}
+
+			f32 Weight = GetCausticBeamWeight(World, Beam.Source, Beam.SourceIndex, Beam.TargetIndex);
+			if(Weight > 0.0f)
+			{
+				Weights[Map->BeamCount] = Weight;
+				Map->Beams[Map->BeamCount++] = Beam;
+				TotalWeight += Weight;
+			}
+		}
+	}
+
+	// NOTE: Beams too weak to get a photon of their own are dropped.
+	u32 PhotonCount = 0;
+	u32 BeamCount = 0;
+	for(u32 BeamIndex = 0;
+		BeamIndex < Map->BeamCount;
+		++BeamIndex)
+	{
+		f32 WeightBefore = 0.0f;
+		for(u32 Before = 0;
+			Before < BeamIndex;
+			++Before)
+		{
+			WeightBefore += Weights[Before];
+		}
+		u32 OnePastLastPhoton = (u32)(PhotonsPerPass*((WeightBefore + Weights[BeamIndex]) / TotalWeight));
+		if(BeamIndex == Map->BeamCount - 1)
+		{
+			OnePastLastPhoton = PhotonsPerPass;
+		}
+
+		if(OnePastLastPhoton > PhotonCount)
+		{
+			caustic_beam *Beam = Map->Beams + BeamCount++;
+			*Beam = Map->Beams[BeamIndex];
+			Beam->FirstPhoton = PhotonCount;
+			Beam->OnePastLastPhoton = OnePastLastPhoton;
+			PhotonCount = OnePastLastPhoton;
+		}
+	}
+	Map->BeamCount = BeamCount;
+	DeallocateMemory(Weights, Maximum(MaxBeamCount, 1)*sizeof(f32));
+
+	Map->PhotonsPerPass = BeamCount ? PhotonsPerPass : 0;
+	Map->BatchCount = (Map->PhotonsPerPass + CAUSTIC_BATCH_SIZE - 1) / CAUSTIC_BATCH_SIZE;
+	Map->Traced = (caustic_photon *)AllocateMemory(Maximum(Map->PhotonsPerPass, 1)*sizeof(caustic_photon));
+	Map->Photons = (caustic_photon *)AllocateMemory(Maximum(Map->PhotonsPerPass, 1)*sizeof(caustic_photon));
+
+	u32 CellCount = 1;
+	while(CellCount < 2*Map->PhotonsPerPass)
+	{
+		CellCount *= 2;
+	}
+	Map->CellMask = CellCount - 1;
+	Map->CellStarts = (u32 *)AllocateMemory((CellCount + 1)*sizeof(u32));
+	Map->CellOccupied = (u32 *)AllocateMemory(((CellCount + 31) / 32)*sizeof(u32));
+
+	return Map;
+}
+
+internal caustic_beam *
+FindCausticBeam(caustic_map *Map, u32 PhotonIndex)
+{
+	u32 First = 0;
+	u32 OnePastLast = Map->BeamCount;
+	while(OnePastLast - First > 1)
+	{
+		u32 Middle = (First + OnePastLast) / 2;
+		if(PhotonIndex < Map->Beams[Middle].FirstPhoton)
+		{
+			OnePastLast = Middle;
+		}
+		else
+		{
+			First = Middle;
+		}
+	}
+
+	caustic_beam *Result = Map->Beams + First;
+	Assert((Result->FirstPhoton <= PhotonIndex) && (PhotonIndex < Result->OnePastLastPhoton));
+	return Result;
+}
+
+// NOTE: Random is 5 numbers uniform in [0, 1). Returns false for photons
+// that come out with no power.
+internal b32
+EmitCausticPhoton(world *World, caustic_beam *Beam, f32 *Random, caustic_emission *Emission)
+{
+	b32 Result = false;
+	f32 PhotonCount = (f32)(Beam->OnePastLastPhoton - Beam->FirstPhoton);
+	sphere *Target = &World->Objects[Beam->TargetIndex].Sphere;
+	switch(Beam->Source)
+	{
+		case CausticSource_Sun:
+		{
+			// NOTE: Jittered the way shadow rays to the sun are, then
+			// started from a disk covering the caster, in front of it.
+			v3 Jitter = NOZ(V3(2.0f*Random[0] - 1.0f, 2.0f*Random[1] - 1.0f, 2.0f*Random[2] - 1.0f));
+			v3 Direction = -NOZ(-World->LightDirection + 0.1f*Jitter);
+
+			v3 Up = (AbsoluteValue(Direction.x) < 0.9f) ? V3(1.0f, 0.0f, 0.0f) : V3(0.0f, 1.0f, 0.0f);
+			v3 X = NOZ(Cross(Up, Direction));
+			v3 Y = Cross(Direction, X);
+			f32 DiskRadius = Target->Radius*SquareRoot(Random[3]);
+			f32 Phi = 2.0f*Pi32*Random[4];
+
+			Emission->P = (Target->Center - 2.0f*Target->Radius*Direction +
+			               DiskRadius*Cos(Phi)*X + DiskRadius*Sin(Phi)*Y);
+			Emission->Direction = Direction;
+			Emission->Power = (Pi32*Square(Target->Radius) / PhotonCount)*World->LightColor;
+			Result = true;
+		} break;
+
+		case CausticSource_Light:
+		{
+			light *Light = World->Lights + Beam->SourceIndex;
+			v3 ToTarget = Target->Center - Light->P;
+			f32 DistanceSq = LengthSq(ToTarget);
+			f32 SolidAngle = GetSphereSolidAngle(DistanceSq, Target->Radius);
+			if(SolidAngle > 0.0f)
+			{
+				f32 CosMax = SquareRoot(1.0f - Square(Target->Radius) / DistanceSq);
+				v3 Direction = SampleCone(NOZ(ToTarget), CosMax, Random[0], Random[1]);
+				f32 Falloff = GetLightFalloff(Light, Direction);
+
+				Emission->P = Light->P;
+				Emission->Direction = Direction;
+				Emission->Power = (Falloff*SolidAngle / PhotonCount)*Light->Color;
+				Result = (Falloff > 0.0f);
+			}
+		} break;
+
+		InvalidDefaultCase;
+	}
+	return Result;
+}
+
+inline u32
+GetCausticCell(caustic_map *Map, s32 X, s32 Y, s32 Z)
+{
+	u32 Result = (((u32)X*73856093) ^ ((u32)Y*19349663) ^ ((u32)Z*83492791)) & Map->CellMask;
+	return Result;
+}
+
+inline u32
+GetCausticCell(caustic_map *Map, v3 P)
+{
+	v3 Cell = Map->InvCellDim*P;
+	u32 Result = GetCausticCell(Map, FloorReal32ToInt32(Cell.x), FloorReal32ToInt32(Cell.y), FloorReal32ToInt32(Cell.z));
+	return Result;
+}
+
+// NOTE: A counting sort of the stored photons by cell. It goes through
+// Traced in photon order, so the map comes out the same however the
+// tracing was split between threads.
+internal void
+SortCausticPhotons(caustic_map *Map)
+{
+	u32 CellCount = Map->CellMask + 1;
+	memset(Map->CellStarts, 0, (CellCount + 1)*sizeof(u32));
+	memset(Map->CellOccupied, 0, ((CellCount + 31) / 32)*sizeof(u32));
+	rectangle3 Bounds = InvertedInfinityRectangle3();
+	for(u32 PhotonIndex = 0;
+		PhotonIndex < Map->PhotonsPerPass;
+		++PhotonIndex)
+	{
+		caustic_photon *Photon = Map->Traced + PhotonIndex;
+		if(LengthSq(Photon->Power) > 0.0f)
+		{
+			u32 Cell = GetCausticCell(Map, Photon->P);
+			++Map->CellStarts[Cell];
+			Map->CellOccupied[Cell / 32] |= (1 << (Cell % 32));
+			Bounds = Combine(Bounds, Rectangle3(Photon->P, Photon->P));
+		}
+	}
+	v3 Margin = V3(Map->Radius, Map->Radius, Map->Radius);
+	Map->Bounds = Rectangle3(Bounds.Min - Margin, Bounds.Max + Margin);
+
+	for(u32 Cell = 1;
+		Cell < CellCount;
+		++Cell)
+	{
+		Map->CellStarts[Cell] += Map->CellStarts[Cell - 1];
+	}
+	Map->PhotonCount = Map->CellStarts[CellCount - 1];
+	Map->CellStarts[CellCount] = Map->PhotonCount;
+
+	// NOTE: Each cell's entry is its end now. Filling back to front from
+	// there leaves it pointing at the cell's start.
+	for(u32 PhotonIndex = Map->PhotonsPerPass;
+		PhotonIndex > 0;
+		--PhotonIndex)
+	{
+		caustic_photon *Photon = Map->Traced + PhotonIndex - 1;
+		if(LengthSq(Photon->Power) > 0.0f)
+		{
+			u32 Cell = GetCausticCell(Map, Photon->P);
+			Map->Photons[--Map->CellStarts[Cell]] = *Photon;
+		}
+	}
+}
+
+// NOTE: What the caustic photons around P add at a rough hit, for the path
+// to scale by its attenuation as it would a shadow ray's light. Normal faces
+// the side the path arrived on.
+internal v3
+GetCausticRadiance(caustic_map *Map, v3 P, v3 Normal)
+{
+	v3 Result = {};
+	if(Map->PhotonCount && InsideRectangle(Map->Bounds, P))
+	{
+		f32 RadiusSq = Square(Map->Radius);
+		v3 MinCell = Map->InvCellDim*(P - V3(Map->Radius, Map->Radius, Map->Radius));
+		s32 MinX = FloorReal32ToInt32(MinCell.x);
+		s32 MinY = FloorReal32ToInt32(MinCell.y);
+		s32 MinZ = FloorReal32ToInt32(MinCell.z);
+
+		// NOTE: Two of the 8 cells can hash to the same slot, which must
+		// only be read once.
+		u32 Visited[8];
+		u32 VisitedCount = 0;
+		for(u32 Neighbor = 0;
+			Neighbor < 8;
+			++Neighbor)
+		{
+			u32 Cell = GetCausticCell(Map, MinX + (Neighbor & 1), MinY + ((Neighbor >> 1) & 1), MinZ + (Neighbor >> 2));
+			if(!(Map->CellOccupied[Cell / 32] & (1 << (Cell % 32))))
+			{
+				continue;
+			}
+
+			b32 Seen = false;
+			for(u32 VisitedIndex = 0;
+				VisitedIndex < VisitedCount;
+				++VisitedIndex)
+			{
+				Seen |= (Visited[VisitedIndex] == Cell);
+			}
+			if(Seen)
+			{
+				continue;
+			}
+			Visited[VisitedCount++] = Cell;
+
+			for(u32 PhotonIndex = Map->CellStarts[Cell];
+				PhotonIndex < Map->CellStarts[Cell + 1];
+				++PhotonIndex)
+			{
+				caustic_photon *Photon = Map->Photons + PhotonIndex;
+				f32 DistanceSq = LengthSq(Photon->P - P);
+				if((DistanceSq < RadiusSq) && (Inner(Photon->Normal, Normal) > CAUSTIC_MIN_NORMAL_COS))
+				{
+					Result += (1.0f - DistanceSq/RadiusSq)*Photon->Power;
+				}
+			}
+		}
+
+		// NOTE: The kernel integrates to Pi*Radius^2/2 over the disk.
+		Result = (2.0f / (Pi32*RadiusSq))*Result;
+	}
+	return Result;
+}
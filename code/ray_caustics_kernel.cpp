@@ -0,0 +1,138 @@
+/*@H
+* File: ray_caustics_kernel.cpp
+* Author: Jesse Calvert
+* Created: October 19, 2026, 15:14
+* Last modified: October 19, 2026, 15:38
+*/
+
+// NOTE: The per instruction set half of ray_caustics.cpp, compiled into each
+// kernel namespace by ray_kernel.cpp: tracing the photons. Photons take the
+// same turns a path does, so they go through the scalar tracer's pieces.
+
+// NOTE: Traces one photon and leaves it in Traced, with no power if it
+// never reached a rough surface through the beam's caster. Returns the
+// number of rays it cast.
+internal u32
+TraceCausticPhoton(world *World, caustic_map *Map, u32 PhotonIndex, u32 FrameIndex)
+{
+	caustic_photon *Photon = Map->Traced + PhotonIndex;
+	*Photon = {};
+
+	caustic_beam *Beam = FindCausticBeam(Map, PhotonIndex);
+	random_series Series = RandomSeries(GetSampleSeed(FrameIndex, PhotonIndex, CAUSTIC_SEED_SAMPLE));
+	f32 Random[5];
+	for(u32 Index = 0;
+		Index < ArrayCount(Random);
+		++Index)
+	{
+		Random[Index] = RandomUnilateral(&Series);
+	}
+
+	caustic_emission Emission;
+	if(!EmitCausticPhoton(World, Beam, Random, &Emission))
+	{
+		return 0;
+	}
+
+	u32 RayCount = 0;
+	v3a RayOrigin = V3a(Emission.P);
+	v3a RayDirection = V3a(Emission.Direction);
+	v3 Power = Emission.Power;
+	if(Beam->Source == CausticSource_Sun)
+	{
+		// NOTE: The disk the photon starts from could be in shadow.
+		++RayCount;
+		if(SingleRayCast(World, RayOrigin, -RayDirection, Real32Maximum).MaterialHit)
+		{
+			return RayCount;
+		}
+	}
+
+	b32 InsideObject = false;
+	for(u32 BounceIndex = 0;
+		BounceIndex < CAUSTIC_MAX_BOUNCES;
+		++BounceIndex)
+	{
+		++RayCount;
+		ray_cast_result RayCastResult = SingleRayCast(World, RayOrigin, RayDirection, Real32Maximum);
+		material *MaterialHit = RayCastResult.MaterialHit;
+		if(!MaterialHit ||
+		   ((BounceIndex == 0) && (MaterialHit != &World->Objects[Beam->TargetIndex].Material)))
+		{
+			break;
+		}
+
+		v3a HitNormal = RayCastResult.HitNormal;
+		v3a NewRayOrigin = RayOrigin + RayCastResult.ClosestHit*RayDirection;
+		f32 CosIncidentAngle = Inner(-RayDirection, HitNormal);
+		if(CosIncidentAngle < 0.0f) {CosIncidentAngle = -CosIncidentAngle;}
+		v3a PureBounce = RayDirection + 2.0f*CosIncidentAngle*HitNormal;
+
+		if(MaterialHit->Transparent)
+		{
+			RayOrigin = NewRayOrigin;
+			// NOTE: Rays leave glass longer than they went in (see
+			// ray_caustics.cpp), which would throw off the cosines after.
+			RayDirection = NOZ(ScatterTransparent(MaterialHit, RayDirection, HitNormal, CosIncidentAngle, PureBounce,
+			                                      &InsideObject, &Series));
+		}
+		else if(MaterialHit->Specularity >= MIS_MAX_SPECULARITY)
+		{
+			Power = Hadamard(Power, CosIncidentAngle*MaterialHit->ReflectionColor);
+
+			RayOrigin = NewRayOrigin;
+			v3a RandomBounce = NOZ(V3a(RandomBilateral(&Series), RandomBilateral(&Series), RandomBilateral(&Series)));
+			if(Inner(RandomBounce, HitNormal) < 0)
+			{
+				RandomBounce = -RandomBounce;
+			}
+			RayDirection = NOZ(Lerp(RandomBounce, MaterialHit->Specularity, PureBounce));
+		}
+		else
+		{
+			// NOTE: Only photons that went through a caster get here.
+			Photon->P = V3(NewRayOrigin);
+			Photon->Normal = V3((Inner(RayDirection, HitNormal) > 0.0f) ? -HitNormal : HitNormal);
+			Photon->Power = Power;
+			if(Beam->Source == CausticSource_Sun)
+			{
+				Photon->Power = (1.0f / Maximum(CosIncidentAngle, CAUSTIC_MIN_COS))*Power;
+			}
+			break;
+		}
+	}
+
+	return RayCount;
+}
+
+// NOTE: Run on every thread through the tile queue, like a frame; each call
+// takes batches of photons until there are none left, whichever tile it was
+// handed.
+internal TILE_KERNEL(TraceCausticsKernel)
+{
+	world *World = WorkOrder->World;
+	caustic_map *Map = World->Caustics;
+	u32 RayCount = 0;
+	for(;;)
+	{
+		u32 BatchIndex = LockedAddAndReturnPreviousValue(&Map->NextBatch, 1);
+		if(BatchIndex >= Map->BatchCount)
+		{
+			break;
+		}
+
+		u32 FirstPhoton = BatchIndex*CAUSTIC_BATCH_SIZE;
+		u32 OnePastLastPhoton = Minimum(FirstPhoton + CAUSTIC_BATCH_SIZE, Map->PhotonsPerPass);
+		for(u32 PhotonIndex = FirstPhoton;
+			PhotonIndex < OnePastLastPhoton;
+			++PhotonIndex)
+		{
+			RayCount += TraceCausticPhoton(World, Map, PhotonIndex, FrameIndex);
+		}
+	}
+
+	if(RayCount)
+	{
+		LockedAddAndReturnPreviousValue(RaysCast, RayCount);
+	}
+}
@@ -0,0 +1,111 @@
+/*@H
+* File: ray_convergence.cpp
+* Author: Jesse Calvert
+* Created: October 19, 2026, 14:08
+* Last modified: October 19, 2026, 14:08
+*/
+
+// NOTE: The convergence benchmark, run with -convergence MAXSPP. Rays per
+// second say nothing about whether a change gets to a clean image sooner,
+// so this renders a high sample count ground truth first, then the same
+// frame at 1, 2, 4, ... samples up to MAXSPP, and measures each one's RMSE
+// against the ground truth (on linear radiance) and its wall time. Monte
+// Carlo error squared falls as 1/time, so efficiency, 1/(RMSE^2 * time),
+// comes out flat for a plain path tracer. A sampling or integrator change
+// that really helps raises the whole curve; one that only trades time for
+// noise just moves along it.
+//
+// The ground truth is drawn from a frame index no benchmark step uses, so
+// its samples are independent of theirs. Its own noise still adds to every
+// step's error, so it wants several times MAXSPP.
+
+#define CONVERGENCE_REFERENCE_FRAME 0xFFFFFFFF
+
+internal void
+SetTileSamples(work_queue *WorkQueue, u32 RaysPerPixel)
+{
+	for(u32 TileIndex = 0;
+		TileIndex < WorkQueue->TileQueueSize;
+		++TileIndex)
+	{
+		WorkQueue->TileWorkQueue[TileIndex].FirstSample = 0;
+		WorkQueue->TileWorkQueue[TileIndex].RaysPerPixel = RaysPerPixel;
+	}
+}
+
+internal f64
+GetRadianceRMSE(image *Image, v3 *Reference)
+{
+	f64 SquaredError = 0.0;
+	for(u32 Y = 0;
+		Y < Image->Height;
+		++Y)
+	{
+		for(u32 X = 0;
+			X < Image->Width;
+			++X)
+		{
+			u32 RadianceIndex = GetRadianceIndex(Image, X, Y);
+			v3 Error = Image->Radiance[RadianceIndex] - Reference[RadianceIndex];
+			SquaredError += (f64)Error.x*Error.x + (f64)Error.y*Error.y + (f64)Error.z*Error.z;
+		}
+	}
+
+	f64 Result = sqrt(SquaredError / (3.0*Image->PixelCount));
+	return Result;
+}
+
+internal s32
+RunConvergence(work_queue *WorkQueue, image *Image, u32 MaxSamples, u32 ReferenceSamples, char *CSVFilename)
+{
+	if(ReferenceSamples < 4*MaxSamples)
+	{
+		printf("Warning: a %u spp ground truth is noisy next to %u spp; its own error will show in the curve.\n",
+		       ReferenceSamples, MaxSamples);
+	}
+
+	u32 RadianceCount = GetRadianceCount(Image);
+	v3 *Reference = (v3 *)malloc(RadianceCount*sizeof(v3));
+
+	SetTileSamples(WorkQueue, ReferenceSamples);
+	WorkQueue->FrameIndex = CONVERGENCE_REFERENCE_FRAME;
+	f64 ReferenceStart = GetWallClock();
+	RenderFrame(WorkQueue, true);
+	f64 ReferenceSeconds = GetWallClock() - ReferenceStart;
+	memcpy(Reference, Image->Radiance, RadianceCount*sizeof(v3));
+	printf("\rGround truth: %u spp in %.2f s\n", ReferenceSamples, ReferenceSeconds);
+
+	FILE *CSV = CSVFilename ? fopen(CSVFilename, "wb") : 0;
+	if(CSV)
+	{
+		fprintf(CSV, "spp,seconds,rays,rmse,efficiency\n");
+	}
+
+	printf("%8s %10s %12s %12s %14s\n", "spp", "seconds", "rays", "RMSE", "1/(RMSE^2 s)");
+	WorkQueue->FrameIndex = 0;
+	for(u32 Samples = 1;
+		Samples <= MaxSamples;
+		Samples *= 2)
+	{
+		SetTileSamples(WorkQueue, Samples);
+		f64 StepStart = GetWallClock();
+		RenderFrame(WorkQueue, false);
+		f64 StepSeconds = GetWallClock() - StepStart;
+
+		f64 RMSE = GetRadianceRMSE(Image, Reference);
+		f64 Efficiency = 1.0 / (RMSE*RMSE*StepSeconds);
+		printf("%8u %10.4f %12u %12.6f %14.1f\n", Samples, StepSeconds, WorkQueue->RaysCast, RMSE, Efficiency);
+		fflush(stdout);
+		if(CSV)
+		{
+			fprintf(CSV, "%u,%f,%u,%f,%f\n", Samples, StepSeconds, WorkQueue->RaysCast, RMSE, Efficiency);
+		}
+	}
+
+	if(CSV)
+	{
+		fclose(CSV);
+	}
+	free(Reference);
+	return 0;
+}
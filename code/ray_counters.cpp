@@ -0,0 +1,147 @@
+/*@H
+* File: ray_counters.cpp
+* Author: Jesse Calvert
+* Created: October 19, 2026, 13:30
+* Last modified: October 19, 2026, 13:47
+*/
+
+// NOTE: Event counters around tile rendering, turned on with -counters.
+// Each thread opens its own counters the first time it renders a tile and
+// adds what changed across every tile into its own slot, so the idle and
+// coordination time in between never shows up. Where the platform can't
+// supply a counter (no PMU in a container, say) it's reported as n/a and
+// rendering carries on.
+
+#define MAX_COUNTER_THREADS 256
+
+struct counter_thread
+{
+	u32 Available;
+	u64 Totals[PerfCounter_Count];
+};
+
+struct tile_counters
+{
+	counter_thread *Thread;
+	u64 Start[PerfCounter_Count];
+};
+
+global_variable b32 CountersEnabled;
+global_variable char *CounterError;
+global_variable counter_thread CounterThreads[MAX_COUNTER_THREADS];
+global_variable volatile u32 CounterThreadCount;
+global_variable thread_local counter_thread *CounterThread;
+
+inline counter_thread *
+GetCounterThread()
+{
+	if(!CounterThread)
+	{
+		u32 ThreadIndex = LockedAddAndReturnPreviousValue(&CounterThreadCount, 1);
+		Assert(ThreadIndex < MAX_COUNTER_THREADS);
+		CounterThread = CounterThreads + ThreadIndex;
+		CounterThread->Available = OpenThreadCounters(&CounterError);
+	}
+
+	counter_thread *Result = CounterThread;
+	return Result;
+}
+
+internal void
+StartCounters()
+{
+	CountersEnabled = true;
+
+	// NOTE: Opening the main thread's counters up front finds out early
+	// whether there's anything to count.
+	counter_thread *Thread = GetCounterThread();
+	if(!(Thread->Available & (1 << PerfCounter_Cycles)))
+	{
+		printf("Hardware counters unavailable (%s)%s\n", CounterError ? CounterError : "unknown",
+		       Thread->Available ? ", counting software events only." : ".");
+	}
+}
+
+inline void
+BeginTileCounters(tile_counters *Counters)
+{
+	Counters->Thread = GetCounterThread();
+	ReadThreadCounters(Counters->Start);
+}
+
+inline void
+EndTileCounters(tile_counters *Counters)
+{
+	u64 End[PerfCounter_Count];
+	ReadThreadCounters(End);
+
+	counter_thread *Thread = Counters->Thread;
+	for(u32 Counter = 0;
+		Counter < PerfCounter_Count;
+		++Counter)
+	{
+		if(Thread->Available & (1 << Counter))
+		{
+			Thread->Totals[Counter] += End[Counter] - Counters->Start[Counter];
+		}
+	}
+}
+
+internal void
+PrintCounterRatio(char *Name, u64 *Totals, u32 Available, u32 Counter, f64 Divisor, u32 Decimals, char *Unit)
+{
+	if((Available & (1 << Counter)) && (Divisor > 0.0))
+	{
+		printf("  %-24s %12.*f%s\n", Name, Decimals, (f64)Totals[Counter] / Divisor, Unit);
+	}
+	else
+	{
+		printf("  %-24s %12s\n", Name, "n/a");
+	}
+}
+
+// NOTE: Call once the render threads are idle.
+internal void
+PrintCounters(u64 RaysCast, f64 RenderSeconds)
+{
+	u32 ThreadCount = Minimum(CounterThreadCount, MAX_COUNTER_THREADS);
+
+	// NOTE: A counter is only reported if every thread that rendered had it.
+	u64 Totals[PerfCounter_Count] = {};
+	u32 Available = 0xFFFFFFFF;
+	for(u32 ThreadIndex = 0;
+		ThreadIndex < ThreadCount;
+		++ThreadIndex)
+	{
+		counter_thread *Thread = CounterThreads + ThreadIndex;
+		Available &= Thread->Available;
+		for(u32 Counter = 0;
+			Counter < PerfCounter_Count;
+			++Counter)
+		{
+			Totals[Counter] += Thread->Totals[Counter];
+		}
+	}
+	if(!ThreadCount)
+	{
+		Available = 0;
+	}
+
+	f64 Rays = (f64)RaysCast;
+	printf("Counters (%u threads, tile rendering only):\n", ThreadCount);
+	printf("  %-24s %12.2f M\n", "Rays/s", RenderSeconds > 0.0 ? (1.0e-6*Rays / RenderSeconds) : 0.0);
+	PrintCounterRatio("IPC", Totals, Available, PerfCounter_Instructions,
+	                  (Available & (1 << PerfCounter_Cycles)) ? (f64)Totals[PerfCounter_Cycles] : 0.0, 2, "");
+	PrintCounterRatio("Cycles/ray", Totals, Available, PerfCounter_Cycles, Rays, 2, "");
+	PrintCounterRatio("Instructions/ray", Totals, Available, PerfCounter_Instructions, Rays, 2, "");
+	PrintCounterRatio("L1D read misses/ray", Totals, Available, PerfCounter_L1DMisses, Rays, 2, "");
+	PrintCounterRatio("LLC misses/ray", Totals, Available, PerfCounter_LLCMisses, Rays, 2, "");
+	PrintCounterRatio("Local DRAM loads/ray", Totals, Available, PerfCounter_LocalNodeLoads, Rays, 2, "");
+	PrintCounterRatio("Remote DRAM loads/ray", Totals, Available, PerfCounter_RemoteNodeLoads, Rays, 2, "");
+
+	// NOTE: Every counted ray is one query against the whole scene.
+	PrintCounterRatio("Mispredicts/intersection", Totals, Available, PerfCounter_BranchMisses, Rays, 2, "");
+	PrintCounterRatio("Task clock", Totals, Available, PerfCounter_TaskClock, 1.0e6, 1, " ms");
+	PrintCounterRatio("Context switches", Totals, Available, PerfCounter_ContextSwitches, 1.0, 0, "");
+	PrintCounterRatio("Page faults", Totals, Available, PerfCounter_PageFaults, 1.0, 0, "");
+}
@@ -0,0 +1,216 @@
+/*@H
+* File: ray_deadline.cpp
+* Author: Jesse Calvert
+* Created: October 19, 2026, 13:22
+* Last modified: October 19, 2026, 16:28
+*/
+
+// NOTE: Deadline rendering. Instead of a fixed sample count, the frame is
+// rendered in passes over every tile until a wall-clock deadline, and
+// whatever has accumulated by then is resolved and written. The first pass is
+// one sample per pixel and calibrates throughput. Each later pass asks for
+// about half of the time left, so passes shrink toward the deadline and the
+// one it cuts short leaves only a few tiles a little behind the rest.
+
+// NOTE: SRGBThresholds[Byte] is the smallest linear value the single
+// packer takes to Byte or more, for the 8-wide resolve to check itself
+// against (see ray_deadline_kernel.cpp); the two ends are padded so every
+// byte has a pair. Floats from 0 up order the same as their bits, so each is
+// a binary search over the bits up to 1.0f.
+internal void
+BuildSRGBThresholds(f32 *SRGBThresholds)
+{
+	SRGBThresholds[0] = -Real32Maximum;
+	SRGBThresholds[256] = Real32Maximum;
+	for(u32 Byte = 1;
+		Byte < 256;
+		++Byte)
+	{
+		u32 Low = 0;
+		u32 High = 0x3F800000;
+		while(Low < High)
+		{
+			u32 Middle = Low + (High - Low) / 2;
+			f32 Value;
+			memcpy(&Value, &Middle, sizeof(Value));
+			if((kernel_sse2::PackLinear01ToSRGBU32(V3(Value, Value, Value)) & 0xFF) >= Byte)
+			{
+				High = Middle;
+			}
+			else
+			{
+				Low = Middle + 1;
+			}
+		}
+		memcpy(SRGBThresholds + Byte, &Low, sizeof(Low));
+	}
+}
+
+internal s32
+RenderToDeadline(work_queue *WorkQueue, image *Image, f64 Deadline, u32 MaxSamples, char *Filename,
+                 resolve_kernel *ResolveKernel)
+{
+	tile_work_order *Tiles = WorkQueue->TileWorkQueue;
+	u32 TileCount = WorkQueue->TileQueueSize;
+
+	// NOTE: Radiance comes from the caller, already prefaulted by the pool.
+	u32 RadianceCount = GetRadianceCount(Image);
+	v3 *Accumulated = (v3 *)calloc(RadianceCount, sizeof(v3));
+	u32 *SampleCount = (u32 *)calloc(RadianceCount, sizeof(u32));
+	f32 SRGBThresholds[257];
+	BuildSRGBThresholds(SRGBThresholds);
+
+	// NOTE: SecondsPerSample is the whole pool's; one thread takes PoolSize
+	// times as long on its own tile. The workers stop taking tiles early
+	// enough that the ones still in flight, folding them in, and resolving
+	// and writing the image all land before the deadline. The last of those
+	// is measured up front: packing cost depends on the colors, so a slice of
+	// the image is resolved from a color ramp rather than timing the empty image.
+	u32 PoolSize = WorkQueue->ThreadCount + 1;
+	u32 TilePixelCount = GetTilePixelCount(Tiles);
+	f64 SecondsPerSample = 0.0;
+	f64 AccumulateSeconds = 0.0;
+
+	u32 SliceRows = Maximum(Image->Height / 16, 1);
+	u32 SliceCount = AlignPow2(SliceRows, RADIANCE_BLOCK_DIM)*Image->Stride;
+	for(u32 PixelIndex = 0;
+		PixelIndex < SliceCount;
+		++PixelIndex)
+	{
+		f32 Value = (f32)(PixelIndex & 255) / 64.0f;
+		Accumulated[PixelIndex] = V3(Value, 0.5f*Value, 0.25f*Value);
+		SampleCount[PixelIndex] = 4;
+	}
+	f64 ResolveStart = GetWallClock();
+	ResolveKernel(Image, Accumulated, SampleCount, 0, SliceRows, SRGBThresholds);
+	f64 ResolveSeconds = ((f64)Image->Height / SliceRows)*(GetWallClock() - ResolveStart);
+	memset(Accumulated, 0, SliceCount*sizeof(v3));
+	memset(SampleCount, 0, SliceCount*sizeof(u32));
+
+	memset(Image->Pixels, 0, Image->PixelsSize);
+	f64 WriteStart = GetWallClock();
+	WriteImage(Image, Filename);
+	f64 FinishSeconds = 1.25*(ResolveSeconds + GetWallClock() - WriteStart);
+
+	u32 PassCount = 0;
+	u32 SamplesDone = 0;
+	u32 TilesAhead = 0;
+	u32 TilesAheadSamples = 0;
+	u64 RaysCast = 0;
+	f64 RenderStart = GetWallClock();
+	for(;;)
+	{
+		f64 PassStart = GetWallClock();
+		SetTimelineFrame(PassCount);
+		f64 Remaining = Deadline - PassStart - AccumulateSeconds - FinishSeconds;
+		if((PassCount > 0) && ((Remaining <= 0.0) || (SamplesDone >= MaxSamples)))
+		{
+			break;
+		}
+
+		u32 PassSamples = 1;
+		f64 TileSeconds = 0.0;
+		if(SecondsPerSample > 0.0)
+		{
+			// NOTE: Half of what's left, but never so much per tile that the
+			// tiles still in flight at the cutoff are a big slice of it.
+			f64 TileSecondsPerSample = PoolSize*SecondsPerSample*TilePixelCount;
+			f64 Affordable = 0.5*Remaining / (SecondsPerSample*Image->PixelCount);
+			Affordable = Minimum(Affordable, 0.125*Remaining / TileSecondsPerSample);
+			PassSamples = (u32)Maximum(Minimum(Affordable, (f64)(MaxSamples - SamplesDone)), 1.0);
+			TileSeconds = PassSamples*TileSecondsPerSample;
+		}
+
+		for(u32 TileIndex = 0;
+			TileIndex < TileCount;
+			++TileIndex)
+		{
+			Tiles[TileIndex].FirstSample = SamplesDone;
+			Tiles[TileIndex].RaysPerPixel = PassSamples;
+		}
+
+		f64 WorkerDeadline = Deadline - AccumulateSeconds - FinishSeconds - TileSeconds;
+		u32 OnePastLastTile = RenderTilesUntil(WorkQueue, 0, TileCount, WorkerDeadline);
+		f64 RenderEnd = GetWallClock();
+		RaysCast += WorkQueue->RaysCast;
+
+		u32 SamplesRendered = 0;
+		for(u32 TileIndex = 0;
+			TileIndex < OnePastLastTile;
+			++TileIndex)
+		{
+			tile_work_order *Tile = Tiles + TileIndex;
+			SamplesRendered += GetTilePixelCount(Tile)*PassSamples;
+			for(u32 Y = Tile->MinY;
+				Y < Tile->OnePastMaxY;
+				++Y)
+			{
+				for(u32 X = Tile->MinX;
+					X < Tile->OnePastMaxX;
+					++X)
+				{
+					u32 PixelIndex = GetRadianceIndex(Image, X, Y);
+					Accumulated[PixelIndex] += (f32)PassSamples*Image->Radiance[PixelIndex];
+					SampleCount[PixelIndex] += PassSamples;
+				}
+			}
+		}
+		f64 AccumulateEnd = GetWallClock();
+		AccumulateSeconds = Maximum(AccumulateSeconds, AccumulateEnd - RenderEnd);
+		RecordTimelineSpan("pass", PassCount, PassStart, AccumulateEnd);
+		++PassCount;
+
+		if(OnePastLastTile < TileCount)
+		{
+			TilesAhead = OnePastLastTile;
+			TilesAheadSamples = SamplesDone + PassSamples;
+			if(PassCount == 1)
+			{
+				printf("\rThe deadline only left time for %u of %u tiles at one sample per pixel.\n",
+				       OnePastLastTile, TileCount);
+			}
+			break;
+		}
+
+		// NOTE: Only full passes calibrate; a cut short one includes the
+		// time the pool spent draining.
+		SecondsPerSample = (RenderEnd - PassStart) / SamplesRendered;
+		SamplesDone += PassSamples;
+
+		printf("\rPass %u: %u spp", PassCount, SamplesDone);
+		fflush(stdout);
+	}
+
+	ResolveKernel(Image, Accumulated, SampleCount, 0, Image->Height, SRGBThresholds);
+	WriteImage(Image, Filename);
+
+	f64 Finished = GetWallClock();
+	printf("\rDeadline render: %u passes, %u spp", PassCount, SamplesDone);
+	if(TilesAhead)
+	{
+		printf(" (%u tiles at %u)", TilesAhead, TilesAheadSamples);
+	}
+	printf("\nRays: %llu\n", (unsigned long long)RaysCast);
+	f64 MarginMS = 1000.0*(Deadline - Finished);
+	if(MarginMS >= 0.0)
+	{
+		printf("Finished %.1f ms before the deadline\n", MarginMS);
+	}
+	else
+	{
+		printf("Finished %.1f ms after the deadline\n", -MarginMS);
+	}
+
+#if RAY_PROFILE
+	PrintProfile(RaysCast);
+#endif
+
+	if(CountersEnabled)
+	{
+		PrintCounters(RaysCast, Finished - RenderStart);
+	}
+
+	free(SampleCount);
+	free(Accumulated);
+	return 0;
+}
@@ -0,0 +1,131 @@
+/*@H
+* File: ray_deadline_kernel.cpp
+* Author: Jesse Calvert
+* Created: October 19, 2026, 16:25
+* Last modified: October 19, 2026, 16:28
+*/
+
+// NOTE: The per instruction set half of ray_deadline.cpp, compiled into each
+// kernel namespace by ray_kernel.cpp: resolving what the passes accumulated.
+
+// NOTE: Packs to the same bits as PackLinear01ToSRGBU32, eight at a time.
+// A blend of square roots lands each channel within a step of its byte with
+// no Pow. Checking against SRGBThresholds, the smallest linear value that
+// reaches each byte (see BuildSRGBThresholds), catches the lanes that missed,
+// and those are walked to the right byte one at a time.
+inline u32x8
+PackLinear01ToSRGBU32x8(v3x8 Color, f32 *SRGBThresholds)
+{
+	u32x8 Result = U32x8(0xFF000000);
+	for(u32 Channel = 0;
+		Channel < 3;
+		++Channel)
+	{
+		f32x8 Linear = Color.E[Channel];
+		f32x8 Clamped = Min(Max(Linear, F32x8(0.0f)), F32x8(1.0f));
+		f32x8 Root2 = SquareRoot(Clamped);
+		f32x8 Root4 = SquareRoot(Root2);
+		f32x8 Root8 = SquareRoot(Root4);
+		f32x8 Curve = 0.662002687f*Root2 + 0.684122060f*Root4 - 0.323583601f*Root8 - 0.0225411470f*Clamped;
+		f32x8 Encoded = Select(Clamped < 0.0031308f, 12.92f*Clamped, Curve);
+		u32x8 Byte = U32x8FromF32x8(Min(Max(255.0f*Encoded + 0.5f, F32x8(0.0f)), F32x8(255.0f)));
+
+		// NOTE: Max gives back its second argument for NaN, so Clamped and
+		// Byte stay in range and the gathers never leave the table.
+		f32x8 Low = GatherF32x8(SRGBThresholds, Byte);
+		f32x8 High = GatherF32x8(SRGBThresholds + 1, Byte);
+		if(AnyTrue((Linear < Low) | AndNot(Mask8(true), Linear < High)))
+		{
+			for(u32 Lane = 0;
+				Lane < LANE_WIDTH;
+				++Lane)
+			{
+				u32 Value = Byte.E[Lane];
+				f32 LaneLinear = Linear.E[Lane];
+				while((Value > 0) && (LaneLinear < SRGBThresholds[Value]))
+				{
+					--Value;
+				}
+				while((Value < 255) && (LaneLinear >= SRGBThresholds[Value + 1]))
+				{
+					++Value;
+				}
+				Byte.E[Lane] = Value;
+			}
+		}
+
+		Result = Result | (Byte << (16 - 8*Channel));
+	}
+	return Result;
+}
+
+// NOTE: Accumulated and SampleCount share the image's radiance layout, so
+// this also detiles a blocked one: each block-aligned run of a row is
+// contiguous in both, and goes straight into the matching run of Pixels.
+// Full runs are resolved eight pixels at a time; the ragged one at the right
+// edge of a row goes through the single packer.
+internal RESOLVE_KERNEL(ResolveAccumulatedKernel)
+{
+	for(u32 Y = FirstRow;
+		Y < OnePastLastRow;
+		++Y)
+	{
+		u32 *Dest = GetPixelPointer(Image, 0, Y);
+		for(u32 RunX = 0;
+			RunX < Image->Width;
+			RunX += RADIANCE_BLOCK_DIM)
+		{
+			u32 RunIndex = GetRadianceIndex(Image, RunX, Y);
+			u32 RunWidth = Minimum(Image->Width - RunX, RADIANCE_BLOCK_DIM);
+			if(RunWidth == LANE_WIDTH)
+			{
+				v3x8 Sum;
+				f32x8 Count;
+				b32 AnyEmpty = false;
+				for(u32 Lane = 0;
+					Lane < LANE_WIDTH;
+					++Lane)
+				{
+					SetLane(&Sum, Lane, Accumulated[RunIndex + Lane]);
+					Count.E[Lane] = (f32)SampleCount[RunIndex + Lane];
+					AnyEmpty |= (SampleCount[RunIndex + Lane] == 0);
+				}
+
+				mask8 Filled = (Count > 0.0f);
+				f32x8 InvCount = Select(Filled, F32x8(1.0f) / Select(Filled, Count, F32x8(1.0f)), F32x8(0.0f));
+				StoreU32x8(Dest, PackLinear01ToSRGBU32x8(InvCount*Sum, SRGBThresholds));
+
+				// NOTE: Pixels nothing reached yet stay 0, alpha included.
+				if(AnyEmpty)
+				{
+					for(u32 Lane = 0;
+						Lane < LANE_WIDTH;
+						++Lane)
+					{
+						if(!SampleCount[RunIndex + Lane])
+						{
+							Dest[Lane] = 0;
+						}
+					}
+				}
+				Dest += LANE_WIDTH;
+			}
+			else
+			{
+				for(u32 RunOffset = 0;
+					RunOffset < RunWidth;
+					++RunOffset)
+				{
+					u32 PixelIndex = RunIndex + RunOffset;
+					u32 Pixel = 0;
+					if(SampleCount[PixelIndex])
+					{
+						v3 Color = (1.0f / (f32)SampleCount[PixelIndex])*Accumulated[PixelIndex];
+						Pixel = PackLinear01ToSRGBU32(Color);
+					}
+					*Dest++ = Pixel;
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,687 @@
+/*@H
+* File: ray_distributed.cpp
+* Author: Jesse Calvert
+* Created: October 19, 2026, 12:52
+* Last modified: October 19, 2026, 13:51
+*/
+
+// NOTE: Distributed rendering over TCP. The coordinator owns the output
+// image and deals out contiguous ranges of the tile work orders; each worker
+// process builds its own copy of the scene from the job description, renders
+// the ranges it is handed on its own thread pool and streams the finished
+// tiles back. A worker that disconnects, or goes quiet for longer than the
+// timeout, is dropped and its range goes back in the queue. Messages are
+// sent as raw little-endian structs, which covers every machine this runs on.
+
+#define DISTRIBUTED_MAGIC LittleEndianTag('R', 'A', 'Y', 'D')
+#define DISTRIBUTED_VERSION 1
+#define MAX_DISTRIBUTED_WORKERS 64
+#define MAX_DISTRIBUTED_RANGES 256
+
+enum message_type
+{
+	Message_Hello,
+	Message_Job,
+	Message_Ready,
+	Message_RenderRange,
+	Message_Tile,
+	Message_RangeDone,
+	Message_Shutdown,
+
+	// NOTE: Render server requests, see ray_server.cpp.
+	Message_RenderRequest,
+	Message_RenderDone,
+};
+
+struct message_header
+{
+	u32 Magic;
+	u32 Type;
+	u32 Size;
+};
+
+struct hello_message
+{
+	u32 Version;
+};
+
+enum tile_format
+{
+	TileFormat_SRGB8,
+	TileFormat_Half,
+};
+
+struct job_message
+{
+	char SceneName[32];
+	u32 Width;
+	u32 Height;
+	u32 TileDim;
+	u32 RaysPerPixel;
+	u32 MaxBounces;
+	u32 LaneWidth;
+	u32 TileFormat;
+	f32 FrameDeltaTime;
+	f32 RebuildThreshold;
+};
+
+struct render_range_message
+{
+	u32 FrameIndex;
+	u32 FirstTile;
+	u32 OnePastLastTile;
+};
+
+// NOTE: Followed by the tile's pixels, row by row, in the job's tile_format.
+struct tile_message
+{
+	u32 FrameIndex;
+	u32 TileIndex;
+};
+
+struct range_done_message
+{
+	u32 FrameIndex;
+	u32 FirstTile;
+	u32 RaysCast;
+};
+
+internal b32
+SendNetMessage(platform_socket Socket, message_type Type, void *Payload, u32 PayloadSize,
+               void *Extra = 0, u32 ExtraSize = 0)
+{
+	message_header Header = {};
+	Header.Magic = DISTRIBUTED_MAGIC;
+	Header.Type = Type;
+	Header.Size = PayloadSize + ExtraSize;
+
+	b32 Result = (SendAll(Socket, &Header, sizeof(Header)) &&
+	              ((PayloadSize == 0) || SendAll(Socket, Payload, PayloadSize)) &&
+	              ((ExtraSize == 0) || SendAll(Socket, Extra, ExtraSize)));
+	return Result;
+}
+
+internal b32
+ReceiveNetMessage(platform_socket Socket, message_header *Header, void *Buffer, u32 BufferSize)
+{
+	b32 Result = (ReceiveAll(Socket, Header, sizeof(*Header)) &&
+	              (Header->Magic == DISTRIBUTED_MAGIC) &&
+	              (Header->Size <= BufferSize) &&
+	              ((Header->Size == 0) || ReceiveAll(Socket, Buffer, Header->Size)));
+	return Result;
+}
+
+// NOTE: Half floats keep the linear radiance at half the size of f32 while
+// leaving headroom above 1 for whoever merges the tiles. Values too small for
+// a normal half flush to zero; nothing the tracer produces needs them.
+internal u16
+HalfFromFloat(f32 Value)
+{
+	u32 Bits;
+	memcpy(&Bits, &Value, sizeof(Bits));
+
+	u32 Sign = (Bits >> 16) & 0x8000;
+	s32 Exponent = (s32)((Bits >> 23) & 0xFF) - 127 + 15;
+	u32 Mantissa = Bits & 0x7FFFFF;
+
+	u32 Result = Sign;
+	if(Exponent >= 31)
+	{
+		Result |= 0x7C00;
+	}
+	else if(Exponent > 0)
+	{
+		// NOTE: A rounding carry out of the mantissa correctly bumps the
+		// exponent, all the way to infinity if need be.
+		Result |= ((u32)Exponent << 10) | (Mantissa >> 13);
+		Result += (Mantissa >> 12) & 1;
+	}
+
+	return (u16)Result;
+}
+
+internal f32
+FloatFromHalf(u16 Value)
+{
+	u32 Sign = ((u32)Value & 0x8000) << 16;
+	u32 Exponent = ((u32)Value >> 10) & 0x1F;
+	u32 Mantissa = (u32)Value & 0x3FF;
+
+	f32 Result;
+	if(Exponent == 0)
+	{
+		Result = (f32)Mantissa*(1.0f / 16777216.0f);
+		Result = Sign ? -Result : Result;
+	}
+	else
+	{
+		u32 Bits = Sign | ((Exponent == 31) ? 0x7F800000 : ((Exponent - 15 + 127) << 23)) | (Mantissa << 13);
+		memcpy(&Result, &Bits, sizeof(Result));
+	}
+
+	return Result;
+}
+
+inline u32
+GetTilePixelCount(tile_work_order *Tile)
+{
+	u32 Result = (Tile->OnePastMaxX - Tile->MinX)*(Tile->OnePastMaxY - Tile->MinY);
+	return Result;
+}
+
+inline u32
+GetTileBytesPerPixel(u32 Format)
+{
+	u32 Result = (Format == TileFormat_Half) ? 3*sizeof(u16) : 3*sizeof(u8);
+	return Result;
+}
+
+internal u32
+EncodeTile(tile_work_order *Tile, u32 Format, u8 *Dest)
+{
+	image *Image = Tile->Image;
+	u8 *At = Dest;
+	for(u32 Y = Tile->MinY;
+		Y < Tile->OnePastMaxY;
+		++Y)
+	{
+		for(u32 X = Tile->MinX;
+			X < Tile->OnePastMaxX;
+			++X)
+		{
+			if(Format == TileFormat_Half)
+			{
+				v3 Color = Image->Radiance[GetRadianceIndex(Image, X, Y)];
+				u16 Half[3] = {HalfFromFloat(Color.r), HalfFromFloat(Color.g), HalfFromFloat(Color.b)};
+				memcpy(At, Half, sizeof(Half));
+				At += sizeof(Half);
+			}
+			else
+			{
+				u32 Pixel = *GetPixelPointer(Image, X, Y);
+				*At++ = (u8)(Pixel >> 16);
+				*At++ = (u8)(Pixel >> 8);
+				*At++ = (u8)(Pixel >> 0);
+			}
+		}
+	}
+
+	u32 Result = (u32)(At - Dest);
+	return Result;
+}
+
+internal void
+DecodeTile(tile_work_order *Tile, u32 Format, u8 *Source)
+{
+	image *Image = Tile->Image;
+	u8 *At = Source;
+	for(u32 Y = Tile->MinY;
+		Y < Tile->OnePastMaxY;
+		++Y)
+	{
+		u32 *Dest = GetPixelPointer(Image, Tile->MinX, Y);
+		for(u32 X = Tile->MinX;
+			X < Tile->OnePastMaxX;
+			++X)
+		{
+			if(Format == TileFormat_Half)
+			{
+				u16 Half[3];
+				memcpy(Half, At, sizeof(Half));
+				At += sizeof(Half);
+
+				v3 Color = V3(FloatFromHalf(Half[0]), FloatFromHalf(Half[1]), FloatFromHalf(Half[2]));
+				if(Image->Radiance)
+				{
+					Image->Radiance[GetRadianceIndex(Image, X, Y)] = Color;
+				}
+
+				// NOTE: Every kernel packs bit-identically; the SSE2 one is
+				// just the one every machine has.
+				*Dest++ = kernel_sse2::PackLinear01ToSRGBU32(Color);
+			}
+			else
+			{
+				u32 R = At[0];
+				u32 G = At[1];
+				u32 B = At[2];
+				At += 3;
+				*Dest++ = (0xFFu << 24) | (R << 16) | (G << 8) | (B << 0);
+			}
+		}
+	}
+}
+
+//
+// NOTE: Coordinator
+//
+
+enum range_state
+{
+	Range_Pending,
+	Range_Assigned,
+	Range_Done,
+};
+
+struct distributed_range
+{
+	u32 FirstTile;
+	u32 OnePastLastTile;
+	range_state State;
+};
+
+struct distributed_worker
+{
+	platform_socket Socket;
+	b32 Ready;
+
+	b32 Busy;
+	u32 RangeIndex;
+	f64 LastHeardFrom;
+
+	u32 TilesRendered;
+};
+
+struct distributed_coordinator
+{
+	platform_socket Listener;
+	u16 Port;
+	job_message Job;
+	f64 WorkerTimeout;
+	u32 RangeSize;
+
+	u32 WorkerCount;
+	distributed_worker Workers[MAX_DISTRIBUTED_WORKERS];
+
+	u32 ReceiveBufferSize;
+	u8 *ReceiveBuffer;
+
+	u32 WorkersLost;
+	u32 TilesReassigned;
+	u64 BytesReceived;
+};
+
+internal b32
+StartCoordinator(distributed_coordinator *Coordinator, job_message *Job, u16 Port,
+                 u32 LocalWorkerCount, u32 WorkerThreadCount, u32 TestWorkerExitAfter)
+{
+	Coordinator->Job = *Job;
+	Coordinator->Listener = ListenOnPort(Port, false, &Coordinator->Port);
+	b32 Result = (Coordinator->Listener != InvalidSocket);
+	if(Result)
+	{
+		// NOTE: The biggest message is one tile at the widest format.
+		u32 MaxTileWidth = GetMaxTileWidth(Job->Width, Job->TileDim);
+		u32 MaxTileHeight = (Job->Height + Job->TileDim - 1) / Job->TileDim;
+		Coordinator->ReceiveBufferSize = sizeof(tile_message) +
+			MaxTileWidth*MaxTileHeight*GetTileBytesPerPixel(TileFormat_Half);
+		Coordinator->ReceiveBuffer = (u8 *)malloc(Coordinator->ReceiveBufferSize);
+
+		char Address[64];
+		snprintf(Address, sizeof(Address), "127.0.0.1:%u", Coordinator->Port);
+		char Threads[16];
+		snprintf(Threads, sizeof(Threads), "%u", WorkerThreadCount);
+		char ExitAfter[16];
+		snprintf(ExitAfter, sizeof(ExitAfter), "%u", TestWorkerExitAfter);
+
+		for(u32 WorkerIndex = 0;
+			WorkerIndex < LocalWorkerCount;
+			++WorkerIndex)
+		{
+			char *Arguments[] = {"ray", "-worker", Address, "-threads", Threads, 0, 0, 0};
+			if(TestWorkerExitAfter && (WorkerIndex == 0))
+			{
+				Arguments[5] = "-test-worker-exit";
+				Arguments[6] = ExitAfter;
+			}
+
+			if(!SpawnSelf(Arguments))
+			{
+				printf("Couldn't start local worker %u.\n", WorkerIndex);
+			}
+		}
+	}
+
+	return Result;
+}
+
+internal void
+AcceptWorker(distributed_coordinator *Coordinator)
+{
+	platform_socket Socket = AcceptConnection(Coordinator->Listener, (u32)(1000.0*Coordinator->WorkerTimeout));
+	if(Socket != InvalidSocket)
+	{
+		message_header Header;
+		hello_message Hello = {};
+		if((Coordinator->WorkerCount < MAX_DISTRIBUTED_WORKERS) &&
+		   ReceiveNetMessage(Socket, &Header, &Hello, sizeof(Hello)) &&
+		   (Header.Type == Message_Hello) &&
+		   (Hello.Version == DISTRIBUTED_VERSION) &&
+		   SendNetMessage(Socket, Message_Job, &Coordinator->Job, sizeof(Coordinator->Job)))
+		{
+			distributed_worker *Worker = Coordinator->Workers + Coordinator->WorkerCount++;
+			*Worker = {};
+			Worker->Socket = Socket;
+			Worker->LastHeardFrom = GetWallClock();
+		}
+		else
+		{
+			CloseConnection(Socket);
+		}
+	}
+}
+
+internal void
+DropWorker(distributed_coordinator *Coordinator, distributed_range *Ranges, u32 WorkerIndex, char *Reason)
+{
+	distributed_worker *Worker = Coordinator->Workers + WorkerIndex;
+	CloseConnection(Worker->Socket);
+	++Coordinator->WorkersLost;
+
+	if(Worker->Busy)
+	{
+		distributed_range *Range = Ranges + Worker->RangeIndex;
+		Range->State = Range_Pending;
+		Coordinator->TilesReassigned += Range->OnePastLastTile - Range->FirstTile;
+		printf("\rWorker %u %s, reassigning tiles %u-%u.\n", WorkerIndex, Reason,
+		       Range->FirstTile, Range->OnePastLastTile - 1);
+	}
+	else
+	{
+		printf("\rWorker %u %s.\n", WorkerIndex, Reason);
+	}
+
+	// NOTE: Swap-remove; the last worker's range stays with it.
+	*Worker = Coordinator->Workers[--Coordinator->WorkerCount];
+}
+
+// NOTE: Returns false if every worker is gone and nobody new showed up
+// within the timeout; the image is left partially rendered in that case.
+internal b32
+RenderFrameDistributed(distributed_coordinator *Coordinator, tile_work_order *Tiles, u32 TileCount,
+                       u32 FrameIndex, u64 *RaysCast, b32 ShowProgress)
+{
+	distributed_range Ranges[MAX_DISTRIBUTED_RANGES];
+	u32 RangeSize = Maximum(Coordinator->RangeSize, (TileCount + MAX_DISTRIBUTED_RANGES - 1) / MAX_DISTRIBUTED_RANGES);
+	u32 RangeCount = 0;
+	for(u32 FirstTile = 0;
+		FirstTile < TileCount;
+		FirstTile += RangeSize)
+	{
+		distributed_range *Range = Ranges + RangeCount++;
+		Range->FirstTile = FirstTile;
+		Range->OnePastLastTile = Minimum(FirstTile + RangeSize, TileCount);
+		Range->State = Range_Pending;
+	}
+
+	u32 TilesDone = 0;
+	u32 RangesDone = 0;
+	f64 LastWorkerSeen = GetWallClock();
+	b32 Result = true;
+	while(RangesDone < RangeCount)
+	{
+		f64 Now = GetWallClock();
+		if(Coordinator->WorkerCount)
+		{
+			LastWorkerSeen = Now;
+		}
+		else if((Now - LastWorkerSeen) > Coordinator->WorkerTimeout)
+		{
+			printf("\rNo workers left to render frame %u.\n", FrameIndex);
+			Result = false;
+			break;
+		}
+
+		// NOTE: Hand out pending ranges in order, one per idle worker.
+		u32 NextRange = 0;
+		for(u32 WorkerIndex = 0;
+			WorkerIndex < Coordinator->WorkerCount;
+			++WorkerIndex)
+		{
+			distributed_worker *Worker = Coordinator->Workers + WorkerIndex;
+			if(Worker->Ready && !Worker->Busy)
+			{
+				while((NextRange < RangeCount) && (Ranges[NextRange].State != Range_Pending))
+				{
+					++NextRange;
+				}
+
+				if(NextRange < RangeCount)
+				{
+					distributed_range *Range = Ranges + NextRange;
+					render_range_message Message = {FrameIndex, Range->FirstTile, Range->OnePastLastTile};
+					Worker->Busy = true;
+					Worker->RangeIndex = NextRange;
+					Worker->LastHeardFrom = Now;
+					Range->State = Range_Assigned;
+
+					if(!SendNetMessage(Worker->Socket, Message_RenderRange, &Message, sizeof(Message)))
+					{
+						DropWorker(Coordinator, Ranges, WorkerIndex--, "disconnected");
+					}
+				}
+			}
+		}
+
+		platform_socket Sockets[MAX_DISTRIBUTED_WORKERS + 1];
+		b32 Readable[MAX_DISTRIBUTED_WORKERS + 1];
+		Sockets[0] = Coordinator->Listener;
+		for(u32 WorkerIndex = 0;
+			WorkerIndex < Coordinator->WorkerCount;
+			++WorkerIndex)
+		{
+			Sockets[WorkerIndex + 1] = Coordinator->Workers[WorkerIndex].Socket;
+		}
+		u32 SocketCount = Coordinator->WorkerCount + 1;
+		WaitForReadable(Sockets, Readable, SocketCount, 100);
+		Now = GetWallClock();
+
+		// NOTE: Walk backwards so dropping a worker doesn't disturb the
+		// indices still to be visited.
+		for(u32 SocketIndex = SocketCount - 1;
+			SocketIndex > 0;
+			--SocketIndex)
+		{
+			u32 WorkerIndex = SocketIndex - 1;
+			distributed_worker *Worker = Coordinator->Workers + WorkerIndex;
+			if(Readable[SocketIndex])
+			{
+				message_header Header;
+				if(!ReceiveNetMessage(Worker->Socket, &Header, Coordinator->ReceiveBuffer, Coordinator->ReceiveBufferSize))
+				{
+					DropWorker(Coordinator, Ranges, WorkerIndex, "disconnected");
+					continue;
+				}
+
+				Worker->LastHeardFrom = Now;
+				Coordinator->BytesReceived += sizeof(Header) + Header.Size;
+
+				if(Header.Type == Message_Ready)
+				{
+					Worker->Ready = true;
+				}
+				else if(Header.Type == Message_Tile)
+				{
+					tile_message *Message = (tile_message *)Coordinator->ReceiveBuffer;
+					if((Header.Size >= sizeof(tile_message)) &&
+					   (Message->FrameIndex == FrameIndex) &&
+					   (Message->TileIndex < TileCount))
+					{
+						tile_work_order *Tile = Tiles + Message->TileIndex;
+						u32 PixelsSize = GetTilePixelCount(Tile)*GetTileBytesPerPixel(Coordinator->Job.TileFormat);
+						if(Header.Size == sizeof(tile_message) + PixelsSize)
+						{
+							DecodeTile(Tile, Coordinator->Job.TileFormat, (u8 *)(Message + 1));
+						}
+					}
+				}
+				else if(Header.Type == Message_RangeDone)
+				{
+					range_done_message *Message = (range_done_message *)Coordinator->ReceiveBuffer;
+					distributed_range *Range = Ranges + Worker->RangeIndex;
+					if(Worker->Busy &&
+					   (Header.Size == sizeof(range_done_message)) &&
+					   (Message->FrameIndex == FrameIndex) &&
+					   (Message->FirstTile == Range->FirstTile))
+					{
+						u32 RangeTileCount = Range->OnePastLastTile - Range->FirstTile;
+						Range->State = Range_Done;
+						Worker->Busy = false;
+						Worker->TilesRendered += RangeTileCount;
+						TilesDone += RangeTileCount;
+						++RangesDone;
+						*RaysCast += Message->RaysCast;
+					}
+				}
+			}
+			else if(Worker->Busy && ((Now - Worker->LastHeardFrom) > Coordinator->WorkerTimeout))
+			{
+				DropWorker(Coordinator, Ranges, WorkerIndex, "timed out");
+			}
+		}
+
+		if(Readable[0])
+		{
+			AcceptWorker(Coordinator);
+		}
+
+		if(ShowProgress)
+		{
+			printf("\rRaycasting... %d%% (%u workers)", (u32)((100.0f*TilesDone) / TileCount), Coordinator->WorkerCount);
+			fflush(stdout);
+		}
+	}
+
+	return Result;
+}
+
+internal void
+StopCoordinator(distributed_coordinator *Coordinator)
+{
+	for(u32 WorkerIndex = 0;
+		WorkerIndex < Coordinator->WorkerCount;
+		++WorkerIndex)
+	{
+		distributed_worker *Worker = Coordinator->Workers + WorkerIndex;
+		SendNetMessage(Worker->Socket, Message_Shutdown, 0, 0);
+		CloseConnection(Worker->Socket);
+	}
+	Coordinator->WorkerCount = 0;
+	CloseConnection(Coordinator->Listener);
+}
+
+//
+// NOTE: Worker
+//
+
+internal s32
+RunWorker(char *CoordinatorAddress, u32 ThreadCount, u32 TestExitAfter)
+{
+	char Host[256];
+	snprintf(Host, sizeof(Host), "%s", CoordinatorAddress);
+	char *PortName = strrchr(Host, ':');
+	if(!PortName)
+	{
+		printf("Expected -worker HOST:PORT, got %s.\n", CoordinatorAddress);
+		return 1;
+	}
+	*PortName++ = 0;
+
+	// NOTE: No receive timeout; an idle worker just waits for its next range.
+	platform_socket Socket = ConnectToHost(Host, (u16)atoi(PortName), 0);
+	if(Socket == InvalidSocket)
+	{
+		printf("Couldn't connect to coordinator at %s.\n", CoordinatorAddress);
+		return 1;
+	}
+
+	hello_message Hello = {DISTRIBUTED_VERSION};
+	message_header Header;
+	job_message Job = {};
+	if(!SendNetMessage(Socket, Message_Hello, &Hello, sizeof(Hello)) ||
+	   !ReceiveNetMessage(Socket, &Header, &Job, sizeof(Job)) ||
+	   (Header.Type != Message_Job))
+	{
+		printf("Coordinator at %s didn't send a job.\n", CoordinatorAddress);
+		CloseConnection(Socket);
+		return 1;
+	}
+	Job.SceneName[ArrayCount(Job.SceneName) - 1] = 0;
+
+	image Image = AllocateImage(Job.Width, Job.Height);
+	if(Job.TileFormat == TileFormat_Half)
+	{
+		AllocateImageRadiance(&Image, RadianceLayout_Linear);
+	}
+
+	memory_arena SceneArena = {};
+	memory_index SceneArenaSize = Megabytes(64);
+	InitializeArena(&SceneArena, SceneArenaSize, AllocateMemory(SceneArenaSize));
+
+	world World = {};
+	BuildScene(&World, &SceneArena, Job.SceneName, Image.Width, Image.Height);
+
+	work_queue WorkQueue = {};
+	WorkQueue.TileKernel = TileKernels[GetSupportedKernelISA()];
+	BuildTileWorkOrders(&WorkQueue, &Image, &World, Job.TileDim, Job.RaysPerPixel, Job.MaxBounces, Job.LaneWidth);
+	ThreadStart(&WorkQueue, ThreadCount);
+	PrefaultImage(&WorkQueue);
+
+	u32 BytesPerPixel = GetTileBytesPerPixel(Job.TileFormat);
+	u32 MaxTileSize = 0;
+	for(u32 TileIndex = 0;
+		TileIndex < WorkQueue.TileQueueSize;
+		++TileIndex)
+	{
+		MaxTileSize = Maximum(MaxTileSize, GetTilePixelCount(WorkQueue.TileWorkQueue + TileIndex)*BytesPerPixel);
+	}
+	u8 *TileBuffer = (u8 *)malloc(MaxTileSize);
+
+	u32 CurrentFrame = 0;
+	u32 RangesRendered = 0;
+	b32 Connected = SendNetMessage(Socket, Message_Ready, 0, 0);
+	while(Connected)
+	{
+		render_range_message Range;
+		if(!ReceiveNetMessage(Socket, &Header, &Range, sizeof(Range)) ||
+		   (Header.Type != Message_RenderRange) ||
+		   (Range.FirstTile >= Range.OnePastLastTile) ||
+		   (Range.OnePastLastTile > WorkQueue.TileQueueSize))
+		{
+			break;
+		}
+
+		if(TestExitAfter && (RangesRendered == TestExitAfter))
+		{
+			// NOTE: Vanish with a range in hand, the way a crashed worker
+			// would, so the coordinator's recovery can be exercised.
+			exit(1);
+		}
+
+		if(World.Animate && (Range.FrameIndex != CurrentFrame))
+		{
+			World.Animate(&World, Range.FrameIndex*Job.FrameDeltaTime);
+			UpdateInstanceHierarchy(&World, Job.RebuildThreshold);
+			CurrentFrame = Range.FrameIndex;
+		}
+
+		WorkQueue.FrameIndex = Range.FrameIndex;
+		RenderTiles(&WorkQueue, Range.FirstTile, Range.OnePastLastTile, false);
+
+		for(u32 TileIndex = Range.FirstTile;
+			Connected && (TileIndex < Range.OnePastLastTile);
+			++TileIndex)
+		{
+			tile_message Message = {Range.FrameIndex, TileIndex};
+			u32 TileSize = EncodeTile(WorkQueue.TileWorkQueue + TileIndex, Job.TileFormat, TileBuffer);
+			Connected = SendNetMessage(Socket, Message_Tile, &Message, sizeof(Message), TileBuffer, TileSize);
+		}
+
+		range_done_message Done = {Range.FrameIndex, Range.FirstTile, WorkQueue.RaysCast};
+		Connected = Connected && SendNetMessage(Socket, Message_RangeDone, &Done, sizeof(Done));
+		++RangesRendered;
+	}
+
+	CloseConnection(Socket);
+	return 0;
+}
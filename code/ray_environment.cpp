@@ -0,0 +1,291 @@
+/*@H
+* File: ray_environment.cpp
+* Author: Jesse Calvert
+* Created: October 19, 2026, 15:48
+* Last modified: October 19, 2026, 15:56
+*/
+
+// NOTE: Environment lighting, with -environment FILE.pfm. Rays that escape
+// see an equirectangular float image instead of one flat background color.
+// Most of a bright environment's light tends to come from a small part of
+// it, like the sun in a sky, which bounces only find by chance. So rough
+// hits also aim a ray at it, picking a direction in proportion to its
+// brightness, and the two are weighed against each other with the balance
+// heuristic, just as emitters are (see ray_lights.cpp).
+//
+// Picking goes by row first, by the rows' totals, and then by texel within
+// the row, each a binary search over a CDF. Texels are weighed by their
+// luminance times the sine of their angle from +y, since rows near the
+// poles cover less of the sphere, and that same sine is divided back out
+// of the probability per steradian.
+
+// NOTE: Reads a PFM, color (PF) or gray (Pf). Rows are stored bottom up,
+// and the sign of the scale says which byte order the floats are in;
+// negative is little endian. Returns 0 if the file can't be read.
+internal environment_map *
+LoadEnvironmentMap(char *Filename)
+{
+	environment_map *Result = 0;
+	FILE *InFile = fopen(Filename, "rb");
+	if(InFile)
+	{
+		char Type[3] = {};
+		s32 Width = 0;
+		s32 Height = 0;
+		f32 Scale = 0.0f;
+		if((fscanf(InFile, "%2s %d %d %f", Type, &Width, &Height, &Scale) == 4) &&
+		   ((strcmp(Type, "PF") == 0) || (strcmp(Type, "Pf") == 0)) &&
+		   (Width > 0) && (Width <= MAX_READ_IMAGE_DIM) &&
+		   (Height > 0) && (Height <= MAX_READ_IMAGE_DIM) &&
+		   (Scale != 0.0f) &&
+		   (fgetc(InFile) != EOF))
+		{
+			u32 ChannelCount = (Type[1] == 'F') ? 3 : 1;
+			u32 RowSize = ChannelCount*Width;
+			f32 *Row = (f32 *)AllocateMemory(RowSize*sizeof(f32));
+
+			environment_map *Map = (environment_map *)AllocateMemory(sizeof(environment_map));
+			Map->Width = Width;
+			Map->Height = Height;
+			Map->Texels = (v3 *)AllocateMemory(Width*Height*sizeof(v3));
+
+			b32 Valid = true;
+			for(u32 FileRow = 0;
+				Valid && (FileRow < (u32)Height);
+				++FileRow)
+			{
+				Valid = (fread(Row, sizeof(f32), RowSize, InFile) == RowSize);
+				if(Scale > 0.0f)
+				{
+					for(u32 Index = 0;
+						Index < RowSize;
+						++Index)
+					{
+						u32 Bits;
+						memcpy(&Bits, Row + Index, sizeof(Bits));
+						Bits = ((Bits >> 24) | ((Bits >> 8) & 0xFF00) | ((Bits << 8) & 0xFF0000) | (Bits << 24));
+						memcpy(Row + Index, &Bits, sizeof(Bits));
+					}
+				}
+
+				v3 *Texel = Map->Texels + (Height - 1 - FileRow)*Width;
+				for(u32 X = 0;
+					X < (u32)Width;
+					++X)
+				{
+					f32 *Channels = Row + ChannelCount*X;
+					v3 Color = (ChannelCount == 3) ? V3(Channels[0], Channels[1], Channels[2]) : V3(Channels[0], Channels[0], Channels[0]);
+
+					// NOTE: Negative or NaN texels would throw off the CDFs.
+					for(u32 Channel = 0;
+						Channel < 3;
+						++Channel)
+					{
+						if(!(Color.E[Channel] > 0.0f))
+						{
+							Color.E[Channel] = 0.0f;
+						}
+					}
+					*Texel++ = Color;
+				}
+			}
+			DeallocateMemory(Row, RowSize*sizeof(f32));
+
+			if(Valid)
+			{
+				Result = Map;
+			}
+		}
+		fclose(InFile);
+	}
+	return Result;
+}
+
+// NOTE: Sums are kept in doubles, so long rows don't lose their tails.
+internal void
+BuildEnvironmentCDFs(environment_map *Map)
+{
+	u32 Width = Map->Width;
+	u32 Height = Map->Height;
+	Map->ConditionalCDF = (f32 *)AllocateMemory(Height*(Width + 1)*sizeof(f32));
+	Map->MarginalCDF = (f32 *)AllocateMemory((Height + 1)*sizeof(f32));
+
+	f64 *RowTotals = (f64 *)AllocateMemory(Height*sizeof(f64));
+	f64 Total = 0.0;
+	for(u32 Y = 0;
+		Y < Height;
+		++Y)
+	{
+		f32 SinTheta = Sin(Pi32*((f32)Y + 0.5f) / (f32)Height);
+		f32 *CDF = Map->ConditionalCDF + Y*(Width + 1);
+		v3 *Texel = Map->Texels + Y*Width;
+
+		f64 RowTotal = 0.0;
+		CDF[0] = 0.0f;
+		for(u32 X = 0;
+			X < Width;
+			++X)
+		{
+			RowTotal += SinTheta*Luminance(Texel[X]);
+			CDF[X + 1] = (f32)RowTotal;
+		}
+
+		// NOTE: Black rows are never picked, but are still given a CDF a
+		// search can walk.
+		for(u32 X = 1;
+			X <= Width;
+			++X)
+		{
+			CDF[X] = (RowTotal > 0.0) ? (f32)(CDF[X] / RowTotal) : ((f32)X / (f32)Width);
+		}
+		CDF[Width] = 1.0f;
+
+		RowTotals[Y] = RowTotal;
+		Total += RowTotal;
+	}
+
+	f64 Sum = 0.0;
+	Map->MarginalCDF[0] = 0.0f;
+	for(u32 Y = 0;
+		Y < Height;
+		++Y)
+	{
+		Sum += RowTotals[Y];
+		Map->MarginalCDF[Y + 1] = (Total > 0.0) ? (f32)(Sum / Total) : 0.0f;
+	}
+	DeallocateMemory(RowTotals, Height*sizeof(f64));
+}
+
+// NOTE: The last of the Count intervals of CDF whose start is at or below
+// U, which is never an empty one.
+internal u32
+FindCDFInterval(f32 *CDF, u32 Count, f32 U)
+{
+	u32 Low = 0;
+	u32 High = Count - 1;
+	while(Low < High)
+	{
+		u32 Middle = (Low + High + 1) / 2;
+		if(CDF[Middle] <= U)
+		{
+			Low = Middle;
+		}
+		else
+		{
+			High = Middle - 1;
+		}
+	}
+	return Low;
+}
+
+inline void
+GetEnvironmentUV(v3 Direction, f32 *U, f32 *V)
+{
+	Direction = NOZ(Direction);
+	*U = 0.5f + ATan2(Direction.x, -Direction.z) / (2.0f*Pi32);
+	*V = Arccos(Clamp(Direction.y, -1.0f, 1.0f)) / Pi32;
+}
+
+inline f32
+GetEnvironmentTexelProbability(environment_map *Map, u32 X, u32 Y)
+{
+	f32 *CDF = Map->ConditionalCDF + Y*(Map->Width + 1);
+	f32 Result = (Map->MarginalCDF[Y + 1] - Map->MarginalCDF[Y])*(CDF[X + 1] - CDF[X]);
+	return Result;
+}
+
+// NOTE: The probability per steradian of picking a direction in a texel
+// picked with TexelProbability, at SinTheta from +y.
+inline f32
+GetEnvironmentProbability(environment_map *Map, f32 TexelProbability, f32 SinTheta)
+{
+	f32 Result = 0.0f;
+	if(SinTheta > 0.0f)
+	{
+		Result = TexelProbability*(f32)(Map->Width*Map->Height) / (2.0f*Pi32*Pi32*SinTheta);
+	}
+	return Result;
+}
+
+// NOTE: What a ray escaping in Direction sees, along with the probability
+// per steradian of picking Direction if Probability isn't 0.
+internal v3
+GetEnvironmentRadiance(environment_map *Map, v3 Direction, f32 *Probability)
+{
+	f32 U, V;
+	GetEnvironmentUV(Direction, &U, &V);
+	u32 X = Minimum((u32)Maximum(U*Map->Width, 0.0f), Map->Width - 1);
+	u32 Y = Minimum((u32)Maximum(V*Map->Height, 0.0f), Map->Height - 1);
+	if(Probability)
+	{
+		*Probability = GetEnvironmentProbability(Map, GetEnvironmentTexelProbability(Map, X, Y), Sin(Pi32*V));
+	}
+
+	v3 Result = Map->Texels[Y*Map->Width + X];
+	return Result;
+}
+
+// NOTE: A texel picked in proportion to its weight, and where in it, as U
+// and V across the whole map.
+struct environment_pick
+{
+	u32 TexelIndex;
+	f32 TexelProbability;
+	f32 U;
+	f32 V;
+};
+
+// NOTE: U and V are uniform in [0, 1). Each picks its interval and is then
+// stretched across it, to place the pick within the texel. Returns false if
+// the environment is black.
+internal b32
+PickEnvironmentTexel(environment_map *Map, f32 U, f32 V, environment_pick *Pick)
+{
+	if(Map->MarginalCDF[Map->Height] <= 0.0f)
+	{
+		return false;
+	}
+
+	u32 Y = FindCDFInterval(Map->MarginalCDF, Map->Height, V);
+	f32 RowStart = Map->MarginalCDF[Y];
+	f32 RowV = (V - RowStart) / (Map->MarginalCDF[Y + 1] - RowStart);
+
+	f32 *CDF = Map->ConditionalCDF + Y*(Map->Width + 1);
+	u32 X = FindCDFInterval(CDF, Map->Width, U);
+	f32 TexelU = (U - CDF[X]) / (CDF[X + 1] - CDF[X]);
+
+	Pick->TexelIndex = Y*Map->Width + X;
+	Pick->TexelProbability = GetEnvironmentTexelProbability(Map, X, Y);
+	Pick->U = ((f32)X + Clamp01(TexelU)) / (f32)Map->Width;
+	Pick->V = ((f32)Y + Clamp01(RowV)) / (f32)Map->Height;
+	return true;
+}
+
+struct environment_sample
+{
+	v3 Direction;
+	v3 Radiance;
+	f32 Probability;
+};
+
+// NOTE: Returns false if the environment is black or the direction lands
+// on a pole.
+internal b32
+SampleEnvironment(environment_map *Map, f32 U, f32 V, environment_sample *Sample)
+{
+	environment_pick Pick;
+	if(!PickEnvironmentTexel(Map, U, V, &Pick))
+	{
+		return false;
+	}
+
+	f32 Phi = 2.0f*Pi32*(Pick.U - 0.5f);
+	f32 Theta = Pi32*Pick.V;
+	f32 SinTheta = Sin(Theta);
+
+	Sample->Direction = V3(SinTheta*Sin(Phi), Cos(Theta), -SinTheta*Cos(Phi));
+	Sample->Radiance = Map->Texels[Pick.TexelIndex];
+	Sample->Probability = GetEnvironmentProbability(Map, Pick.TexelProbability, SinTheta);
+	b32 Result = (Sample->Probability > 0.0f);
+	return Result;
+}
@@ -2,12 +2,20 @@
 * File: ray_intrinsics.h
 * Author: Jesse Calvert
 * Created: October 22, 2017, 17:28
-* Last modified: October 22, 2017, 17:28
+* Last modified: October 19, 2026, 13:27
 */
 
 #pragma once
 #include <math.h>
 
+#if COMPILER_MSVC
+#include <intrin.h>
+#endif
+
+#if RAY_SIMD_MATH
+#include <immintrin.h>
+#endif
+
 inline int32
 SignOf(int32 Value)
 {
@@ -43,6 +51,22 @@ SquareRoot(real32 Real32)
     return Result;
 }
 
+inline real32
+InverseSquareRoot(real32 Real32)
+{
+#if RAY_SIMD_MATH && RAY_FAST_RSQRT
+    // NOTE: ~12 bit estimate refined by one Newton-Raphson step.
+    __m128 X = _mm_set_ss(Real32);
+    __m128 Y = _mm_rsqrt_ss(X);
+    Y = _mm_mul_ss(_mm_mul_ss(_mm_set_ss(0.5f), Y),
+                   _mm_sub_ss(_mm_set_ss(3.0f), _mm_mul_ss(_mm_mul_ss(X, Y), Y)));
+    real32 Result = _mm_cvtss_f32(Y);
+#else
+    real32 Result = 1.0f/sqrtf(Real32);
+#endif
+    return Result;
+}
+
 inline uint32
 RotateLeft(uint32 Value, int32 Amount)
 {
@@ -189,3 +213,73 @@ FindLeastSignificantSetBit(uint32 Value)
 
     return Result;
 }
+
+inline bit_scan_result
+FindMostSignificantSetBit(uint32 Value)
+{
+    bit_scan_result Result = {};
+
+#if COMPILER_MSVC
+    Result.Found = _BitScanReverse((unsigned long *)&Result.Index, Value);
+#else
+    if(Value)
+    {
+        Result.Index = 31 - __builtin_clz(Value);
+        Result.Found = true;
+    }
+#endif
+
+    return Result;
+}
+
+struct cpu_features
+{
+    bool32 SSE42;
+    bool32 AVX2;
+    bool32 AVX512;
+};
+
+inline cpu_features
+GetCPUFeatures()
+{
+    cpu_features Result = {};
+
+#if COMPILER_MSVC
+    int Info[4];
+    __cpuid(Info, 0);
+    int MaxLeaf = Info[0];
+
+    __cpuid(Info, 1);
+    Result.SSE42 = ((Info[2] >> 19) & 1) && ((Info[2] >> 20) & 1) && ((Info[2] >> 23) & 1);
+    bool32 OSXSAVE = (Info[2] >> 27) & 1;
+    bool32 AVX = (Info[2] >> 28) & 1;
+
+    // NOTE: The OS also has to preserve the wide registers across context
+    // switches, which it advertises in XCR0.
+    uint64 XCR0 = OSXSAVE ? _xgetbv(0) : 0;
+    bool32 YMMEnabled = ((XCR0 & 0x06) == 0x06);
+    bool32 ZMMEnabled = ((XCR0 & 0xE6) == 0xE6);
+
+    if(MaxLeaf >= 7)
+    {
+        __cpuidex(Info, 7, 0);
+        Result.AVX2 = AVX && YMMEnabled && ((Info[1] >> 5) & 1);
+        Result.AVX512 = (Result.AVX2 && ZMMEnabled &&
+                         ((Info[1] >> 16) & 1) &&   // F
+                         ((Info[1] >> 17) & 1) &&   // DQ
+                         ((Info[1] >> 30) & 1) &&   // BW
+                         ((Info[1] >> 31) & 1));    // VL
+    }
+#else
+    __builtin_cpu_init();
+    Result.SSE42 = (__builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt"));
+    Result.AVX2 = __builtin_cpu_supports("avx2");
+    Result.AVX512 = (Result.AVX2 &&
+                     __builtin_cpu_supports("avx512f") &&
+                     __builtin_cpu_supports("avx512dq") &&
+                     __builtin_cpu_supports("avx512bw") &&
+                     __builtin_cpu_supports("avx512vl"));
+#endif
+
+    return Result;
+}
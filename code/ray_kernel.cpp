@@ -0,0 +1,83 @@
+/*@H
+* File: ray_kernel.cpp
+* Author: Jesse Calvert
+* Created: October 19, 2026, 12:58
+* Last modified: October 19, 2026, 16:37
+*/
+
+// NOTE: ray.cpp includes this once per instruction set level, with
+// KERNEL_ISA and KERNEL_NAMESPACE set beforehand. Everything on the tracing
+// path is compiled inside that namespace for that level, and main picks one
+// set at startup from cpuid.
+//
+// Multiply-add contraction is turned off (AVX-512 implies FMA): fusing shifts
+// results enough near the hit tolerances that the same scene would render
+// differently depending on the host.
+
+#define KERNEL_PRAGMA_(Text) _Pragma(#Text)
+#define KERNEL_PRAGMA(Text) KERNEL_PRAGMA_(Text)
+
+#if KERNEL_ISA == KERNEL_ISA_SSE4
+#define KERNEL_TARGET "sse4.2,popcnt"
+#elif KERNEL_ISA == KERNEL_ISA_AVX2
+#define KERNEL_TARGET "avx2"
+#elif KERNEL_ISA == KERNEL_ISA_AVX512
+#define KERNEL_TARGET "avx2,avx512f,avx512vl,avx512bw,avx512dq"
+#endif
+
+// NOTE: MSVC emits whatever its intrinsics ask for, so only GCC and Clang
+// need telling which instructions these functions may use.
+#if COMPILER_LLVM && defined(KERNEL_TARGET)
+#if defined(__clang__)
+KERNEL_PRAGMA(clang attribute push(__attribute__((target(KERNEL_TARGET))), apply_to = function))
+KERNEL_PRAGMA(clang fp contract(off))
+#else
+KERNEL_PRAGMA(GCC push_options)
+KERNEL_PRAGMA(GCC target(KERNEL_TARGET))
+KERNEL_PRAGMA(GCC optimize("fp-contract=off"))
+#endif
+#endif
+
+namespace KERNEL_NAMESPACE
+{
+
+// NOTE: The lane overloads declared in here would otherwise hide the
+// scalar versions whenever the arguments are plain floats.
+using ::Square;
+using ::SquareRoot;
+using ::AbsoluteValue;
+using ::Lerp;
+
+#include "ray_lane_math.h"
+#include "ray_trace.cpp"
+#include "ray_caustics_kernel.cpp"
+#include "ray_lane.cpp"
+#include "ray_radiance_cache_kernel.cpp"
+#include "ray_deadline_kernel.cpp"
+#include "ray_microbench_kernel.cpp"
+
+internal TILE_KERNEL(RenderTileKernel)
+{
+	if(WorkOrder->LaneWidth == LANE_WIDTH)
+	{
+		RenderTileX8(WorkOrder, FrameIndex, RaysCast);
+	}
+	else
+	{
+		RenderTileX1(WorkOrder, FrameIndex, RaysCast);
+	}
+}
+
+}
+
+#if COMPILER_LLVM && defined(KERNEL_TARGET)
+#if defined(__clang__)
+KERNEL_PRAGMA(clang attribute pop)
+#else
+KERNEL_PRAGMA(GCC pop_options)
+#endif
+#endif
+
+#undef KERNEL_TARGET
+#undef KERNEL_NAMESPACE
+#undef KERNEL_ISA
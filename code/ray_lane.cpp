@@ -0,0 +1,908 @@
+/*@H
+* File: ray_lane.cpp
+* Author: Jesse Calvert
+* Created: October 19, 2026, 12:32
+* Last modified: October 19, 2026, 16:59
+*/
+
+// NOTE: Traces LANE_WIDTH independent paths at once, one per SIMD lane.
+// Everything mirrors the single ray versions in ray_trace.cpp; branches become
+// masks, and lanes that have finished are carried along but ignored.
+
+struct lane_ray_cast_result
+{
+	f32x8 ClosestHit;
+	v3x8 HitNormal;
+	material *MaterialHit[LANE_WIDTH];
+};
+
+// NOTE: Xorshift on its own is linear, and consecutive outputs used as the
+// components of one direction visibly skew the bounce distribution. Adding a
+// Weyl sequence on the way out (as xorwow does) breaks that up.
+struct random_series_x8
+{
+	u32x8 State;
+	u32x8 Weyl;
+};
+
+// NOTE: Each lane traces the next of the pixel's samples, and is seeded the
+// same way a single ray for that sample would be (see GetSampleSeed).
+inline random_series_x8
+RandomSeriesX8(u32 FrameIndex, u32 PixelIndex, u32 FirstSample)
+{
+	random_series_x8 Result;
+	for(u32 Lane = 0;
+		Lane < LANE_WIDTH;
+		++Lane)
+	{
+		random_series Series = RandomSeries(GetSampleSeed(FrameIndex, PixelIndex, FirstSample + Lane));
+		Result.State.E[Lane] = Series.State;
+		Result.Weyl.E[Lane] = Series.Weyl;
+	}
+	return Result;
+}
+
+inline_force u32x8
+RandomNextU32(random_series_x8 *Series)
+{
+	u32x8 State = Series->State;
+	State = State ^ (State << 13);
+	State = State ^ (State >> 17);
+	State = State ^ (State << 5);
+	Series->State = State;
+	Series->Weyl = Series->Weyl + U32x8(362437);
+
+	u32x8 Result = State + Series->Weyl;
+	return Result;
+}
+
+inline_force f32x8
+RandomUnilateral(random_series_x8 *Series)
+{
+	// NOTE: Top 23 random bits as the mantissa of a float in [1, 2).
+	u32x8 Bits = (RandomNextU32(Series) >> 9) | U32x8(0x3F800000);
+	f32x8 Result = F32x8FromBits(Bits) - F32x8(1.0f);
+	return Result;
+}
+
+inline_force f32x8
+RandomBilateral(random_series_x8 *Series)
+{
+	f32x8 Result = F32x8(-1.0f) + 2.0f*RandomUnilateral(Series);
+	return Result;
+}
+
+inline_force void
+RecordHits(lane_ray_cast_result *Result, mask8 HitMask, f32x8 DistanceToHit, v3x8 HitNormal, material *Material)
+{
+	Result->ClosestHit = Select(HitMask, DistanceToHit, Result->ClosestHit);
+	Result->HitNormal = Select(HitMask, HitNormal, Result->HitNormal);
+	if(AnyTrue(HitMask))
+	{
+		for(u32 Lane = 0;
+			Lane < LANE_WIDTH;
+			++Lane)
+		{
+			if(HitMask.E[Lane])
+			{
+				Result->MaterialHit[Lane] = Material;
+			}
+		}
+	}
+}
+
+inline_force void
+IntersectObject(object *Object, v3x8 RayOrigin, v3x8 RayDirection, mask8 Active, lane_ray_cast_result *Result)
+{
+	f32 Tolerance = 0.0001f;
+
+	switch(Object->Type)
+	{
+		case Object_Plane:
+		{
+			plane *Plane = &Object->Plane;
+			v3x8 PlaneNormal = V3x8(Plane->Normal);
+			f32x8 Denom = Inner(PlaneNormal, RayDirection);
+			mask8 DenomMask = (Denom > Tolerance) | (Denom < -Tolerance);
+
+			f32x8 DistanceToHit = (F32x8(Plane->Offset) - Inner(PlaneNormal, RayOrigin))/Denom;
+			mask8 HitMask = Active & DenomMask &
+				(DistanceToHit > Tolerance) & (DistanceToHit < Result->ClosestHit);
+			RecordHits(Result, HitMask, DistanceToHit, PlaneNormal, &Object->Material);
+		} break;
+
+		case Object_Sphere:
+		{
+			sphere *Sphere = &Object->Sphere;
+
+			v3x8 SphereRelativeCenter = RayOrigin - V3x8(Sphere->Center);
+
+			f32x8 a = Inner(RayDirection, RayDirection);
+			f32x8 b = 2.0f*Inner(RayDirection, SphereRelativeCenter);
+			f32x8 c = Inner(SphereRelativeCenter, SphereRelativeCenter) - Square(Sphere->Radius);
+			f32x8 Determinant = Square(b) - 4.0f*a*c;
+			mask8 DeterminantMask = Active & (Determinant > Tolerance);
+			if(AnyTrue(DeterminantMask))
+			{
+				f32x8 RootDeterminant = SquareRoot(Max(Determinant, F32x8(0.0f)));
+				f32x8 InvDenom = F32x8(1.0f)/(2.0f*a);
+				f32x8 DistanceToHitPos = (-b + RootDeterminant)*InvDenom;
+				f32x8 DistanceToHitNeg = (-b - RootDeterminant)*InvDenom;
+
+				mask8 TakeNeg = (DistanceToHitNeg > Tolerance) & (DistanceToHitNeg < DistanceToHitPos);
+				f32x8 DistanceToHit = Select(TakeNeg, DistanceToHitNeg, DistanceToHitPos);
+
+				mask8 HitMask = DeterminantMask &
+					(DistanceToHit > Tolerance) & (DistanceToHit < Result->ClosestHit);
+				if(AnyTrue(HitMask))
+				{
+					v3x8 HitNormal = NOZ(SphereRelativeCenter + DistanceToHit*RayDirection);
+					RecordHits(Result, HitMask, DistanceToHit, HitNormal, &Object->Material);
+				}
+			}
+		} break;
+
+		InvalidDefaultCase;
+	}
+}
+
+inline_force v3x8
+InverseDirection(v3x8 RayDirection)
+{
+	v3x8 Result = V3x8(F32x8(1.0f)/RayDirection.x,
+	                   F32x8(1.0f)/RayDirection.y,
+	                   F32x8(1.0f)/RayDirection.z);
+	return Result;
+}
+
+inline_force mask8
+RayIntersectsBounds(rectangle3 Bounds, v3x8 RayOrigin, v3x8 InvRayDirection, f32x8 MaxDistance)
+{
+	f32x8 tMin = F32x8(0.0f);
+	f32x8 tMax = MaxDistance;
+	for(u32 Axis = 0;
+		Axis < 3;
+		++Axis)
+	{
+		f32x8 t0 = (F32x8(Bounds.Min.E[Axis]) - RayOrigin.E[Axis])*InvRayDirection.E[Axis];
+		f32x8 t1 = (F32x8(Bounds.Max.E[Axis]) - RayOrigin.E[Axis])*InvRayDirection.E[Axis];
+		tMin = Max(tMin, Min(t0, t1));
+		tMax = Min(tMax, Max(t0, t1));
+	}
+
+	mask8 Result = AndNot(Mask8(true), tMax < tMin);
+	return Result;
+}
+
+internal void
+IntersectPrototype(prototype *Prototype, v3x8 RayOrigin, v3x8 RayDirection, mask8 Active, lane_ray_cast_result *Result)
+{
+	bvh *Hierarchy = &Prototype->Hierarchy;
+	v3x8 InvRayDirection = InverseDirection(RayDirection);
+
+	// NOTE: The whole packet walks the tree together and descends wherever
+	// any live lane overlaps the node.
+	u32 Stack[BVH_MAX_DEPTH];
+	u32 StackCount = 0;
+	Stack[StackCount++] = 0;
+	while(StackCount)
+	{
+		bvh_node *Node = Hierarchy->Nodes + Stack[--StackCount];
+		mask8 NodeMask = Active & RayIntersectsBounds(Node->Bounds, RayOrigin, InvRayDirection, Result->ClosestHit);
+		if(AnyTrue(NodeMask))
+		{
+			if(Node->Count)
+			{
+				for(u32 Index = Node->FirstIndex;
+					Index < Node->FirstIndex + Node->Count;
+					++Index)
+				{
+					IntersectObject(Prototype->Objects + Hierarchy->Indices[Index], RayOrigin, RayDirection, NodeMask, Result);
+				}
+			}
+			else
+			{
+				Assert(StackCount + 2 <= ArrayCount(Stack));
+				Stack[StackCount++] = Node->FirstIndex + 1;
+				Stack[StackCount++] = Node->FirstIndex;
+			}
+		}
+	}
+}
+
+internal void
+IntersectInstances(world *World, v3x8 RayOrigin, v3x8 RayDirection, mask8 Active, lane_ray_cast_result *Result)
+{
+	bvh *Hierarchy = &World->InstanceHierarchy;
+	v3x8 InvRayDirection = InverseDirection(RayDirection);
+
+	u32 Stack[BVH_MAX_DEPTH];
+	u32 StackCount = 0;
+	Stack[StackCount++] = 0;
+	while(StackCount)
+	{
+		bvh_node *Node = Hierarchy->Nodes + Stack[--StackCount];
+		mask8 NodeMask = Active & RayIntersectsBounds(Node->Bounds, RayOrigin, InvRayDirection, Result->ClosestHit);
+		if(AnyTrue(NodeMask))
+		{
+			if(Node->Count)
+			{
+				for(u32 Index = Node->FirstIndex;
+					Index < Node->FirstIndex + Node->Count;
+					++Index)
+				{
+					instance *Instance = World->Instances + Hierarchy->Indices[Index];
+
+					v3x8 ObjectRayOrigin = TransformPoint(Instance->WorldToObject, RayOrigin);
+					v3x8 ObjectRayDirection = TransformVector(Instance->WorldToObject, RayDirection);
+
+					lane_ray_cast_result InstanceResult = {};
+					InstanceResult.ClosestHit = Result->ClosestHit;
+					IntersectPrototype(Instance->Prototype, ObjectRayOrigin, ObjectRayDirection, NodeMask, &InstanceResult);
+
+					mask8 HitMask = (InstanceResult.ClosestHit < Result->ClosestHit);
+					if(AnyTrue(HitMask))
+					{
+						Result->ClosestHit = Select(HitMask, InstanceResult.ClosestHit, Result->ClosestHit);
+						Result->HitNormal = Select(HitMask, NOZ(TransformNormal(Instance->WorldToObject, InstanceResult.HitNormal)), Result->HitNormal);
+						for(u32 Lane = 0;
+							Lane < LANE_WIDTH;
+							++Lane)
+						{
+							if(HitMask.E[Lane])
+							{
+								Result->MaterialHit[Lane] = InstanceResult.MaterialHit[Lane];
+							}
+						}
+					}
+				}
+			}
+			else
+			{
+				Assert(StackCount + 2 <= ArrayCount(Stack));
+				Stack[StackCount++] = Node->FirstIndex + 1;
+				Stack[StackCount++] = Node->FirstIndex;
+			}
+		}
+	}
+}
+
+internal lane_ray_cast_result
+SingleRayCast(world *World, v3x8 RayOrigin, v3x8 RayDirection, mask8 Active, f32x8 MaxDistance)
+{
+	lane_ray_cast_result Result = {};
+	Result.ClosestHit = MaxDistance;
+
+	for(u32 ObjectIndex = 0;
+		ObjectIndex < World->ObjectCount;
+		++ObjectIndex)
+	{
+		IntersectObject(World->Objects + ObjectIndex, RayOrigin, RayDirection, Active, &Result);
+	}
+
+	if(World->InstanceCount)
+	{
+		IntersectInstances(World, RayOrigin, RayDirection, Active, &Result);
+	}
+
+	return Result;
+}
+
+// NOTE: Lane versions of GetBounceProbability and SampleEmitter in
+// ray_lights.cpp; the math is the same, see there.
+internal f32x8
+GetBounceProbability(v3x8 Direction, v3x8 Normal, v3x8 Mirror, f32x8 Specularity)
+{
+	// NOTE: Every lane is worked out, so mirrors are clamped to keep them
+	// finite; callers only read the rough ones.
+	f32x8 Result = F32x8(0.0f);
+	Specularity = Min(Specularity, F32x8(MIS_MAX_SPECULARITY));
+	f32x8 Scale = 1.0f - Specularity;
+	f32x8 InvScale = F32x8(1.0f)/Scale;
+	f32x8 CosMirror = Inner(Direction, Mirror);
+	f32x8 Discriminant = Square(Specularity*CosMirror) - Square(Specularity) + Square(Scale);
+	mask8 Meets = AndNot(Mask8(true), Discriminant < 0.0f);
+	f32x8 RootDiscriminant = SquareRoot(Max(Discriminant, F32x8(0.0f)));
+	f32x8 Lambdas[2] = {Specularity*CosMirror + RootDiscriminant, Specularity*CosMirror - RootDiscriminant};
+	for(u32 Root = 0;
+		Root < ArrayCount(Lambdas);
+		++Root)
+	{
+		f32x8 Lambda = Lambdas[Root];
+		v3x8 Unpulled = InvScale*(Lambda*Direction - Specularity*Mirror);
+		f32x8 Cos = AbsoluteValue(Inner(Unpulled, Direction));
+		mask8 Counts = Meets & (Lambda > 0.0f) & (Inner(Unpulled, Normal) > 0.0f) & (Cos > 0.0f);
+		f32x8 MaxComponent = Max(AbsoluteValue(Unpulled.x), Max(AbsoluteValue(Unpulled.y), AbsoluteValue(Unpulled.z)));
+		f32x8 Denominator = 12.0f*MaxComponent*MaxComponent*MaxComponent*Square(Scale)*Cos;
+		Result += Select(Counts, Square(Lambda) / Select(Counts, Denominator, F32x8(1.0f)), F32x8(0.0f));
+	}
+	return Result;
+}
+
+struct lane_emitter_sample
+{
+	object *Emitters[LANE_WIDTH];
+	v3x8 Direction;
+	f32x8 Probability;
+};
+
+// NOTE: Lanes left out of Active, or that the emitter they picked looks too
+// big from, come back with a zero probability. If that's all of them,
+// nothing else is worked out.
+internal void
+SampleEmitter(world *World, v3x8 P, mask8 Active, f32x8 EmitterSelect, f32x8 U, f32x8 V, lane_emitter_sample *Sample)
+{
+	v3x8 Center = P;
+	f32x8 Radius = F32x8(0.0f);
+	for(u32 Lane = 0;
+		Lane < LANE_WIDTH;
+		++Lane)
+	{
+		object *Emitter = 0;
+		if(Active.E[Lane])
+		{
+			u32 EmitterIndex = Minimum((u32)(EmitterSelect.E[Lane]*World->EmitterCount), World->EmitterCount - 1);
+			Emitter = World->Emitters[EmitterIndex];
+			SetLane(&Center, Lane, Emitter->Sphere.Center);
+			Radius.E[Lane] = Emitter->Sphere.Radius;
+		}
+		Sample->Emitters[Lane] = Emitter;
+	}
+
+	v3x8 ToCenter = Center - P;
+	f32x8 DistanceSq = LengthSq(ToCenter);
+	f32x8 RadiusSq = Square(Radius);
+	mask8 Small = Active & (RadiusSq < MIS_MAX_EMITTER_SIN_SQ*DistanceSq);
+	Sample->Probability = F32x8(0.0f);
+	if(!AnyTrue(Small))
+	{
+		return;
+	}
+	DistanceSq = Select(Small, DistanceSq, F32x8(1.0f));
+
+	f32x8 SinSq = RadiusSq / DistanceSq;
+	f32x8 CosMax = SquareRoot(Max(1.0f - SinSq, F32x8(0.0f)));
+	f32x8 SolidAngle = Select(Small, 2.0f*Pi32*SinSq / (1.0f + CosMax), F32x8(1.0f));
+	Sample->Probability = Select(Small, F32x8(1.0f) / ((f32)World->EmitterCount*SolidAngle), F32x8(0.0f));
+
+	v3x8 Z = (F32x8(1.0f) / SquareRoot(DistanceSq))*ToCenter;
+	v3x8 Up = Select(AbsoluteValue(Z.x) < 0.9f, V3x8(V3(1.0f, 0.0f, 0.0f)), V3x8(V3(0.0f, 1.0f, 0.0f)));
+	v3x8 X = NOZ(Cross(Up, Z));
+	v3x8 Y = Cross(Z, X);
+
+	f32x8 CosTheta = 1.0f - U*(1.0f - CosMax);
+	f32x8 SinTheta = SquareRoot(Max(1.0f - Square(CosTheta), F32x8(0.0f)));
+	f32x8 CosPhi;
+	f32x8 SinPhi;
+	CosSinTurns(V, &CosPhi, &SinPhi);
+
+	Sample->Direction = NOZ((SinTheta*CosPhi)*X + (SinTheta*SinPhi)*Y + CosTheta*Z);
+}
+
+// NOTE: Lane version of GetEnvironmentRadiance in ray_environment.cpp. The
+// angles are worked out all together, and the texels read one lane at a
+// time. Probabilities are only worked out for lanes in WantProbability.
+internal v3x8
+GetEnvironmentRadiance(environment_map *Map, v3x8 Direction, mask8 Active, mask8 WantProbability, f32x8 *Probability)
+{
+	Direction = NOZ(Direction);
+	f32x8 SinTheta = SquareRoot(Max(1.0f - Square(Direction.y), F32x8(0.0f)));
+	f32x8 U = 0.5f + ATan2Turns(Direction.x, -Direction.z);
+	f32x8 V = 2.0f*ATan2Turns(SinTheta, Direction.y);
+
+	v3x8 Result = V3x8(V3(0.0f, 0.0f, 0.0f));
+	*Probability = F32x8(0.0f);
+	for(u32 Lane = 0;
+		Lane < LANE_WIDTH;
+		++Lane)
+	{
+		if(Active.E[Lane])
+		{
+			u32 X = Minimum((u32)Maximum(U.E[Lane]*Map->Width, 0.0f), Map->Width - 1);
+			u32 Y = Minimum((u32)Maximum(V.E[Lane]*Map->Height, 0.0f), Map->Height - 1);
+			SetLane(&Result, Lane, Map->Texels[Y*Map->Width + X]);
+			if(WantProbability.E[Lane])
+			{
+				Probability->E[Lane] = GetEnvironmentProbability(Map, GetEnvironmentTexelProbability(Map, X, Y),
+				                                                 SinTheta.E[Lane]);
+			}
+		}
+	}
+	return Result;
+}
+
+struct lane_environment_sample
+{
+	v3x8 Direction;
+	v3x8 Radiance;
+	f32x8 Probability;
+};
+
+// NOTE: The texels are picked one lane at a time, since each is a pair of
+// searches, and the directions worked out all together. CosSinTurns of the
+// pick's U is Pi past the direction's angle around +y, hence the flipped
+// signs against SampleEnvironment. Lanes left out of Active, or that land on
+// a pole, come back with a zero probability.
+internal void
+SampleEnvironment(environment_map *Map, mask8 Active, f32x8 U, f32x8 V, lane_environment_sample *Sample)
+{
+	f32x8 PickU = F32x8(0.0f);
+	f32x8 PickV = F32x8(0.0f);
+	f32x8 TexelProbability = F32x8(0.0f);
+	Sample->Radiance = V3x8(V3(0.0f, 0.0f, 0.0f));
+	for(u32 Lane = 0;
+		Lane < LANE_WIDTH;
+		++Lane)
+	{
+		environment_pick Pick;
+		if(Active.E[Lane] && PickEnvironmentTexel(Map, U.E[Lane], V.E[Lane], &Pick))
+		{
+			PickU.E[Lane] = Pick.U;
+			PickV.E[Lane] = Pick.V;
+			TexelProbability.E[Lane] = Pick.TexelProbability;
+			SetLane(&Sample->Radiance, Lane, Map->Texels[Pick.TexelIndex]);
+		}
+	}
+
+	f32x8 CosTheta;
+	f32x8 SinTheta;
+	CosSinTurns(0.5f*PickV, &CosTheta, &SinTheta);
+	f32x8 CosPhi;
+	f32x8 SinPhi;
+	CosSinTurns(PickU, &CosPhi, &SinPhi);
+
+	Sample->Direction = V3x8(-SinTheta*SinPhi, CosTheta, SinTheta*CosPhi);
+	mask8 Valid = (TexelProbability > 0.0f) & (SinTheta > 0.0f);
+	f32x8 Scale = F32x8((f32)(Map->Width*Map->Height) / (2.0f*Pi32*Pi32));
+	Sample->Probability = Select(Valid, Scale*TexelProbability / Select(Valid, SinTheta, F32x8(1.0f)), F32x8(0.0f));
+}
+
+internal v3x8
+RayCast(world *World, v3x8 RayOrigin, v3x8 RayDirection, u32 MaxBounces,
+        random_series_x8 *Series, volatile u32 *RaysCast)
+{
+	TIMED_ZONE(ProfileZone_RayCast);
+
+	v3x8 Zero = V3x8(V3(0.0f, 0.0f, 0.0f));
+	v3x8 Result = Zero;
+	v3x8 Attenuation = V3x8(V3(1.0f, 1.0f, 1.0f));
+	mask8 Active = Mask8(true);
+	mask8 InsideObject = Mask8(false);
+	u32 RayCount = 0;
+
+	// NOTE: As in the single ray version, how likely the last bounce's
+	// direction was is only worked out for lanes that need it.
+	mask8 LastBounceRough = Mask8(false);
+	v3x8 LastBounceP = Zero;
+	v3x8 LastBounceNormal = Zero;
+	v3x8 LastBounceMirror = Zero;
+	f32x8 LastBounceSpecularity = F32x8(0.0f);
+
+	// NOTE: Each lane's matte bounces so far, and while the radiance cache
+	// is being filled, its matte vertices to add to it.
+	radiance_cache *Cache = World->RadianceCache;
+	u32 MatteBounceCount[LANE_WIDTH] = {};
+	u32 CacheVertexCount[LANE_WIDTH] = {};
+	radiance_cache_vertex CacheVertices[LANE_WIDTH][RADIANCE_CACHE_MAX_VERTICES];
+
+	v3x8 BackgroundColor = V3x8(World->NullMaterial.EmitColor);
+	v3x8 ToLight = V3x8(-World->LightDirection);
+	f32 SunProbability = GetSunProbability(World);
+	v3x8 SunColor = V3x8((SunProbability > 0.0f) ? (1.0f/SunProbability)*World->LightColor : World->LightColor);
+
+	for(u32 BounceIndex = 0;
+		BounceIndex < MaxBounces;
+		++BounceIndex)
+	{
+		RayCount += CountTrue(Active);
+		BEGIN_TIMED_ZONE(IntersectionZone, BounceIndex ? ProfileZone_SecondaryIntersection : ProfileZone_PrimaryIntersection);
+		lane_ray_cast_result RayCastResult = SingleRayCast(World, RayOrigin, RayDirection, Active, F32x8(Real32Maximum));
+		END_TIMED_ZONE(IntersectionZone);
+
+		// NOTE: Lanes that escaped pick up the background and stop.
+		mask8 HitMask = Active & (RayCastResult.ClosestHit < Real32Maximum);
+		mask8 Escaped = AndNot(Active, HitMask);
+		v3x8 Background = BackgroundColor;
+		if(World->Environment && AnyTrue(Escaped))
+		{
+			f32x8 EnvironmentProbability;
+			Background = GetEnvironmentRadiance(World->Environment, RayDirection, Escaped, LastBounceRough, &EnvironmentProbability);
+			f32x8 LastBounceProbability = F32x8(0.0f);
+			if(AnyTrue(Escaped & LastBounceRough))
+			{
+				LastBounceProbability = GetBounceProbability(RayDirection, LastBounceNormal, LastBounceMirror,
+				                                             LastBounceSpecularity);
+			}
+			f32x8 Sum = LastBounceProbability + EnvironmentProbability;
+			mask8 Positive = Sum > 0.0f;
+			f32x8 EnvironmentWeight = Select(Positive, LastBounceProbability / Select(Positive, Sum, F32x8(1.0f)), F32x8(0.0f));
+			Background = Select(Escaped & LastBounceRough, EnvironmentWeight*Background, Background);
+		}
+		Result += Select(Escaped, Hadamard(Attenuation, Background), Zero);
+		Active = HitMask;
+		if(!AnyTrue(Active))
+		{
+			break;
+		}
+
+		v3x8 ReflectionColor = Zero;
+		v3x8 EmitColor = Zero;
+		f32x8 Specularity = F32x8(0.0f);
+		f32x8 RefractionIndex = F32x8(1.0f);
+		mask8 Transparent = Mask8(false);
+		for(u32 Lane = 0;
+			Lane < LANE_WIDTH;
+			++Lane)
+		{
+			if(Active.E[Lane])
+			{
+				material *MaterialHit = RayCastResult.MaterialHit[Lane];
+				ReflectionColor.r.E[Lane] = MaterialHit->ReflectionColor.r;
+				ReflectionColor.g.E[Lane] = MaterialHit->ReflectionColor.g;
+				ReflectionColor.b.E[Lane] = MaterialHit->ReflectionColor.b;
+				EmitColor.r.E[Lane] = MaterialHit->EmitColor.r;
+				EmitColor.g.E[Lane] = MaterialHit->EmitColor.g;
+				EmitColor.b.E[Lane] = MaterialHit->EmitColor.b;
+				Specularity.E[Lane] = MaterialHit->Specularity;
+				RefractionIndex.E[Lane] = MaterialHit->RefractionIndex;
+				Transparent.E[Lane] = MaterialHit->Transparent ? 0xFFFFFFFF : 0;
+			}
+		}
+
+		mask8 BouncedRough = Active & LastBounceRough;
+		LastBounceRough = Mask8(false);
+
+		v3x8 HitNormal = RayCastResult.HitNormal;
+		v3x8 NewRayOrigin = Select(Active, RayOrigin + RayCastResult.ClosestHit*RayDirection, RayOrigin);
+		f32x8 CosIncidentAngle = AbsoluteValue(Inner(-RayDirection, HitNormal));
+		v3x8 PureBounce = RayDirection + (2.0f*CosIncidentAngle)*HitNormal;
+		v3x8 NextRayDirection = PureBounce;
+
+		mask8 TransparentHit = Active & Transparent;
+		mask8 OpaqueHit = AndNot(Active, Transparent);
+
+		if(AnyTrue(TransparentHit))
+		{
+			TIMED_ZONE(ProfileZone_TransparentFresnel);
+			f32x8 RefractionIndexRatio = Select(InsideObject, RefractionIndex, F32x8(1.0f)/RefractionIndex);
+			f32x8 Radical = 1.0f - Square(RefractionIndexRatio)*(1.0f - Square(CosIncidentAngle));
+			mask8 TotalInternalReflection = (Radical < 0.0f);
+
+			v3x8 Refraction = RefractionIndexRatio*RayDirection +
+				(RefractionIndexRatio*CosIncidentAngle - SquareRoot(Max(Radical, F32x8(0.0f))))*HitNormal;
+			f32x8 CosRefractionAngle = Inner(-Refraction, HitNormal);
+			f32x8 OldRefIndex = Select(InsideObject, RefractionIndex, F32x8(1.0f));
+			f32x8 NewRefIndex = Select(InsideObject, F32x8(1.0f), RefractionIndex);
+			f32x8 FresnelParallel = Square((NewRefIndex*CosIncidentAngle - OldRefIndex*CosRefractionAngle)/(NewRefIndex*CosIncidentAngle + OldRefIndex*CosRefractionAngle));
+			f32x8 FresnelPerp = Square((OldRefIndex*CosRefractionAngle - NewRefIndex*CosIncidentAngle)/(OldRefIndex*CosRefractionAngle + NewRefIndex*CosIncidentAngle));
+
+			f32x8 ReflectRatio = 0.5f*(FresnelParallel + FresnelPerp);
+			mask8 Reflected = TotalInternalReflection | (RandomUnilateral(Series) < ReflectRatio);
+			mask8 Refracted = AndNot(TransparentHit, Reflected);
+
+			NextRayDirection = Select(Refracted, Refraction, NextRayDirection);
+			InsideObject = InsideObject ^ Refracted;
+		}
+
+		if(AnyTrue(OpaqueHit))
+		{
+			Attenuation = Select(OpaqueHit, Hadamard(Attenuation, CosIncidentAngle*ReflectionColor), Attenuation);
+
+			// NOTE: While the radiance cache is being filled, matte lanes
+			// note their vertices; otherwise lanes that find their cell stop
+			// there. Either way it's one lane at a time.
+			mask8 Matte = AndNot(OpaqueHit, Specularity > RADIANCE_CACHE_MAX_SPECULARITY);
+			if(Cache && AnyTrue(Matte))
+			{
+				v3x8 ShadingNormal = Select(Inner(RayDirection, HitNormal) > 0.0f, -HitNormal, HitNormal);
+				v3x8 Cached = Zero;
+				mask8 CachedLanes = Mask8(false);
+				for(u32 Lane = 0;
+					Lane < LANE_WIDTH;
+					++Lane)
+				{
+					if(Matte.E[Lane])
+					{
+						if(Cache->Filling)
+						{
+							if((MatteBounceCount[Lane] >= Cache->LookupBounce) &&
+							   (CacheVertexCount[Lane] < RADIANCE_CACHE_MAX_VERTICES))
+							{
+								radiance_cache_vertex *Vertex = CacheVertices[Lane] + CacheVertexCount[Lane]++;
+								Vertex->Key = GetRadianceCacheKey(Cache, GetLane(NewRayOrigin, Lane), GetLane(ShadingNormal, Lane));
+								Vertex->Attenuation = GetLane(Attenuation, Lane);
+								Vertex->ResultBefore = GetLane(Result, Lane);
+							}
+						}
+						else
+						{
+							v3 Radiance;
+							if((MatteBounceCount[Lane] >= Cache->LookupBounce) &&
+							   LookupRadianceCache(Cache, GetRadianceCacheKey(Cache, GetLane(NewRayOrigin, Lane),
+							                                                  GetLane(ShadingNormal, Lane)), &Radiance))
+							{
+								SetLane(&Cached, Lane, Radiance);
+								CachedLanes.E[Lane] = 0xFFFFFFFF;
+							}
+						}
+						++MatteBounceCount[Lane];
+					}
+				}
+				Result += Hadamard(Attenuation, Cached);
+				OpaqueHit = AndNot(OpaqueHit, CachedLanes);
+				Active = AndNot(Active, CachedLanes);
+			}
+
+			// NOTE: Shadow ray, to the sun or to one of the lights. Lanes
+			// that pick from the light tree walk it one at a time.
+			BEGIN_TIMED_ZONE(ShadowZone, ProfileZone_ShadowRay);
+			f32x8 LightSelect = F32x8(0.0f);
+			if(World->LightCount)
+			{
+				LightSelect = RandomUnilateral(Series);
+			}
+			v3x8 RandomDirection = NOZ(V3x8(RandomBilateral(Series), RandomBilateral(Series), RandomBilateral(Series)));
+
+			mask8 SunLanes = OpaqueHit & (LightSelect < SunProbability);
+			mask8 TreeLanes = AndNot(OpaqueHit, SunLanes);
+			v3x8 LightDirection = NOZ(ToLight + 0.1f*RandomDirection);
+			f32x8 LightDistance = F32x8(Real32Maximum);
+			v3x8 LightRadiance = SunColor;
+			if(AnyTrue(TreeLanes))
+			{
+				v3x8 ShadingNormal = Select(Inner(RayDirection, HitNormal) > 0.0f, -HitNormal, HitNormal);
+				for(u32 Lane = 0;
+					Lane < LANE_WIDTH;
+					++Lane)
+				{
+					if(TreeLanes.E[Lane])
+					{
+						light_sample Sample;
+						if(SampleLightTree(World, GetLane(NewRayOrigin, Lane), GetLane(ShadingNormal, Lane),
+						                   RescaleSelect(LightSelect.E[Lane], SunProbability, false),
+						                   GetLane(RandomDirection, Lane), &Sample))
+						{
+							SetLane(&LightDirection, Lane, Sample.Direction);
+							LightDistance.E[Lane] = Sample.Distance;
+							SetLane(&LightRadiance, Lane, Sample.Radiance);
+						}
+						else
+						{
+							TreeLanes.E[Lane] = 0;
+						}
+					}
+				}
+			}
+
+			mask8 ShadowLanes = SunLanes | TreeLanes;
+			RayCount += CountTrue(ShadowLanes);
+			lane_ray_cast_result ShadowRayCast = SingleRayCast(World, NewRayOrigin, LightDirection, ShadowLanes, LightDistance);
+			mask8 Lit = AndNot(ShadowLanes, ShadowRayCast.ClosestHit < LightDistance);
+			Result += Select(Lit, Hadamard(Attenuation, LightRadiance), Zero);
+
+			// NOTE: Emitter ray
+			mask8 Rough = OpaqueHit & (Specularity < MIS_MAX_SPECULARITY);
+			if(World->EmitterCount && AnyTrue(Rough))
+			{
+				f32x8 EmitterSelect = RandomUnilateral(Series);
+				f32x8 EmitterU = RandomUnilateral(Series);
+				f32x8 EmitterV = RandomUnilateral(Series);
+
+				lane_emitter_sample Sample;
+				SampleEmitter(World, NewRayOrigin, Rough, EmitterSelect, EmitterU, EmitterV, &Sample);
+				mask8 Aimed = (Sample.Probability > 0.0f);
+
+				// NOTE: As in the single ray version, lanes whose bounce
+				// can't take the direction aren't traced.
+				mask8 EmitterLanes = Mask8(false);
+				f32x8 EmitterWeight = F32x8(0.0f);
+				if(AnyTrue(Aimed))
+				{
+					f32x8 BounceProbability = GetBounceProbability(Sample.Direction, HitNormal, PureBounce, Specularity);
+					EmitterLanes = Aimed & (BounceProbability > 0.0f);
+					EmitterWeight = BounceProbability / Select(EmitterLanes, BounceProbability + Sample.Probability, F32x8(1.0f));
+				}
+
+				if(AnyTrue(EmitterLanes))
+				{
+					RayCount += CountTrue(EmitterLanes);
+					lane_ray_cast_result EmitterRayCast = SingleRayCast(World, NewRayOrigin, Sample.Direction,
+					                                                    EmitterLanes, F32x8(Real32Maximum));
+					v3x8 EmitterRadiance = Zero;
+					for(u32 Lane = 0;
+						Lane < LANE_WIDTH;
+						++Lane)
+					{
+						object *Emitter = Sample.Emitters[Lane];
+						if(EmitterLanes.E[Lane] && (EmitterRayCast.MaterialHit[Lane] == &Emitter->Material))
+						{
+							v3 Direction = GetLane(Sample.Direction, Lane);
+							v3 Radiance = GetEmitterRadiance(Emitter, Direction, GetLane(EmitterRayCast.HitNormal, Lane));
+							SetLane(&EmitterRadiance, Lane, EmitterWeight.E[Lane]*Radiance);
+						}
+					}
+					Result += Hadamard(Attenuation, EmitterRadiance);
+				}
+			}
+
+			// NOTE: Environment ray; see ray_environment.cpp.
+			if(World->Environment)
+			{
+				f32x8 EnvironmentU = RandomUnilateral(Series);
+				f32x8 EnvironmentV = RandomUnilateral(Series);
+
+				lane_environment_sample Sample;
+				SampleEnvironment(World->Environment, Rough, EnvironmentU, EnvironmentV, &Sample);
+
+				f32x8 BounceProbability = GetBounceProbability(Sample.Direction, HitNormal, PureBounce, Specularity);
+				mask8 EnvironmentLanes = Rough & (Sample.Probability > 0.0f) & (BounceProbability > 0.0f);
+				if(AnyTrue(EnvironmentLanes))
+				{
+					RayCount += CountTrue(EnvironmentLanes);
+					lane_ray_cast_result EnvironmentRayCast = SingleRayCast(World, NewRayOrigin, Sample.Direction,
+					                                                        EnvironmentLanes, F32x8(Real32Maximum));
+					mask8 Unblocked = AndNot(EnvironmentLanes, EnvironmentRayCast.ClosestHit < Real32Maximum);
+					f32x8 EnvironmentWeight = BounceProbability / Select(EnvironmentLanes, BounceProbability + Sample.Probability, F32x8(1.0f));
+					Result += Select(Unblocked, EnvironmentWeight*Hadamard(Attenuation, Sample.Radiance), Zero);
+				}
+			}
+			END_TIMED_ZONE(ShadowZone);
+
+			// NOTE: Caustics, looked up one lane at a time.
+			if(World->Caustics && AnyTrue(Rough))
+			{
+				v3x8 ShadingNormal = Select(Inner(RayDirection, HitNormal) > 0.0f, -HitNormal, HitNormal);
+				v3x8 Caustic = Zero;
+				for(u32 Lane = 0;
+					Lane < LANE_WIDTH;
+					++Lane)
+				{
+					if(Rough.E[Lane])
+					{
+						SetLane(&Caustic, Lane, GetCausticRadiance(World->Caustics, GetLane(NewRayOrigin, Lane),
+						                                           GetLane(ShadingNormal, Lane)));
+					}
+				}
+				Result += Hadamard(Attenuation, Caustic);
+			}
+
+			f32x8 EmitWeight = F32x8(1.0f);
+			mask8 WeighedLanes = OpaqueHit & BouncedRough & (LengthSq(EmitColor) > 0.0f);
+			if(AnyTrue(WeighedLanes))
+			{
+				f32x8 EmitterProbability = F32x8(0.0f);
+				for(u32 Lane = 0;
+					Lane < LANE_WIDTH;
+					++Lane)
+				{
+					object *Emitter = WeighedLanes.E[Lane] ? FindEmitter(World, RayCastResult.MaterialHit[Lane]) : 0;
+					if(Emitter)
+					{
+						EmitterProbability.E[Lane] = GetEmitterProbability(World, Emitter, GetLane(LastBounceP, Lane));
+					}
+				}
+
+				mask8 Aimable = (EmitterProbability > 0.0f);
+				if(AnyTrue(Aimable))
+				{
+					f32x8 LastBounceProbability = GetBounceProbability(RayDirection, LastBounceNormal, LastBounceMirror,
+					                                                   LastBounceSpecularity);
+					f32x8 Sum = LastBounceProbability + EmitterProbability;
+					mask8 Positive = Sum > 0.0f;
+					f32x8 Weight = Select(Positive, LastBounceProbability / Select(Positive, Sum, F32x8(1.0f)), F32x8(0.0f));
+					EmitWeight = Select(Aimable, Weight, EmitWeight);
+				}
+			}
+			Result += Select(OpaqueHit, EmitWeight*Hadamard(Attenuation, EmitColor), Zero);
+
+			TIMED_ZONE(ProfileZone_BounceSampling);
+			v3x8 RandomBounce = NOZ(V3x8(RandomBilateral(Series), RandomBilateral(Series), RandomBilateral(Series)));
+			RandomBounce = Select(Inner(RandomBounce, HitNormal) < 0.0f, -RandomBounce, RandomBounce);
+			v3x8 DiffuseBounce = NOZ(Lerp(RandomBounce, Specularity, PureBounce));
+			NextRayDirection = Select(OpaqueHit, DiffuseBounce, NextRayDirection);
+
+			if((World->EmitterCount || World->Environment) && AnyTrue(Rough))
+			{
+				LastBounceRough = Rough;
+				LastBounceP = NewRayOrigin;
+				LastBounceNormal = HitNormal;
+				LastBounceMirror = PureBounce;
+				LastBounceSpecularity = Specularity;
+			}
+		}
+
+		RayOrigin = NewRayOrigin;
+		RayDirection = NextRayDirection;
+	}
+
+	for(u32 Lane = 0;
+		Lane < LANE_WIDTH;
+		++Lane)
+	{
+		if(CacheVertexCount[Lane])
+		{
+			AddRadianceCachePath(Cache, CacheVertices[Lane], CacheVertexCount[Lane], GetLane(Result, Lane));
+		}
+	}
+
+	LockedAddAndReturnPreviousValue(RaysCast, RayCount);
+
+	return Result;
+}
+
+internal void
+RenderTileX8(tile_work_order *WorkOrder, u32 FrameIndex, volatile u32 *RaysCast)
+{
+	world *World = WorkOrder->World;
+	image *Image = WorkOrder->Image;
+	u32 RaysPerPixel = WorkOrder->RaysPerPixel;
+
+	v3x8 CameraP = V3x8(World->CameraP);
+	v3x8 FilmP = V3x8(World->FilmP);
+	v3x8 HalfFilmX = V3x8(World->HalfFilmW*World->CameraX);
+	v3x8 HalfFilmY = V3x8(World->HalfFilmH*World->CameraY);
+	f32 InvImageWidth = 1.0f/(f32)Image->Width;
+	f32 InvImageHeight = 1.0f/(f32)Image->Height;
+
+	// NOTE: Samples the radiance cache's fill already traced are picked up
+	// from it; see ray_radiance_cache.cpp.
+	radiance_cache *Cache = World->RadianceCache;
+	u32 FilledSamples = GetRadianceCacheFilledSamples(Cache, WorkOrder, FrameIndex);
+
+	for(u32 Y = WorkOrder->MinY;
+		Y < WorkOrder->OnePastMaxY;
+		++Y)
+	{
+		u32 *Dest = GetPixelPointer(Image, WorkOrder->MinX, Y);
+
+		for(u32 X = WorkOrder->MinX;
+			X < WorkOrder->OnePastMaxX;
+			++X)
+		{
+			v3 Color = {};
+			f32 Contrib = 1.0f/RaysPerPixel;
+			u32 PixelIndex = Y*Image->Width + X;
+			if(FilledSamples)
+			{
+				Color = Contrib*Cache->FillColor[PixelIndex];
+			}
+
+			u32 RayIndex = FilledSamples;
+			for(;
+				RayIndex + LANE_WIDTH <= RaysPerPixel;
+				RayIndex += LANE_WIDTH)
+			{
+				random_series_x8 Series = RandomSeriesX8(FrameIndex, PixelIndex, WorkOrder->FirstSample + RayIndex);
+				f32x8 XRatio = -1.0f + 2.0f*((((f32)X) + 0.5f*RandomBilateral(&Series))*InvImageWidth);
+				f32x8 YRatio = -1.0f + 2.0f*((((f32)Y) + 0.5f*RandomBilateral(&Series))*InvImageHeight);
+				v3x8 FilmPoint = FilmP + XRatio*HalfFilmX + YRatio*HalfFilmY;
+				v3x8 RayDirection = NOZ(FilmPoint - CameraP);
+
+				v3x8 LaneColor = RayCast(World, CameraP, RayDirection, WorkOrder->MaxBounces, &Series, RaysCast);
+				Color += Contrib*HorizontalAdd(LaneColor);
+			}
+
+			// NOTE: Sample counts that don't fill a whole packet finish the
+			// remainder one ray at a time.
+			for(;
+				RayIndex < RaysPerPixel;
+				++RayIndex)
+			{
+				random_series Series = RandomSeries(GetSampleSeed(FrameIndex, PixelIndex, WorkOrder->FirstSample + RayIndex));
+				f32 XRatio = -1.0f + 2.0f*((((f32)X) + 0.5f*RandomBilateral(&Series))*InvImageWidth);
+				f32 YRatio = -1.0f + 2.0f*((((f32)Y) + 0.5f*RandomBilateral(&Series))*InvImageHeight);
+				v3a FilmPoint = V3a(World->FilmP + XRatio*World->HalfFilmW*World->CameraX + YRatio*World->HalfFilmH*World->CameraY);
+				v3a RayOrigin = V3a(World->CameraP);
+				v3a RayDirection = NOZ(FilmPoint - RayOrigin);
+				Color += Contrib*V3(RayCast(World, RayOrigin, RayDirection, WorkOrder->MaxBounces, &Series, RaysCast));
+			}
+
+			TIMED_ZONE(ProfileZone_PackSRGB);
+			*Dest++ = PackLinear01ToSRGBU32(Color);
+			if(Image->Radiance)
+			{
+				Image->Radiance[GetRadianceIndex(Image, X, Y)] = Color;
+			}
+		}
+	}
+}
@@ -0,0 +1,961 @@
+/*@H
+* File: ray_lane_math.h
+* Author: Jesse Calvert
+* Created: October 19, 2026, 12:58
+* Last modified: October 19, 2026, 16:28
+*/
+
+// NOTE: Eight independent values laid out as structure of arrays, one per
+// SIMD lane. There's no include guard: ray_kernel.cpp pulls this in once per
+// instruction set, inside that set's namespace. From AVX2 up each value is a
+// single 256-bit register, the SSE levels split it across two, and with
+// RAY_SIMD_MATH off it's a plain array.
+
+#undef LANE_AVX
+#undef LANE_SSE
+#if RAY_SIMD_MATH && (KERNEL_ISA >= KERNEL_ISA_AVX2)
+#define LANE_AVX 1
+#define LANE_SSE 0
+#elif RAY_SIMD_MATH
+#define LANE_AVX 0
+#define LANE_SSE 1
+#else
+#define LANE_AVX 0
+#define LANE_SSE 0
+#endif
+
+union alignas(32) f32x8
+{
+	r32 E[LANE_WIDTH];
+#if LANE_AVX
+	__m256 W;
+#elif LANE_SSE
+	__m128 W[2];
+#endif
+};
+
+union alignas(32) u32x8
+{
+	u32 E[LANE_WIDTH];
+#if LANE_AVX
+	__m256i W;
+#elif LANE_SSE
+	__m128i W[2];
+#endif
+};
+
+// NOTE: Each lane is either all ones or all zeros, the way SIMD compares
+// report their results.
+union alignas(32) mask8
+{
+	u32 E[LANE_WIDTH];
+#if LANE_AVX
+	__m256 W;
+#elif LANE_SSE
+	__m128 W[2];
+#endif
+};
+
+union v3x8
+{
+	struct
+	{
+		f32x8 x, y, z;
+	};
+	struct
+	{
+		f32x8 r, g, b;
+	};
+	f32x8 E[3];
+};
+
+//
+// NOTE: Lane operations
+//
+
+inline_force f32x8
+F32x8(r32 Value)
+{
+	f32x8 Result;
+#if LANE_AVX
+	Result.W = _mm256_set1_ps(Value);
+#elif LANE_SSE
+	Result.W[0] = Result.W[1] = _mm_set1_ps(Value);
+#else
+	for(u32 Lane = 0;
+		Lane < LANE_WIDTH;
+		++Lane)
+	{
+		Result.E[Lane] = Value;
+	}
+#endif
+	return Result;
+}
+
+inline_force u32x8
+U32x8(u32 Value)
+{
+	u32x8 Result;
+#if LANE_AVX
+	Result.W = _mm256_set1_epi32((s32)Value);
+#elif LANE_SSE
+	Result.W[0] = Result.W[1] = _mm_set1_epi32((s32)Value);
+#else
+	for(u32 Lane = 0;
+		Lane < LANE_WIDTH;
+		++Lane)
+	{
+		Result.E[Lane] = Value;
+	}
+#endif
+	return Result;
+}
+
+inline_force mask8
+Mask8(b32 Value)
+{
+	mask8 Result;
+	u32 Bits = Value ? 0xFFFFFFFF : 0;
+	for(u32 Lane = 0;
+		Lane < LANE_WIDTH;
+		++Lane)
+	{
+		Result.E[Lane] = Bits;
+	}
+	return Result;
+}
+
+inline_force f32x8
+operator+(f32x8 A, f32x8 B)
+{
+	f32x8 Result;
+#if LANE_AVX
+	Result.W = _mm256_add_ps(A.W, B.W);
+#elif LANE_SSE
+	Result.W[0] = _mm_add_ps(A.W[0], B.W[0]);
+	Result.W[1] = _mm_add_ps(A.W[1], B.W[1]);
+#else
+	for(u32 Lane = 0;
+		Lane < LANE_WIDTH;
+		++Lane)
+	{
+		Result.E[Lane] = A.E[Lane] + B.E[Lane];
+	}
+#endif
+	return Result;
+}
+
+inline_force f32x8
+operator-(f32x8 A, f32x8 B)
+{
+	f32x8 Result;
+#if LANE_AVX
+	Result.W = _mm256_sub_ps(A.W, B.W);
+#elif LANE_SSE
+	Result.W[0] = _mm_sub_ps(A.W[0], B.W[0]);
+	Result.W[1] = _mm_sub_ps(A.W[1], B.W[1]);
+#else
+	for(u32 Lane = 0;
+		Lane < LANE_WIDTH;
+		++Lane)
+	{
+		Result.E[Lane] = A.E[Lane] - B.E[Lane];
+	}
+#endif
+	return Result;
+}
+
+inline_force f32x8
+operator*(f32x8 A, f32x8 B)
+{
+	f32x8 Result;
+#if LANE_AVX
+	Result.W = _mm256_mul_ps(A.W, B.W);
+#elif LANE_SSE
+	Result.W[0] = _mm_mul_ps(A.W[0], B.W[0]);
+	Result.W[1] = _mm_mul_ps(A.W[1], B.W[1]);
+#else
+	for(u32 Lane = 0;
+		Lane < LANE_WIDTH;
+		++Lane)
+	{
+		Result.E[Lane] = A.E[Lane] * B.E[Lane];
+	}
+#endif
+	return Result;
+}
+
+inline_force f32x8
+operator/(f32x8 A, f32x8 B)
+{
+	f32x8 Result;
+#if LANE_AVX
+	Result.W = _mm256_div_ps(A.W, B.W);
+#elif LANE_SSE
+	Result.W[0] = _mm_div_ps(A.W[0], B.W[0]);
+	Result.W[1] = _mm_div_ps(A.W[1], B.W[1]);
+#else
+	for(u32 Lane = 0;
+		Lane < LANE_WIDTH;
+		++Lane)
+	{
+		Result.E[Lane] = A.E[Lane] / B.E[Lane];
+	}
+#endif
+	return Result;
+}
+
+inline_force f32x8
+operator-(f32x8 A)
+{
+	f32x8 Result = F32x8(0.0f) - A;
+	return Result;
+}
+
+inline_force f32x8
+operator*(r32 Scalar, f32x8 A)
+{
+	f32x8 Result = F32x8(Scalar)*A;
+	return Result;
+}
+
+inline_force f32x8
+operator*(f32x8 A, r32 Scalar)
+{
+	f32x8 Result = A*F32x8(Scalar);
+	return Result;
+}
+
+inline_force f32x8
+operator+(r32 Scalar, f32x8 A)
+{
+	f32x8 Result = F32x8(Scalar) + A;
+	return Result;
+}
+
+inline_force f32x8
+operator+(f32x8 A, r32 Scalar)
+{
+	f32x8 Result = A + F32x8(Scalar);
+	return Result;
+}
+
+inline_force f32x8
+operator-(r32 Scalar, f32x8 A)
+{
+	f32x8 Result = F32x8(Scalar) - A;
+	return Result;
+}
+
+inline_force f32x8
+operator-(f32x8 A, r32 Scalar)
+{
+	f32x8 Result = A - F32x8(Scalar);
+	return Result;
+}
+
+inline_force f32x8 &
+operator+=(f32x8 &A, f32x8 B)
+{
+	A = A + B;
+	return A;
+}
+
+inline_force mask8
+operator<(f32x8 A, f32x8 B)
+{
+	mask8 Result;
+#if LANE_AVX
+	Result.W = _mm256_cmp_ps(A.W, B.W, _CMP_LT_OQ);
+#elif LANE_SSE
+	Result.W[0] = _mm_cmplt_ps(A.W[0], B.W[0]);
+	Result.W[1] = _mm_cmplt_ps(A.W[1], B.W[1]);
+#else
+	for(u32 Lane = 0;
+		Lane < LANE_WIDTH;
+		++Lane)
+	{
+		Result.E[Lane] = (A.E[Lane] < B.E[Lane]) ? 0xFFFFFFFF : 0;
+	}
+#endif
+	return Result;
+}
+
+inline_force mask8
+operator>(f32x8 A, f32x8 B)
+{
+	mask8 Result = (B < A);
+	return Result;
+}
+
+inline_force mask8
+operator<(f32x8 A, r32 B)
+{
+	mask8 Result = (A < F32x8(B));
+	return Result;
+}
+
+inline_force mask8
+operator>(f32x8 A, r32 B)
+{
+	mask8 Result = (F32x8(B) < A);
+	return Result;
+}
+
+inline_force mask8
+operator&(mask8 A, mask8 B)
+{
+	mask8 Result;
+#if LANE_AVX
+	Result.W = _mm256_and_ps(A.W, B.W);
+#elif LANE_SSE
+	Result.W[0] = _mm_and_ps(A.W[0], B.W[0]);
+	Result.W[1] = _mm_and_ps(A.W[1], B.W[1]);
+#else
+	for(u32 Lane = 0;
+		Lane < LANE_WIDTH;
+		++Lane)
+	{
+		Result.E[Lane] = A.E[Lane] & B.E[Lane];
+	}
+#endif
+	return Result;
+}
+
+inline_force mask8
+operator|(mask8 A, mask8 B)
+{
+	mask8 Result;
+#if LANE_AVX
+	Result.W = _mm256_or_ps(A.W, B.W);
+#elif LANE_SSE
+	Result.W[0] = _mm_or_ps(A.W[0], B.W[0]);
+	Result.W[1] = _mm_or_ps(A.W[1], B.W[1]);
+#else
+	for(u32 Lane = 0;
+		Lane < LANE_WIDTH;
+		++Lane)
+	{
+		Result.E[Lane] = A.E[Lane] | B.E[Lane];
+	}
+#endif
+	return Result;
+}
+
+inline_force mask8
+operator^(mask8 A, mask8 B)
+{
+	mask8 Result;
+#if LANE_AVX
+	Result.W = _mm256_xor_ps(A.W, B.W);
+#elif LANE_SSE
+	Result.W[0] = _mm_xor_ps(A.W[0], B.W[0]);
+	Result.W[1] = _mm_xor_ps(A.W[1], B.W[1]);
+#else
+	for(u32 Lane = 0;
+		Lane < LANE_WIDTH;
+		++Lane)
+	{
+		Result.E[Lane] = A.E[Lane] ^ B.E[Lane];
+	}
+#endif
+	return Result;
+}
+
+inline_force mask8
+AndNot(mask8 A, mask8 B)
+{
+	// NOTE: A & ~B
+	mask8 Result;
+#if LANE_AVX
+	Result.W = _mm256_andnot_ps(B.W, A.W);
+#elif LANE_SSE
+	Result.W[0] = _mm_andnot_ps(B.W[0], A.W[0]);
+	Result.W[1] = _mm_andnot_ps(B.W[1], A.W[1]);
+#else
+	for(u32 Lane = 0;
+		Lane < LANE_WIDTH;
+		++Lane)
+	{
+		Result.E[Lane] = A.E[Lane] & ~B.E[Lane];
+	}
+#endif
+	return Result;
+}
+
+inline_force u32
+LaneBits(mask8 Mask)
+{
+	// NOTE: One bit per lane, lane 0 in the lowest bit.
+#if LANE_AVX
+	u32 Result = (u32)_mm256_movemask_ps(Mask.W);
+#elif LANE_SSE
+	u32 Result = (u32)(_mm_movemask_ps(Mask.W[0]) | (_mm_movemask_ps(Mask.W[1]) << 4));
+#else
+	u32 Result = 0;
+	for(u32 Lane = 0;
+		Lane < LANE_WIDTH;
+		++Lane)
+	{
+		Result |= (Mask.E[Lane] & 1) << Lane;
+	}
+#endif
+	return Result;
+}
+
+inline_force b32
+AnyTrue(mask8 Mask)
+{
+	b32 Result = (LaneBits(Mask) != 0);
+	return Result;
+}
+
+inline_force u32
+CountTrue(mask8 Mask)
+{
+	u32 Bits = LaneBits(Mask);
+	Bits = Bits - ((Bits >> 1) & 0x55);
+	Bits = (Bits & 0x33) + ((Bits >> 2) & 0x33);
+	u32 Result = (Bits + (Bits >> 4)) & 0x0F;
+	return Result;
+}
+
+inline_force f32x8
+Select(mask8 Mask, f32x8 A, f32x8 B)
+{
+	// NOTE: A where the mask is set, B everywhere else.
+	f32x8 Result;
+#if LANE_AVX
+	Result.W = _mm256_blendv_ps(B.W, A.W, Mask.W);
+#elif LANE_SSE && (KERNEL_ISA >= KERNEL_ISA_SSE4)
+	Result.W[0] = _mm_blendv_ps(B.W[0], A.W[0], Mask.W[0]);
+	Result.W[1] = _mm_blendv_ps(B.W[1], A.W[1], Mask.W[1]);
+#elif LANE_SSE
+	Result.W[0] = _mm_or_ps(_mm_and_ps(Mask.W[0], A.W[0]), _mm_andnot_ps(Mask.W[0], B.W[0]));
+	Result.W[1] = _mm_or_ps(_mm_and_ps(Mask.W[1], A.W[1]), _mm_andnot_ps(Mask.W[1], B.W[1]));
+#else
+	for(u32 Lane = 0;
+		Lane < LANE_WIDTH;
+		++Lane)
+	{
+		Result.E[Lane] = Mask.E[Lane] ? A.E[Lane] : B.E[Lane];
+	}
+#endif
+	return Result;
+}
+
+inline_force f32x8
+Min(f32x8 A, f32x8 B)
+{
+	f32x8 Result;
+#if LANE_AVX
+	Result.W = _mm256_min_ps(A.W, B.W);
+#elif LANE_SSE
+	Result.W[0] = _mm_min_ps(A.W[0], B.W[0]);
+	Result.W[1] = _mm_min_ps(A.W[1], B.W[1]);
+#else
+	for(u32 Lane = 0;
+		Lane < LANE_WIDTH;
+		++Lane)
+	{
+		Result.E[Lane] = (A.E[Lane] < B.E[Lane]) ? A.E[Lane] : B.E[Lane];
+	}
+#endif
+	return Result;
+}
+
+inline_force f32x8
+Max(f32x8 A, f32x8 B)
+{
+	f32x8 Result;
+#if LANE_AVX
+	Result.W = _mm256_max_ps(A.W, B.W);
+#elif LANE_SSE
+	Result.W[0] = _mm_max_ps(A.W[0], B.W[0]);
+	Result.W[1] = _mm_max_ps(A.W[1], B.W[1]);
+#else
+	for(u32 Lane = 0;
+		Lane < LANE_WIDTH;
+		++Lane)
+	{
+		Result.E[Lane] = (A.E[Lane] > B.E[Lane]) ? A.E[Lane] : B.E[Lane];
+	}
+#endif
+	return Result;
+}
+
+inline_force f32x8
+AbsoluteValue(f32x8 A)
+{
+	f32x8 Result = Max(A, -A);
+	return Result;
+}
+
+inline_force f32x8
+Square(f32x8 A)
+{
+	f32x8 Result = A*A;
+	return Result;
+}
+
+inline_force f32x8
+SquareRoot(f32x8 A)
+{
+	f32x8 Result;
+#if LANE_AVX
+	Result.W = _mm256_sqrt_ps(A.W);
+#elif LANE_SSE
+	Result.W[0] = _mm_sqrt_ps(A.W[0]);
+	Result.W[1] = _mm_sqrt_ps(A.W[1]);
+#else
+	for(u32 Lane = 0;
+		Lane < LANE_WIDTH;
+		++Lane)
+	{
+		Result.E[Lane] = SquareRoot(A.E[Lane]);
+	}
+#endif
+	return Result;
+}
+
+inline_force f32x8
+Lerp(f32x8 A, f32x8 t, f32x8 B)
+{
+	f32x8 Result = A + t*(B - A);
+	return Result;
+}
+
+// NOTE: The cosine and sine of 2*Pi*Turns, for Turns in [0, 1). The angle is
+// folded into [0, Pi/2] by symmetry and the Taylor series taken to where
+// its error is under a float's, so it's all multiplies and adds and comes
+// out the same on every instruction set.
+inline void
+CosSinTurns(f32x8 Turns, f32x8 *CosResult, f32x8 *SinResult)
+{
+	f32x8 Centered = Turns - 0.5f;
+	f32x8 Half = AbsoluteValue(Centered);
+	mask8 Far = (Half > 0.25f);
+	f32x8 x = 2.0f*Pi32*Min(Half, 0.5f - Half);
+	f32x8 x2 = x*x;
+
+	f32x8 Cos = 1.0f - x2*(1.0f/2.0f - x2*(1.0f/24.0f - x2*(1.0f/720.0f - x2*(1.0f/40320.0f -
+	            x2*(1.0f/3628800.0f - x2*(1.0f/479001600.0f))))));
+	f32x8 Sin = x*(1.0f - x2*(1.0f/6.0f - x2*(1.0f/120.0f - x2*(1.0f/5040.0f - x2*(1.0f/362880.0f -
+	            x2*(1.0f/39916800.0f))))));
+
+	// NOTE: 2*Pi*Turns is Pi past the centered angle, which flips both.
+	*CosResult = Select(Far, Cos, -Cos);
+	*SinResult = Select(Centered < 0.0f, Sin, -Sin);
+}
+
+// NOTE: The angle of (X, Y) from +x, as a fraction of a turn in
+// [-0.5, 0.5]. The arctangent is only taken of the smaller over the larger
+// of the two, which stays in [0, 1] where a short polynomial is good to
+// about 1e-5 radians, and the octant is put back after.
+inline f32x8
+ATan2Turns(f32x8 Y, f32x8 X)
+{
+	f32x8 AbsX = AbsoluteValue(X);
+	f32x8 AbsY = AbsoluteValue(Y);
+	f32x8 Larger = Max(AbsX, AbsY);
+	f32x8 t = Min(AbsX, AbsY) / Select(Larger > 0.0f, Larger, F32x8(1.0f));
+	f32x8 t2 = t*t;
+
+	f32x8 Angle = t*(0.99997726f - t2*(0.33262347f - t2*(0.19354346f - t2*(0.11643287f - t2*(0.05265332f -
+	              0.01172120f*t2)))));
+	Angle = Select(AbsY > AbsX, 0.5f*Pi32 - Angle, Angle);
+	Angle = Select(X < 0.0f, Pi32 - Angle, Angle);
+	Angle = Select(Y < 0.0f, -Angle, Angle);
+
+	f32x8 Result = (1.0f / (2.0f*Pi32))*Angle;
+	return Result;
+}
+
+inline_force u32x8
+operator+(u32x8 A, u32x8 B)
+{
+	u32x8 Result;
+#if LANE_AVX
+	Result.W = _mm256_add_epi32(A.W, B.W);
+#elif LANE_SSE
+	Result.W[0] = _mm_add_epi32(A.W[0], B.W[0]);
+	Result.W[1] = _mm_add_epi32(A.W[1], B.W[1]);
+#else
+	for(u32 Lane = 0;
+		Lane < LANE_WIDTH;
+		++Lane)
+	{
+		Result.E[Lane] = A.E[Lane] + B.E[Lane];
+	}
+#endif
+	return Result;
+}
+
+inline_force u32x8
+operator^(u32x8 A, u32x8 B)
+{
+	u32x8 Result;
+#if LANE_AVX
+	Result.W = _mm256_xor_si256(A.W, B.W);
+#elif LANE_SSE
+	Result.W[0] = _mm_xor_si128(A.W[0], B.W[0]);
+	Result.W[1] = _mm_xor_si128(A.W[1], B.W[1]);
+#else
+	for(u32 Lane = 0;
+		Lane < LANE_WIDTH;
+		++Lane)
+	{
+		Result.E[Lane] = A.E[Lane] ^ B.E[Lane];
+	}
+#endif
+	return Result;
+}
+
+inline_force u32x8
+operator|(u32x8 A, u32x8 B)
+{
+	u32x8 Result;
+#if LANE_AVX
+	Result.W = _mm256_or_si256(A.W, B.W);
+#elif LANE_SSE
+	Result.W[0] = _mm_or_si128(A.W[0], B.W[0]);
+	Result.W[1] = _mm_or_si128(A.W[1], B.W[1]);
+#else
+	for(u32 Lane = 0;
+		Lane < LANE_WIDTH;
+		++Lane)
+	{
+		Result.E[Lane] = A.E[Lane] | B.E[Lane];
+	}
+#endif
+	return Result;
+}
+
+inline_force u32x8
+operator<<(u32x8 A, u32 Shift)
+{
+	u32x8 Result;
+#if LANE_AVX
+	Result.W = _mm256_slli_epi32(A.W, Shift);
+#elif LANE_SSE
+	Result.W[0] = _mm_slli_epi32(A.W[0], Shift);
+	Result.W[1] = _mm_slli_epi32(A.W[1], Shift);
+#else
+	for(u32 Lane = 0;
+		Lane < LANE_WIDTH;
+		++Lane)
+	{
+		Result.E[Lane] = A.E[Lane] << Shift;
+	}
+#endif
+	return Result;
+}
+
+inline_force u32x8
+operator>>(u32x8 A, u32 Shift)
+{
+	u32x8 Result;
+#if LANE_AVX
+	Result.W = _mm256_srli_epi32(A.W, Shift);
+#elif LANE_SSE
+	Result.W[0] = _mm_srli_epi32(A.W[0], Shift);
+	Result.W[1] = _mm_srli_epi32(A.W[1], Shift);
+#else
+	for(u32 Lane = 0;
+		Lane < LANE_WIDTH;
+		++Lane)
+	{
+		Result.E[Lane] = A.E[Lane] >> Shift;
+	}
+#endif
+	return Result;
+}
+
+// NOTE: Unaligned loads and stores of eight consecutive floats.
+inline_force f32x8
+LoadF32x8(f32 *Source)
+{
+	f32x8 Result;
+#if LANE_AVX
+	Result.W = _mm256_loadu_ps(Source);
+#elif LANE_SSE
+	Result.W[0] = _mm_loadu_ps(Source);
+	Result.W[1] = _mm_loadu_ps(Source + 4);
+#else
+	for(u32 Lane = 0;
+		Lane < LANE_WIDTH;
+		++Lane)
+	{
+		Result.E[Lane] = Source[Lane];
+	}
+#endif
+	return Result;
+}
+
+inline_force void
+StoreF32x8(f32 *Dest, f32x8 A)
+{
+#if LANE_AVX
+	_mm256_storeu_ps(Dest, A.W);
+#elif LANE_SSE
+	_mm_storeu_ps(Dest, A.W[0]);
+	_mm_storeu_ps(Dest + 4, A.W[1]);
+#else
+	for(u32 Lane = 0;
+		Lane < LANE_WIDTH;
+		++Lane)
+	{
+		Dest[Lane] = A.E[Lane];
+	}
+#endif
+}
+
+inline_force void
+StoreU32x8(u32 *Dest, u32x8 A)
+{
+#if LANE_AVX
+	_mm256_storeu_si256((__m256i *)Dest, A.W);
+#elif LANE_SSE
+	_mm_storeu_si128((__m128i *)Dest, A.W[0]);
+	_mm_storeu_si128((__m128i *)(Dest + 4), A.W[1]);
+#else
+	for(u32 Lane = 0;
+		Lane < LANE_WIDTH;
+		++Lane)
+	{
+		Dest[Lane] = A.E[Lane];
+	}
+#endif
+}
+
+// NOTE: Result lane i is Base[Index lane i].
+inline_force f32x8
+GatherF32x8(f32 *Base, u32x8 Index)
+{
+	f32x8 Result;
+#if LANE_AVX
+	Result.W = _mm256_i32gather_ps(Base, Index.W, 4);
+#else
+	for(u32 Lane = 0;
+		Lane < LANE_WIDTH;
+		++Lane)
+	{
+		Result.E[Lane] = Base[Index.E[Lane]];
+	}
+#endif
+	return Result;
+}
+
+// NOTE: Truncates, like a cast; only for values that fit in an s32.
+inline_force u32x8
+U32x8FromF32x8(f32x8 A)
+{
+	u32x8 Result;
+#if LANE_AVX
+	Result.W = _mm256_cvttps_epi32(A.W);
+#elif LANE_SSE
+	Result.W[0] = _mm_cvttps_epi32(A.W[0]);
+	Result.W[1] = _mm_cvttps_epi32(A.W[1]);
+#else
+	for(u32 Lane = 0;
+		Lane < LANE_WIDTH;
+		++Lane)
+	{
+		Result.E[Lane] = (u32)(s32)A.E[Lane];
+	}
+#endif
+	return Result;
+}
+
+inline_force f32x8
+F32x8FromBits(u32x8 A)
+{
+	f32x8 Result;
+#if LANE_AVX
+	Result.W = _mm256_castsi256_ps(A.W);
+#elif LANE_SSE
+	Result.W[0] = _mm_castsi128_ps(A.W[0]);
+	Result.W[1] = _mm_castsi128_ps(A.W[1]);
+#else
+	for(u32 Lane = 0;
+		Lane < LANE_WIDTH;
+		++Lane)
+	{
+		union {u32 U; r32 F;} Bits;
+		Bits.U = A.E[Lane];
+		Result.E[Lane] = Bits.F;
+	}
+#endif
+	return Result;
+}
+
+inline_force v3x8
+V3x8(f32x8 x, f32x8 y, f32x8 z)
+{
+	v3x8 Result;
+	Result.x = x;
+	Result.y = y;
+	Result.z = z;
+	return Result;
+}
+
+inline_force v3x8
+V3x8(v3 A)
+{
+	v3x8 Result = V3x8(F32x8(A.x), F32x8(A.y), F32x8(A.z));
+	return Result;
+}
+
+inline_force v3
+GetLane(v3x8 A, u32 Lane)
+{
+	Assert(Lane < LANE_WIDTH);
+	v3 Result = V3(A.x.E[Lane], A.y.E[Lane], A.z.E[Lane]);
+	return Result;
+}
+
+inline_force void
+SetLane(v3x8 *A, u32 Lane, v3 Value)
+{
+	Assert(Lane < LANE_WIDTH);
+	A->x.E[Lane] = Value.x;
+	A->y.E[Lane] = Value.y;
+	A->z.E[Lane] = Value.z;
+}
+
+inline_force v3
+HorizontalAdd(v3x8 A)
+{
+	v3 Result = {};
+	for(u32 Lane = 0;
+		Lane < LANE_WIDTH;
+		++Lane)
+	{
+		Result += GetLane(A, Lane);
+	}
+	return Result;
+}
+
+inline_force v3x8
+operator+(v3x8 A, v3x8 B)
+{
+	v3x8 Result = V3x8(A.x + B.x, A.y + B.y, A.z + B.z);
+	return Result;
+}
+
+inline_force v3x8
+operator-(v3x8 A, v3x8 B)
+{
+	v3x8 Result = V3x8(A.x - B.x, A.y - B.y, A.z - B.z);
+	return Result;
+}
+
+inline_force v3x8
+operator-(v3x8 A)
+{
+	v3x8 Result = V3x8(-A.x, -A.y, -A.z);
+	return Result;
+}
+
+inline_force v3x8
+operator*(f32x8 Scalar, v3x8 A)
+{
+	v3x8 Result = V3x8(Scalar*A.x, Scalar*A.y, Scalar*A.z);
+	return Result;
+}
+
+inline_force v3x8
+operator*(r32 Scalar, v3x8 A)
+{
+	v3x8 Result = F32x8(Scalar)*A;
+	return Result;
+}
+
+inline_force v3x8 &
+operator+=(v3x8 &A, v3x8 B)
+{
+	A = A + B;
+	return A;
+}
+
+inline_force v3x8
+Hadamard(v3x8 A, v3x8 B)
+{
+	v3x8 Result = V3x8(A.x*B.x, A.y*B.y, A.z*B.z);
+	return Result;
+}
+
+inline_force f32x8
+Inner(v3x8 A, v3x8 B)
+{
+	f32x8 Result = A.x*B.x + A.y*B.y + A.z*B.z;
+	return Result;
+}
+
+inline_force f32x8
+LengthSq(v3x8 A)
+{
+	f32x8 Result = Inner(A, A);
+	return Result;
+}
+
+inline_force v3x8
+Cross(v3x8 U, v3x8 V)
+{
+	v3x8 Result = V3x8(U.y*V.z - U.z*V.y,
+	                   U.z*V.x - U.x*V.z,
+	                   U.x*V.y - U.y*V.x);
+	return Result;
+}
+
+inline_force v3x8
+Lerp(v3x8 A, f32x8 t, v3x8 B)
+{
+	v3x8 Result = A + t*(B - A);
+	return Result;
+}
+
+inline_force v3x8
+Select(mask8 Mask, v3x8 A, v3x8 B)
+{
+	v3x8 Result = V3x8(Select(Mask, A.x, B.x),
+	                   Select(Mask, A.y, B.y),
+	                   Select(Mask, A.z, B.z));
+	return Result;
+}
+
+inline_force v3x8
+NOZ(v3x8 A)
+{
+	f32x8 ALengthSq = LengthSq(A);
+	f32x8 InvLength = F32x8(1.0f)/SquareRoot(ALengthSq);
+	v3x8 Result = Select(ALengthSq > 0.0f, InvLength*A, V3x8(V3(0, 0, 0)));
+	return Result;
+}
+
+inline_force v3x8
+TransformPoint(mat4 A, v3x8 P)
+{
+	v3x8 Result = V3x8(A.M[0]*P.x + A.M[4]*P.y + A.M[8]*P.z + A.M[12],
+	                   A.M[1]*P.x + A.M[5]*P.y + A.M[9]*P.z + A.M[13],
+	                   A.M[2]*P.x + A.M[6]*P.y + A.M[10]*P.z + A.M[14]);
+	return Result;
+}
+
+inline_force v3x8
+TransformVector(mat4 A, v3x8 V)
+{
+	v3x8 Result = V3x8(A.M[0]*V.x + A.M[4]*V.y + A.M[8]*V.z,
+	                   A.M[1]*V.x + A.M[5]*V.y + A.M[9]*V.z,
+	                   A.M[2]*V.x + A.M[6]*V.y + A.M[10]*V.z);
+	return Result;
+}
+
+inline_force v3x8
+TransformNormal(mat4 InverseA, v3x8 N)
+{
+	v3x8 Result = V3x8(InverseA.M[0]*N.x + InverseA.M[1]*N.y + InverseA.M[2]*N.z,
+	                   InverseA.M[4]*N.x + InverseA.M[5]*N.y + InverseA.M[6]*N.z,
+	                   InverseA.M[8]*N.x + InverseA.M[9]*N.y + InverseA.M[10]*N.z);
+	return Result;
+}
@@ -0,0 +1,500 @@
+/*@H
+* File: ray_lights.cpp
+* Author: Jesse Calvert
+* Created: October 19, 2026, 14:19
+* Last modified: October 19, 2026, 17:37
+*/
+
+// NOTE: Direct lighting from many lights. Every diffuse hit sends a single
+// shadow ray, to one light picked in proportion to how much it's likely to
+// add there, so the cost per hit grows with the log of the light count
+// rather than the count itself.
+//
+// The lights sit in a bvh built the same way as the geometry's, and each
+// node also knows the total power of the lights under it. Picking walks
+// down from the root, choosing between the two children by their power
+// over the squared distance to them (see GetClusterImportance), and at a
+// leaf chooses between its lights the same way. The product of the choices
+// is the light's probability, which the sample is divided by. Spot cones
+// aren't kept in the nodes, so a cluster of spots pointing away still gets
+// picked now and then; those samples come back black.
+//
+// The sun has no position and stays out of the tree. When there are both,
+// each hit picks the sun or the tree with even odds.
+
+// NOTE: Lights are bounded by at least this much, so lights in a line
+// still give the surface area heuristic something to split.
+#define LIGHT_MIN_RADIUS 0.01f
+
+inline f32
+Luminance(v3 Color)
+{
+	f32 Result = 0.2126f*Color.r + 0.7152f*Color.g + 0.0722f*Color.b;
+	return Result;
+}
+
+internal void
+ReserveLights(memory_arena *Arena, world *World, u32 MaxLightCount)
+{
+	World->LightCount = 0;
+	World->MaxLightCount = MaxLightCount;
+	World->Lights = PushArray(Arena, MaxLightCount, light);
+}
+
+internal light *
+AddPointLight(world *World, v3 P, v3 Color, f32 Radius)
+{
+	Assert(World->LightCount < World->MaxLightCount);
+	light *Result = World->Lights + World->LightCount++;
+	*Result = {};
+	Result->Type = Light_Point;
+	Result->P = P;
+	Result->Color = Color;
+	Result->Radius = Radius;
+	Result->Power = 4.0f*Pi32*Luminance(Color);
+	return Result;
+}
+
+// NOTE: Angles are measured from Direction, in radians.
+internal light *
+AddSpotLight(world *World, v3 P, v3 Direction, v3 Color, f32 Radius, f32 InnerAngle, f32 OuterAngle)
+{
+	light *Result = AddPointLight(World, P, Color, Radius);
+	Result->Type = Light_Spot;
+	Result->Direction = NOZ(Direction);
+	Result->CosInner = Cos(InnerAngle);
+	Result->CosOuter = Cos(OuterAngle);
+
+	// NOTE: About what reaches the cone, counting the fade as half.
+	f32 CosMiddle = 0.5f*(Result->CosInner + Result->CosOuter);
+	Result->Power = 2.0f*Pi32*(1.0f - CosMiddle)*Luminance(Color);
+	return Result;
+}
+
+// NOTE: Measured from the light's center, not the point sampled on it, so a
+// light only ever lights what its importance says it can.
+inline f32
+GetLightFalloff(light *Light, v3 ToPoint)
+{
+	f32 Result = 1.0f;
+	if(Light->Type == Light_Spot)
+	{
+		f32 CosAngle = Inner(NOZ(ToPoint), Light->Direction);
+		f32 t = Clamp01((CosAngle - Light->CosOuter) / (Light->CosInner - Light->CosOuter));
+		Result = t*t*(3.0f - 2.0f*t);
+	}
+	return Result;
+}
+
+internal void
+BuildLightTree(memory_arena *Arena, world *World)
+{
+	if(World->LightCount)
+	{
+		rectangle3 *Bounds = PushArray(Arena, World->LightCount, rectangle3);
+		for(u32 LightIndex = 0;
+			LightIndex < World->LightCount;
+			++LightIndex)
+		{
+			light *Light = World->Lights + LightIndex;
+			f32 Radius = Maximum(Light->Radius, LIGHT_MIN_RADIUS);
+			v3 Extent = V3(Radius, Radius, Radius);
+			Bounds[LightIndex] = Rectangle3(Light->P - Extent, Light->P + Extent);
+		}
+
+		light_tree *Tree = &World->LightTree;
+		BuildBVH(Arena, &Tree->Hierarchy, World->LightCount, Bounds);
+
+		// NOTE: Children come after their parents, so going backwards sums
+		// every node's children before the node itself.
+		Tree->NodePower = PushArray(Arena, Tree->Hierarchy.NodeCount, f32);
+		for(u32 NodeIndex = Tree->Hierarchy.NodeCount;
+			NodeIndex > 0;
+			--NodeIndex)
+		{
+			bvh_node *Node = Tree->Hierarchy.Nodes + NodeIndex - 1;
+			f32 Power = 0.0f;
+			if(Node->Count)
+			{
+				for(u32 Index = Node->FirstIndex;
+					Index < Node->FirstIndex + Node->Count;
+					++Index)
+				{
+					Power += World->Lights[Tree->Hierarchy.Indices[Index]].Power;
+				}
+			}
+			else
+			{
+				Power = Tree->NodePower[Node->FirstIndex] + Tree->NodePower[Node->FirstIndex + 1];
+			}
+			Tree->NodePower[NodeIndex - 1] = Power;
+		}
+	}
+}
+
+// NOTE: The odds of sampling the sun rather than the light tree.
+inline f32
+GetSunProbability(world *World)
+{
+	f32 Result = 1.0f;
+	if(World->LightCount)
+	{
+		Result = (LengthSq(World->LightColor) > 0.0f) ? 0.5f : 0.0f;
+	}
+	return Result;
+}
+
+// NOTE: A guess at how much a cluster of lights could add at P: its power
+// over the squared distance to its center. The distance is held to at
+// least half the diagonal, so a point inside or beside the box isn't
+// swamped by it, and a box entirely behind the surface gets nothing.
+internal f32
+GetClusterImportance(rectangle3 Bounds, f32 Power, v3 P, v3 N)
+{
+	f32 Result = 0.0f;
+	b32 InFront = false;
+	for(u32 Corner = 0;
+		Corner < 8;
+		++Corner)
+	{
+		v3 CornerP = V3((Corner & 1) ? Bounds.Max.x : Bounds.Min.x,
+		                (Corner & 2) ? Bounds.Max.y : Bounds.Min.y,
+		                (Corner & 4) ? Bounds.Max.z : Bounds.Min.z);
+		if(Inner(CornerP - P, N) > 0.0f)
+		{
+			InFront = true;
+			break;
+		}
+	}
+
+	if(InFront)
+	{
+		f32 DistanceSq = LengthSq(Center(Bounds) - P);
+		f32 MinDistanceSq = 0.25f*LengthSq(Dim(Bounds));
+		Result = Power / Maximum(DistanceSq, MinDistanceSq);
+	}
+	return Result;
+}
+
+internal f32
+GetLightImportance(light *Light, v3 P, v3 N)
+{
+	f32 Result = 0.0f;
+	v3 ToLight = Light->P - P;
+	if(Inner(ToLight, N) > -Light->Radius)
+	{
+		f32 DistanceSq = Maximum(LengthSq(ToLight), Square(Maximum(Light->Radius, LIGHT_MIN_RADIUS)));
+		Result = Light->Power*GetLightFalloff(Light, -ToLight) / DistanceSq;
+	}
+	return Result;
+}
+
+// NOTE: Takes Select's place in [0, 1) below Probability, or above it, and
+// stretches it back out to [0, 1), so one number serves every choice on the
+// way down.
+inline f32
+RescaleSelect(f32 Select, f32 Probability, b32 Below)
+{
+	f32 Result = Below ? (Select / Probability) : ((Select - Probability) / (1.0f - Probability));
+	Result = Minimum(Result, 0.99999994f);
+	return Result;
+}
+
+struct light_sample
+{
+	v3 Direction;
+	f32 Distance;
+
+	// NOTE: Already divided by the odds of picking the light.
+	v3 Radiance;
+};
+
+// NOTE: Picks a light for the point P, with N the side of the surface the
+// light has to be on. Select is uniform in [0, 1); Jitter is a unit vector
+// that picks the point on the bulb. Returns false if no light can reach P.
+internal b32
+SampleLightTree(world *World, v3 P, v3 N, f32 Select, v3 Jitter, light_sample *Sample)
+{
+	light_tree *Tree = &World->LightTree;
+	bvh *Hierarchy = &Tree->Hierarchy;
+	f32 Probability = 1.0f;
+
+	bvh_node *Node = Hierarchy->Nodes;
+	if(GetClusterImportance(Node->Bounds, Tree->NodePower[0], P, N) <= 0.0f)
+	{
+		return false;
+	}
+
+	while(!Node->Count)
+	{
+		u32 LeftIndex = Node->FirstIndex;
+		bvh_node *Left = Hierarchy->Nodes + LeftIndex;
+		bvh_node *Right = Left + 1;
+		f32 LeftImportance = GetClusterImportance(Left->Bounds, Tree->NodePower[LeftIndex], P, N);
+		f32 RightImportance = GetClusterImportance(Right->Bounds, Tree->NodePower[LeftIndex + 1], P, N);
+		f32 TotalImportance = LeftImportance + RightImportance;
+		if(TotalImportance <= 0.0f)
+		{
+			return false;
+		}
+
+		f32 LeftProbability = LeftImportance / TotalImportance;
+		b32 GoLeft = (Select < LeftProbability);
+		Select = RescaleSelect(Select, LeftProbability, GoLeft);
+		Probability *= GoLeft ? LeftProbability : (1.0f - LeftProbability);
+		Node = GoLeft ? Left : Right;
+	}
+
+	f32 TotalImportance = 0.0f;
+	for(u32 Index = Node->FirstIndex;
+		Index < Node->FirstIndex + Node->Count;
+		++Index)
+	{
+		TotalImportance += GetLightImportance(World->Lights + Hierarchy->Indices[Index], P, N);
+	}
+	if(TotalImportance <= 0.0f)
+	{
+		return false;
+	}
+
+	light *Light = 0;
+	f32 LightImportance = 0.0f;
+	f32 Target = Select*TotalImportance;
+	for(u32 Index = Node->FirstIndex;
+		Index < Node->FirstIndex + Node->Count;
+		++Index)
+	{
+		light *Candidate = World->Lights + Hierarchy->Indices[Index];
+		f32 Importance = GetLightImportance(Candidate, P, N);
+		if(Importance > 0.0f)
+		{
+			Light = Candidate;
+			LightImportance = Importance;
+			if(Target < Importance)
+			{
+				break;
+			}
+			Target -= Importance;
+		}
+	}
+	Assert(Light);
+	Probability *= LightImportance / TotalImportance;
+
+	v3 ToLight = Light->P + Light->Radius*Jitter - P;
+	f32 DistanceSq = LengthSq(ToLight);
+	f32 Distance = SquareRoot(DistanceSq);
+	v3 Direction = (1.0f/Distance)*ToLight;
+	f32 CosSurface = Inner(Direction, N);
+	if(!(CosSurface > 0.0f))
+	{
+		return false;
+	}
+
+	Sample->Direction = Direction;
+	Sample->Distance = Distance;
+	Sample->Radiance = (CosSurface*GetLightFalloff(Light, P - Light->P) / (DistanceSq*Probability))*Light->Color;
+	return true;
+}
+
+//
+// NOTE: Emissive spheres
+//
+
+// NOTE: A bounce only finds an emitter by chance, and rarely if it's small.
+// So rough hits also aim a ray straight at one, picked uniformly, by
+// sampling the cone of directions its sphere covers. The two strategies are
+// combined with the balance heuristic: whichever found the emitter, its
+// share is its probability for that direction over the sum of both. That
+// needs the bounce's probability for any direction, which
+// GetBounceProbability works out. Near-mirrors only ever reflect one way,
+// and just bounce.
+//
+// The extra ray only pays for emitters much brighter than anything else the
+// bounce finds, which turn into fireflies when it does, so ones dimmer than
+// MIS_MIN_EMITTER_RADIANCE are left to the bounce altogether. Bright ones
+// are only aimed at from where they look small: from where one fills more
+// of the sky than MIS_MAX_EMITTER_SIN_SQ (the squared sine of its cone's
+// half angle), the bounce finds it often enough on its own, and keeps all
+// of the share when it does. The glowing sphere in the spheres scene and
+// swarm's sun are both well under MIS_MIN_EMITTER_RADIANCE, and are left to
+// the bounce on purpose: aiming at them nearly doubled the render time for
+// almost no less noise. The beacon scene has an emitter that is aimed at,
+// and -regress renders it at both lane widths.
+//
+// What an emitter adds is whatever a bounce into it would have: EmitColor,
+// scaled by the emitter's ReflectionColor and the cosine at the hit, since
+// those are folded into the attenuation first. Sampled hits are scaled the
+// same way, so both strategies converge to the image the bounce alone did.
+
+#define MIS_MAX_SPECULARITY 0.95f
+#define MIS_MIN_EMITTER_RADIANCE 4.0f
+#define MIS_MAX_EMITTER_SIN_SQ 0.01f
+
+internal void
+FindEmitters(world *World)
+{
+	World->EmitterCount = 0;
+	for(u32 ObjectIndex = 0;
+		ObjectIndex < World->ObjectCount;
+		++ObjectIndex)
+	{
+		object *Object = World->Objects + ObjectIndex;
+		v3 Radiance = Hadamard(Object->Material.ReflectionColor, Object->Material.EmitColor);
+		if((Object->Type == Object_Sphere) &&
+		   !Object->Material.Transparent &&
+		   (Maximum(Radiance.r, Maximum(Radiance.g, Radiance.b)) > MIS_MIN_EMITTER_RADIANCE))
+		{
+			World->Emitters[World->EmitterCount++] = Object;
+		}
+	}
+}
+
+inline object *
+FindEmitter(world *World, material *Material)
+{
+	object *Result = 0;
+	for(u32 EmitterIndex = 0;
+		EmitterIndex < World->EmitterCount;
+		++EmitterIndex)
+	{
+		if(&World->Emitters[EmitterIndex]->Material == Material)
+		{
+			Result = World->Emitters[EmitterIndex];
+			break;
+		}
+	}
+	return Result;
+}
+
+// NOTE: The probability per steradian of the bounce off a surface with
+// Normal going in Direction, where Mirror is the pure reflection. The bounce
+// normalizes a point drawn uniformly from the [-1, 1] cube, flipped above
+// the surface, which comes out as 1/(12 m^3) with m the direction's largest
+// component, and then pulls it towards Mirror by Specularity. Pulled points
+// lie on a sphere of radius 1 - Specularity around Specularity*Mirror, so
+// Direction meets it at up to two distances Lambda, one behind the other
+// once Specularity is over a half. Each is an unpulled direction the bounce
+// could have started from, and projecting the sphere onto the unit sphere
+// scales solid angle there by Lambda^2/((1 - Specularity)^2 |cos|), with cos
+// the angle between the two directions.
+internal f32
+GetBounceProbability(v3 Direction, v3 Normal, v3 Mirror, f32 Specularity)
+{
+	Assert(Specularity < MIS_MAX_SPECULARITY);
+
+	f32 Result = 0.0f;
+	f32 Scale = 1.0f - Specularity;
+	f32 CosMirror = Inner(Direction, Mirror);
+	f32 Discriminant = Square(Specularity*CosMirror) - Square(Specularity) + Square(Scale);
+	if(Discriminant >= 0.0f)
+	{
+		f32 RootDiscriminant = SquareRoot(Discriminant);
+		f32 Lambdas[2] = {Specularity*CosMirror + RootDiscriminant, Specularity*CosMirror - RootDiscriminant};
+		for(u32 Root = 0;
+			Root < ArrayCount(Lambdas);
+			++Root)
+		{
+			f32 Lambda = Lambdas[Root];
+			if(Lambda > 0.0f)
+			{
+				v3 Unpulled = (1.0f/Scale)*(Lambda*Direction - Specularity*Mirror);
+				f32 Cos = AbsoluteValue(Inner(Unpulled, Direction));
+				if((Inner(Unpulled, Normal) > 0.0f) && (Cos > 0.0f))
+				{
+					f32 MaxComponent = Maximum(AbsoluteValue(Unpulled.x), Maximum(AbsoluteValue(Unpulled.y), AbsoluteValue(Unpulled.z)));
+					f32 CubeProbability = 1.0f / (12.0f*MaxComponent*MaxComponent*MaxComponent);
+					Result += CubeProbability*Square(Lambda) / (Square(Scale)*Cos);
+				}
+			}
+		}
+	}
+	return Result;
+}
+
+// NOTE: The probability per steradian of aiming at Emitter from P, which is
+// the same for every direction in its cone. Nothing aims at an emitter from
+// inside or on it, or from close enough that it looks big.
+internal f32
+GetEmitterProbability(world *World, object *Emitter, v3 P)
+{
+	f32 Result = 0.0f;
+	sphere *Sphere = &Emitter->Sphere;
+	f32 DistanceSq = LengthSq(Sphere->Center - P);
+	f32 RadiusSq = Square(Sphere->Radius);
+	if(RadiusSq < MIS_MAX_EMITTER_SIN_SQ*DistanceSq)
+	{
+		// NOTE: 1 - cos written so it keeps its precision for far emitters.
+		f32 SinSq = RadiusSq / DistanceSq;
+		f32 CosMax = SquareRoot(1.0f - SinSq);
+		f32 SolidAngle = 2.0f*Pi32*SinSq / (1.0f + CosMax);
+		Result = 1.0f / (World->EmitterCount*SolidAngle);
+	}
+	return Result;
+}
+
+// NOTE: A direction uniform over the cone within acos(CosMax) of Axis, from
+// U and V uniform in [0, 1).
+internal v3
+SampleCone(v3 Axis, f32 CosMax, f32 U, f32 V)
+{
+	v3 Z = Axis;
+	v3 Up = (AbsoluteValue(Z.x) < 0.9f) ? V3(1.0f, 0.0f, 0.0f) : V3(0.0f, 1.0f, 0.0f);
+	v3 X = NOZ(Cross(Up, Z));
+	v3 Y = Cross(Z, X);
+
+	f32 CosTheta = 1.0f - U*(1.0f - CosMax);
+	f32 SinTheta = SquareRoot(Maximum(0.0f, 1.0f - Square(CosTheta)));
+	f32 Phi = 2.0f*Pi32*V;
+
+	v3 Result = NOZ(SinTheta*Cos(Phi)*X + SinTheta*Sin(Phi)*Y + CosTheta*Z);
+	return Result;
+}
+
+struct emitter_sample
+{
+	object *Emitter;
+	v3 Direction;
+	f32 Probability;
+};
+
+// NOTE: Select, U and V are uniform in [0, 1). Returns false if P is inside
+// the emitter it picked.
+internal b32
+SampleEmitter(world *World, v3 P, f32 Select, f32 U, f32 V, emitter_sample *Sample)
+{
+	u32 EmitterIndex = Minimum((u32)(Select*World->EmitterCount), World->EmitterCount - 1);
+	object *Emitter = World->Emitters[EmitterIndex];
+	f32 Probability = GetEmitterProbability(World, Emitter, P);
+	if(Probability <= 0.0f)
+	{
+		return false;
+	}
+
+	v3 ToCenter = Emitter->Sphere.Center - P;
+	f32 SinSq = Square(Emitter->Sphere.Radius) / LengthSq(ToCenter);
+	f32 CosMax = SquareRoot(1.0f - SinSq);
+
+	Sample->Emitter = Emitter;
+	Sample->Direction = SampleCone(NOZ(ToCenter), CosMax, U, V);
+	Sample->Probability = Probability;
+	return true;
+}
+
+// NOTE: What a ray in Direction that hit Emitter with HitNormal brings back.
+inline v3
+GetEmitterRadiance(object *Emitter, v3 Direction, v3 HitNormal)
+{
+	f32 Cos = AbsoluteValue(Inner(Direction, HitNormal));
+	v3 Result = Cos*Hadamard(Emitter->Material.ReflectionColor, Emitter->Material.EmitColor);
+	return Result;
+}
+
+// NOTE: The balance heuristic's share for the strategy with probability
+// Probability, against one with Other.
+inline f32
+GetBalanceWeight(f32 Probability, f32 Other)
+{
+	f32 Sum = Probability + Other;
+	f32 Result = (Sum > 0.0f) ? (Probability / Sum) : 0.0f;
+	return Result;
+}
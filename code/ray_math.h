@@ -2,7 +2,7 @@
 * File: ray_math.h
 * Author: Jesse Calvert
 * Created: October 22, 2017, 17:26
-* Last modified: October 24, 2017, 16:47
+* Last modified: October 19, 2026, 12:49
 */
 
 #pragma once
@@ -92,6 +92,25 @@ union v3u
 	};
 };
 
+// NOTE: A v3 padded out to 16 bytes so it can live in a SIMD register.
+// The fourth lane is kept at zero. With RAY_SIMD_MATH off this is just an
+// aligned scalar v3, so code written against it builds either way.
+union alignas(16) v3a
+{
+	r32 E[4];
+	struct
+	{
+		r32 x, y, z, Ignored_0;
+	};
+	struct
+	{
+		r32 r, g, b, Ignored_1;
+	};
+#if RAY_SIMD_MATH
+	__m128 W;
+#endif
+};
+
 union v4
 {
 	r32 E[4];
@@ -123,6 +142,9 @@ union v4
 		v3 rgb;
 		r32 Ignored_2;
 	};
+#if RAY_SIMD_MATH
+	__m128 W;
+#endif
 };
 
 struct rectangle2
@@ -182,6 +204,9 @@ union quaternion
 		r32 Ignored_3;
 		v3 xyz;
 	};
+#if RAY_SIMD_MATH
+	__m128 W;
+#endif
 };
 
 struct sphere
@@ -785,6 +810,249 @@ DistanceToSegment(v3 TestPoint, v3 Head, v3 Tail)
 	return Result;
 }
 
+//
+// NOTE: v3a operations
+//
+
+#if RAY_SIMD_MATH
+inline __m128
+HorizontalAdd4(__m128 A)
+{
+	// NOTE: Returns the sum of all four lanes in every lane.
+	__m128 Swapped = _mm_shuffle_ps(A, A, _MM_SHUFFLE(2, 3, 0, 1));
+	__m128 Sums = _mm_add_ps(A, Swapped);
+	Swapped = _mm_shuffle_ps(Sums, Sums, _MM_SHUFFLE(1, 0, 3, 2));
+	__m128 Result = _mm_add_ps(Sums, Swapped);
+	return Result;
+}
+#endif
+
+inline v3a
+V3a(r32 x, r32 y, r32 z)
+{
+	v3a Result;
+#if RAY_SIMD_MATH
+	Result.W = _mm_setr_ps(x, y, z, 0.0f);
+#else
+	Result.x = x;
+	Result.y = y;
+	Result.z = z;
+	Result.Ignored_0 = 0.0f;
+#endif
+	return Result;
+}
+
+inline v3a
+V3a(v3 V)
+{
+	v3a Result = V3a(V.x, V.y, V.z);
+	return Result;
+}
+
+inline v3
+V3(v3a V)
+{
+	v3 Result = V3(V.x, V.y, V.z);
+	return Result;
+}
+
+inline v3a
+operator+(v3a A, v3a B)
+{
+#if RAY_SIMD_MATH
+	v3a Result;
+	Result.W = _mm_add_ps(A.W, B.W);
+#else
+	v3a Result = V3a(A.x + B.x, A.y + B.y, A.z + B.z);
+#endif
+	return Result;
+}
+
+inline v3a
+operator*(r32 Scalar, v3a Vector)
+{
+#if RAY_SIMD_MATH
+	v3a Result;
+	Result.W = _mm_mul_ps(_mm_set1_ps(Scalar), Vector.W);
+#else
+	v3a Result = V3a(Scalar*Vector.x, Scalar*Vector.y, Scalar*Vector.z);
+#endif
+	return Result;
+}
+
+inline v3a
+operator*(v3a Vector, r32 Scalar)
+{
+	v3a Result = Scalar*Vector;
+	return Result;
+}
+
+inline v3a
+operator-(v3a A, v3a B)
+{
+#if RAY_SIMD_MATH
+	v3a Result;
+	Result.W = _mm_sub_ps(A.W, B.W);
+#else
+	v3a Result = V3a(A.x - B.x, A.y - B.y, A.z - B.z);
+#endif
+	return Result;
+}
+
+inline v3a
+operator-(v3a A)
+{
+#if RAY_SIMD_MATH
+	v3a Result;
+	Result.W = _mm_sub_ps(_mm_setzero_ps(), A.W);
+#else
+	v3a Result = V3a(-A.x, -A.y, -A.z);
+#endif
+	return Result;
+}
+
+inline v3a &
+operator+=(v3a &A, v3a B)
+{
+	A = A + B;
+	return A;
+}
+
+inline b32
+operator==(v3a A, v3a B)
+{
+	b32 Result = ((A.x == B.x) &&
+	              (A.y == B.y) &&
+	              (A.z == B.z));
+	return Result;
+}
+
+inline b32
+operator!=(v3a A, v3a B)
+{
+	b32 Result = !(A == B);
+	return Result;
+}
+
+#if RAY_SIMD_MATH
+inline __m128
+InnerWide(__m128 A, __m128 B)
+{
+	// NOTE: x*x + y*y + z*z in every lane. Relies on the w lanes being zero.
+	__m128 Result = HorizontalAdd4(_mm_mul_ps(A, B));
+	return Result;
+}
+#endif
+
+inline r32
+Inner(v3a A, v3a B)
+{
+#if RAY_SIMD_MATH
+	r32 Result = _mm_cvtss_f32(InnerWide(A.W, B.W));
+#else
+	r32 Result = A.x*B.x + A.y*B.y + A.z*B.z;
+#endif
+	return Result;
+}
+
+inline v3a
+Hadamard(v3a A, v3a B)
+{
+#if RAY_SIMD_MATH
+	v3a Result;
+	Result.W = _mm_mul_ps(A.W, B.W);
+#else
+	v3a Result = V3a(A.x*B.x, A.y*B.y, A.z*B.z);
+#endif
+	return Result;
+}
+
+inline v3a
+Lerp(v3a A, r32 t, v3a B)
+{
+	v3a Result = A + t*(B - A);
+	return Result;
+}
+
+inline r32
+LengthSq(v3a A)
+{
+	r32 Result = Inner(A, A);
+	return Result;
+}
+
+inline r32
+Length(v3a A)
+{
+	r32 Result = SquareRoot(LengthSq(A));
+	return Result;
+}
+
+inline r32
+Distance(v3a A, v3a B)
+{
+	r32 Result = Length(B - A);
+	return Result;
+}
+
+inline v3a
+NOZ(v3a A)
+{
+#if RAY_SIMD_MATH
+	__m128 LengthSquared = InnerWide(A.W, A.W);
+#if RAY_FAST_RSQRT
+	__m128 InvLength = _mm_rsqrt_ps(LengthSquared);
+	InvLength = _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f), InvLength),
+	                       _mm_sub_ps(_mm_set1_ps(3.0f), _mm_mul_ps(_mm_mul_ps(LengthSquared, InvLength), InvLength)));
+#else
+	__m128 InvLength = _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(LengthSquared));
+#endif
+	__m128 NonZero = _mm_cmpgt_ps(LengthSquared, _mm_setzero_ps());
+	v3a Result;
+	Result.W = _mm_and_ps(_mm_mul_ps(A.W, InvLength), NonZero);
+#else
+	r32 ALengthSq = LengthSq(A);
+	v3a Result = {};
+	if(ALengthSq != 0.0f)
+	{
+		Result = InverseSquareRoot(ALengthSq)*A;
+	}
+#endif
+	return Result;
+}
+
+inline v3a
+Normalize(v3a A)
+{
+	Assert(LengthSq(A) != 0.0f);
+	v3a Result = NOZ(A);
+	return Result;
+}
+
+inline v3a
+Cross(v3a U, v3a V)
+{
+#if RAY_SIMD_MATH
+	__m128 UYZX = _mm_shuffle_ps(U.W, U.W, _MM_SHUFFLE(3, 0, 2, 1));
+	__m128 VYZX = _mm_shuffle_ps(V.W, V.W, _MM_SHUFFLE(3, 0, 2, 1));
+	__m128 ZXY = _mm_sub_ps(_mm_mul_ps(U.W, VYZX), _mm_mul_ps(UYZX, V.W));
+	v3a Result;
+	Result.W = _mm_shuffle_ps(ZXY, ZXY, _MM_SHUFFLE(3, 0, 2, 1));
+#else
+	v3a Result = V3a(U.y*V.z - U.z*V.y,
+	                 U.z*V.x - U.x*V.z,
+	                 U.x*V.y - U.y*V.x);
+#endif
+	return Result;
+}
+
+inline b32
+SameDirection(v3a A, v3a B)
+{
+	b32 Result = (Inner(A, B) > 0.0f);
+	return Result;
+}
+
 //
 // NOTE: v4 operations
 //
@@ -823,7 +1091,12 @@ operator==(v4 A, v4 B)
 inline v4
 operator+(v4 A, v4 B)
 {
+#if RAY_SIMD_MATH
+	v4 Result;
+	Result.W = _mm_add_ps(A.W, B.W);
+#else
 	v4 Result = {A.x + B.x, A.y + B.y, A.z + B.z, A.w + B.w};
+#endif
 	return Result;
 }
 
@@ -837,7 +1110,12 @@ operator+=(v4 &A, v4 B)
 inline v4
 operator*(r32 Scalar, v4 Vector)
 {
+#if RAY_SIMD_MATH
+	v4 Result;
+	Result.W = _mm_mul_ps(_mm_set1_ps(Scalar), Vector.W);
+#else
 	v4 Result = {Scalar*Vector.x, Scalar*Vector.y, Scalar*Vector.z, Scalar*Vector.w};
+#endif
 	return Result;
 }
 
@@ -851,38 +1129,62 @@ operator*(v4 Vector, r32 Scalar)
 inline v4
 operator-(v4 A, v4 B)
 {
+#if RAY_SIMD_MATH
+	v4 Result;
+	Result.W = _mm_sub_ps(A.W, B.W);
+#else
 	v4 Result = A + (-1.0f)*B;
+#endif
 	return Result;
 }
 
 inline v4
 operator-(v4 A)
 {
+#if RAY_SIMD_MATH
+	v4 Result;
+	Result.W = _mm_sub_ps(_mm_setzero_ps(), A.W);
+#else
 	v4 Result = V4(-A.x, -A.y, -A.z, -A.w);
+#endif
 	return Result;
 }
 
 inline r32
 Inner(v4 A, v4 B)
 {
+#if RAY_SIMD_MATH
+	r32 Result = _mm_cvtss_f32(HorizontalAdd4(_mm_mul_ps(A.W, B.W)));
+#else
 	r32 Result = A.x*B.x + A.y*B.y + A.z*B.z + A.w*B.w;
+#endif
 	return Result;
 }
 
 inline v4
 Hadamard(v4 A, v4 B)
 {
+#if RAY_SIMD_MATH
+	v4 Result;
+	Result.W = _mm_mul_ps(A.W, B.W);
+#else
 	v4 Result = {A.x*B.x, A.y*B.y, A.z*B.z, A.w*B.w};
+#endif
 	return Result;
 }
 
 inline v4
 Lerp(v4 A, r32 t, v4 B)
 {
+#if RAY_SIMD_MATH
+	v4 Result;
+	Result.W = _mm_add_ps(A.W, _mm_mul_ps(_mm_set1_ps(t), _mm_sub_ps(B.W, A.W)));
+#else
 	v4 Result = V4(Lerp(A.x, t, B.x),
 	               Lerp(A.y, t, B.y),
 	               Lerp(A.z, t, B.z),
 	               Lerp(A.w, t, B.w));
+#endif
 	return Result;
 }
 
@@ -1015,6 +1317,15 @@ Rectangle3(v3 Min, v3 Max)
 	return Result;
 }
 
+inline rectangle3
+InvertedInfinityRectangle3()
+{
+	// NOTE: Combining anything with this yields the other rectangle.
+	rectangle3 Result = {V3(Real32Maximum, Real32Maximum, Real32Maximum),
+	                     V3(Real32Minimum, Real32Minimum, Real32Minimum)};
+	return Result;
+}
+
 inline rectangle3
 Rectangle3CenterDim(v3 Center, v3 Dim)
 {
@@ -1050,7 +1361,7 @@ Dim(rectangle3 Rect)
 inline v3
 Center(rectangle3 Rect)
 {
-	v3 Result = 0.5f*(Rect.Max - Rect.Min);
+	v3 Result = 0.5f*(Rect.Min + Rect.Max);
 	return Result;
 }
 
@@ -1350,10 +1661,37 @@ Row(mat4 A, u32 RowIndex)
 	return Result;
 }
 
+inline v4
+operator*(mat4 A, v4 V)
+{
+#if RAY_SIMD_MATH
+	// NOTE: Columns are contiguous, so this is a sum of scaled columns
+	// rather than four row dot products.
+	__m128 Sum = _mm_mul_ps(A.C[0].W, _mm_shuffle_ps(V.W, V.W, _MM_SHUFFLE(0, 0, 0, 0)));
+	Sum = _mm_add_ps(Sum, _mm_mul_ps(A.C[1].W, _mm_shuffle_ps(V.W, V.W, _MM_SHUFFLE(1, 1, 1, 1))));
+	Sum = _mm_add_ps(Sum, _mm_mul_ps(A.C[2].W, _mm_shuffle_ps(V.W, V.W, _MM_SHUFFLE(2, 2, 2, 2))));
+	Sum = _mm_add_ps(Sum, _mm_mul_ps(A.C[3].W, _mm_shuffle_ps(V.W, V.W, _MM_SHUFFLE(3, 3, 3, 3))));
+	v4 Result;
+	Result.W = Sum;
+#else
+	v4 Result = V4(Inner(Row(A, 0), V),
+	               Inner(Row(A, 1), V),
+	               Inner(Row(A, 2), V),
+	               Inner(Row(A, 3), V));
+#endif
+	return Result;
+}
+
 inline mat4
 operator*(mat4 A, mat4 B)
 {
 	mat4 Result = {};
+#if RAY_SIMD_MATH
+	Result.C[0] = A*B.C[0];
+	Result.C[1] = A*B.C[1];
+	Result.C[2] = A*B.C[2];
+	Result.C[3] = A*B.C[3];
+#else
 	for(u32 Y = 0;
 	    Y < 4;
 	    ++Y)
@@ -1366,20 +1704,11 @@ operator*(mat4 A, mat4 B)
 			Result.M[Index] = Inner(B.C[X], Row(A, Y));
 		}
 	}
+#endif
 
 	return Result;
 }
 
-inline v4
-operator*(mat4 A, v4 V)
-{
-	v4 Result = V4(Inner(Row(A, 0), V),
-	               Inner(Row(A, 1), V),
-	               Inner(Row(A, 2), V),
-	               Inner(Row(A, 3), V));
-	return Result;
-}
-
 inline mat4
 RotationMat4(r32 Roll)
 {
@@ -1514,6 +1843,159 @@ TransformationMat4(v2 P, mat2 Rotation, v2 Scale, v2 Offset)
 	return Result;
 }
 
+inline mat4
+Transpose(mat4 A)
+{
+#if RAY_SIMD_MATH
+	mat4 Result = A;
+	_MM_TRANSPOSE4_PS(Result.C[0].W, Result.C[1].W, Result.C[2].W, Result.C[3].W);
+#else
+	mat4 Result =
+	{
+		A.M[0], A.M[4], A.M[8], A.M[12],
+		A.M[1], A.M[5], A.M[9], A.M[13],
+		A.M[2], A.M[6], A.M[10], A.M[14],
+		A.M[3], A.M[7], A.M[11], A.M[15],
+	};
+#endif
+	return Result;
+}
+
+inline mat4
+AffineInverse(mat4 A)
+{
+	// NOTE: Assumes the bottom row is (0, 0, 0, 1).
+	r32 a00 = A.M[0], a10 = A.M[1], a20 = A.M[2];
+	r32 a01 = A.M[4], a11 = A.M[5], a21 = A.M[6];
+	r32 a02 = A.M[8], a12 = A.M[9], a22 = A.M[10];
+
+	r32 c00 = a11*a22 - a12*a21;
+	r32 c01 = a12*a20 - a10*a22;
+	r32 c02 = a10*a21 - a11*a20;
+	r32 Determinant = a00*c00 + a01*c01 + a02*c02;
+	Assert(Determinant != 0.0f);
+	r32 InvDeterminant = 1.0f/Determinant;
+
+	mat4 Result =
+	{
+		InvDeterminant*c00,
+		InvDeterminant*c01,
+		InvDeterminant*c02,
+		0,
+
+		InvDeterminant*(a02*a21 - a01*a22),
+		InvDeterminant*(a00*a22 - a02*a20),
+		InvDeterminant*(a01*a20 - a00*a21),
+		0,
+
+		InvDeterminant*(a01*a12 - a02*a11),
+		InvDeterminant*(a02*a10 - a00*a12),
+		InvDeterminant*(a00*a11 - a01*a10),
+		0,
+
+		0, 0, 0, 1,
+	};
+
+	v4 Translation = Result*V4(-A.M[12], -A.M[13], -A.M[14], 1.0f);
+	Result.M[12] = Translation.x;
+	Result.M[13] = Translation.y;
+	Result.M[14] = Translation.z;
+	return Result;
+}
+
+inline v3
+TransformPoint(mat4 A, v3 P)
+{
+	v3 Result = V3(A.M[0]*P.x + A.M[4]*P.y + A.M[8]*P.z + A.M[12],
+	               A.M[1]*P.x + A.M[5]*P.y + A.M[9]*P.z + A.M[13],
+	               A.M[2]*P.x + A.M[6]*P.y + A.M[10]*P.z + A.M[14]);
+	return Result;
+}
+
+inline v3
+TransformVector(mat4 A, v3 V)
+{
+	v3 Result = V3(A.M[0]*V.x + A.M[4]*V.y + A.M[8]*V.z,
+	               A.M[1]*V.x + A.M[5]*V.y + A.M[9]*V.z,
+	               A.M[2]*V.x + A.M[6]*V.y + A.M[10]*V.z);
+	return Result;
+}
+
+inline v3
+TransformNormal(mat4 InverseA, v3 N)
+{
+	// NOTE: Normals transform by the inverse transpose, so this takes the
+	// inverse of the matrix that was applied to the surface.
+	v3 Result = V3(InverseA.M[0]*N.x + InverseA.M[1]*N.y + InverseA.M[2]*N.z,
+	               InverseA.M[4]*N.x + InverseA.M[5]*N.y + InverseA.M[6]*N.z,
+	               InverseA.M[8]*N.x + InverseA.M[9]*N.y + InverseA.M[10]*N.z);
+	return Result;
+}
+
+inline v3a
+TransformPoint(mat4 A, v3a P)
+{
+#if RAY_SIMD_MATH
+	__m128 Sum = _mm_add_ps(A.C[3].W, _mm_mul_ps(A.C[0].W, _mm_shuffle_ps(P.W, P.W, _MM_SHUFFLE(0, 0, 0, 0))));
+	Sum = _mm_add_ps(Sum, _mm_mul_ps(A.C[1].W, _mm_shuffle_ps(P.W, P.W, _MM_SHUFFLE(1, 1, 1, 1))));
+	Sum = _mm_add_ps(Sum, _mm_mul_ps(A.C[2].W, _mm_shuffle_ps(P.W, P.W, _MM_SHUFFLE(2, 2, 2, 2))));
+
+	// NOTE: Affine matrices have w = 1 in the last column; clear it.
+	v3a Result;
+	Result.W = _mm_and_ps(Sum, _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0)));
+#else
+	v3a Result = V3a(TransformPoint(A, V3(P)));
+#endif
+	return Result;
+}
+
+inline v3a
+TransformVector(mat4 A, v3a V)
+{
+#if RAY_SIMD_MATH
+	__m128 Sum = _mm_mul_ps(A.C[0].W, _mm_shuffle_ps(V.W, V.W, _MM_SHUFFLE(0, 0, 0, 0)));
+	Sum = _mm_add_ps(Sum, _mm_mul_ps(A.C[1].W, _mm_shuffle_ps(V.W, V.W, _MM_SHUFFLE(1, 1, 1, 1))));
+	Sum = _mm_add_ps(Sum, _mm_mul_ps(A.C[2].W, _mm_shuffle_ps(V.W, V.W, _MM_SHUFFLE(2, 2, 2, 2))));
+	v3a Result;
+	Result.W = Sum;
+#else
+	v3a Result = V3a(TransformVector(A, V3(V)));
+#endif
+	return Result;
+}
+
+inline v3a
+TransformNormal(mat4 InverseA, v3a N)
+{
+#if RAY_SIMD_MATH
+	__m128 X = InnerWide(InverseA.C[0].W, N.W);
+	__m128 Y = InnerWide(InverseA.C[1].W, N.W);
+	__m128 Z = InnerWide(InverseA.C[2].W, N.W);
+	v3a Result;
+	Result.W = _mm_movelh_ps(_mm_unpacklo_ps(X, Y), _mm_and_ps(Z, _mm_castsi128_ps(_mm_setr_epi32(-1, 0, 0, 0))));
+#else
+	v3a Result = V3a(TransformNormal(InverseA, V3(N)));
+#endif
+	return Result;
+}
+
+inline rectangle3
+TransformBounds(mat4 A, rectangle3 Rect)
+{
+	rectangle3 Result = InvertedInfinityRectangle3();
+	for(u32 CornerIndex = 0;
+	    CornerIndex < 8;
+	    ++CornerIndex)
+	{
+		v3 Corner = V3((CornerIndex & 1) ? Rect.Max.x : Rect.Min.x,
+		               (CornerIndex & 2) ? Rect.Max.y : Rect.Min.y,
+		               (CornerIndex & 4) ? Rect.Max.z : Rect.Min.z);
+		v3 P = TransformPoint(A, Corner);
+		Result = Combine(Result, Rectangle3(P, P));
+	}
+	return Result;
+}
+
 //
 // NOTE: quaternion operations
 //
@@ -1535,34 +2017,63 @@ Q(r32 r, v3 V)
 inline quaternion
 operator+(quaternion A, quaternion B)
 {
+#if RAY_SIMD_MATH
+	quaternion Result;
+	Result.W = _mm_add_ps(A.W, B.W);
+#else
 	quaternion Result = Q(A.r + B.r,
 	                      A.i + B.i,
 	                      A.j + B.j,
 	                      A.k + B.k);
+#endif
 	return Result;
 }
 
 inline quaternion
 operator*(quaternion A, quaternion B)
 {
+#if RAY_SIMD_MATH
+	// NOTE: Each term is one component of A times a signed swizzle of B.
+	__m128 R = _mm_shuffle_ps(A.W, A.W, _MM_SHUFFLE(0, 0, 0, 0));
+	__m128 I = _mm_shuffle_ps(A.W, A.W, _MM_SHUFFLE(1, 1, 1, 1));
+	__m128 J = _mm_shuffle_ps(A.W, A.W, _MM_SHUFFLE(2, 2, 2, 2));
+	__m128 K = _mm_shuffle_ps(A.W, A.W, _MM_SHUFFLE(3, 3, 3, 3));
+	__m128 BI = _mm_mul_ps(_mm_shuffle_ps(B.W, B.W, _MM_SHUFFLE(2, 3, 0, 1)), _mm_setr_ps(-1.0f, 1.0f, -1.0f, 1.0f));
+	__m128 BJ = _mm_mul_ps(_mm_shuffle_ps(B.W, B.W, _MM_SHUFFLE(1, 0, 3, 2)), _mm_setr_ps(-1.0f, 1.0f, 1.0f, -1.0f));
+	__m128 BK = _mm_mul_ps(_mm_shuffle_ps(B.W, B.W, _MM_SHUFFLE(0, 1, 2, 3)), _mm_setr_ps(-1.0f, -1.0f, 1.0f, 1.0f));
+
+	quaternion Result;
+	Result.W = _mm_add_ps(_mm_add_ps(_mm_mul_ps(R, B.W), _mm_mul_ps(I, BI)),
+	                      _mm_add_ps(_mm_mul_ps(J, BJ), _mm_mul_ps(K, BK)));
+#else
 	quaternion Result = Q(A.r*B.r - A.i*B.i - A.j*B.j - A.k*B.k,
 	                      A.r*B.i + A.i*B.r + A.j*B.k - A.k*B.j,
 	                      A.r*B.j + A.j*B.r + A.k*B.i - A.i*B.k,
 	                      A.r*B.k + A.k*B.r + A.i*B.j - A.j*B.i);
+#endif
 	return Result;
 }
 
 inline quaternion
 operator*(r32 A, quaternion B)
 {
+#if RAY_SIMD_MATH
+	quaternion Result;
+	Result.W = _mm_mul_ps(_mm_set1_ps(A), B.W);
+#else
 	quaternion Result = Q(A*B.r, A*B.i, A*B.j, A*B.k);
+#endif
 	return Result;
 }
 
 inline r32
 LengthSq(quaternion A)
 {
+#if RAY_SIMD_MATH
+	r32 Result = _mm_cvtss_f32(HorizontalAdd4(_mm_mul_ps(A.W, A.W)));
+#else
 	r32 Result = (A.r*A.r + A.i*A.i + A.j*A.j + A.k*A.k);
+#endif
 	return Result;
 }
 
@@ -1585,11 +2096,15 @@ IsUnit(quaternion A)
 inline quaternion
 Normalize(quaternion A)
 {
+#if RAY_SIMD_MATH
+	quaternion Result = InverseSquareRoot(LengthSq(A))*A;
+#else
 	r32 LengthA = Length(A);
 	quaternion Result = Q(A.r/LengthA,
 	                      A.i/LengthA,
 	                      A.j/LengthA,
 	                      A.k/LengthA);
+#endif
 	return Result;
 }
 
@@ -1661,6 +2176,13 @@ RotationMat4(quaternion Q)
 	return Result;
 }
 
+inline mat4
+TransformationMat4(v3 P, quaternion Rotation, v3 Scale)
+{
+	mat4 Result = TranslationMat4(P)*RotationMat4(Rotation)*ScaleMat4(Scale);
+	return Result;
+}
+
 inline mat3
 RotationMat3(quaternion Q)
 {
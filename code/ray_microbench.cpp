@@ -0,0 +1,292 @@
+/*@H
+* File: ray_microbench.cpp
+* Author: Jesse Calvert
+* Created: October 19, 2026, 14:05
+* Last modified: October 19, 2026, 14:07
+*/
+
+// NOTE: Microbenchmarks, run with -microbench. Each one applies a single
+// function to MICROBENCH_ELEMENT_COUNT random inputs and is repeated
+// MICROBENCH_REPETITION_COUNT times; the minimum and the median per element
+// are reported, in TSC cycles and in nanoseconds. The inputs are generated
+// once up front and are small enough to stay in L2, so what's measured is
+// the arithmetic rather than memory.
+//
+// The ray_math.h functions are compiled once, so they're timed once. The
+// kernels are timed once per instruction set the CPU has, from
+// ray_microbench_kernel.cpp, along with the lane versions of the same math,
+// so scalar and SIMD variants can be compared directly.
+
+#define MICROBENCH_ELEMENT_COUNT 4096
+#define MICROBENCH_REPETITION_COUNT 51
+
+struct microbench_data
+{
+	v3 A[MICROBENCH_ELEMENT_COUNT];
+	v3 B[MICROBENCH_ELEMENT_COUNT];
+	quaternion Rotations[MICROBENCH_ELEMENT_COUNT];
+	mat4 Matrices[MICROBENCH_ELEMENT_COUNT];
+	v3 Colors[MICROBENCH_ELEMENT_COUNT];
+
+	// NOTE: The same A and B split into components, for the lanes.
+	f32 AX[MICROBENCH_ELEMENT_COUNT];
+	f32 AY[MICROBENCH_ELEMENT_COUNT];
+	f32 AZ[MICROBENCH_ELEMENT_COUNT];
+	f32 BX[MICROBENCH_ELEMENT_COUNT];
+	f32 BY[MICROBENCH_ELEMENT_COUNT];
+	f32 BZ[MICROBENCH_ELEMENT_COUNT];
+
+	// NOTE: Rays start in a box around the sphere and point anywhere, so
+	// about half of them hit it.
+	object Sphere;
+	v3 RayOrigins[MICROBENCH_ELEMENT_COUNT];
+	v3 RayDirections[MICROBENCH_ELEMENT_COUNT];
+	f32 RayOriginX[MICROBENCH_ELEMENT_COUNT];
+	f32 RayOriginY[MICROBENCH_ELEMENT_COUNT];
+	f32 RayOriginZ[MICROBENCH_ELEMENT_COUNT];
+	f32 RayDirectionX[MICROBENCH_ELEMENT_COUNT];
+	f32 RayDirectionY[MICROBENCH_ELEMENT_COUNT];
+	f32 RayDirectionZ[MICROBENCH_ELEMENT_COUNT];
+
+	v3 OutV3[MICROBENCH_ELEMENT_COUNT];
+	mat4 OutMat4[MICROBENCH_ELEMENT_COUNT];
+	u32 OutU32[MICROBENCH_ELEMENT_COUNT];
+	f32 OutX[MICROBENCH_ELEMENT_COUNT];
+	f32 OutY[MICROBENCH_ELEMENT_COUNT];
+	f32 OutZ[MICROBENCH_ELEMENT_COUNT];
+};
+
+#define MICROBENCH(name) void name(microbench_data *Data)
+typedef MICROBENCH(microbench);
+
+#define MICROBENCH_KERNELS(name) void name(microbench_data *Data)
+typedef MICROBENCH_KERNELS(microbench_kernels);
+
+#if COMPILER_MSVC
+global_variable void * volatile MicrobenchSink;
+#endif
+
+// NOTE: The do-not-optimize barrier. The compiler has to assume the memory
+// at Pointer is read here and that anything may have changed, so the
+// outputs can't be dropped and no work moves from one repetition to the next.
+inline void
+KeepMemory(void *Pointer)
+{
+#if COMPILER_MSVC
+	MicrobenchSink = Pointer;
+	_ReadWriteBarrier();
+#else
+	asm volatile("" : : "r"(Pointer) : "memory");
+#endif
+}
+
+internal void
+SortU64(u64 *Values, u32 Count)
+{
+	for(u32 Index = 1;
+		Index < Count;
+		++Index)
+	{
+		u64 Value = Values[Index];
+		u32 Dest = Index;
+		while(Dest && (Values[Dest - 1] > Value))
+		{
+			Values[Dest] = Values[Dest - 1];
+			--Dest;
+		}
+		Values[Dest] = Value;
+	}
+}
+
+internal void
+RunMicrobench(char *Name, microbench *Function, microbench_data *Data)
+{
+	u64 Cycles[MICROBENCH_REPETITION_COUNT];
+	u64 Nanoseconds[MICROBENCH_REPETITION_COUNT];
+
+	// NOTE: One untimed run first, for the caches and the branch predictors.
+	Function(Data);
+	KeepMemory(Data);
+
+	for(u32 Repetition = 0;
+		Repetition < MICROBENCH_REPETITION_COUNT;
+		++Repetition)
+	{
+		f64 StartTime = GetWallClock();
+		u64 StartCycles = ReadCPUTimer();
+		Function(Data);
+		KeepMemory(Data);
+		u64 EndCycles = ReadCPUTimer();
+		f64 EndTime = GetWallClock();
+
+		Cycles[Repetition] = EndCycles - StartCycles;
+		Nanoseconds[Repetition] = (u64)(1.0e9*(EndTime - StartTime));
+	}
+
+	SortU64(Cycles, MICROBENCH_REPETITION_COUNT);
+	SortU64(Nanoseconds, MICROBENCH_REPETITION_COUNT);
+	u32 Median = MICROBENCH_REPETITION_COUNT / 2;
+	f64 PerElement = 1.0 / MICROBENCH_ELEMENT_COUNT;
+	printf("  %-28s %8.2f %8.2f   %8.3f %8.3f\n", Name,
+	       PerElement*Cycles[0], PerElement*Cycles[Median],
+	       PerElement*Nanoseconds[0], PerElement*Nanoseconds[Median]);
+	fflush(stdout);
+}
+
+internal v3
+RandomV3(f32 Scale)
+{
+	v3 Result = Scale*V3(RandomBilateral(), RandomBilateral(), RandomBilateral());
+	return Result;
+}
+
+internal void
+InitializeMicrobenchData(microbench_data *Data)
+{
+	srand(1);
+	Data->Sphere.Type = Object_Sphere;
+	Data->Sphere.Sphere = Sphere(V3(0.0f, 0.0f, 0.0f), 1.0f);
+
+	for(u32 Index = 0;
+		Index < MICROBENCH_ELEMENT_COUNT;
+		++Index)
+	{
+		Data->A[Index] = RandomV3(10.0f);
+		Data->B[Index] = RandomV3(10.0f);
+		Data->Rotations[Index] = RotationQuaternion(NOZ(RandomV3(1.0f)), Pi32*RandomBilateral());
+		Data->Matrices[Index] = TransformationMat4(RandomV3(10.0f), Data->Rotations[Index],
+		                                           V3(1.0f, 1.0f, 1.0f) + RandomV3(0.5f));
+		Data->Colors[Index] = 1.2f*V3(RandomUnilateral(), RandomUnilateral(), RandomUnilateral());
+
+		Data->AX[Index] = Data->A[Index].x;
+		Data->AY[Index] = Data->A[Index].y;
+		Data->AZ[Index] = Data->A[Index].z;
+		Data->BX[Index] = Data->B[Index].x;
+		Data->BY[Index] = Data->B[Index].y;
+		Data->BZ[Index] = Data->B[Index].z;
+
+		Data->RayOrigins[Index] = RandomV3(3.0f);
+		Data->RayDirections[Index] = NOZ(-Data->RayOrigins[Index] + RandomV3(1.5f));
+		Data->RayOriginX[Index] = Data->RayOrigins[Index].x;
+		Data->RayOriginY[Index] = Data->RayOrigins[Index].y;
+		Data->RayOriginZ[Index] = Data->RayOrigins[Index].z;
+		Data->RayDirectionX[Index] = Data->RayDirections[Index].x;
+		Data->RayDirectionY[Index] = Data->RayDirections[Index].y;
+		Data->RayDirectionZ[Index] = Data->RayDirections[Index].z;
+	}
+}
+
+internal MICROBENCH(MicrobenchNOZV3)
+{
+	for(u32 Index = 0;
+		Index < MICROBENCH_ELEMENT_COUNT;
+		++Index)
+	{
+		Data->OutV3[Index] = NOZ(Data->A[Index]);
+	}
+}
+
+internal MICROBENCH(MicrobenchNOZV3a)
+{
+	for(u32 Index = 0;
+		Index < MICROBENCH_ELEMENT_COUNT;
+		++Index)
+	{
+		Data->OutV3[Index] = V3(NOZ(V3a(Data->A[Index])));
+	}
+}
+
+internal MICROBENCH(MicrobenchCrossV3)
+{
+	for(u32 Index = 0;
+		Index < MICROBENCH_ELEMENT_COUNT;
+		++Index)
+	{
+		Data->OutV3[Index] = Cross(Data->A[Index], Data->B[Index]);
+	}
+}
+
+internal MICROBENCH(MicrobenchCrossV3a)
+{
+	for(u32 Index = 0;
+		Index < MICROBENCH_ELEMENT_COUNT;
+		++Index)
+	{
+		Data->OutV3[Index] = V3(Cross(V3a(Data->A[Index]), V3a(Data->B[Index])));
+	}
+}
+
+internal MICROBENCH(MicrobenchMat4Multiply)
+{
+	for(u32 Index = 0;
+		Index < MICROBENCH_ELEMENT_COUNT;
+		++Index)
+	{
+		u32 NextIndex = (Index + 1) % MICROBENCH_ELEMENT_COUNT;
+		Data->OutMat4[Index] = Data->Matrices[Index]*Data->Matrices[NextIndex];
+	}
+}
+
+internal MICROBENCH(MicrobenchTransformPoint)
+{
+	for(u32 Index = 0;
+		Index < MICROBENCH_ELEMENT_COUNT;
+		++Index)
+	{
+		Data->OutV3[Index] = TransformPoint(Data->Matrices[Index], Data->A[Index]);
+	}
+}
+
+internal MICROBENCH(MicrobenchQuaternionRotate)
+{
+	for(u32 Index = 0;
+		Index < MICROBENCH_ELEMENT_COUNT;
+		++Index)
+	{
+		Data->OutV3[Index] = RotateBy(Data->A[Index], Data->Rotations[Index]);
+	}
+}
+
+internal MICROBENCH(MicrobenchQuaternionMatrixRotate)
+{
+	for(u32 Index = 0;
+		Index < MICROBENCH_ELEMENT_COUNT;
+		++Index)
+	{
+		Data->OutV3[Index] = RotationMat3(Data->Rotations[Index])*Data->A[Index];
+	}
+}
+
+internal void
+RunMicrobenches(microbench_kernels **Kernels, char **ISANames, u32 SupportedISA)
+{
+	microbench_data *Data = (microbench_data *)AllocateMemory(sizeof(microbench_data));
+	InitializeMicrobenchData(Data);
+
+	printf("%u elements, %u repetitions; per element:\n", MICROBENCH_ELEMENT_COUNT, MICROBENCH_REPETITION_COUNT);
+	printf("  %-28s %8s %8s   %8s %8s\n", "", "min cyc", "med cyc", "min ns", "med ns");
+
+#if RAY_SIMD_MATH
+	printf("ray_math.h (SIMD math)\n");
+#else
+	printf("ray_math.h (scalar math)\n");
+#endif
+	RunMicrobench("NOZ v3", MicrobenchNOZV3, Data);
+	RunMicrobench("NOZ v3a", MicrobenchNOZV3a, Data);
+	RunMicrobench("Cross v3", MicrobenchCrossV3, Data);
+	RunMicrobench("Cross v3a", MicrobenchCrossV3a, Data);
+	RunMicrobench("mat4 * mat4", MicrobenchMat4Multiply, Data);
+	RunMicrobench("TransformPoint mat4", MicrobenchTransformPoint, Data);
+	RunMicrobench("RotateBy quaternion", MicrobenchQuaternionRotate, Data);
+	RunMicrobench("RotationMat3 quaternion * v3", MicrobenchQuaternionMatrixRotate, Data);
+
+	for(u32 ISA = 0;
+		ISA <= SupportedISA;
+		++ISA)
+	{
+		printf("Kernels: %s\n", ISANames[ISA]);
+		Kernels[ISA](Data);
+	}
+
+	DeallocateMemory(Data, sizeof(microbench_data));
+}
@@ -0,0 +1,92 @@
+/*@H
+* File: ray_microbench_kernel.cpp
+* Author: Jesse Calvert
+* Created: October 19, 2026, 14:05
+* Last modified: October 19, 2026, 14:07
+*/
+
+// NOTE: The per instruction set half of ray_microbench.cpp, compiled into
+// each kernel namespace by ray_kernel.cpp. Lane versions run LANE_WIDTH
+// elements per call, but are still reported per element.
+
+inline_force void
+StoreV3x8(microbench_data *Data, u32 Index, v3x8 Value)
+{
+	StoreF32x8(Data->OutX + Index, Value.x);
+	StoreF32x8(Data->OutY + Index, Value.y);
+	StoreF32x8(Data->OutZ + Index, Value.z);
+}
+
+internal MICROBENCH(MicrobenchNOZV3x8)
+{
+	for(u32 Index = 0;
+		Index < MICROBENCH_ELEMENT_COUNT;
+		Index += LANE_WIDTH)
+	{
+		v3x8 A = V3x8(LoadF32x8(Data->AX + Index), LoadF32x8(Data->AY + Index), LoadF32x8(Data->AZ + Index));
+		StoreV3x8(Data, Index, NOZ(A));
+	}
+}
+
+internal MICROBENCH(MicrobenchCrossV3x8)
+{
+	for(u32 Index = 0;
+		Index < MICROBENCH_ELEMENT_COUNT;
+		Index += LANE_WIDTH)
+	{
+		v3x8 A = V3x8(LoadF32x8(Data->AX + Index), LoadF32x8(Data->AY + Index), LoadF32x8(Data->AZ + Index));
+		v3x8 B = V3x8(LoadF32x8(Data->BX + Index), LoadF32x8(Data->BY + Index), LoadF32x8(Data->BZ + Index));
+		StoreV3x8(Data, Index, Cross(A, B));
+	}
+}
+
+internal MICROBENCH(MicrobenchSphereV3a)
+{
+	for(u32 Index = 0;
+		Index < MICROBENCH_ELEMENT_COUNT;
+		++Index)
+	{
+		ray_cast_result Result = {};
+		Result.ClosestHit = Real32Maximum;
+		IntersectObject(&Data->Sphere, V3a(Data->RayOrigins[Index]), V3a(Data->RayDirections[Index]), &Result);
+		Data->OutX[Index] = Result.ClosestHit;
+	}
+}
+
+internal MICROBENCH(MicrobenchSphereV3x8)
+{
+	for(u32 Index = 0;
+		Index < MICROBENCH_ELEMENT_COUNT;
+		Index += LANE_WIDTH)
+	{
+		v3x8 RayOrigin = V3x8(LoadF32x8(Data->RayOriginX + Index),
+		                      LoadF32x8(Data->RayOriginY + Index),
+		                      LoadF32x8(Data->RayOriginZ + Index));
+		v3x8 RayDirection = V3x8(LoadF32x8(Data->RayDirectionX + Index),
+		                         LoadF32x8(Data->RayDirectionY + Index),
+		                         LoadF32x8(Data->RayDirectionZ + Index));
+		lane_ray_cast_result Result = {};
+		Result.ClosestHit = F32x8(Real32Maximum);
+		IntersectObject(&Data->Sphere, RayOrigin, RayDirection, Mask8(true), &Result);
+		StoreF32x8(Data->OutX + Index, Result.ClosestHit);
+	}
+}
+
+internal MICROBENCH(MicrobenchPackSRGB)
+{
+	for(u32 Index = 0;
+		Index < MICROBENCH_ELEMENT_COUNT;
+		++Index)
+	{
+		Data->OutU32[Index] = PackLinear01ToSRGBU32(Data->Colors[Index]);
+	}
+}
+
+internal MICROBENCH_KERNELS(RunKernelMicrobenches)
+{
+	RunMicrobench("NOZ v3x8", MicrobenchNOZV3x8, Data);
+	RunMicrobench("Cross v3x8", MicrobenchCrossV3x8, Data);
+	RunMicrobench("Sphere intersection v3a", MicrobenchSphereV3a, Data);
+	RunMicrobench("Sphere intersection v3x8", MicrobenchSphereV3x8, Data);
+	RunMicrobench("PackLinear01ToSRGBU32", MicrobenchPackSRGB, Data);
+}
@@ -0,0 +1,171 @@
+/*@H
+* File: ray_numa.cpp
+* Author: Jesse Calvert
+* Created: October 19, 2026, 13:46
+* Last modified: October 19, 2026, 16:16
+*/
+
+// NOTE: NUMA-aware rendering, turned on with -numa. The pool's threads are
+// dealt out to the nodes in turn and pinned there, with the main thread on
+// node 0. Every node gets its own copy of the scene, built while the main
+// thread is pinned to that node so the pages are first touched, and so
+// placed, there. A full frame's tiles are split into one run per node (see
+// SplitTilesByNode); threads drain their own node's run before helping the
+// others, so most tiles, and the image rows under them, stay local too.
+// The preview and deadline renders hand tiles out strictly in order and
+// keep the single queue, though their threads are still pinned.
+
+global_variable memory_index NUMAReplicaSize;
+
+internal void
+BindWorkerThread(work_queue *WorkQueue)
+{
+	// NOTE: The main thread is thread 0.
+	u32 ThreadIndex = LockedAddAndReturnPreviousValue(&WorkQueue->ThreadsStarted, 1) + 1;
+	if(WorkQueue->NodeCount > 1)
+	{
+		ThreadNode = ThreadIndex % WorkQueue->NodeCount;
+		PinThreadToNode(WorkQueue->Topology, ThreadNode);
+	}
+}
+
+// NOTE: Deals the CPUs out over NodeCount made-up nodes, so the split can be
+// exercised on a machine with only one. Nodes left without a CPU share one.
+internal void
+SplitNUMATopology(numa_topology *Topology, u32 NodeCount)
+{
+	numa_topology *Real = (numa_topology *)malloc(sizeof(numa_topology));
+	*Real = *Topology;
+	memset(Topology, 0, sizeof(*Topology));
+
+	NodeCount = Minimum(NodeCount, MAX_NUMA_NODES);
+	for(u32 Node = 0;
+		Node < NodeCount;
+		++Node)
+	{
+		for(u32 CPUIndex = Node;
+			CPUIndex < Real->CPUCount;
+			CPUIndex += NodeCount)
+		{
+			AddNUMACPU(Topology, Real->CPUs[CPUIndex], Node);
+		}
+		if(!Topology->NodeCPUCount[Node])
+		{
+			AddNUMACPU(Topology, Real->CPUs[Node % Real->CPUCount], Node);
+		}
+	}
+	Topology->NodeCount = NodeCount;
+
+	free(Real);
+}
+
+// NOTE: Call before the scene is built, so the original lands on node 0
+// along with the main thread. Returns whether there's more than one node to
+// split the work across.
+internal b32
+StartNUMA(numa_topology *Topology, u32 SplitNodeCount)
+{
+	GetNUMATopology(Topology);
+	if(SplitNodeCount)
+	{
+		SplitNUMATopology(Topology, SplitNodeCount);
+	}
+
+	printf("NUMA: %u node%s (", Topology->NodeCount, (Topology->NodeCount == 1) ? "" : "s");
+	for(u32 Node = 0;
+		Node < Topology->NodeCount;
+		++Node)
+	{
+		printf("%s%u CPUs", Node ? ", " : "", Topology->NodeCPUCount[Node]);
+	}
+	printf(")%s\n", SplitNodeCount ? ", split by hand" : "");
+
+	b32 Result = (Topology->NodeCount > 1);
+	if(Result)
+	{
+		PinThreadToNode(Topology, 0);
+	}
+	return Result;
+}
+
+// NOTE: Call before ThreadStart, so the workers find their nodes set up.
+// World is the original scene, which serves node 0.
+internal void
+StartNodeQueues(work_queue *WorkQueue, numa_topology *Topology, u32 ThreadCount, world *World,
+                char *SceneName, u32 Width, u32 Height, memory_index SceneArenaSize)
+{
+	WorkQueue->Topology = Topology;
+	WorkQueue->NodeCount = Topology->NodeCount;
+	for(u32 ThreadIndex = 0;
+		ThreadIndex < ThreadCount + 1;
+		++ThreadIndex)
+	{
+		++WorkQueue->Nodes[ThreadIndex % WorkQueue->NodeCount].ThreadCount;
+	}
+
+	WorkQueue->Nodes[0].World = World;
+	for(u32 NodeIndex = 1;
+		NodeIndex < WorkQueue->NodeCount;
+		++NodeIndex)
+	{
+		PinThreadToNode(Topology, NodeIndex);
+
+		memory_arena Arena = {};
+		InitializeArena(&Arena, SceneArenaSize, AllocateMemory(SceneArenaSize));
+		world *Replica = PushStruct(&Arena, world);
+		*Replica = {};
+		// NOTE: BuildScene reseeds rand(), so this comes out identical to the
+		// original.
+		BuildScene(Replica, &Arena, SceneName, Width, Height);
+		// NOTE: The environment map is only ever read, so one copy serves all.
+		Replica->Environment = World->Environment;
+		WorkQueue->Nodes[NodeIndex].World = Replica;
+		NUMAReplicaSize = Arena.Used;
+	}
+	PinThreadToNode(Topology, 0);
+}
+
+// NOTE: Replays the original's animation on every replica. Each one is
+// updated from its own node, since a rebuild can touch new arena pages.
+internal void
+AnimateNodeWorlds(work_queue *WorkQueue, f32 Time, f32 RebuildThreshold)
+{
+	for(u32 NodeIndex = 1;
+		NodeIndex < WorkQueue->NodeCount;
+		++NodeIndex)
+	{
+		world *Replica = WorkQueue->Nodes[NodeIndex].World;
+		PinThreadToNode(WorkQueue->Topology, NodeIndex);
+		Replica->Animate(Replica, Time);
+		UpdateInstanceHierarchy(Replica, RebuildThreshold);
+	}
+	PinThreadToNode(WorkQueue->Topology, 0);
+}
+
+// NOTE: Tiles are counted against the node whose run they came from: local
+// if one of its own threads rendered them, remote if another node's thread
+// had to help, in which case that tile's image writes crossed nodes. Scene
+// reads are always local, from the node's replica.
+internal void
+PrintNUMAReport(work_queue *WorkQueue)
+{
+	u32 TotalLocal = 0;
+	u32 TotalRemote = 0;
+	printf("NUMA: %u nodes, %u KB scene replica per extra node\n", WorkQueue->NodeCount,
+	       (u32)(NUMAReplicaSize/1024));
+	for(u32 NodeIndex = 0;
+		NodeIndex < WorkQueue->NodeCount;
+		++NodeIndex)
+	{
+		work_queue_node *Node = WorkQueue->Nodes + NodeIndex;
+		u32 Tiles = Node->LocalTiles + Node->RemoteTiles;
+		printf("  Node %u: %u threads, %u tiles, %u local, %u remote (%.1f%%)\n",
+		       NodeIndex, Node->ThreadCount, Tiles, Node->LocalTiles, Node->RemoteTiles,
+		       Tiles ? (100.0*Node->RemoteTiles / Tiles) : 0.0);
+		TotalLocal += Node->LocalTiles;
+		TotalRemote += Node->RemoteTiles;
+	}
+	u32 TotalTiles = TotalLocal + TotalRemote;
+	printf("  All: %u tiles, %.1f%% rendered off their node\n", TotalTiles,
+	       TotalTiles ? (100.0*TotalRemote / TotalTiles) : 0.0);
+}
@@ -0,0 +1,480 @@
+/*@H
+* File: ray_preview.cpp
+* Author: Jesse Calvert
+* Created: October 19, 2026, 13:08
+* Last modified: October 19, 2026, 13:51
+*/
+
+// NOTE: Interactive preview. The image is refined through a ladder of
+// resolution levels, from 1/8 scale up to full, inside a fixed per-frame time
+// budget. After a camera change, the first level is the finest one whose
+// whole pass fits the budget at one sample per pixel. While the camera holds
+// still, each frame renders as many tiles as fit before the deadline, center
+// tiles first, and carries on from there next frame. Each level keeps its own
+// running average. The displayed frame shows, per pixel, the finest level
+// that has samples there, and goes to shared memory for a viewer to poll.
+
+#define PREVIEW_MAGIC LittleEndianTag('R', 'A', 'Y', 'P')
+#define PREVIEW_LEVEL_COUNT 4
+
+// NOTE: Lives at the start of the shared mapping, with Width*Height packed
+// pixels right after it.
+struct preview_shared
+{
+	u32 Magic;
+	u32 Width;
+	u32 Height;
+
+	// NOTE: Odd while a frame is being written. A reader copies the pixels and
+	// retries if Sequence was odd or changed underneath it.
+	volatile u32 Sequence;
+	volatile u32 FrameIndex;
+	f32 SamplesPerPixel;
+	u32 Scale;
+
+	// NOTE: Written by the viewer, which bumps CameraVersion afterwards.
+	volatile u32 CameraVersion;
+	v3 CameraP;
+	v3 CameraLookAt;
+};
+
+struct preview_level
+{
+	u32 Scale;
+	u32 ScaleShift;
+	image Image;
+	v3 *Accumulated;
+	u32 *SampleCount;
+	u32 *Packed;
+
+	u32 TileCount;
+	tile_work_order Tiles[MAX_TILE_COUNT];
+
+	u32 NextTile;
+	u32 PassSamples;
+	u32 SamplesDone;
+};
+
+inline u32 *
+GetPreviewPixels(preview_shared *Shared)
+{
+	u32 *Result = (u32 *)(Shared + 1);
+	return Result;
+}
+
+internal void
+SortTilesCenterOut(tile_work_order *Tiles, u32 TileCount, image *Image)
+{
+	f32 CenterX = 0.5f*Image->Width;
+	f32 CenterY = 0.5f*Image->Height;
+	f32 Distances[MAX_TILE_COUNT];
+	for(u32 TileIndex = 0;
+		TileIndex < TileCount;
+		++TileIndex)
+	{
+		tile_work_order *Tile = Tiles + TileIndex;
+		f32 X = 0.5f*(Tile->MinX + Tile->OnePastMaxX) - CenterX;
+		f32 Y = 0.5f*(Tile->MinY + Tile->OnePastMaxY) - CenterY;
+		Distances[TileIndex] = X*X + Y*Y;
+	}
+
+	// NOTE: Insertion sort; it runs once per level at startup.
+	for(u32 TileIndex = 1;
+		TileIndex < TileCount;
+		++TileIndex)
+	{
+		tile_work_order Tile = Tiles[TileIndex];
+		f32 Distance = Distances[TileIndex];
+		u32 Slot = TileIndex;
+		while((Slot > 0) && (Distances[Slot - 1] > Distance))
+		{
+			Tiles[Slot] = Tiles[Slot - 1];
+			Distances[Slot] = Distances[Slot - 1];
+			--Slot;
+		}
+		Tiles[Slot] = Tile;
+		Distances[Slot] = Distance;
+	}
+}
+
+internal void
+InitializePreviewLevel(preview_level *Level, u32 Scale, u32 Width, u32 Height, world *World,
+                       u32 MaxBounces, u32 LaneWidth)
+{
+	Level->Scale = Scale;
+	Level->ScaleShift = FindLeastSignificantSetBit(Scale).Index;
+	Level->Image = AllocateImage(Maximum((Width + Scale - 1) / Scale, 1),
+	                             Maximum((Height + Scale - 1) / Scale, 1));
+	image *Image = &Level->Image;
+	AllocateImageRadiance(Image, RadianceLayout_Linear);
+	Level->Accumulated = (v3 *)calloc(Image->PixelCount, sizeof(v3));
+	Level->SampleCount = (u32 *)calloc(Image->PixelCount, sizeof(u32));
+	Level->Packed = (u32 *)calloc(Image->PixelCount, sizeof(u32));
+
+	// NOTE: Finer levels get finer tile grids so a single tile never eats
+	// much of a frame.
+	u32 TileDim = Maximum(MAX_TILE_DIM / Scale, 2);
+	work_queue *Layout = (work_queue *)calloc(1, sizeof(work_queue));
+	BuildTileWorkOrders(Layout, Image, World, TileDim, 1, MaxBounces, LaneWidth);
+	Level->TileCount = Layout->TileQueueSize;
+	memcpy(Level->Tiles, Layout->TileWorkQueue, Level->TileCount*sizeof(tile_work_order));
+	free(Layout);
+
+	SortTilesCenterOut(Level->Tiles, Level->TileCount, Image);
+}
+
+internal void
+ResetPreviewLevel(preview_level *Level)
+{
+	memset(Level->Accumulated, 0, Level->Image.PixelCount*sizeof(v3));
+	memset(Level->SampleCount, 0, Level->Image.PixelCount*sizeof(u32));
+	Level->NextTile = 0;
+	Level->PassSamples = 0;
+	Level->SamplesDone = 0;
+}
+
+internal void
+AccumulatePreviewTile(preview_level *Level, tile_work_order *Tile)
+{
+	image *Image = &Level->Image;
+	for(u32 Y = Tile->MinY;
+		Y < Tile->OnePastMaxY;
+		++Y)
+	{
+		for(u32 X = Tile->MinX;
+			X < Tile->OnePastMaxX;
+			++X)
+		{
+			// NOTE: The level's own buffers are packed; only Radiance has the
+			// image's padded rows.
+			u32 PixelIndex = Y*Image->Width + X;
+			v3 Radiance = Image->Radiance[GetRadianceIndex(Image, X, Y)];
+			Level->Accumulated[PixelIndex] += (f32)Tile->RaysPerPixel*Radiance;
+			Level->SampleCount[PixelIndex] += Tile->RaysPerPixel;
+
+			v3 Color = (1.0f / (f32)Level->SampleCount[PixelIndex])*Level->Accumulated[PixelIndex];
+			Level->Packed[PixelIndex] = kernel_sse2::PackLinear01ToSRGBU32(Color);
+		}
+	}
+}
+
+internal void
+ComposePreview(preview_shared *Shared, preview_level *Levels, u32 CoarsestLevel)
+{
+	u32 *Dest = GetPreviewPixels(Shared);
+
+	// NOTE: Every level covers the same image, so a level's pixel for an
+	// output pixel is just both coordinates shifted down by its scale.
+	for(u32 Y = 0;
+		Y < Shared->Height;
+		++Y)
+	{
+		u32 *SampleCountRows[PREVIEW_LEVEL_COUNT];
+		u32 *PackedRows[PREVIEW_LEVEL_COUNT];
+		for(u32 LevelIndex = CoarsestLevel;
+			LevelIndex < PREVIEW_LEVEL_COUNT;
+			++LevelIndex)
+		{
+			preview_level *Level = Levels + LevelIndex;
+			u32 RowOffset = (Y >> Level->ScaleShift)*Level->Image.Width;
+			SampleCountRows[LevelIndex] = Level->SampleCount + RowOffset;
+			PackedRows[LevelIndex] = Level->Packed + RowOffset;
+		}
+
+		for(u32 X = 0;
+			X < Shared->Width;
+			++X)
+		{
+			u32 Pixel = 0;
+			for(s32 LevelIndex = PREVIEW_LEVEL_COUNT - 1;
+				LevelIndex >= (s32)CoarsestLevel;
+				--LevelIndex)
+			{
+				u32 LevelX = X >> Levels[LevelIndex].ScaleShift;
+				if(SampleCountRows[LevelIndex][LevelX])
+				{
+					Pixel = PackedRows[LevelIndex][LevelX];
+					break;
+				}
+			}
+			*Dest++ = Pixel;
+		}
+	}
+}
+
+internal int
+CompareF64(const void *A, const void *B)
+{
+	f64 ValueA = *(f64 *)A;
+	f64 ValueB = *(f64 *)B;
+	int Result = (ValueA < ValueB) ? -1 : ((ValueA > ValueB) ? 1 : 0);
+	return Result;
+}
+
+internal s32
+RunPreview(work_queue *WorkQueue, world *World, u32 Width, u32 Height, u32 MaxBounces, u32 LaneWidth,
+           u32 MaxSamples, f64 BudgetMS, u32 FrameCount, u32 OrbitEvery, char *SharedName)
+{
+	u32 SharedSize = sizeof(preview_shared) + Width*Height*sizeof(u32);
+	preview_shared *Shared = (preview_shared *)MapSharedMemory(SharedName, SharedSize, true);
+	if(!Shared)
+	{
+		printf("Couldn't map shared memory %s, frames stay private.\n", SharedName);
+		Shared = (preview_shared *)calloc(1, SharedSize);
+	}
+	Shared->Magic = PREVIEW_MAGIC;
+	Shared->Width = Width;
+	Shared->Height = Height;
+	Shared->Sequence = 0;
+	Shared->FrameIndex = 0;
+	u32 CameraVersion = Shared->CameraVersion;
+
+	preview_level *Levels = (preview_level *)calloc(PREVIEW_LEVEL_COUNT, sizeof(preview_level));
+	for(u32 LevelIndex = 0;
+		LevelIndex < PREVIEW_LEVEL_COUNT;
+		++LevelIndex)
+	{
+		u32 Scale = 1 << (PREVIEW_LEVEL_COUNT - 1 - LevelIndex);
+		InitializePreviewLevel(Levels + LevelIndex, Scale, Width, Height, World, MaxBounces, LaneWidth);
+	}
+
+	v3 LookAt = World->CameraP - Length(World->CameraP)*World->CameraZ;
+
+	f64 Budget = BudgetMS / 1000.0;
+	// NOTE: Running estimates: throughput of the whole pool, how long one
+	// thread spends on a one-sample tile, the per-frame cost of folding tiles
+	// into the averages and composing, and how far the workers run past the
+	// deadline finishing the tiles they hold. The deadline handed to the
+	// workers leaves room for the last two. Overshoot is measured rather than
+	// modelled since it depends on how many cores the pool really gets; it
+	// rises quickly and decays slowly to keep the tail of frame times in check.
+	u32 PoolSize = WorkQueue->ThreadCount + 1;
+	f64 SecondsPerSample = 0.0;
+	f64 TileSecondsPerSample = 0.0;
+	f64 FinishSeconds = 0.0;
+	f64 OvershootSeconds = 0.0;
+	b32 Restart = true;
+	u32 ActiveLevel = 0;
+	u32 CoarsestLevel = 0;
+	u32 RestartCount = 0;
+
+	u32 RenderedFrameCount = 0;
+	u32 OverBudgetCount = 0;
+	f64 *FrameMS = (f64 *)calloc(FrameCount, sizeof(f64));
+
+	printf("Preview %ux%u, %.1f ms budget, shared memory %s\n", Width, Height, BudgetMS, SharedName);
+	for(u32 FrameIndex = 0;
+		FrameIndex < FrameCount;
+		++FrameIndex)
+	{
+		f64 FrameStart = GetWallClock();
+		SetTimelineFrame(FrameIndex);
+
+		if(Shared->CameraVersion != CameraVersion)
+		{
+			CameraVersion = Shared->CameraVersion;
+			LookAt = Shared->CameraLookAt;
+			InitializeCamera(World, Shared->CameraP, LookAt, Width, Height);
+			Restart = true;
+		}
+		else if(OrbitEvery && (FrameIndex > 0) && ((FrameIndex % OrbitEvery) == 0))
+		{
+			v3 Offset = World->CameraP - LookAt;
+			f32 Angle = 0.15f;
+			v3 Rotated = V3(Cos(Angle)*Offset.x + Sin(Angle)*Offset.z, Offset.y,
+			                -Sin(Angle)*Offset.x + Cos(Angle)*Offset.z);
+			InitializeCamera(World, LookAt + Rotated, LookAt, Width, Height);
+			Restart = true;
+		}
+
+		if(Restart)
+		{
+			for(u32 LevelIndex = 0;
+				LevelIndex < PREVIEW_LEVEL_COUNT;
+				++LevelIndex)
+			{
+				ResetPreviewLevel(Levels + LevelIndex);
+			}
+
+			// NOTE: Start as fine as a whole one-sample pass allows, so the
+			// first frame after a change already covers the screen.
+			ActiveLevel = 0;
+			for(u32 LevelIndex = 1;
+				LevelIndex < PREVIEW_LEVEL_COUNT;
+				++LevelIndex)
+			{
+				f64 PassSeconds = SecondsPerSample*Levels[LevelIndex].Image.PixelCount + FinishSeconds;
+				if((SecondsPerSample > 0.0) && (PassSeconds < 0.8*Budget))
+				{
+					ActiveLevel = LevelIndex;
+				}
+			}
+			CoarsestLevel = ActiveLevel;
+			Restart = false;
+			++RestartCount;
+		}
+
+		// NOTE: Coarse levels only need one full pass before the next level
+		// takes over; the full resolution level keeps going to MaxSamples.
+		preview_level *Level = Levels + ActiveLevel;
+		while((ActiveLevel + 1 < PREVIEW_LEVEL_COUNT) && (Level->SamplesDone >= 1))
+		{
+			Level = Levels + ++ActiveLevel;
+		}
+
+		if(Level->SamplesDone >= MaxSamples)
+		{
+			// NOTE: Converged; wait for the camera to move.
+			SleepMS((u32)BudgetMS);
+			continue;
+		}
+
+		if(Level->NextTile == 0)
+		{
+			u32 PassSamples = 1;
+			if((ActiveLevel == PREVIEW_LEVEL_COUNT - 1) && (SecondsPerSample > 0.0))
+			{
+				// NOTE: Enough samples per pass to fill a frame, but few enough
+				// that one tile stays a small slice of the budget.
+				f64 Affordable = (Budget - FinishSeconds) / (SecondsPerSample*Level->Image.PixelCount);
+				f64 TileSeconds = TileSecondsPerSample*GetTilePixelCount(Level->Tiles);
+				if(TileSeconds > 0.0)
+				{
+					Affordable = Minimum(Affordable, 0.1*Budget / TileSeconds);
+				}
+				PassSamples = (u32)Maximum(Minimum(Affordable, (f64)(MaxSamples - Level->SamplesDone)), 1.0);
+			}
+			Level->PassSamples = PassSamples;
+			for(u32 TileIndex = 0;
+				TileIndex < Level->TileCount;
+				++TileIndex)
+			{
+				Level->Tiles[TileIndex].FirstSample = Level->SamplesDone;
+				Level->Tiles[TileIndex].RaysPerPixel = PassSamples;
+			}
+		}
+
+		memcpy(WorkQueue->TileWorkQueue, Level->Tiles, Level->TileCount*sizeof(tile_work_order));
+		WorkQueue->TileQueueSize = Level->TileCount;
+
+		f64 RenderStart = GetWallClock();
+		f64 Deadline = FrameStart + Budget - FinishSeconds - OvershootSeconds;
+		u32 OnePastLastTile = RenderTilesUntil(WorkQueue, Level->NextTile, Level->TileCount, Deadline);
+		f64 RenderEnd = GetWallClock();
+
+		if(OnePastLastTile < Level->TileCount)
+		{
+			f64 Overshoot = Maximum(RenderEnd - Deadline, 0.0);
+			f64 Rate = (Overshoot > OvershootSeconds) ? 0.5 : 0.05;
+			OvershootSeconds += Rate*(Overshoot - OvershootSeconds);
+		}
+
+		u32 SamplesRendered = 0;
+		for(u32 TileIndex = Level->NextTile;
+			TileIndex < OnePastLastTile;
+			++TileIndex)
+		{
+			tile_work_order *Tile = Level->Tiles + TileIndex;
+			SamplesRendered += GetTilePixelCount(Tile)*Tile->RaysPerPixel;
+			AccumulatePreviewTile(Level, Tile);
+		}
+
+		if(SamplesRendered)
+		{
+			f64 Measured = (RenderEnd - RenderStart) / SamplesRendered;
+			SecondsPerSample = (SecondsPerSample > 0.0) ? (0.8*SecondsPerSample + 0.2*Measured) : Measured;
+			TileSecondsPerSample = PoolSize*SecondsPerSample;
+		}
+
+		Level->NextTile = OnePastLastTile;
+		if(Level->NextTile == Level->TileCount)
+		{
+			Level->NextTile = 0;
+			Level->SamplesDone += Level->PassSamples;
+		}
+
+		++Shared->Sequence;
+		LockedAddAndReturnPreviousValue((volatile u32 *)&Shared->Sequence, 0);
+		ComposePreview(Shared, Levels, CoarsestLevel);
+		Shared->SamplesPerPixel = (f32)Level->SamplesDone;
+		Shared->Scale = Level->Scale;
+		++Shared->FrameIndex;
+		LockedAddAndReturnPreviousValue((volatile u32 *)&Shared->Sequence, 1);
+		f64 FrameEnd = GetWallClock();
+		FinishSeconds = 0.8*FinishSeconds + 0.2*(FrameEnd - RenderEnd);
+		RecordTimelineSpan("frame", FrameIndex, FrameStart, FrameEnd);
+
+		FrameMS[RenderedFrameCount] = 1000.0*(FrameEnd - FrameStart);
+		if(FrameMS[RenderedFrameCount] > BudgetMS)
+		{
+			++OverBudgetCount;
+		}
+		++RenderedFrameCount;
+
+		printf("\rFrame %u: 1/%u scale, %u spp", FrameIndex, Level->Scale, Level->SamplesDone);
+		fflush(stdout);
+	}
+
+	image Image = PackedImage(GetPreviewPixels(Shared), Width, Height);
+	WriteImage(&Image, "test.bmp");
+
+	printf("\rPreview: %u frames rendered, %u restarts\n", RenderedFrameCount, RestartCount);
+	if(RenderedFrameCount)
+	{
+		qsort(FrameMS, RenderedFrameCount, sizeof(f64), CompareF64);
+		u32 P50 = (RenderedFrameCount - 1)*50 / 100;
+		u32 P99 = (RenderedFrameCount - 1)*99 / 100;
+		printf("Frame time: p50 %.2f ms, p99 %.2f ms, max %.2f ms (budget %.1f ms, %u over, %.1f%%)\n",
+		       FrameMS[P50], FrameMS[P99], FrameMS[RenderedFrameCount - 1], BudgetMS,
+		       OverBudgetCount, 100.0*OverBudgetCount / RenderedFrameCount);
+	}
+
+	return 0;
+}
+
+// NOTE: A minimal viewer: waits for the preview to publish a new frame and
+// writes it out.
+internal s32
+SnapshotPreview(char *SharedName, char *Filename)
+{
+	preview_shared *Shared = (preview_shared *)MapSharedMemory(SharedName, sizeof(preview_shared), false);
+	if(!Shared || (Shared->Magic != PREVIEW_MAGIC))
+	{
+		printf("No preview running under %s.\n", SharedName);
+		return 1;
+	}
+
+	u32 Width = Shared->Width;
+	u32 Height = Shared->Height;
+	Shared = (preview_shared *)MapSharedMemory(SharedName, sizeof(preview_shared) + Width*Height*sizeof(u32), false);
+
+	image Image = PackedImage((u32 *)malloc(Width*Height*sizeof(u32)), Width, Height);
+	u32 StartFrame = Shared->FrameIndex;
+	f64 GiveUp = GetWallClock() + 5.0;
+	b32 Copied = false;
+	while(!Copied && (GetWallClock() < GiveUp))
+	{
+		u32 Sequence = Shared->Sequence;
+		if(((Sequence & 1) == 0) && (Shared->FrameIndex != StartFrame))
+		{
+			memcpy(Image.Pixels, GetPreviewPixels(Shared), Image.PixelsSize);
+			LockedAddAndReturnPreviousValue((volatile u32 *)&Shared->Sequence, 0);
+			Copied = (Shared->Sequence == Sequence);
+		}
+		else
+		{
+			SleepMS(1);
+		}
+	}
+
+	if(!Copied)
+	{
+		printf("The preview under %s didn't publish a frame.\n", SharedName);
+		return 1;
+	}
+
+	WriteImage(&Image, Filename);
+	printf("Frame %u, 1/%u scale, %.0f spp -> %s\n", Shared->FrameIndex, Shared->Scale,
+	       Shared->SamplesPerPixel, Filename);
+	return 0;
+}
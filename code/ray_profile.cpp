@@ -0,0 +1,269 @@
+/*@H
+* File: ray_profile.cpp
+* Author: Jesse Calvert
+* Created: October 19, 2026, 13:40
+* Last modified: October 19, 2026, 16:13
+*/
+
+// NOTE: Cycle counting for the hot path, compiled in with RAY_PROFILE=1.
+// TIMED_ZONE(Zone) times the rest of the enclosing scope with the TSC;
+// BEGIN_TIMED_ZONE/END_TIMED_ZONE time a stretch of statements without
+// adding a scope. Each thread accumulates into its own slot, so nothing is
+// shared while tracing. Zones nest, and each one also records the time its
+// children took so the report can show self time. Hits are binned by log2 of
+// their cycle count. With RAY_PROFILE off, all of it expands to nothing, and
+// the instrumented functions compile exactly as they did before.
+// ReadCPUTimer stays either way, since the microbenchmarks use it too.
+
+#if !COMPILER_MSVC
+#include <x86intrin.h>
+#endif
+#define ReadCPUTimer() __rdtsc()
+
+#if RAY_PROFILE
+
+enum profile_zone
+{
+	ProfileZone_RenderTile,
+	ProfileZone_RayCast,
+	ProfileZone_PrimaryIntersection,
+	ProfileZone_SecondaryIntersection,
+	ProfileZone_TransparentFresnel,
+	ProfileZone_ShadowRay,
+	ProfileZone_BounceSampling,
+	ProfileZone_PackSRGB,
+
+	ProfileZone_Count,
+};
+
+global_variable char *ProfileZoneNames[ProfileZone_Count] =
+{
+	"RenderTile",
+	"RayCast",
+	"PrimaryIntersection",
+	"SecondaryIntersection",
+	"TransparentFresnel",
+	"ShadowRay",
+	"BounceSampling",
+	"PackSRGB",
+};
+
+#define PROFILE_HISTOGRAM_BUCKETS 32
+#define MAX_PROFILE_THREADS 256
+
+struct profile_zone_stats
+{
+	u64 Cycles;
+	u64 SelfCycles;
+	u64 HitCount;
+	u64 Histogram[PROFILE_HISTOGRAM_BUCKETS];
+};
+
+struct timed_zone;
+struct profile_thread
+{
+	timed_zone *Current;
+	profile_zone_stats Zones[ProfileZone_Count];
+};
+
+global_variable profile_thread ProfileThreads[MAX_PROFILE_THREADS];
+global_variable volatile u32 ProfileThreadCount;
+global_variable thread_local profile_thread *ThreadProfile;
+
+inline profile_thread *
+GetThreadProfile()
+{
+	if(!ThreadProfile)
+	{
+		u32 ThreadIndex = LockedAddAndReturnPreviousValue(&ProfileThreadCount, 1);
+		Assert(ThreadIndex < MAX_PROFILE_THREADS);
+		ThreadProfile = ProfileThreads + ThreadIndex;
+	}
+
+	profile_thread *Result = ThreadProfile;
+	return Result;
+}
+
+struct timed_zone
+{
+	profile_thread *Thread;
+	timed_zone *Parent;
+	u32 Zone;
+	u64 ChildCycles;
+	u64 Start;
+};
+
+inline void
+BeginTimedZone(timed_zone *TimedZone, u32 Zone)
+{
+	profile_thread *Thread = GetThreadProfile();
+	TimedZone->Thread = Thread;
+	TimedZone->Parent = Thread->Current;
+	TimedZone->Zone = Zone;
+	TimedZone->ChildCycles = 0;
+	Thread->Current = TimedZone;
+	TimedZone->Start = ReadCPUTimer();
+}
+
+inline void
+EndTimedZone(timed_zone *TimedZone)
+{
+	u64 Cycles = ReadCPUTimer() - TimedZone->Start;
+
+	profile_thread *Thread = TimedZone->Thread;
+	profile_zone_stats *Stats = Thread->Zones + TimedZone->Zone;
+	Stats->Cycles += Cycles;
+	Stats->SelfCycles += Cycles - TimedZone->ChildCycles;
+	++Stats->HitCount;
+	u32 Clamped = (Cycles > 0xFFFFFFFF) ? 0xFFFFFFFF : (u32)Cycles;
+	++Stats->Histogram[FindMostSignificantSetBit(Clamped).Index];
+
+	Thread->Current = TimedZone->Parent;
+	if(TimedZone->Parent)
+	{
+		TimedZone->Parent->ChildCycles += Cycles;
+	}
+}
+
+struct scoped_timed_zone
+{
+	timed_zone TimedZone;
+
+	scoped_timed_zone(u32 Zone)
+	{
+		BeginTimedZone(&TimedZone, Zone);
+	}
+
+	~scoped_timed_zone()
+	{
+		EndTimedZone(&TimedZone);
+	}
+};
+
+#define TIMED_ZONE__(Zone, Line) scoped_timed_zone TimedZone_##Line(Zone)
+#define TIMED_ZONE_(Zone, Line) TIMED_ZONE__(Zone, Line)
+#define TIMED_ZONE(Zone) TIMED_ZONE_(Zone, __LINE__)
+#define BEGIN_TIMED_ZONE(Name, Zone) timed_zone Name; BeginTimedZone(&Name, Zone)
+#define END_TIMED_ZONE(Name) EndTimedZone(&Name)
+
+// NOTE: Drops everything recorded so far, so passes that aren't rendering,
+// like the prefault's clearing pass, stay out of the report. Only called
+// between passes, when no thread is inside a zone.
+internal void
+ResetProfile()
+{
+	u32 ThreadCount = Minimum(ProfileThreadCount, MAX_PROFILE_THREADS);
+	for(u32 ThreadIndex = 0;
+		ThreadIndex < ThreadCount;
+		++ThreadIndex)
+	{
+		memset(ProfileThreads[ThreadIndex].Zones, 0, sizeof(ProfileThreads[ThreadIndex].Zones));
+	}
+}
+
+// NOTE: The histogram only knows which power of two a hit fell under, so
+// percentiles come back as that bucket's upper bound.
+internal u64
+GetHistogramPercentile(profile_zone_stats *Stats, u32 Percent)
+{
+	u64 Target = (Stats->HitCount*Percent + 99) / 100;
+	u64 Seen = 0;
+	u64 Result = 0;
+	for(u32 Bucket = 0;
+		Bucket < PROFILE_HISTOGRAM_BUCKETS;
+		++Bucket)
+	{
+		Seen += Stats->Histogram[Bucket];
+		if(Seen >= Target)
+		{
+			Result = 2ULL << Bucket;
+			break;
+		}
+	}
+	return Result;
+}
+
+internal void
+PrintProfile(u64 RaysCast)
+{
+	u32 ThreadCount = Minimum(ProfileThreadCount, MAX_PROFILE_THREADS);
+
+	profile_zone_stats Totals[ProfileZone_Count] = {};
+	u64 AllSelfCycles = 0;
+	for(u32 ThreadIndex = 0;
+		ThreadIndex < ThreadCount;
+		++ThreadIndex)
+	{
+		profile_thread *Thread = ProfileThreads + ThreadIndex;
+		for(u32 Zone = 0;
+			Zone < ProfileZone_Count;
+			++Zone)
+		{
+			profile_zone_stats *Source = Thread->Zones + Zone;
+			profile_zone_stats *Dest = Totals + Zone;
+			Dest->Cycles += Source->Cycles;
+			Dest->SelfCycles += Source->SelfCycles;
+			Dest->HitCount += Source->HitCount;
+			for(u32 Bucket = 0;
+				Bucket < PROFILE_HISTOGRAM_BUCKETS;
+				++Bucket)
+			{
+				Dest->Histogram[Bucket] += Source->Histogram[Bucket];
+			}
+			AllSelfCycles += Source->SelfCycles;
+		}
+	}
+
+	u32 Order[ProfileZone_Count];
+	for(u32 Zone = 0;
+		Zone < ProfileZone_Count;
+		++Zone)
+	{
+		Order[Zone] = Zone;
+	}
+
+	// NOTE: Sorted by self time, which is where the cycles actually went.
+	for(u32 OrderIndex = 1;
+		OrderIndex < ProfileZone_Count;
+		++OrderIndex)
+	{
+		u32 Zone = Order[OrderIndex];
+		u32 Slot = OrderIndex;
+		while((Slot > 0) && (Totals[Order[Slot - 1]].SelfCycles < Totals[Zone].SelfCycles))
+		{
+			Order[Slot] = Order[Slot - 1];
+			--Slot;
+		}
+		Order[Slot] = Zone;
+	}
+
+	f64 PerRay = RaysCast ? (1.0 / (f64)RaysCast) : 0.0;
+	printf("Profile: %u threads, %llu rays, cycles from the TSC\n", ThreadCount, (unsigned long long)RaysCast);
+	printf("  %-22s %12s %7s %10s %10s %10s %10s %10s\n",
+	       "Zone", "Hits", "Self%", "Self/ray", "Total/ray", "Mean/hit", "p50/hit", "p99/hit");
+	for(u32 OrderIndex = 0;
+		OrderIndex < ProfileZone_Count;
+		++OrderIndex)
+	{
+		u32 Zone = Order[OrderIndex];
+		profile_zone_stats *Stats = Totals + Zone;
+		if(Stats->HitCount)
+		{
+			printf("  %-22s %12llu %6.1f%% %10.1f %10.1f %10.1f %10llu %10llu\n",
+			       ProfileZoneNames[Zone], (unsigned long long)Stats->HitCount,
+			       AllSelfCycles ? (100.0*Stats->SelfCycles / AllSelfCycles) : 0.0,
+			       PerRay*Stats->SelfCycles, PerRay*Stats->Cycles,
+			       (f64)Stats->Cycles / Stats->HitCount,
+			       (unsigned long long)GetHistogramPercentile(Stats, 50),
+			       (unsigned long long)GetHistogramPercentile(Stats, 99));
+		}
+	}
+}
+
+#else
+
+#define TIMED_ZONE(Zone)
+#define BEGIN_TIMED_ZONE(Name, Zone)
+#define END_TIMED_ZONE(Name)
+
+#endif
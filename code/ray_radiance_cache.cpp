@@ -0,0 +1,247 @@
+/*@H
+* File: ray_radiance_cache.cpp
+* Author: Jesse Calvert
+* Created: October 19, 2026, 15:46
+* Last modified: October 19, 2026, 16:37
+*/
+
+// NOTE: The radiance cache, with -radiance-cache BOUNCES. Past the first
+// bounce or two off matte surfaces, a path only goes on to pick up indirect
+// light, which changes slowly over a surface, and it still pays for every
+// bounce up to MaxBounces to do it. So before the first frame, and again
+// whenever the scene moves, a fill pass traces the frame's first few
+// samples of every pixel (-radiance-cache-fill) as full paths, and each
+// matte vertex along them adds what the rest of its path brought back
+// (divided by the attenuation it had there) to a cell keyed by where it is
+// and which way its surface faces. Those samples count toward the frame, so
+// the fill costs nothing the frame wasn't going to trace anyway; the frame's
+// other samples then stop at their first matte vertex BOUNCES matte bounces
+// in whose cell is filled, and take the cell's average there, shadow rays
+// and all.
+//
+// That trades noise and rays for bias: light gets smeared across a cell
+// (-radiance-cache-cell), and cells with fewer than -radiance-cache-min
+// samples are passed over rather than trusted. Only surfaces with a
+// specularity up to RADIANCE_CACHE_MAX_SPECULARITY are cached, since what
+// a shinier one sends back depends on where it's seen from.
+//
+// Threads claim cells by swapping their key into an empty slot and add to
+// them with locked adds, so the fill takes no locks. The sums are fixed
+// point, which makes them come out the same whatever order the paths land
+// in, and renders with the cache are as repeatable as ones without. Cells
+// are only read once the fill is over.
+
+#define RADIANCE_CACHE_DEFAULT_CELL_DIM 0.5f
+#define RADIANCE_CACHE_DEFAULT_MIN_SAMPLES 4
+#define RADIANCE_CACHE_DEFAULT_FILL_SAMPLES 2
+#define RADIANCE_CACHE_MAX_SPECULARITY 0.3f
+
+// NOTE: Matte vertices past this many on a fill path aren't added, and
+// nor are the ones too few matte bounces in for any lookup to reach.
+#define RADIANCE_CACHE_MAX_VERTICES 16
+
+// NOTE: The table is sized to a few slots per fill path, so that clearing
+// it before each fill stays cheap at small image sizes.
+#define RADIANCE_CACHE_SLOTS_PER_PATH 4
+#define RADIANCE_CACHE_MIN_ENTRY_COUNT (1 << 12)
+#define RADIANCE_CACHE_MAX_ENTRY_COUNT (1 << 20)
+#define RADIANCE_CACHE_MAX_PROBES 64
+
+// NOTE: Sums are kept in 48.16 fixed point, and samples are clamped so
+// that a few hundred million of them still fit.
+#define RADIANCE_CACHE_FIXED_ONE 65536.0f
+#define RADIANCE_CACHE_MAX_RADIANCE 1024.0f
+
+#define RADIANCE_CACHE_COORD_MASK 0x7FFFF
+
+// NOTE: A matte vertex on a fill path, and the path's attenuation and
+// radiance as it got there.
+struct radiance_cache_vertex
+{
+	u64 Key;
+	v3 Attenuation;
+	v3 ResultBefore;
+};
+
+// NOTE: FillSamples is capped at the frame's samples, since the fill traces
+// the frame's own. It also takes any of the rest that wouldn't make up a
+// whole packet, so that the frame traces none of them one ray at a time.
+internal radiance_cache *
+CreateRadianceCache(image *Image, u32 RaysPerPixel, u32 LaneWidth, u32 LookupBounce, f32 CellDim,
+                    u32 MinSamples, u32 FillSamples)
+{
+	radiance_cache *Cache = (radiance_cache *)AllocateMemory(sizeof(radiance_cache));
+	Cache->InvCellDim = 1.0f / CellDim;
+	Cache->LookupBounce = LookupBounce;
+	Cache->MinSamples = MinSamples;
+	FillSamples = Minimum(FillSamples, RaysPerPixel);
+	Cache->FillSamples = RaysPerPixel - LaneWidth*((RaysPerPixel - FillSamples)/LaneWidth);
+	Cache->FillImage = Image;
+	Cache->FillColor = (v3 *)AllocateMemory(Image->Width*Image->Height*sizeof(v3));
+
+	u32 PathCount = Image->Width*Image->Height*Cache->FillSamples;
+	u32 EntryCount = RADIANCE_CACHE_MIN_ENTRY_COUNT;
+	while((EntryCount < RADIANCE_CACHE_MAX_ENTRY_COUNT) &&
+	      (EntryCount < RADIANCE_CACHE_SLOTS_PER_PATH*PathCount))
+	{
+		EntryCount *= 2;
+	}
+	Cache->EntryMask = EntryCount - 1;
+	Cache->Entries = (radiance_cache_entry *)AllocateMemory(EntryCount*sizeof(radiance_cache_entry));
+	return Cache;
+}
+
+internal void
+ClearRadianceCache(radiance_cache *Cache)
+{
+	memset((void *)Cache->Entries, 0, (Cache->EntryMask + 1)*sizeof(radiance_cache_entry));
+	Cache->EntryCount = 0;
+	Cache->DroppedCount = 0;
+}
+
+// NOTE: How many of a work order's samples the fill already traced, which
+// the tile kernels skip and take from FillColor. That only works if the fill
+// traced this frame and image, and the order starts at the first sample and
+// covers them all; anything else traces every sample itself.
+inline u32
+GetRadianceCacheFilledSamples(radiance_cache *Cache, tile_work_order *WorkOrder, u32 FrameIndex)
+{
+	u32 Result = 0;
+	if(Cache &&
+	   (Cache->FillImage == WorkOrder->Image) &&
+	   (Cache->FillFrameIndex == FrameIndex) &&
+	   (WorkOrder->FirstSample == 0) &&
+	   (WorkOrder->RaysPerPixel >= Cache->FillSamples))
+	{
+		Result = Cache->FillSamples;
+	}
+	return Result;
+}
+
+// NOTE: The cell's coordinates take 19 bits each, and which of the six
+// axis directions the normal is closest to takes 3 more. The top bit is
+// always set, so no key is 0, which marks an empty slot.
+inline u64
+GetRadianceCacheKey(radiance_cache *Cache, v3 P, v3 Normal)
+{
+	v3 Cell = Cache->InvCellDim*P;
+	u64 X = (u64)(FloorReal32ToInt32(Cell.x) & RADIANCE_CACHE_COORD_MASK);
+	u64 Y = (u64)(FloorReal32ToInt32(Cell.y) & RADIANCE_CACHE_COORD_MASK);
+	u64 Z = (u64)(FloorReal32ToInt32(Cell.z) & RADIANCE_CACHE_COORD_MASK);
+
+	u32 Axis = 0;
+	f32 AxisLength = AbsoluteValue(Normal.x);
+	if(AbsoluteValue(Normal.y) > AxisLength)
+	{
+		Axis = 1;
+		AxisLength = AbsoluteValue(Normal.y);
+	}
+	if(AbsoluteValue(Normal.z) > AxisLength)
+	{
+		Axis = 2;
+	}
+	u64 Face = 2*Axis + ((Normal.E[Axis] < 0.0f) ? 1 : 0);
+
+	u64 Result = (1ull << 63) | (Face << 57) | (X << 38) | (Y << 19) | Z;
+	return Result;
+}
+
+// NOTE: Linear probing from the key's hashed slot. Claim takes the first
+// empty slot for the key if it isn't in yet; otherwise an empty slot means
+// the key isn't there. Returns 0 if RADIANCE_CACHE_MAX_PROBES slots in a
+// row belong to other keys.
+internal radiance_cache_entry *
+FindRadianceCacheEntry(radiance_cache *Cache, u64 Key, b32 Claim)
+{
+	radiance_cache_entry *Result = 0;
+	u32 Slot = (u32)((Key*0x9E3779B97F4A7C15ull) >> 32);
+	for(u32 Probe = 0;
+		Probe < RADIANCE_CACHE_MAX_PROBES;
+		++Probe)
+	{
+		radiance_cache_entry *Entry = Cache->Entries + ((Slot + Probe) & Cache->EntryMask);
+		u64 EntryKey = Entry->Key;
+		if(!EntryKey && Claim)
+		{
+			EntryKey = LockedCompareExchange64(&Entry->Key, Key, 0);
+			if(!EntryKey)
+			{
+				LockedAddAndReturnPreviousValue(&Cache->EntryCount, 1);
+				EntryKey = Key;
+			}
+		}
+
+		if(EntryKey == Key)
+		{
+			Result = Entry;
+			break;
+		}
+		else if(!EntryKey)
+		{
+			break;
+		}
+	}
+	return Result;
+}
+
+internal void
+AddRadianceCacheSample(radiance_cache *Cache, u64 Key, v3 Radiance)
+{
+	radiance_cache_entry *Entry = FindRadianceCacheEntry(Cache, Key, true);
+	if(Entry)
+	{
+		for(u32 Channel = 0;
+			Channel < 3;
+			++Channel)
+		{
+			f32 Value = Clamp(Radiance.E[Channel], 0.0f, RADIANCE_CACHE_MAX_RADIANCE);
+			LockedAddAndReturnPreviousValue64(&Entry->Sum[Channel], (u64)(RADIANCE_CACHE_FIXED_ONE*Value + 0.5f));
+		}
+		LockedAddAndReturnPreviousValue(&Entry->Count, 1);
+	}
+	else
+	{
+		LockedAddAndReturnPreviousValue(&Cache->DroppedCount, 1);
+	}
+}
+
+// NOTE: Everything a fill path picked up from a vertex on was scaled by at
+// least the attenuation it had there, so dividing that back out leaves what
+// the vertex saw. Channels the vertex's attenuation had already zeroed saw
+// nothing anyone could use.
+internal void
+AddRadianceCachePath(radiance_cache *Cache, radiance_cache_vertex *Vertices, u32 VertexCount, v3 Result)
+{
+	for(u32 VertexIndex = 0;
+		VertexIndex < VertexCount;
+		++VertexIndex)
+	{
+		radiance_cache_vertex *Vertex = Vertices + VertexIndex;
+		v3 Seen = Result - Vertex->ResultBefore;
+		v3 Radiance = {};
+		for(u32 Channel = 0;
+			Channel < 3;
+			++Channel)
+		{
+			if(Vertex->Attenuation.E[Channel] > 0.0f)
+			{
+				Radiance.E[Channel] = Seen.E[Channel] / Vertex->Attenuation.E[Channel];
+			}
+		}
+		AddRadianceCacheSample(Cache, Vertex->Key, Radiance);
+	}
+}
+
+internal b32
+LookupRadianceCache(radiance_cache *Cache, u64 Key, v3 *Radiance)
+{
+	b32 Result = false;
+	radiance_cache_entry *Entry = FindRadianceCacheEntry(Cache, Key, false);
+	if(Entry && (Entry->Count >= Cache->MinSamples))
+	{
+		f32 Scale = 1.0f / (RADIANCE_CACHE_FIXED_ONE*(f32)Entry->Count);
+		*Radiance = Scale*V3((f32)Entry->Sum[0], (f32)Entry->Sum[1], (f32)Entry->Sum[2]);
+		Result = true;
+	}
+	return Result;
+}
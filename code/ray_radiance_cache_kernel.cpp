@@ -0,0 +1,107 @@
+/*@H
+* File: ray_radiance_cache_kernel.cpp
+* Author: Jesse Calvert
+* Created: October 19, 2026, 15:46
+* Last modified: October 19, 2026, 16:37
+*/
+
+// NOTE: The per instruction set half of ray_radiance_cache.cpp, compiled into
+// each kernel namespace by ray_kernel.cpp: the fill pass. Fill paths are the
+// frame's first FillSamples samples of each pixel, and the tracers add their
+// matte vertices to the cache while the cache is Filling. With lanes, a
+// packet takes the next eight of the tile's (pixel, sample) pairs, so a fill
+// of fewer samples than a packet still runs eight paths at a time; whatever
+// doesn't fill a last packet goes one ray at a time.
+internal TILE_KERNEL(FillRadianceCacheKernel)
+{
+	world *World = WorkOrder->World;
+	image *Image = WorkOrder->Image;
+	radiance_cache *Cache = World->RadianceCache;
+
+	u32 TileWidth = WorkOrder->OnePastMaxX - WorkOrder->MinX;
+	u32 TileHeight = WorkOrder->OnePastMaxY - WorkOrder->MinY;
+	u32 PathCount = TileWidth*TileHeight*Cache->FillSamples;
+	f32 InvImageWidth = 1.0f/(f32)Image->Width;
+	f32 InvImageHeight = 1.0f/(f32)Image->Height;
+
+	for(u32 Y = WorkOrder->MinY;
+		Y < WorkOrder->OnePastMaxY;
+		++Y)
+	{
+		for(u32 X = WorkOrder->MinX;
+			X < WorkOrder->OnePastMaxX;
+			++X)
+		{
+			Cache->FillColor[Y*Image->Width + X] = {};
+		}
+	}
+
+	u32 PathIndex = 0;
+	if(WorkOrder->LaneWidth == LANE_WIDTH)
+	{
+		v3x8 CameraP = V3x8(World->CameraP);
+		v3x8 FilmP = V3x8(World->FilmP);
+		v3x8 HalfFilmX = V3x8(World->HalfFilmW*World->CameraX);
+		v3x8 HalfFilmY = V3x8(World->HalfFilmH*World->CameraY);
+
+		for(;
+			PathIndex + LANE_WIDTH <= PathCount;
+			PathIndex += LANE_WIDTH)
+		{
+			u32 PixelIndex[LANE_WIDTH];
+			f32x8 PixelX;
+			f32x8 PixelY;
+			random_series_x8 Series;
+			for(u32 Lane = 0;
+				Lane < LANE_WIDTH;
+				++Lane)
+			{
+				u32 Pixel = (PathIndex + Lane) / Cache->FillSamples;
+				u32 SampleIndex = (PathIndex + Lane) % Cache->FillSamples;
+				u32 X = WorkOrder->MinX + (Pixel % TileWidth);
+				u32 Y = WorkOrder->MinY + (Pixel / TileWidth);
+				PixelIndex[Lane] = Y*Image->Width + X;
+				PixelX.E[Lane] = (f32)X;
+				PixelY.E[Lane] = (f32)Y;
+
+				random_series LaneSeries = RandomSeries(GetSampleSeed(FrameIndex, PixelIndex[Lane], SampleIndex));
+				Series.State.E[Lane] = LaneSeries.State;
+				Series.Weyl.E[Lane] = LaneSeries.Weyl;
+			}
+
+			f32x8 XRatio = -1.0f + 2.0f*((PixelX + 0.5f*RandomBilateral(&Series))*InvImageWidth);
+			f32x8 YRatio = -1.0f + 2.0f*((PixelY + 0.5f*RandomBilateral(&Series))*InvImageHeight);
+			v3x8 FilmPoint = FilmP + XRatio*HalfFilmX + YRatio*HalfFilmY;
+			v3x8 Color = RayCast(World, CameraP, NOZ(FilmPoint - CameraP), WorkOrder->MaxBounces, &Series, RaysCast);
+
+			for(u32 Lane = 0;
+				Lane < LANE_WIDTH;
+				++Lane)
+			{
+				Cache->FillColor[PixelIndex[Lane]] += GetLane(Color, Lane);
+			}
+		}
+	}
+
+	v3a CameraP = V3a(World->CameraP);
+	v3a FilmP = V3a(World->FilmP);
+	v3a HalfFilmX = World->HalfFilmW*V3a(World->CameraX);
+	v3a HalfFilmY = World->HalfFilmH*V3a(World->CameraY);
+	for(;
+		PathIndex < PathCount;
+		++PathIndex)
+	{
+		u32 Pixel = PathIndex / Cache->FillSamples;
+		u32 SampleIndex = PathIndex % Cache->FillSamples;
+		u32 X = WorkOrder->MinX + (Pixel % TileWidth);
+		u32 Y = WorkOrder->MinY + (Pixel / TileWidth);
+		u32 PixelIndex = Y*Image->Width + X;
+
+		random_series Series = RandomSeries(GetSampleSeed(FrameIndex, PixelIndex, SampleIndex));
+		f32 XRatio = -1.0f + 2.0f*((((f32)X) + 0.5f*RandomBilateral(&Series))*InvImageWidth);
+		f32 YRatio = -1.0f + 2.0f*((((f32)Y) + 0.5f*RandomBilateral(&Series))*InvImageHeight);
+		v3a FilmPoint = FilmP + XRatio*HalfFilmX + YRatio*HalfFilmY;
+		v3a Color = RayCast(World, CameraP, NOZ(FilmPoint - CameraP), WorkOrder->MaxBounces, &Series, RaysCast);
+		Cache->FillColor[PixelIndex] += V3(Color);
+	}
+}
@@ -0,0 +1,351 @@
+/*@H
+* File: ray_regress.cpp
+* Author: Jesse Calvert
+* Created: October 19, 2026, 13:56
+* Last modified: October 19, 2026, 17:37
+*/
+
+// NOTE: The regression suite, run with -regress. Each case renders one of
+// the canonical scenes at a fixed sample count and compares it with a stored
+// reference render, and fails if the PSNR or SSIM drop below, or the
+// relative MSE climbs above, the case's limits. Renders are deterministic
+// (see GetSampleSeed), so the numbers only move when the renderer does. Rays
+// per second are printed too, and appended to -regress-log if one is given,
+// so a speedup can be landed alongside proof that the images held up.
+//
+// One case isn't a render: CheckDegenerateHierarchy builds a hierarchy over
+// the input that would otherwise grow deepest, and checks it stays within
+// the traversal stacks.
+//
+// The spheres reference is the one that ships with the repo. The others are
+// rendered by -regress-update at REGRESS_REFERENCE_SPP; references that
+// ship with the repo are never overwritten.
+
+#define REGRESS_REFERENCE_SPP 256
+#define REGRESS_MAX_BOUNCES 8
+
+struct regress_case
+{
+	char *SceneName;
+	char *Reference;
+
+	// NOTE: Only generated references are rendered by -regress-update, at
+	// this size; the others are compared at whatever size they are.
+	b32 Generated;
+	u32 Width;
+	u32 Height;
+
+	u32 RaysPerPixel;
+	f64 MinPSNR;
+	f64 MinSSIM;
+	f64 MaxRelMSE;
+
+	// NOTE: 0 renders at the lane width -regress was run with.
+	u32 LaneWidth;
+};
+
+global_variable regress_case RegressCases[] =
+{
+	{"spheres", "Nov_2_2017_2.bmp", false, 0, 0, 16, 36.5, 0.92, 0.003},
+	{"forest", "reference/forest.bmp", true, 320, 180, 16, 31.0, 0.92, 0.012},
+	{"swarm", "reference/swarm.bmp", true, 320, 180, 16, 29.0, 0.95, 0.018},
+	{"lanterns", "reference/lanterns.bmp", true, 320, 180, 16, 18.5, 0.48, 0.26},
+
+	// NOTE: The only scene with an emitter that's aimed at, so it's run
+	// through both tracers. The second case compares against the reference
+	// the first one generates.
+	{"beacon", "reference/beacon.bmp", true, 320, 180, 16, 32.0, 0.93, 0.006, 1},
+	{"beacon", "reference/beacon.bmp", false, 0, 0, 16, 32.0, 0.93, 0.006, LANE_WIDTH},
+};
+
+struct image_error
+{
+	f64 PSNR;
+	f64 SSIM;
+	f64 RelMSE;
+};
+
+inline f64
+GetPixelLuma(u32 Pixel)
+{
+	f64 Result = (0.299*((Pixel >> 16) & 0xFF) +
+	              0.587*((Pixel >> 8) & 0xFF) +
+	              0.114*((Pixel >> 0) & 0xFF));
+	return Result;
+}
+
+inline f64
+SRGB8ToLinear(u32 Value)
+{
+	f64 S = Value / 255.0;
+	f64 Result = (S <= 0.04045) ? (S / 12.92) : pow((S + 0.055) / 1.055, 2.4);
+	return Result;
+}
+
+// NOTE: PSNR is over the 8-bit sRGB channels. Relative MSE is over linear
+// radiance, each error scaled by the reference's brightness there, so dark
+// regions count as much as bright ones. SSIM is on luma, averaged over 8x8
+// windows placed every 4 pixels.
+internal image_error
+CompareImages(image *Test, image *Reference)
+{
+	Assert((Test->Width == Reference->Width) && (Test->Height == Reference->Height));
+
+	f64 SquaredError = 0.0;
+	f64 RelativeError = 0.0;
+	for(u32 Y = 0;
+		Y < Test->Height;
+		++Y)
+	{
+		u32 *TestRow = GetPixelPointer(Test, 0, Y);
+		u32 *ReferenceRow = GetPixelPointer(Reference, 0, Y);
+		for(u32 X = 0;
+			X < Test->Width;
+			++X)
+		{
+			for(u32 Shift = 0;
+				Shift < 24;
+				Shift += 8)
+			{
+				u32 A = (TestRow[X] >> Shift) & 0xFF;
+				u32 B = (ReferenceRow[X] >> Shift) & 0xFF;
+				SquaredError += Square((f64)A - (f64)B);
+
+				f64 LinearB = SRGB8ToLinear(B);
+				RelativeError += Square(SRGB8ToLinear(A) - LinearB) / (Square(LinearB) + 0.01);
+			}
+		}
+	}
+
+	image_error Result = {};
+	f64 ChannelCount = 3.0*Test->PixelCount;
+	f64 MSE = SquaredError / ChannelCount;
+	Result.PSNR = (MSE > 0.0) ? 10.0*log10(255.0*255.0 / MSE) : 99.0;
+	Result.RelMSE = RelativeError / ChannelCount;
+
+	f64 C1 = Square(0.01*255.0);
+	f64 C2 = Square(0.03*255.0);
+	f64 SSIMSum = 0.0;
+	u32 WindowCount = 0;
+	for(u32 WindowY = 0;
+		WindowY + 8 <= Test->Height;
+		WindowY += 4)
+	{
+		for(u32 WindowX = 0;
+			WindowX + 8 <= Test->Width;
+			WindowX += 4)
+		{
+			f64 SumA = 0.0;
+			f64 SumB = 0.0;
+			f64 SumAA = 0.0;
+			f64 SumBB = 0.0;
+			f64 SumAB = 0.0;
+			for(u32 Y = WindowY;
+				Y < WindowY + 8;
+				++Y)
+			{
+				for(u32 X = WindowX;
+					X < WindowX + 8;
+					++X)
+				{
+					f64 A = GetPixelLuma(*GetPixelPointer(Test, X, Y));
+					f64 B = GetPixelLuma(*GetPixelPointer(Reference, X, Y));
+					SumA += A;
+					SumB += B;
+					SumAA += A*A;
+					SumBB += B*B;
+					SumAB += A*B;
+				}
+			}
+
+			f64 MeanA = SumA / 64.0;
+			f64 MeanB = SumB / 64.0;
+			f64 VarianceA = SumAA / 64.0 - MeanA*MeanA;
+			f64 VarianceB = SumBB / 64.0 - MeanB*MeanB;
+			f64 Covariance = SumAB / 64.0 - MeanA*MeanB;
+			SSIMSum += (((2.0*MeanA*MeanB + C1)*(2.0*Covariance + C2)) /
+			            ((MeanA*MeanA + MeanB*MeanB + C1)*(VarianceA + VarianceB + C2)));
+			++WindowCount;
+		}
+	}
+	Result.SSIM = WindowCount ? (SSIMSum / WindowCount) : 1.0;
+
+	return Result;
+}
+
+// NOTE: Points on the x axis, starting near the largest float, each 12.5
+// times closer to the origin than the one before. Every point is further out
+// than a twelfth of the range the rest span, so a binned split can only take
+// the farthest one off at each level. Left alone, the hierarchy would go a
+// level deeper per point until the range gets too small to bin, well past
+// BVH_MAX_DEPTH.
+#define REGRESS_CHAIN_COUNT 72
+
+internal b32
+CheckDegenerateHierarchy(memory_arena *Arena)
+{
+	rectangle3 *Bounds = PushArray(Arena, REGRESS_CHAIN_COUNT, rectangle3);
+	f32 Distance = 1.0e38f;
+	for(u32 Index = 0;
+		Index < REGRESS_CHAIN_COUNT;
+		++Index)
+	{
+		v3 P = V3(Distance, 0.0f, 0.0f);
+		Bounds[Index] = Rectangle3(P, P);
+		Distance /= 12.5f;
+	}
+
+	bvh Hierarchy = {};
+	BuildBVH(Arena, &Hierarchy, REGRESS_CHAIN_COUNT, Bounds);
+
+	// NOTE: Walks the tree the way the traversal loops do, but on a stack big
+	// enough for any tree over these points.
+	u32 Stack[REGRESS_CHAIN_COUNT + 1];
+	u32 StackDepth[REGRESS_CHAIN_COUNT + 1];
+	u32 StackCount = 0;
+	u32 MaxDepth = 0;
+	u32 LeafPrimitiveCount = 0;
+	Stack[StackCount] = 0;
+	StackDepth[StackCount++] = 0;
+	while(StackCount)
+	{
+		--StackCount;
+		bvh_node *Node = Hierarchy.Nodes + Stack[StackCount];
+		u32 Depth = StackDepth[StackCount];
+		MaxDepth = Maximum(MaxDepth, Depth);
+		if(Node->Count)
+		{
+			LeafPrimitiveCount += Node->Count;
+		}
+		else
+		{
+			Assert(StackCount + 2 <= ArrayCount(Stack));
+			Stack[StackCount] = Node->FirstIndex + 1;
+			StackDepth[StackCount++] = Depth + 1;
+			Stack[StackCount] = Node->FirstIndex;
+			StackDepth[StackCount++] = Depth + 1;
+		}
+	}
+
+	b32 Result = ((MaxDepth < BVH_MAX_DEPTH) && (LeafPrimitiveCount == REGRESS_CHAIN_COUNT));
+	printf("%-8s %u points: depth %u (max %u), %u in leaves, %s\n", "chain", REGRESS_CHAIN_COUNT,
+	       MaxDepth, BVH_MAX_DEPTH - 1, LeafPrimitiveCount, Result ? "ok" : "FAILED");
+	return Result;
+}
+
+internal s32
+RunRegression(char *Directory, b32 Update, char *LogFilename, u32 TileDim, u32 ThreadCount,
+              tile_kernel *TileKernel, u32 LaneWidth)
+{
+	work_queue WorkQueue = {};
+	WorkQueue.TileKernel = TileKernel;
+	ThreadStart(&WorkQueue, ThreadCount);
+
+	memory_index SceneArenaSize = Megabytes(64);
+	void *SceneMemory = AllocateMemory(SceneArenaSize);
+
+	FILE *Log = 0;
+	if(LogFilename)
+	{
+		Log = fopen(LogFilename, "ab");
+		if(Log && (ftell(Log) == 0))
+		{
+			fprintf(Log, "scene,width,height,spp,lanes,psnr,ssim,relmse,rays_per_second,hash\n");
+		}
+	}
+
+	u32 CaseCount = ArrayCount(RegressCases);
+	u32 FailCount = 0;
+	for(u32 CaseIndex = 0;
+		CaseIndex < CaseCount;
+		++CaseIndex)
+	{
+		regress_case *Case = RegressCases + CaseIndex;
+		u32 CaseLaneWidth = Case->LaneWidth ? Case->LaneWidth : LaneWidth;
+		char Path[512];
+		snprintf(Path, sizeof(Path), "%s/%s", Directory, Case->Reference);
+
+		b32 Generate = (Update && Case->Generated);
+		image Reference = {};
+		u32 Width = Case->Width;
+		u32 Height = Case->Height;
+		u32 RaysPerPixel = Generate ? REGRESS_REFERENCE_SPP : Case->RaysPerPixel;
+		if(!Generate)
+		{
+			if(!ReadImage(Path, &Reference))
+			{
+				printf("%-8s couldn't read the reference %s\n", Case->SceneName, Path);
+				++FailCount;
+				continue;
+			}
+			Width = Reference.Width;
+			Height = Reference.Height;
+		}
+
+		memory_arena SceneArena = {};
+		InitializeArena(&SceneArena, SceneArenaSize, SceneMemory);
+		world World = {};
+		BuildScene(&World, &SceneArena, Case->SceneName, Width, Height);
+
+		image Image = AllocateImage(Width, Height);
+		BuildTileWorkOrders(&WorkQueue, &Image, &World, TileDim, RaysPerPixel, REGRESS_MAX_BOUNCES, CaseLaneWidth);
+		WorkQueue.FrameIndex = 0;
+
+		f64 RenderStart = GetWallClock();
+		RenderFrame(&WorkQueue, false);
+		f64 RenderSeconds = GetWallClock() - RenderStart;
+		f64 RaysPerSecond = WorkQueue.RaysCast / RenderSeconds;
+		u64 Hash = HashImage(&Image, IMAGE_HASH_BASIS);
+
+		if(Generate)
+		{
+			WriteImage(&Image, Path);
+			printf("%-8s %ux%u, %u spp, %u lanes, %.2f Mrays/s -> %s\n", Case->SceneName, Width, Height,
+			       RaysPerPixel, CaseLaneWidth, RaysPerSecond / 1000000.0, Path);
+		}
+		else
+		{
+			image_error Error = CompareImages(&Image, &Reference);
+			b32 Passed = ((Error.PSNR >= Case->MinPSNR) &&
+			              (Error.SSIM >= Case->MinSSIM) &&
+			              (Error.RelMSE <= Case->MaxRelMSE));
+			if(!Passed)
+			{
+				++FailCount;
+			}
+
+			printf("%-8s %ux%u, %u spp, %u lanes: PSNR %.2f dB (min %.1f), SSIM %.4f (min %.2f), "
+			       "rel. MSE %.5f (max %.3f), %.2f Mrays/s, %s\n",
+			       Case->SceneName, Width, Height, RaysPerPixel, CaseLaneWidth,
+			       Error.PSNR, Case->MinPSNR, Error.SSIM, Case->MinSSIM, Error.RelMSE, Case->MaxRelMSE,
+			       RaysPerSecond / 1000000.0, Passed ? "ok" : "FAILED");
+			if(Log)
+			{
+				fprintf(Log, "%s,%u,%u,%u,%u,%f,%f,%f,%.0f,%016llx\n", Case->SceneName, Width, Height,
+				        RaysPerPixel, CaseLaneWidth, Error.PSNR, Error.SSIM, Error.RelMSE, RaysPerSecond,
+				        (unsigned long long)Hash);
+			}
+		}
+		fflush(stdout);
+
+		FreeImage(&Image);
+		FreeImage(&Reference);
+	}
+
+	memory_arena CheckArena = {};
+	InitializeArena(&CheckArena, SceneArenaSize, SceneMemory);
+	++CaseCount;
+	if(!CheckDegenerateHierarchy(&CheckArena))
+	{
+		++FailCount;
+	}
+
+	if(Log)
+	{
+		fclose(Log);
+	}
+
+	printf("Regression: %u of %u cases passed\n", CaseCount - FailCount, CaseCount);
+	s32 Result = FailCount ? 1 : 0;
+	return Result;
+}
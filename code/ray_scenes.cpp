@@ -0,0 +1,399 @@
+/*@H
+* File: ray_scenes.cpp
+* Author: Jesse Calvert
+* Created: October 19, 2026, 12:16
+* Last modified: October 19, 2026, 17:37
+*/
+
+internal void
+SetCameraFilm(world *World, u32 ImageWidth, u32 ImageHeight)
+{
+	f32 FilmD = 1.0f;
+	World->FilmP = World->CameraP - FilmD*World->CameraZ;
+	f32 FilmW = 1.0f;
+	f32 FilmH = 1.0f;
+	if(ImageWidth > ImageHeight)
+	{
+		FilmH = (f32)ImageHeight / (f32)ImageWidth;
+	}
+
+	else if(ImageWidth < ImageHeight)
+	{
+		FilmW = (f32)ImageWidth / (f32)ImageHeight;
+	}
+	World->HalfFilmW = 0.5f * FilmW;
+	World->HalfFilmH = 0.5f * FilmH;
+}
+
+internal void
+InitializeCamera(world *World, v3 CameraP, v3 LookAt, u32 ImageWidth, u32 ImageHeight)
+{
+	World->CameraP = CameraP;
+	World->CameraZ = NOZ(CameraP - LookAt);
+	World->CameraX = NOZ(Cross(V3(0.0f, 1.0f, 0.0f), World->CameraZ));
+	World->CameraY = NOZ(Cross(World->CameraZ, World->CameraX));
+	SetCameraFilm(World, ImageWidth, ImageHeight);
+}
+
+internal void
+BuildSpheresScene(world *World, memory_arena *Arena, u32 ImageWidth, u32 ImageHeight)
+{
+	World->NullMaterial.EmitColor = V3(0.1f, 0.1f, 0.1f);
+	World->LightDirection = NOZ(V3(1.0f, -1.0f, -1.0f));
+	World->LightColor = V3(0.7f, 0.7f, 0.7f);
+
+	object *Plane = World->Objects + World->ObjectCount++;
+	Plane->Type = Object_Plane;
+	Plane->Plane.Normal = V3(0.0f, 1.0f, 0.0f);
+	Plane->Plane.Offset = 0.0f;
+	Plane->Material.ReflectionColor = V3(0.1f, 0.1f, 0.1f);
+	Plane->Material.Specularity = 0.05f;
+
+	f32 Radius = 1.0f;
+	v3 Start = V3(-4.0f, 1.0f, -4.0f);
+	v3 End = V3(4.0f, 1.0f, 4.0f);
+	u32 Rows = 3;
+	u32 Columns = 4;
+	u32 SphereCount = Rows*Columns;
+	f32 dX = (End.x - Start.x) / (Columns - 1);
+	f32 dZ = (End.z - Start.z) / (Rows - 1);
+
+	u32 Index = 0;
+	for(u32 Z = 0;
+		Z < Rows;
+		++Z)
+	{
+		for(u32 X = 0;
+			X < Columns;
+			++X)
+		{
+			f32 T = (f32)Index/(SphereCount - 1);
+
+			object *Sphere = World->Objects + World->ObjectCount++;
+			Sphere->Type = Object_Sphere;
+			Sphere->Sphere.Center = Start + V3(X*dX, 0.0f, Z*dZ);
+			Sphere->Sphere.Radius = Radius;
+			Sphere->Material.ReflectionColor = Lerp(V3(0.9f, 0.1f, 0.1f), T, V3(0.5f, 0.5f, 0.1f));
+			Sphere->Material.Specularity = Lerp(1.0f, T, 0.00f);
+
+			if(Z == 1 && X == 2)
+			{
+				Sphere->Sphere.Center.y += 0.6f;
+				Sphere->Material.ReflectionColor = V3(0.1f, 0.1f, 0.6f);
+				Sphere->Material.Specularity = 1.0f;
+				Sphere->Material.Transparent = true;
+				Sphere->Material.RefractionIndex = 1.52f; // NOTE: Glass
+			}
+			if(Z == 1 && X == 1)
+			{
+				// NOTE: Too dim to be worth aiming at (see FindEmitters), so
+				// only the bounce ever finds it. The beacon scene is the
+				// one lit by an emitter that is.
+				Sphere->Material.EmitColor = 2.0f*Sphere->Material.ReflectionColor;
+			}
+
+			++Index;
+		}
+	}
+
+	InitializeCamera(World, V3(0.0f, 6.0f, 10.0f), V3(0.0f, 0.0f, 0.0f), ImageWidth, ImageHeight);
+}
+
+// NOTE: The spheres scene with the sun and sky off, lit only by its glowing
+// sphere, shrunk to a bead and made fifty times brighter. That's the kind of
+// emitter FindEmitters picks to aim at, so this scene is the one that runs
+// direct emitter sampling and its balance heuristic weights.
+internal void
+BuildBeaconScene(world *World, memory_arena *Arena, u32 ImageWidth, u32 ImageHeight)
+{
+	BuildSpheresScene(World, Arena, ImageWidth, ImageHeight);
+	World->NullMaterial.EmitColor = V3(0.0f, 0.0f, 0.0f);
+	World->LightColor = V3(0.0f, 0.0f, 0.0f);
+
+	for(u32 ObjectIndex = 0;
+		ObjectIndex < World->ObjectCount;
+		++ObjectIndex)
+	{
+		object *Object = World->Objects + ObjectIndex;
+		if(LengthSq(Object->Material.EmitColor) > 0.0f)
+		{
+			Object->Sphere.Radius = 0.15f;
+			Object->Material.EmitColor = 50.0f*Object->Material.EmitColor;
+		}
+	}
+}
+
+internal prototype *
+BuildTreePrototype(memory_arena *Arena)
+{
+	u32 TrunkSegmentCount = 5;
+	u32 LeafClusterCount = 40;
+	prototype *Tree = PushPrototype(Arena, TrunkSegmentCount + LeafClusterCount);
+
+	for(u32 SegmentIndex = 0;
+		SegmentIndex < TrunkSegmentCount;
+		++SegmentIndex)
+	{
+		object *Segment = AddObject(Tree);
+		Segment->Type = Object_Sphere;
+		Segment->Sphere = Sphere(V3(0.0f, 0.2f + 0.25f*SegmentIndex, 0.0f), 0.18f);
+		Segment->Material.ReflectionColor = V3(0.3f, 0.18f, 0.08f);
+	}
+
+	for(u32 ClusterIndex = 0;
+		ClusterIndex < LeafClusterCount;
+		++ClusterIndex)
+	{
+		// NOTE: Scatter leaf clusters through a cone that narrows towards the top.
+		f32 Height = (f32)ClusterIndex/(LeafClusterCount - 1);
+		f32 Spread = 0.9f*(1.0f - Height);
+		f32 Angle = 2.4f*ClusterIndex;
+		v3 P = V3(Spread*Cos(Angle), 1.3f + 1.6f*Height, Spread*Sin(Angle));
+
+		object *Leaves = AddObject(Tree);
+		Leaves->Type = Object_Sphere;
+		Leaves->Sphere = Sphere(P, 0.45f - 0.25f*Height);
+		Leaves->Material.ReflectionColor = Lerp(V3(0.1f, 0.35f, 0.08f), Height, V3(0.25f, 0.55f, 0.1f));
+		Leaves->Material.Specularity = 0.1f;
+	}
+
+	FinalizePrototype(Arena, Tree);
+	return Tree;
+}
+
+internal void
+BuildForestScene(world *World, memory_arena *Arena, u32 ImageWidth, u32 ImageHeight)
+{
+	World->NullMaterial.EmitColor = V3(0.35f, 0.45f, 0.6f);
+	World->LightDirection = NOZ(V3(1.0f, -1.5f, -0.5f));
+	World->LightColor = V3(0.8f, 0.75f, 0.6f);
+
+	object *Ground = World->Objects + World->ObjectCount++;
+	Ground->Type = Object_Plane;
+	Ground->Plane.Normal = V3(0.0f, 1.0f, 0.0f);
+	Ground->Plane.Offset = 0.0f;
+	Ground->Material.ReflectionColor = V3(0.25f, 0.2f, 0.1f);
+
+	prototype *Tree = BuildTreePrototype(Arena);
+
+	u32 TreesPerSide = 100;
+	f32 Spacing = 2.0f;
+	f32 HalfExtent = 0.5f*Spacing*(TreesPerSide - 1);
+	ReserveInstances(Arena, World, TreesPerSide*TreesPerSide);
+	for(u32 Z = 0;
+		Z < TreesPerSide;
+		++Z)
+	{
+		for(u32 X = 0;
+			X < TreesPerSide;
+			++X)
+		{
+			v3 P = V3(X*Spacing - HalfExtent + 0.6f*RandomBilateral(),
+			          0.0f,
+			          Z*Spacing - HalfExtent + 0.6f*RandomBilateral());
+			quaternion Rotation = RotationQuaternion(V3(0.0f, 1.0f, 0.0f), Pi32*RandomBilateral());
+			f32 Scale = 0.8f + 0.5f*RandomUnilateral();
+			AddInstance(World, Tree, TransformationMat4(P, Rotation, V3(Scale, Scale, Scale)));
+		}
+	}
+
+	BuildInstanceHierarchy(Arena, World);
+
+	InitializeCamera(World, V3(0.0f, 9.0f, HalfExtent + 12.0f), V3(0.0f, 0.0f, 0.5f*HalfExtent), ImageWidth, ImageHeight);
+}
+
+struct swarm_body
+{
+	f32 OrbitRadius;
+	f32 OrbitHeight;
+	f32 OrbitPhase;
+	f32 OrbitSpeed;
+
+	v3 SpinAxis;
+	f32 SpinSpeed;
+	f32 Scale;
+};
+
+struct swarm_animation
+{
+	u32 BodyCount;
+	swarm_body *Bodies;
+};
+
+internal mat4
+SwarmBodyTransform(swarm_body *Body, f32 Time)
+{
+	f32 OrbitAngle = Body->OrbitPhase + Body->OrbitSpeed*Time;
+	v3 P = V3(Body->OrbitRadius*Cos(OrbitAngle), Body->OrbitHeight, Body->OrbitRadius*Sin(OrbitAngle));
+	quaternion Rotation = RotationQuaternion(Body->SpinAxis, Body->SpinSpeed*Time);
+	mat4 Result = TransformationMat4(P, Rotation, V3(Body->Scale, Body->Scale, Body->Scale));
+	return Result;
+}
+
+internal SCENE_ANIMATE(AnimateSwarmScene)
+{
+	swarm_animation *Swarm = (swarm_animation *)World->AnimationState;
+	for(u32 BodyIndex = 0;
+		BodyIndex < Swarm->BodyCount;
+		++BodyIndex)
+	{
+		SetInstanceTransform(World, BodyIndex, SwarmBodyTransform(Swarm->Bodies + BodyIndex, Time));
+	}
+}
+
+internal prototype *
+BuildRockPrototype(memory_arena *Arena)
+{
+	u32 LobeCount = 6;
+	prototype *Rock = PushPrototype(Arena, LobeCount + 1);
+
+	object *Core = AddObject(Rock);
+	Core->Type = Object_Sphere;
+	Core->Sphere = Sphere(V3(0.0f, 0.0f, 0.0f), 0.35f);
+	Core->Material.ReflectionColor = V3(0.4f, 0.38f, 0.35f);
+
+	for(u32 LobeIndex = 0;
+		LobeIndex < LobeCount;
+		++LobeIndex)
+	{
+		v3 Offset = V3(0.0f, 0.0f, 0.0f);
+		Offset.E[LobeIndex % 3] = (LobeIndex < 3) ? 0.3f : -0.22f;
+
+		object *Lobe = AddObject(Rock);
+		Lobe->Type = Object_Sphere;
+		Lobe->Sphere = Sphere(Offset, 0.15f + 0.03f*LobeIndex);
+		Lobe->Material.ReflectionColor = V3(0.5f, 0.45f, 0.4f);
+		Lobe->Material.Specularity = 0.2f;
+	}
+
+	FinalizePrototype(Arena, Rock);
+	return Rock;
+}
+
+internal void
+BuildSwarmScene(world *World, memory_arena *Arena, u32 ImageWidth, u32 ImageHeight)
+{
+	World->NullMaterial.EmitColor = V3(0.05f, 0.05f, 0.08f);
+	World->LightDirection = NOZ(V3(0.5f, -1.0f, -0.7f));
+	World->LightColor = V3(0.7f, 0.7f, 0.7f);
+
+	object *Ground = World->Objects + World->ObjectCount++;
+	Ground->Type = Object_Plane;
+	Ground->Plane.Normal = V3(0.0f, 1.0f, 0.0f);
+	Ground->Plane.Offset = 0.0f;
+	Ground->Material.ReflectionColor = V3(0.15f, 0.15f, 0.15f);
+
+	object *Sun = World->Objects + World->ObjectCount++;
+	Sun->Type = Object_Sphere;
+	Sun->Sphere = Sphere(V3(0.0f, 3.0f, 0.0f), 1.5f);
+	Sun->Material.ReflectionColor = V3(0.9f, 0.6f, 0.2f);
+	Sun->Material.EmitColor = V3(1.8f, 1.2f, 0.4f);
+
+	prototype *Rock = BuildRockPrototype(Arena);
+
+	swarm_animation *Swarm = PushStruct(Arena, swarm_animation);
+	Swarm->BodyCount = 4000;
+	Swarm->Bodies = PushArray(Arena, Swarm->BodyCount, swarm_body);
+	World->Animate = AnimateSwarmScene;
+	World->AnimationState = Swarm;
+
+	ReserveInstances(Arena, World, Swarm->BodyCount);
+	for(u32 BodyIndex = 0;
+		BodyIndex < Swarm->BodyCount;
+		++BodyIndex)
+	{
+		swarm_body *Body = Swarm->Bodies + BodyIndex;
+		Body->OrbitRadius = 3.0f + 17.0f*RandomUnilateral();
+		Body->OrbitHeight = 3.0f + 1.5f*RandomBilateral();
+		Body->OrbitPhase = Pi32*RandomBilateral();
+
+		// NOTE: Inner bodies orbit faster, so the swarm shears apart over
+		// time and the hierarchy eventually needs a rebuild.
+		Body->OrbitSpeed = 2.0f/SquareRoot(Body->OrbitRadius);
+		Body->SpinAxis = NOZ(V3(RandomBilateral(), RandomBilateral(), RandomBilateral()));
+		if(LengthSq(Body->SpinAxis) == 0.0f)
+		{
+			Body->SpinAxis = V3(0.0f, 1.0f, 0.0f);
+		}
+		Body->SpinSpeed = 3.0f*RandomBilateral();
+		Body->Scale = 0.5f + 0.7f*RandomUnilateral();
+
+		AddInstance(World, Rock, SwarmBodyTransform(Body, 0.0f));
+	}
+
+	BuildInstanceHierarchy(Arena, World);
+
+	InitializeCamera(World, V3(0.0f, 16.0f, 28.0f), V3(0.0f, 2.0f, 0.0f), ImageWidth, ImageHeight);
+}
+
+// NOTE: A park at night, lit by lanterns strung between the trees, with a
+// spotlight every so often, and a dim moon. The total power is the same
+// however many lights there are, so the image looks about the same for any
+// light count; only the noise and the time should change.
+#define LANTERNS_DEFAULT_LIGHT_COUNT 1000
+#define LANTERNS_TOTAL_INTENSITY 1000.0f
+
+internal void
+BuildLanternsScene(world *World, memory_arena *Arena, u32 LightCount, u32 ImageWidth, u32 ImageHeight)
+{
+	World->NullMaterial.EmitColor = V3(0.01f, 0.012f, 0.025f);
+	World->LightDirection = NOZ(V3(-0.3f, -1.0f, 0.4f));
+	World->LightColor = V3(0.04f, 0.05f, 0.08f);
+
+	object *Ground = World->Objects + World->ObjectCount++;
+	Ground->Type = Object_Plane;
+	Ground->Plane.Normal = V3(0.0f, 1.0f, 0.0f);
+	Ground->Plane.Offset = 0.0f;
+	Ground->Material.ReflectionColor = V3(0.3f, 0.28f, 0.25f);
+
+	prototype *Tree = BuildTreePrototype(Arena);
+
+	u32 TreesPerSide = 16;
+	f32 Spacing = 4.0f;
+	f32 HalfExtent = 0.5f*Spacing*(TreesPerSide - 1);
+	ReserveInstances(Arena, World, TreesPerSide*TreesPerSide);
+	for(u32 Z = 0;
+		Z < TreesPerSide;
+		++Z)
+	{
+		for(u32 X = 0;
+			X < TreesPerSide;
+			++X)
+		{
+			v3 P = V3(X*Spacing - HalfExtent + 1.2f*RandomBilateral(),
+			          0.0f,
+			          Z*Spacing - HalfExtent + 1.2f*RandomBilateral());
+			quaternion Rotation = RotationQuaternion(V3(0.0f, 1.0f, 0.0f), Pi32*RandomBilateral());
+			f32 Scale = 0.8f + 0.5f*RandomUnilateral();
+			AddInstance(World, Tree, TransformationMat4(P, Rotation, V3(Scale, Scale, Scale)));
+		}
+	}
+
+	BuildInstanceHierarchy(Arena, World);
+
+	f32 Intensity = LANTERNS_TOTAL_INTENSITY / LightCount;
+	ReserveLights(Arena, World, LightCount);
+	for(u32 LightIndex = 0;
+		LightIndex < LightCount;
+		++LightIndex)
+	{
+		// NOTE: Lanterns sit on the ground, under the canopies; the
+		// spotlights hang above the treetops and shine down through them.
+		v3 P = V3(HalfExtent*RandomBilateral(), 0.25f + 0.35f*RandomUnilateral(), HalfExtent*RandomBilateral());
+		v3 Color = Intensity*Lerp(V3(1.0f, 0.5f, 0.15f), RandomUnilateral(), V3(1.0f, 0.85f, 0.6f));
+		if((LightIndex % 8) == 0)
+		{
+			P.y = 6.0f;
+			v3 Direction = V3(0.4f*RandomBilateral(), -1.0f, 0.4f*RandomBilateral());
+			AddSpotLight(World, P, Direction, 16.0f*Color, 0.05f, 0.25f, 0.45f);
+		}
+		else
+		{
+			AddPointLight(World, P, Color, 0.05f);
+		}
+	}
+
+	BuildLightTree(Arena, World);
+
+	InitializeCamera(World, V3(0.0f, 12.0f, HalfExtent + 16.0f), V3(0.0f, 0.0f, 0.0f), ImageWidth, ImageHeight);
+}
@@ -0,0 +1,446 @@
+/*@H
+* File: ray_server.cpp
+* Author: Jesse Calvert
+* Created: October 19, 2026, 13:05
+* Last modified: October 19, 2026, 17:27
+*/
+
+// NOTE: A long-lived render server. Scenes are built the first time they're
+// asked for and then stay in memory along with their hierarchies; the thread
+// pool stays parked between requests. Clients connect over loopback, send
+// render requests using the same message framing as the distributed
+// renderer and get tiles streamed back, followed by a summary with the
+// request's timings. Requests are served one at a time in arrival order.
+
+#define MAX_SERVER_SCENES 8
+#define MAX_SERVER_CLIENTS 32
+#define MAX_SERVER_IMAGE_DIM 4096
+
+struct render_request_message
+{
+	u32 RequestID;
+	char SceneName[32];
+	u32 Width;
+	u32 Height;
+	u32 TileDim;
+	u32 RaysPerPixel;
+	u32 MaxBounces;
+	u32 TileFormat;
+
+	// NOTE: Without a camera the scene's own is used.
+	b32 HasCamera;
+	v3 CameraP;
+	v3 CameraX;
+	v3 CameraY;
+	v3 CameraZ;
+};
+
+struct render_done_message
+{
+	u32 RequestID;
+	u32 TileCount;
+	u32 RaysCast;
+	b32 SceneWasWarm;
+	f32 SceneMS;
+	f32 RenderMS;
+	f32 TotalMS;
+};
+
+struct server_scene
+{
+	char Name[32];
+	memory_arena Arena;
+	world World;
+
+	v3 CameraP;
+	v3 CameraX;
+	v3 CameraY;
+	v3 CameraZ;
+};
+
+struct render_server
+{
+	u32 SceneCount;
+	server_scene Scenes[MAX_SERVER_SCENES];
+
+	image Image;
+	work_queue WorkQueue;
+	u32 LaneWidth;
+
+	u32 TileBufferSize;
+	u8 *TileBuffer;
+	b32 TileSent[MAX_TILE_COUNT];
+
+	u32 RequestsServed;
+	f64 TotalLatencyMS;
+};
+
+internal server_scene *
+GetServerScene(render_server *Server, char *Name, u32 Width, u32 Height, b32 *WasWarm)
+{
+	server_scene *Result = 0;
+	for(u32 SceneIndex = 0;
+		SceneIndex < Server->SceneCount;
+		++SceneIndex)
+	{
+		if(strcmp(Server->Scenes[SceneIndex].Name, Name) == 0)
+		{
+			Result = Server->Scenes + SceneIndex;
+		}
+	}
+
+	*WasWarm = (Result != 0);
+	if(!Result && (Server->SceneCount < MAX_SERVER_SCENES))
+	{
+		Result = Server->Scenes + Server->SceneCount++;
+		snprintf(Result->Name, sizeof(Result->Name), "%s", Name);
+
+		memory_index SceneArenaSize = Megabytes(64);
+		InitializeArena(&Result->Arena, SceneArenaSize, AllocateMemory(SceneArenaSize));
+		BuildScene(&Result->World, &Result->Arena, Result->Name, Width, Height);
+
+		Result->CameraP = Result->World.CameraP;
+		Result->CameraX = Result->World.CameraX;
+		Result->CameraY = Result->World.CameraY;
+		Result->CameraZ = Result->World.CameraZ;
+	}
+
+	return Result;
+}
+
+internal void
+ResizeServerImage(render_server *Server, u32 Width, u32 Height, b32 NeedRadiance)
+{
+	image *Image = &Server->Image;
+	if((Image->Width != Width) || (Image->Height != Height))
+	{
+		FreeImage(Image);
+		*Image = AllocateImage(Width, Height);
+	}
+
+	if(NeedRadiance && !Image->Radiance)
+	{
+		AllocateImageRadiance(Image, RadianceLayout_Linear);
+	}
+
+	// NOTE: Worst case one tile is the whole image.
+	u32 TileBufferSize = Image->PixelCount*GetTileBytesPerPixel(TileFormat_Half);
+	if(Server->TileBufferSize < TileBufferSize)
+	{
+		free(Server->TileBuffer);
+		Server->TileBuffer = (u8 *)malloc(TileBufferSize);
+		Server->TileBufferSize = TileBufferSize;
+	}
+}
+
+internal b32
+ServeRenderRequest(render_server *Server, platform_socket Socket, render_request_message *Request)
+{
+	f64 StartTime = GetWallClock();
+
+	Request->SceneName[ArrayCount(Request->SceneName) - 1] = 0;
+	Request->Width = Maximum(Minimum(Request->Width, MAX_SERVER_IMAGE_DIM), 1);
+	Request->Height = Maximum(Minimum(Request->Height, MAX_SERVER_IMAGE_DIM), 1);
+	Request->TileDim = Maximum(Minimum(Request->TileDim, MAX_TILE_DIM), 1);
+	Request->RaysPerPixel = Maximum(Request->RaysPerPixel, 1);
+
+	b32 WasWarm;
+	server_scene *Scene = GetServerScene(Server, Request->SceneName, Request->Width, Request->Height, &WasWarm);
+	if(!Scene)
+	{
+		printf("Request %u: no room for scene %s.\n", Request->RequestID, Request->SceneName);
+		return false;
+	}
+	f64 SceneTime = GetWallClock();
+
+	world *World = &Scene->World;
+	World->CameraP = Request->HasCamera ? Request->CameraP : Scene->CameraP;
+	World->CameraX = Request->HasCamera ? Request->CameraX : Scene->CameraX;
+	World->CameraY = Request->HasCamera ? Request->CameraY : Scene->CameraY;
+	World->CameraZ = Request->HasCamera ? Request->CameraZ : Scene->CameraZ;
+	SetCameraFilm(World, Request->Width, Request->Height);
+
+	ResizeServerImage(Server, Request->Width, Request->Height, (Request->TileFormat == TileFormat_Half));
+	work_queue *WorkQueue = &Server->WorkQueue;
+	BuildTileWorkOrders(WorkQueue, &Server->Image, World, Request->TileDim,
+	                    Request->RaysPerPixel, Request->MaxBounces, Server->LaneWidth);
+
+	// NOTE: The whole frame is posted at once. The main thread sends each
+	// tile as soon as it's finished, and renders one itself whenever there's
+	// nothing to send. Tiles are taken in queue order, so only the ones from
+	// the first unsent tile up to the queue's cursor can be newly finished.
+	// After a failed send the rest are still waited for, since the pool is
+	// writing into the server's image.
+	u32 TileCount = WorkQueue->TileQueueSize;
+	for(u32 TileIndex = 0;
+		TileIndex < TileCount;
+		++TileIndex)
+	{
+		Server->TileSent[TileIndex] = false;
+	}
+
+	f64 RenderStart = GetWallClock();
+	f64 RenderEnd = 0.0;
+	WorkQueue->SplitByNode = false;
+	PostWorkRange(WorkQueue, 0, TileCount);
+
+	b32 Result = true;
+	u32 FirstUnsent = 0;
+	while(FirstUnsent < TileCount)
+	{
+		b32 AnySent = false;
+		u32 OnePastLastTaken = WorkQueue->NextWorkIndex;
+		for(u32 TileIndex = FirstUnsent;
+			TileIndex < OnePastLastTaken;
+			++TileIndex)
+		{
+			tile_work_order *WorkOrder = WorkQueue->TileWorkQueue + TileIndex;
+			if(!Server->TileSent[TileIndex] && WorkOrder->Finished)
+			{
+				if(Result)
+				{
+					tile_message Message = {Request->RequestID, TileIndex};
+					u32 TileSize = EncodeTile(WorkOrder, Request->TileFormat, Server->TileBuffer);
+					Result = SendNetMessage(Socket, Message_Tile, &Message, sizeof(Message), Server->TileBuffer, TileSize);
+				}
+				Server->TileSent[TileIndex] = true;
+				AnySent = true;
+			}
+		}
+
+		while((FirstUnsent < TileCount) && Server->TileSent[FirstUnsent])
+		{
+			++FirstUnsent;
+		}
+
+		if(!RenderEnd && (WorkQueue->TilesCompleted == TileCount))
+		{
+			RenderEnd = GetWallClock();
+		}
+
+		if(!AnySent)
+		{
+			if(WorkQueue->NextWorkIndex < WorkQueue->OnePastLastWorkIndex)
+			{
+				RenderTile(WorkQueue);
+			}
+			else
+			{
+				SleepMS(0);
+			}
+		}
+	}
+	while(WorkQueue->TilesCompleted < TileCount)
+	{
+		SleepMS(0);
+	}
+	if(!RenderEnd)
+	{
+		RenderEnd = GetWallClock();
+	}
+	f64 RenderSeconds = RenderEnd - RenderStart;
+	u32 RaysCast = WorkQueue->RaysCast;
+
+	render_done_message Done = {};
+	Done.RequestID = Request->RequestID;
+	Done.TileCount = WorkQueue->TileQueueSize;
+	Done.RaysCast = RaysCast;
+	Done.SceneWasWarm = WasWarm;
+	Done.SceneMS = (f32)(1000.0*(SceneTime - StartTime));
+	Done.RenderMS = (f32)(1000.0*RenderSeconds);
+	Done.TotalMS = (f32)(1000.0*(GetWallClock() - StartTime));
+	Result = Result && SendNetMessage(Socket, Message_RenderDone, &Done, sizeof(Done));
+
+	++Server->RequestsServed;
+	Server->TotalLatencyMS += Done.TotalMS;
+	printf("Request %u: %s %ux%u, %u spp, scene %s %.2f ms, render %.2f ms, total %.2f ms\n",
+	       Request->RequestID, Request->SceneName, Request->Width, Request->Height, Request->RaysPerPixel,
+	       WasWarm ? "warm" : "built", Done.SceneMS, Done.RenderMS, Done.TotalMS);
+	fflush(stdout);
+
+	return Result;
+}
+
+internal s32
+RunServer(u16 Port, u32 ThreadCount, tile_kernel *TileKernel, u32 LaneWidth)
+{
+	u16 BoundPort = 0;
+	platform_socket Listener = ListenOnPort(Port, true, &BoundPort);
+	if(Listener == InvalidSocket)
+	{
+		printf("Couldn't listen on port %u.\n", Port);
+		return 1;
+	}
+
+	render_server *Server = (render_server *)calloc(1, sizeof(render_server));
+	Server->LaneWidth = LaneWidth;
+	Server->WorkQueue.TileKernel = TileKernel;
+	ThreadStart(&Server->WorkQueue, ThreadCount);
+
+	printf("Serving on port %u\n", BoundPort);
+	fflush(stdout);
+
+	u32 ClientCount = 0;
+	platform_socket Clients[MAX_SERVER_CLIENTS];
+	b32 Running = true;
+	while(Running)
+	{
+		platform_socket Sockets[MAX_SERVER_CLIENTS + 1];
+		b32 Readable[MAX_SERVER_CLIENTS + 1];
+		Sockets[0] = Listener;
+		for(u32 ClientIndex = 0;
+			ClientIndex < ClientCount;
+			++ClientIndex)
+		{
+			Sockets[ClientIndex + 1] = Clients[ClientIndex];
+		}
+		u32 SocketCount = ClientCount + 1;
+		WaitForReadable(Sockets, Readable, SocketCount, 1000);
+
+		for(u32 SocketIndex = SocketCount - 1;
+			SocketIndex > 0;
+			--SocketIndex)
+		{
+			if(Readable[SocketIndex])
+			{
+				u32 ClientIndex = SocketIndex - 1;
+				message_header Header;
+				render_request_message Request;
+				b32 KeepClient = ReceiveNetMessage(Clients[ClientIndex], &Header, &Request, sizeof(Request));
+				if(KeepClient)
+				{
+					if((Header.Type == Message_RenderRequest) && (Header.Size == sizeof(Request)))
+					{
+						KeepClient = ServeRenderRequest(Server, Clients[ClientIndex], &Request);
+					}
+					else if(Header.Type == Message_Shutdown)
+					{
+						Running = false;
+					}
+					else
+					{
+						KeepClient = false;
+					}
+				}
+
+				if(!KeepClient)
+				{
+					CloseConnection(Clients[ClientIndex]);
+					Clients[ClientIndex] = Clients[--ClientCount];
+				}
+			}
+		}
+
+		if(Readable[0])
+		{
+			// NOTE: Requests can take a while; a generous timeout only guards
+			// against clients that stall halfway through a message.
+			platform_socket Client = AcceptConnection(Listener, 10000);
+			if(Client != InvalidSocket)
+			{
+				if(ClientCount < MAX_SERVER_CLIENTS)
+				{
+					Clients[ClientCount++] = Client;
+				}
+				else
+				{
+					CloseConnection(Client);
+				}
+			}
+		}
+	}
+
+	for(u32 ClientIndex = 0;
+		ClientIndex < ClientCount;
+		++ClientIndex)
+	{
+		CloseConnection(Clients[ClientIndex]);
+	}
+	CloseConnection(Listener);
+
+	printf("Served %u requests, %f ms average latency\n", Server->RequestsServed,
+	       Server->RequestsServed ? Server->TotalLatencyMS/Server->RequestsServed : 0.0);
+	return 0;
+}
+
+// NOTE: Sends RequestCount copies of the request back to back and prints how
+// long each one took as seen from the client; the last image is written out.
+internal s32
+RunServerClient(u16 Port, render_request_message *Request, u32 RequestCount, b32 ShutdownServer)
+{
+	platform_socket Socket = ConnectToHost("127.0.0.1", Port, 0);
+	if(Socket == InvalidSocket)
+	{
+		printf("Couldn't connect to a server on port %u.\n", Port);
+		return 1;
+	}
+
+	image Image = AllocateImage(Request->Width, Request->Height);
+	work_queue *Tiles = (work_queue *)calloc(1, sizeof(work_queue));
+	BuildTileWorkOrders(Tiles, &Image, 0, Request->TileDim, 0, 0, 0);
+
+	u32 BufferSize = sizeof(render_done_message) + sizeof(tile_message) +
+		Image.PixelCount*GetTileBytesPerPixel(TileFormat_Half);
+	u8 *Buffer = (u8 *)malloc(BufferSize);
+
+	f64 TotalMS = 0.0;
+	f64 WorstMS = 0.0;
+	b32 Connected = true;
+	for(u32 RequestIndex = 0;
+		Connected && (RequestIndex < RequestCount);
+		++RequestIndex)
+	{
+		f64 StartTime = GetWallClock();
+		f64 FirstTileTime = 0.0;
+		Request->RequestID = RequestIndex;
+		Connected = SendNetMessage(Socket, Message_RenderRequest, Request, sizeof(*Request));
+
+		message_header Header;
+		while(Connected && ReceiveNetMessage(Socket, &Header, Buffer, BufferSize))
+		{
+			if((Header.Type == Message_Tile) && (Header.Size >= sizeof(tile_message)))
+			{
+				tile_message *Message = (tile_message *)Buffer;
+				if(Message->TileIndex < Tiles->TileQueueSize)
+				{
+					if(FirstTileTime == 0.0)
+					{
+						FirstTileTime = GetWallClock();
+					}
+					DecodeTile(Tiles->TileWorkQueue + Message->TileIndex, Request->TileFormat, (u8 *)(Message + 1));
+				}
+			}
+			else if((Header.Type == Message_RenderDone) && (Header.Size == sizeof(render_done_message)))
+			{
+				render_done_message *Done = (render_done_message *)Buffer;
+				f64 LatencyMS = 1000.0*(GetWallClock() - StartTime);
+				TotalMS += LatencyMS;
+				WorstMS = Maximum(WorstMS, LatencyMS);
+				printf("Request %u: %.2f ms (first tile %.2f ms; server: scene %s %.2f ms, render %.2f ms), %u rays\n",
+				       Done->RequestID, LatencyMS, 1000.0*(FirstTileTime - StartTime),
+				       Done->SceneWasWarm ? "warm" : "built", Done->SceneMS, Done->RenderMS, Done->RaysCast);
+				break;
+			}
+			else
+			{
+				Connected = false;
+			}
+		}
+	}
+
+	if(ShutdownServer)
+	{
+		SendNetMessage(Socket, Message_Shutdown, 0, 0);
+	}
+	CloseConnection(Socket);
+
+	if(!Connected)
+	{
+		printf("Lost the connection to the server.\n");
+		return 1;
+	}
+
+	WriteImage(&Image, "test.bmp");
+	printf("Requests: %u, %f ms average, %f ms worst\n", RequestCount, TotalMS/RequestCount, WorstMS);
+	return 0;
+}
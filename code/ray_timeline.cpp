@@ -0,0 +1,205 @@
+/*@H
+* File: ray_timeline.cpp
+* Author: Jesse Calvert
+* Created: October 19, 2026, 13:28
+* Last modified: October 19, 2026, 13:29
+*/
+
+// NOTE: Tile timeline, turned on with -trace FILE. Every thread that renders
+// a tile claims its own event buffer the first time and appends to it
+// without locking; the main thread also records frame and pass spans. At
+// exit the buffers go out as Chrome trace-event JSON, which chrome://tracing
+// and Perfetto both load, one track per thread.
+
+#define MAX_TIMELINE_THREADS 256
+#define TIMELINE_EVENTS_PER_THREAD 65536
+#define MAX_TIMELINE_SPANS 16384
+
+struct timeline_event
+{
+	f64 Start;
+	f64 End;
+	u32 FrameIndex;
+	u32 TileIndex;
+	u32 RayCount;
+};
+
+struct timeline_thread
+{
+	u32 EventCount;
+	u32 DroppedCount;
+	timeline_event *Events;
+};
+
+struct timeline_span
+{
+	char *Name;
+	u32 Index;
+	f64 Start;
+	f64 End;
+};
+
+struct timeline
+{
+	f64 StartTime;
+	volatile u32 FrameIndex;
+
+	volatile u32 ThreadCount;
+	timeline_thread Threads[MAX_TIMELINE_THREADS];
+
+	u32 SpanCount;
+	timeline_span Spans[MAX_TIMELINE_SPANS];
+};
+
+global_variable timeline *Timeline;
+global_variable thread_local timeline_thread *TimelineThread;
+
+inline timeline_thread *
+GetTimelineThread()
+{
+	if(!TimelineThread)
+	{
+		u32 ThreadIndex = LockedAddAndReturnPreviousValue(&Timeline->ThreadCount, 1);
+		Assert(ThreadIndex < MAX_TIMELINE_THREADS);
+		TimelineThread = Timeline->Threads + ThreadIndex;
+		TimelineThread->Events = (timeline_event *)calloc(TIMELINE_EVENTS_PER_THREAD, sizeof(timeline_event));
+	}
+
+	timeline_thread *Result = TimelineThread;
+	return Result;
+}
+
+internal void
+StartTimeline()
+{
+	Timeline = (timeline *)calloc(1, sizeof(timeline));
+	Timeline->StartTime = GetWallClock();
+
+	// NOTE: The caller is the main thread; claiming the first buffer here
+	// keeps it on track 0.
+	GetTimelineThread();
+}
+
+inline void
+RecordTileEvent(f64 Start, f64 End, u32 TileIndex, u32 RayCount)
+{
+	timeline_thread *Thread = GetTimelineThread();
+	if(Thread->EventCount < TIMELINE_EVENTS_PER_THREAD)
+	{
+		timeline_event *Event = Thread->Events + Thread->EventCount++;
+		Event->Start = Start;
+		Event->End = End;
+		Event->FrameIndex = Timeline->FrameIndex;
+		Event->TileIndex = TileIndex;
+		Event->RayCount = RayCount;
+	}
+	else
+	{
+		++Thread->DroppedCount;
+	}
+}
+
+// NOTE: Main thread only, as is the span recording below.
+internal void
+SetTimelineFrame(u32 FrameIndex)
+{
+	if(Timeline)
+	{
+		Timeline->FrameIndex = FrameIndex;
+	}
+}
+
+internal void
+RecordTimelineSpan(char *Name, u32 Index, f64 Start, f64 End)
+{
+	if(Timeline && (Timeline->SpanCount < MAX_TIMELINE_SPANS))
+	{
+		timeline_span *Span = Timeline->Spans + Timeline->SpanCount++;
+		Span->Name = Name;
+		Span->Index = Index;
+		Span->Start = Start;
+		Span->End = End;
+	}
+}
+
+inline f64
+GetTimelineMicroseconds(f64 Time)
+{
+	f64 Result = 1000000.0*(Time - Timeline->StartTime);
+	return Result;
+}
+
+// NOTE: Call once the render threads are idle; their buffers are read
+// without any synchronization.
+internal void
+WriteTimeline(char *Filename)
+{
+	FILE *File = fopen(Filename, "w");
+	if(!File)
+	{
+		printf("Couldn't write the trace to %s.\n", Filename);
+		return;
+	}
+
+	u32 ThreadCount = Minimum(Timeline->ThreadCount, MAX_TIMELINE_THREADS);
+	u32 EventCount = 0;
+	u32 DroppedCount = 0;
+
+	fprintf(File, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	fprintf(File, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"ray\"}}");
+	for(u32 ThreadIndex = 0;
+		ThreadIndex < ThreadCount;
+		++ThreadIndex)
+	{
+		fprintf(File, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,"
+		        "\"args\":{\"name\":\"%s %u\"}}",
+		        ThreadIndex, ThreadIndex ? "worker" : "main", ThreadIndex);
+	}
+
+	for(u32 SpanIndex = 0;
+		SpanIndex < Timeline->SpanCount;
+		++SpanIndex)
+	{
+		timeline_span *Span = Timeline->Spans + SpanIndex;
+		f64 Start = GetTimelineMicroseconds(Span->Start);
+		f64 Duration = GetTimelineMicroseconds(Span->End) - Start;
+		fprintf(File, ",\n{\"name\":\"%s %u\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,"
+		        "\"ts\":%.3f,\"dur\":%.3f}",
+		        Span->Name, Span->Index, Span->Name, MAX_TIMELINE_THREADS, Start, Duration);
+	}
+	if(Timeline->SpanCount)
+	{
+		fprintf(File, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,"
+		        "\"args\":{\"name\":\"frames\"}}", MAX_TIMELINE_THREADS);
+	}
+
+	for(u32 ThreadIndex = 0;
+		ThreadIndex < ThreadCount;
+		++ThreadIndex)
+	{
+		timeline_thread *Thread = Timeline->Threads + ThreadIndex;
+		for(u32 EventIndex = 0;
+			EventIndex < Thread->EventCount;
+			++EventIndex)
+		{
+			timeline_event *Event = Thread->Events + EventIndex;
+			f64 Start = GetTimelineMicroseconds(Event->Start);
+			f64 Duration = GetTimelineMicroseconds(Event->End) - Start;
+			fprintf(File, ",\n{\"name\":\"tile %u\",\"cat\":\"tile\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,"
+			        "\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%u,\"rays\":%u}}",
+			        Event->TileIndex, ThreadIndex, Start, Duration, Event->FrameIndex, Event->RayCount);
+		}
+		EventCount += Thread->EventCount;
+		DroppedCount += Thread->DroppedCount;
+	}
+
+	fprintf(File, "\n]}\n");
+	fclose(File);
+
+	printf("Trace: %u tile events on %u threads -> %s", EventCount, ThreadCount, Filename);
+	if(DroppedCount)
+	{
+		printf(" (%u dropped, buffers full)", DroppedCount);
+	}
+	printf("\n");
+}
@@ -0,0 +1,647 @@
+/*@H
+* File: ray_trace.cpp
+* Author: Jesse Calvert
+* Created: October 19, 2026, 12:58
+* Last modified: October 19, 2026, 16:59
+*/
+
+// NOTE: The single path tracer and the output packing. Like the lane
+// tracer, this is compiled once per instruction set by ray_kernel.cpp.
+
+inline f32
+LinearToSRGB(f32 L)
+{
+	L = Clamp01(L);
+	f32 Result = L < 0.0031308f ? L*12.92f : 1.055f*Pow(L, 1.0f / 2.4f) - 0.055f;
+	return Result;
+}
+
+inline u32
+PackLinear01ToSRGBU32(v3 Color)
+{
+	u32 R = RoundReal32ToUInt32(255.0f*LinearToSRGB(Color.r));
+	u32 G = RoundReal32ToUInt32(255.0f*LinearToSRGB(Color.g));
+	u32 B = RoundReal32ToUInt32(255.0f*LinearToSRGB(Color.b));
+	u32 A = RoundReal32ToUInt32(255.0f);
+	u32 Result = (A << 24) | (R << 16) | (G << 8) | (B << 0);
+	return Result;
+}
+
+// NOTE: Every sample draws from its own series, seeded from the frame, the
+// pixel and which of the pixel's samples it is. Nothing depends on which
+// thread traced it or how the image was cut into tiles, so the same frame
+// renders to the same bits however it's scheduled.
+inline u32
+MixSeed(u32 Value)
+{
+	Value ^= Value >> 16;
+	Value *= 0x7FEB352D;
+	Value ^= Value >> 15;
+	Value *= 0x846CA68B;
+	Value ^= Value >> 16;
+	return Value;
+}
+
+inline u32
+GetSampleSeed(u32 FrameIndex, u32 PixelIndex, u32 SampleIndex)
+{
+	u32 Result = MixSeed(PixelIndex);
+	Result = MixSeed(Result ^ (SampleIndex*0x9E3779B9));
+	Result = MixSeed(Result ^ (FrameIndex*0x85EBCA6B));
+	return Result;
+}
+
+// NOTE: The scalar counterpart of random_series_x8 in ray_lane.cpp.
+struct random_series
+{
+	u32 State;
+	u32 Weyl;
+};
+
+inline random_series
+RandomSeries(u32 Seed)
+{
+	// NOTE: Xorshift never recovers from a zero state.
+	random_series Result;
+	Result.State = Seed ? Seed : 1;
+	Result.Weyl = Seed*0x2545F491;
+	return Result;
+}
+
+inline u32
+RandomNextU32(random_series *Series)
+{
+	u32 State = Series->State;
+	State ^= State << 13;
+	State ^= State >> 17;
+	State ^= State << 5;
+	Series->State = State;
+	Series->Weyl += 362437;
+
+	u32 Result = State + Series->Weyl;
+	return Result;
+}
+
+inline f32
+RandomUnilateral(random_series *Series)
+{
+	// NOTE: Top 23 random bits as the mantissa of a float in [1, 2).
+	u32 Bits = (RandomNextU32(Series) >> 9) | 0x3F800000;
+	f32 Result;
+	memcpy(&Result, &Bits, sizeof(Result));
+	Result -= 1.0f;
+	return Result;
+}
+
+inline f32
+RandomBilateral(random_series *Series)
+{
+	f32 Result = -1.0f + 2.0f*RandomUnilateral(Series);
+	return Result;
+}
+
+struct ray_cast_result
+{
+	f32 ClosestHit;
+	material *MaterialHit;
+	v3a HitNormal;
+};
+
+// NOTE: Kept inline so the v3a arguments stay in registers; passing them
+// through a call splits them into halves on some ABIs.
+inline void
+IntersectObject(object *Object, v3a RayOrigin, v3a RayDirection, ray_cast_result *Result)
+{
+	f32 Tolerance = 0.0001f;
+
+	switch(Object->Type)
+	{
+		case Object_Plane:
+		{
+			plane *Plane = &Object->Plane;
+			v3a PlaneNormal = V3a(Plane->Normal);
+			f32 Denom = Inner(PlaneNormal, RayDirection);
+			if((Denom > Tolerance) || (Denom < -Tolerance))
+			{
+				f32 DistanceToHit = (Plane->Offset - Inner(PlaneNormal, RayOrigin))/Denom;
+				if((DistanceToHit > Tolerance) && (DistanceToHit < Result->ClosestHit))
+				{
+					Result->ClosestHit = DistanceToHit;
+					Result->MaterialHit = &Object->Material;
+					Result->HitNormal = PlaneNormal;
+				}
+			}
+		} break;
+
+		case Object_Sphere:
+		{
+			sphere *Sphere = &Object->Sphere;
+
+			v3a SphereRelativeCenter = RayOrigin - V3a(Sphere->Center);
+
+			f32 a = Inner(RayDirection, RayDirection);
+			f32 b = 2.0f*Inner(RayDirection, SphereRelativeCenter);
+			f32 c = Inner(SphereRelativeCenter, SphereRelativeCenter) - Square(Sphere->Radius);
+			f32 Determinant = Square(b) - 4.0f*a*c;
+			if(Determinant > Tolerance)
+			{
+				f32 DistanceToHitPos = (-b + SquareRoot(Determinant)) / (2.0f*a);
+				f32 DistanceToHitNeg = (-b - SquareRoot(Determinant)) / (2.0f*a);
+
+				f32 DistanceToHit = DistanceToHitPos;
+				if((DistanceToHitNeg > Tolerance) && (DistanceToHitNeg < DistanceToHitPos))
+				{
+					DistanceToHit = DistanceToHitNeg;
+				}
+
+				if((DistanceToHit > Tolerance) && (DistanceToHit < Result->ClosestHit))
+				{
+					Result->ClosestHit = DistanceToHit;
+					Result->MaterialHit = &Object->Material;
+					Result->HitNormal = NOZ(SphereRelativeCenter + Result->ClosestHit*RayDirection);
+				}
+			}
+		} break;
+
+		InvalidDefaultCase;
+	}
+}
+
+inline v3a
+InverseDirection(v3a RayDirection)
+{
+	// NOTE: Zero components become infinities, which the slab test handles.
+#if RAY_SIMD_MATH
+	v3a Result;
+	Result.W = _mm_div_ps(_mm_set1_ps(1.0f), RayDirection.W);
+#else
+	v3a Result = V3a(1.0f/RayDirection.x, 1.0f/RayDirection.y, 1.0f/RayDirection.z);
+#endif
+	return Result;
+}
+
+internal void
+IntersectPrototype(prototype *Prototype, v3a RayOrigin, v3a RayDirection, ray_cast_result *Result)
+{
+	bvh *Hierarchy = &Prototype->Hierarchy;
+	v3a InvRayDirection = InverseDirection(RayDirection);
+
+	u32 Stack[BVH_MAX_DEPTH];
+	u32 StackCount = 0;
+	Stack[StackCount++] = 0;
+	while(StackCount)
+	{
+		bvh_node *Node = Hierarchy->Nodes + Stack[--StackCount];
+		if(RayIntersectsBounds(Node->Bounds, RayOrigin, InvRayDirection, Result->ClosestHit))
+		{
+			if(Node->Count)
+			{
+				for(u32 Index = Node->FirstIndex;
+					Index < Node->FirstIndex + Node->Count;
+					++Index)
+				{
+					IntersectObject(Prototype->Objects + Hierarchy->Indices[Index], RayOrigin, RayDirection, Result);
+				}
+			}
+			else
+			{
+				Assert(StackCount + 2 <= ArrayCount(Stack));
+				Stack[StackCount++] = Node->FirstIndex + 1;
+				Stack[StackCount++] = Node->FirstIndex;
+			}
+		}
+	}
+}
+
+internal void
+IntersectInstances(world *World, v3a RayOrigin, v3a RayDirection, ray_cast_result *Result)
+{
+	bvh *Hierarchy = &World->InstanceHierarchy;
+	v3a InvRayDirection = InverseDirection(RayDirection);
+
+	u32 Stack[BVH_MAX_DEPTH];
+	u32 StackCount = 0;
+	Stack[StackCount++] = 0;
+	while(StackCount)
+	{
+		bvh_node *Node = Hierarchy->Nodes + Stack[--StackCount];
+		if(RayIntersectsBounds(Node->Bounds, RayOrigin, InvRayDirection, Result->ClosestHit))
+		{
+			if(Node->Count)
+			{
+				for(u32 Index = Node->FirstIndex;
+					Index < Node->FirstIndex + Node->Count;
+					++Index)
+				{
+					instance *Instance = World->Instances + Hierarchy->Indices[Index];
+
+					// NOTE: The object space direction is deliberately left
+					// unnormalized so hit distances stay in world units.
+					v3a ObjectRayOrigin = TransformPoint(Instance->WorldToObject, RayOrigin);
+					v3a ObjectRayDirection = TransformVector(Instance->WorldToObject, RayDirection);
+
+					ray_cast_result InstanceResult = {};
+					InstanceResult.ClosestHit = Result->ClosestHit;
+					IntersectPrototype(Instance->Prototype, ObjectRayOrigin, ObjectRayDirection, &InstanceResult);
+					if(InstanceResult.MaterialHit)
+					{
+						Result->ClosestHit = InstanceResult.ClosestHit;
+						Result->MaterialHit = InstanceResult.MaterialHit;
+						Result->HitNormal = NOZ(TransformNormal(Instance->WorldToObject, InstanceResult.HitNormal));
+					}
+				}
+			}
+			else
+			{
+				Assert(StackCount + 2 <= ArrayCount(Stack));
+				Stack[StackCount++] = Node->FirstIndex + 1;
+				Stack[StackCount++] = Node->FirstIndex;
+			}
+		}
+	}
+}
+
+// NOTE: Only hits nearer than MaxDistance are found.
+internal ray_cast_result
+SingleRayCast(world *World, v3a RayOrigin, v3a RayDirection, f32 MaxDistance)
+{
+	Assert(LengthSq(RayDirection) != 0.0f);
+
+	ray_cast_result Result = {};
+	Result.ClosestHit = MaxDistance;
+
+	for(u32 ObjectIndex = 0;
+		ObjectIndex < World->ObjectCount;
+		++ObjectIndex)
+	{
+		IntersectObject(World->Objects + ObjectIndex, RayOrigin, RayDirection, &Result);
+	}
+
+	if(World->InstanceCount)
+	{
+		IntersectInstances(World, RayOrigin, RayDirection, &Result);
+	}
+
+	return Result;
+}
+
+// NOTE: Reflects or refracts off a transparent surface, picking between them
+// by the Fresnel terms, and returns the new direction. InsideObject flips
+// when the ray goes through.
+inline v3a
+ScatterTransparent(material *Material, v3a RayDirection, v3a HitNormal, f32 CosIncidentAngle, v3a PureBounce,
+                   b32 *InsideObject, random_series *Series)
+{
+	v3a Result = PureBounce;
+	f32 RefractionIndexRatio = *InsideObject ? Material->RefractionIndex : 1.0f/Material->RefractionIndex;
+	f32 Radical = 1.0f - Square(RefractionIndexRatio)*(1.0f - Square(CosIncidentAngle));
+	if(Radical >= 0.0f)
+	{
+		v3a Refraction = RefractionIndexRatio*RayDirection +
+			(RefractionIndexRatio*CosIncidentAngle - SquareRoot(Radical))*HitNormal;
+		f32 CosRefractionAngle = Inner(-Refraction, HitNormal);
+		f32 OldRefIndex = *InsideObject ? Material->RefractionIndex : 1.0f;
+		f32 NewRefIndex = *InsideObject ? 1.0f : Material->RefractionIndex;
+		f32 FresnelParallel = Square((NewRefIndex*CosIncidentAngle - OldRefIndex*CosRefractionAngle)/(NewRefIndex*CosIncidentAngle + OldRefIndex*CosRefractionAngle));
+		f32 FresnelPerp = Square((OldRefIndex*CosRefractionAngle - NewRefIndex*CosIncidentAngle)/(OldRefIndex*CosRefractionAngle + NewRefIndex*CosIncidentAngle));
+
+		f32 ReflectRatio = 0.5f*(FresnelParallel + FresnelPerp);
+		b32 Reflected = (RandomUnilateral(Series) < ReflectRatio);
+		if(!Reflected)
+		{
+			Result = Refraction;
+			*InsideObject = !*InsideObject;
+		}
+	}
+	// NOTE: Otherwise, total internal reflection.
+
+	return Result;
+}
+
+internal v3a
+RayCast(world *World, v3a RayOrigin, v3a RayDirection, u32 MaxBounces,
+        random_series *Series, volatile u32 *RaysCast)
+{
+	TIMED_ZONE(ProfileZone_RayCast);
+
+	v3a Result = {};
+	v3a Attenuation = V3a(1.0f, 1.0f, 1.0f);
+	b32 InsideObject = false;
+	u32 RayCount = 0;
+
+	// NOTE: Where the last bounce left from and what it bounced off, if it
+	// was rough, for weighing an emitter it finds against aiming at it
+	// directly; see ray_lights.cpp. How likely its direction was only gets
+	// worked out if something needs it.
+	b32 LastBounceRough = false;
+	v3a LastBounceP = {};
+	v3 LastBounceNormal = {};
+	v3 LastBounceMirror = {};
+	f32 LastBounceSpecularity = 0.0f;
+
+	// NOTE: Matte bounces so far, and while the radiance cache is being
+	// filled, the matte vertices to add to it; see ray_radiance_cache.cpp.
+	radiance_cache *Cache = World->RadianceCache;
+	u32 MatteBounceCount = 0;
+	u32 CacheVertexCount = 0;
+	radiance_cache_vertex CacheVertices[RADIANCE_CACHE_MAX_VERTICES];
+
+	for(u32 BounceIndex = 0;
+		BounceIndex < MaxBounces;
+		++BounceIndex)
+	{
+		++RayCount;
+		BEGIN_TIMED_ZONE(IntersectionZone, BounceIndex ? ProfileZone_SecondaryIntersection : ProfileZone_PrimaryIntersection);
+		ray_cast_result RayCastResult = SingleRayCast(World, RayOrigin, RayDirection, Real32Maximum);
+		END_TIMED_ZONE(IntersectionZone);
+
+		f32 ClosestHit = RayCastResult.ClosestHit;
+		material *MaterialHit = RayCastResult.MaterialHit;
+		v3a HitNormal = RayCastResult.HitNormal;
+
+		b32 BouncedRough = LastBounceRough;
+		LastBounceRough = false;
+
+		if(MaterialHit)
+		{
+			v3a NewRayOrigin = RayOrigin + ClosestHit*RayDirection;
+			f32 CosIncidentAngle = Inner(-RayDirection, HitNormal);
+			if(CosIncidentAngle < 0.0f) {CosIncidentAngle = -CosIncidentAngle;}
+			v3a PureBounce = RayDirection + 2.0f*CosIncidentAngle*HitNormal;
+
+			if(MaterialHit->Transparent)
+			{
+				TIMED_ZONE(ProfileZone_TransparentFresnel);
+				RayOrigin = NewRayOrigin;
+				RayDirection = ScatterTransparent(MaterialHit, RayDirection, HitNormal, CosIncidentAngle, PureBounce,
+				                                  &InsideObject, Series);
+			}
+			else
+			{
+				Attenuation = Hadamard(Attenuation, CosIncidentAngle*V3a(MaterialHit->ReflectionColor));
+
+				if(Cache && (MaterialHit->Specularity <= RADIANCE_CACHE_MAX_SPECULARITY))
+				{
+					v3a ShadingNormal = (Inner(RayDirection, HitNormal) > 0.0f) ? -HitNormal : HitNormal;
+					u64 Key = GetRadianceCacheKey(Cache, V3(NewRayOrigin), V3(ShadingNormal));
+					if(Cache->Filling)
+					{
+						if((MatteBounceCount >= Cache->LookupBounce) &&
+						   (CacheVertexCount < ArrayCount(CacheVertices)))
+						{
+							radiance_cache_vertex *Vertex = CacheVertices + CacheVertexCount++;
+							Vertex->Key = Key;
+							Vertex->Attenuation = V3(Attenuation);
+							Vertex->ResultBefore = V3(Result);
+						}
+					}
+					else if(MatteBounceCount >= Cache->LookupBounce)
+					{
+						v3 Cached;
+						if(LookupRadianceCache(Cache, Key, &Cached))
+						{
+							Result += Hadamard(Attenuation, V3a(Cached));
+							break;
+						}
+					}
+					++MatteBounceCount;
+				}
+
+				// NOTE: Shadow ray, to the sun or to one of the lights; see
+				// ray_lights.cpp.
+				BEGIN_TIMED_ZONE(ShadowZone, ProfileZone_ShadowRay);
+				f32 SunProbability = GetSunProbability(World);
+				f32 LightSelect = 0.0f;
+				if(World->LightCount)
+				{
+					LightSelect = RandomUnilateral(Series);
+				}
+				v3a RandomDirection = NOZ(V3a(RandomBilateral(Series), RandomBilateral(Series), RandomBilateral(Series)));
+
+				b32 HasLight = true;
+				v3a LightDirection;
+				f32 LightDistance = Real32Maximum;
+				v3a LightRadiance;
+				if(LightSelect < SunProbability)
+				{
+					LightDirection = NOZ(-V3a(World->LightDirection) + 0.1f*RandomDirection);
+					LightRadiance = (1.0f/SunProbability)*V3a(World->LightColor);
+				}
+				else
+				{
+					v3a ShadingNormal = (Inner(RayDirection, HitNormal) > 0.0f) ? -HitNormal : HitNormal;
+					light_sample Sample;
+					HasLight = SampleLightTree(World, V3(NewRayOrigin), V3(ShadingNormal),
+					                           RescaleSelect(LightSelect, SunProbability, false),
+					                           V3(RandomDirection), &Sample);
+					LightDirection = V3a(Sample.Direction);
+					LightDistance = Sample.Distance;
+					LightRadiance = V3a(Sample.Radiance);
+				}
+
+				if(HasLight)
+				{
+					++RayCount;
+					ray_cast_result ShadowRayCast = SingleRayCast(World, NewRayOrigin, LightDirection, LightDistance);
+					if(!ShadowRayCast.MaterialHit)
+					{
+						Result += Hadamard(Attenuation, LightRadiance);
+					}
+				}
+
+				// NOTE: Emitter ray
+				f32 Specularity = MaterialHit->Specularity;
+				b32 Rough = (Specularity < MIS_MAX_SPECULARITY);
+				if(World->EmitterCount && Rough)
+				{
+					f32 EmitterSelect = RandomUnilateral(Series);
+					f32 EmitterU = RandomUnilateral(Series);
+					f32 EmitterV = RandomUnilateral(Series);
+					emitter_sample Sample;
+					f32 BounceProbability = 0.0f;
+					if(SampleEmitter(World, V3(NewRayOrigin), EmitterSelect, EmitterU, EmitterV, &Sample))
+					{
+						BounceProbability = GetBounceProbability(Sample.Direction, V3(HitNormal), V3(PureBounce), Specularity);
+					}
+
+					// NOTE: Directions the bounce can't take get no share, so
+					// there's no point tracing them.
+					if(BounceProbability > 0.0f)
+					{
+						++RayCount;
+						ray_cast_result EmitterRayCast = SingleRayCast(World, NewRayOrigin, V3a(Sample.Direction), Real32Maximum);
+						if(EmitterRayCast.MaterialHit == &Sample.Emitter->Material)
+						{
+							f32 Weight = GetBalanceWeight(BounceProbability, Sample.Probability);
+							v3 Radiance = GetEmitterRadiance(Sample.Emitter, Sample.Direction, V3(EmitterRayCast.HitNormal));
+							Result += Weight*Hadamard(Attenuation, V3a(Radiance));
+						}
+					}
+				}
+
+				// NOTE: Environment ray; see ray_environment.cpp.
+				if(World->Environment)
+				{
+					f32 EnvironmentU = RandomUnilateral(Series);
+					f32 EnvironmentV = RandomUnilateral(Series);
+					environment_sample Sample;
+					f32 BounceProbability = 0.0f;
+					if(Rough && SampleEnvironment(World->Environment, EnvironmentU, EnvironmentV, &Sample))
+					{
+						BounceProbability = GetBounceProbability(Sample.Direction, V3(HitNormal), V3(PureBounce), Specularity);
+					}
+
+					if(BounceProbability > 0.0f)
+					{
+						++RayCount;
+						ray_cast_result EnvironmentRayCast = SingleRayCast(World, NewRayOrigin, V3a(Sample.Direction), Real32Maximum);
+						if(!EnvironmentRayCast.MaterialHit)
+						{
+							f32 Weight = GetBalanceWeight(BounceProbability, Sample.Probability);
+							Result += Weight*Hadamard(Attenuation, V3a(Sample.Radiance));
+						}
+					}
+				}
+				END_TIMED_ZONE(ShadowZone);
+
+				// NOTE: Light from the sun and the lights by way of glass or a
+				// mirror; see ray_caustics.cpp.
+				if(World->Caustics && Rough)
+				{
+					v3a ShadingNormal = (Inner(RayDirection, HitNormal) > 0.0f) ? -HitNormal : HitNormal;
+					v3 Caustic = GetCausticRadiance(World->Caustics, V3(NewRayOrigin), V3(ShadingNormal));
+					Result += Hadamard(Attenuation, V3a(Caustic));
+				}
+
+				f32 EmitWeight = 1.0f;
+				if(BouncedRough && (LengthSq(MaterialHit->EmitColor) > 0.0f))
+				{
+					object *Emitter = FindEmitter(World, MaterialHit);
+					f32 EmitterProbability = Emitter ? GetEmitterProbability(World, Emitter, V3(LastBounceP)) : 0.0f;
+					if(EmitterProbability > 0.0f)
+					{
+						f32 BounceProbability = GetBounceProbability(V3(RayDirection), LastBounceNormal, LastBounceMirror,
+						                                             LastBounceSpecularity);
+						EmitWeight = GetBalanceWeight(BounceProbability, EmitterProbability);
+					}
+				}
+				Result += EmitWeight*Hadamard(Attenuation, V3a(MaterialHit->EmitColor));
+
+				TIMED_ZONE(ProfileZone_BounceSampling);
+				RayOrigin = NewRayOrigin;
+				v3a RandomBounce = NOZ(V3a(RandomBilateral(Series), RandomBilateral(Series), RandomBilateral(Series)));
+				if(Inner(RandomBounce, HitNormal) < 0)
+				{
+					RandomBounce = -RandomBounce;
+				}
+				RayDirection = NOZ(Lerp(RandomBounce, Specularity, PureBounce));
+
+				if((World->EmitterCount || World->Environment) && Rough)
+				{
+					LastBounceRough = true;
+					LastBounceP = NewRayOrigin;
+					LastBounceNormal = V3(HitNormal);
+					LastBounceMirror = V3(PureBounce);
+					LastBounceSpecularity = Specularity;
+				}
+			}
+		}
+		else
+		{
+			v3a Background = V3a(World->NullMaterial.EmitColor);
+			if(World->Environment)
+			{
+				f32 EnvironmentProbability = 0.0f;
+				v3 Radiance = GetEnvironmentRadiance(World->Environment, V3(RayDirection),
+				                                     BouncedRough ? &EnvironmentProbability : 0);
+				f32 EnvironmentWeight = 1.0f;
+				if(BouncedRough)
+				{
+					f32 BounceProbability = GetBounceProbability(V3(RayDirection), LastBounceNormal, LastBounceMirror,
+					                                             LastBounceSpecularity);
+					EnvironmentWeight = GetBalanceWeight(BounceProbability, EnvironmentProbability);
+				}
+				Background = EnvironmentWeight*V3a(Radiance);
+			}
+			Result += Hadamard(Attenuation, Background);
+			break;
+		}
+	}
+
+	if(CacheVertexCount)
+	{
+		AddRadianceCachePath(Cache, CacheVertices, CacheVertexCount, V3(Result));
+	}
+
+	Clamp01(Result.r);
+	Clamp01(Result.g);
+	Clamp01(Result.b);
+
+	LockedAddAndReturnPreviousValue(RaysCast, RayCount);
+
+	return Result;
+}
+
+internal void
+RenderTileX1(tile_work_order *WorkOrder, u32 FrameIndex, volatile u32 *RaysCast)
+{
+	world *World = WorkOrder->World;
+	image *Image = WorkOrder->Image;
+	u32 MinX = WorkOrder->MinX;
+	u32 MinY = WorkOrder->MinY;
+	u32 OnePastMaxX = WorkOrder->OnePastMaxX;
+	u32 OnePastMaxY= WorkOrder->OnePastMaxY;
+	u32 RaysPerPixel = WorkOrder->RaysPerPixel;
+
+	// NOTE: Samples the radiance cache's fill already traced are picked up
+	// from it; see ray_radiance_cache.cpp.
+	radiance_cache *Cache = World->RadianceCache;
+	u32 FilledSamples = GetRadianceCacheFilledSamples(Cache, WorkOrder, FrameIndex);
+
+	v3a CameraP = V3a(World->CameraP);
+	v3a FilmP = V3a(World->FilmP);
+	v3a HalfFilmX = World->HalfFilmW*V3a(World->CameraX);
+	v3a HalfFilmY = World->HalfFilmH*V3a(World->CameraY);
+
+	for(u32 Y = MinY;
+		Y < OnePastMaxY;
+		++Y)
+	{
+		u32 *Dest = GetPixelPointer(Image, MinX, Y);
+
+		for(u32 X = MinX;
+			X < OnePastMaxX;
+			++X)
+		{
+			v3a Color = {};
+			f32 Contrib = 1.0f/RaysPerPixel;
+			if(FilledSamples)
+			{
+				Color = Contrib*V3a(Cache->FillColor[Y*Image->Width + X]);
+			}
+
+			for(u32 RayIndex = FilledSamples;
+				RayIndex < RaysPerPixel;
+				++RayIndex)
+			{
+				u32 SampleIndex = WorkOrder->FirstSample + RayIndex;
+				random_series Series = RandomSeries(GetSampleSeed(FrameIndex, Y*Image->Width + X, SampleIndex));
+				f32 XRatio = -1.0f + 2.0f*((((f32)X) + 0.5f*RandomBilateral(&Series))/(f32)Image->Width);
+				f32 YRatio = -1.0f + 2.0f*((((f32)Y) + 0.5f*RandomBilateral(&Series))/(f32)Image->Height);
+				v3a FilmPoint = FilmP + XRatio*HalfFilmX + YRatio*HalfFilmY;
+
+				v3a RayOrigin = CameraP;
+				v3a RayDirection = NOZ(FilmPoint - RayOrigin);
+
+				Color += Contrib*RayCast(World, RayOrigin, RayDirection, WorkOrder->MaxBounces, &Series, RaysCast);
+			}
+
+			TIMED_ZONE(ProfileZone_PackSRGB);
+			*Dest++ = PackLinear01ToSRGBU32(V3(Color));
+			if(Image->Radiance)
+			{
+				Image->Radiance[GetRadianceIndex(Image, X, Y)] = V3(Color);
+			}
+		}
+	}
+}
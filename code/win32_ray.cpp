@@ -2,12 +2,22 @@
 * File: win32_ray.cpp
 * Author: Jesse Calvert
 * Created: October 24, 2017, 17:48
-* Last modified: October 24, 2017, 18:10
+* Last modified: October 19, 2026, 15:46
 */
 
+// NOTE: winsock2.h has to come before windows.h, which otherwise pulls in
+// the old winsock.h.
+#include <winsock2.h>
+#include <ws2tcpip.h>
 #include "windows.h"
 
+#pragma comment(lib, "ws2_32.lib")
+
+typedef SOCKET platform_socket;
+#define InvalidSocket INVALID_SOCKET
+
 internal void RenderTile(work_queue *WorkOrder);
+internal void BindWorkerThread(work_queue *WorkQueue);
 
 internal u32
 LockedAddAndReturnPreviousValue(volatile u32 *Value, u32 Add)
@@ -16,21 +26,47 @@ LockedAddAndReturnPreviousValue(volatile u32 *Value, u32 Add)
 	return Result;
 }
 
+internal u64
+LockedAddAndReturnPreviousValue64(volatile u64 *Value, u64 Add)
+{
+	u64 Result = InterlockedExchangeAdd64((volatile LONG64 *)Value, Add);
+	return Result;
+}
+
+// NOTE: Stores New only if Value still holds Expected, and returns what
+// it held either way.
+internal u64
+LockedCompareExchange64(volatile u64 *Value, u64 New, u64 Expected)
+{
+	u64 Result = InterlockedCompareExchange64((volatile LONG64 *)Value, New, Expected);
+	return Result;
+}
+
 DWORD WINAPI ThreadDoWork(void *Param)
 {
 	work_queue *WorkQueue = (work_queue *)Param;
+	BindWorkerThread(WorkQueue);
 
-	while(WorkQueue->TilesCompleted < WorkQueue->TileQueueSize)
+	for(;;)
 	{
-		RenderTile(WorkQueue);
+		if(WorkQueue->NextWorkIndex < WorkQueue->OnePastLastWorkIndex)
+		{
+			RenderTile(WorkQueue);
+		}
+		else
+		{
+			// NOTE: Park until the next batch of tiles is posted.
+			WaitForSingleObjectEx(WorkQueue->SemaphoreHandle, INFINITE, FALSE);
+		}
 	}
-
-	return 0;
 }
 
 internal void
 ThreadStart(work_queue *WorkQueue, u32 ThreadCount)
 {
+	WorkQueue->ThreadCount = ThreadCount;
+	WorkQueue->SemaphoreHandle = CreateSemaphoreEx(0, 0, 0x7FFFFFFF, 0, 0, SEMAPHORE_ALL_ACCESS);
+
 	for(u32 ThreadIndex = 0;
 		ThreadIndex < ThreadCount;
 		++ThreadIndex)
@@ -39,3 +75,357 @@ ThreadStart(work_queue *WorkQueue, u32 ThreadCount)
 		CloseHandle(Thread);
 	}
 }
+
+internal void
+WakeWorkerThreads(work_queue *WorkQueue)
+{
+	ReleaseSemaphore(WorkQueue->SemaphoreHandle, WorkQueue->ThreadCount, 0);
+}
+
+internal f64
+GetWallClock()
+{
+	LARGE_INTEGER Frequency;
+	LARGE_INTEGER Counter;
+	QueryPerformanceFrequency(&Frequency);
+	QueryPerformanceCounter(&Counter);
+	f64 Result = (f64)Counter.QuadPart / (f64)Frequency.QuadPart;
+	return Result;
+}
+
+internal void
+SleepMS(u32 Milliseconds)
+{
+	Sleep(Milliseconds);
+}
+
+// NOTE: Zeroed memory straight from the OS, page aligned. Big blocks try
+// large pages first, which only works when the account holds the lock pages
+// in memory privilege; otherwise they fall back to normal pages.
+internal void *
+AllocateMemory(memory_index Size)
+{
+	void *Result = 0;
+	memory_index LargePageSize = GetLargePageMinimum();
+	if(LargePageSize && (Size >= HUGE_PAGE_SIZE))
+	{
+		Result = VirtualAlloc(0, AlignPow2(Size, LargePageSize),
+		                      MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+	}
+	if(!Result)
+	{
+		Result = VirtualAlloc(0, Size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+	}
+	return Result;
+}
+
+internal void
+DeallocateMemory(void *Memory, memory_index Size)
+{
+	if(Memory)
+	{
+		VirtualFree(Memory, 0, MEM_RELEASE);
+	}
+}
+
+// NOTE: Only sees the calling process's processor group, so at most 64 CPUs
+// in all. Without NUMA information every CPU goes into node 0.
+internal void
+GetNUMATopology(numa_topology *Topology)
+{
+	memset(Topology, 0, sizeof(*Topology));
+	ULONG HighestNode = 0;
+	if(GetNumaHighestNodeNumber(&HighestNode))
+	{
+		for(ULONG OSNode = 0;
+			(OSNode <= HighestNode) && (Topology->NodeCount < MAX_NUMA_NODES);
+			++OSNode)
+		{
+			ULONGLONG Mask = 0;
+			if(GetNumaNodeProcessorMask((UCHAR)OSNode, &Mask) && Mask)
+			{
+				u32 Node = Topology->NodeCount++;
+				for(u32 CPU = 0;
+					CPU < 64;
+					++CPU)
+				{
+					if(Mask & (1ULL << CPU))
+					{
+						AddNUMACPU(Topology, CPU, Node);
+					}
+				}
+			}
+		}
+	}
+
+	if(!Topology->NodeCount)
+	{
+		SYSTEM_INFO SystemInfo;
+		GetSystemInfo(&SystemInfo);
+		for(u32 CPU = 0;
+			CPU < SystemInfo.dwNumberOfProcessors;
+			++CPU)
+		{
+			AddNUMACPU(Topology, CPU, 0);
+		}
+		Topology->NodeCount = 1;
+	}
+}
+
+internal b32
+PinThreadToNode(numa_topology *Topology, u32 Node)
+{
+	DWORD_PTR Mask = 0;
+	for(u32 CPUIndex = 0;
+		CPUIndex < Topology->CPUCount;
+		++CPUIndex)
+	{
+		if((Topology->CPUNode[CPUIndex] == Node) && (Topology->CPUs[CPUIndex] < 8*sizeof(DWORD_PTR)))
+		{
+			Mask |= ((DWORD_PTR)1 << Topology->CPUs[CPUIndex]);
+		}
+	}
+
+	b32 Result = (Mask && SetThreadAffinityMask(GetCurrentThread(), Mask));
+	return Result;
+}
+
+// NOTE: Maps Size bytes of named memory that other processes can map too,
+// creating it if asked to. Returns 0 on failure. The mapping handle is
+// deliberately kept open for the life of the process.
+internal void *
+MapSharedMemory(char *Name, u32 Size, b32 Create)
+{
+	void *Result = 0;
+
+	HANDLE Mapping = Create ?
+		CreateFileMappingA(INVALID_HANDLE_VALUE, 0, PAGE_READWRITE, 0, Size, Name) :
+		OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, Name);
+	if(Mapping)
+	{
+		Result = MapViewOfFile(Mapping, FILE_MAP_ALL_ACCESS, 0, 0, Size);
+	}
+
+	return Result;
+}
+
+// NOTE: There's no counter backend here yet; -counters reports n/a.
+internal u32
+OpenThreadCounters(char **HardwareError)
+{
+	if(HardwareError && !*HardwareError)
+	{
+		*HardwareError = "no counter backend on Windows";
+	}
+	return 0;
+}
+
+internal void
+ReadThreadCounters(u64 *Values)
+{
+}
+
+internal b32
+SpawnSelf(char **Arguments)
+{
+	char ExecutablePath[MAX_PATH];
+	GetModuleFileNameA(0, ExecutablePath, sizeof(ExecutablePath));
+
+	char CommandLine[4096] = {};
+	u32 Used = 0;
+	for(char **Argument = Arguments;
+		*Argument;
+		++Argument)
+	{
+		int Written = _snprintf_s(CommandLine + Used, sizeof(CommandLine) - Used, _TRUNCATE,
+		                          "%s\"%s\"", (Argument == Arguments) ? "" : " ", *Argument);
+		if(Written < 0)
+		{
+			break;
+		}
+		Used += (u32)Written;
+	}
+
+	STARTUPINFOA StartupInfo = {};
+	StartupInfo.cb = sizeof(StartupInfo);
+	PROCESS_INFORMATION ProcessInfo = {};
+	b32 Result = CreateProcessA(ExecutablePath, CommandLine, 0, 0, FALSE, 0, 0, 0,
+	                            &StartupInfo, &ProcessInfo);
+	if(Result)
+	{
+		CloseHandle(ProcessInfo.hThread);
+		CloseHandle(ProcessInfo.hProcess);
+	}
+
+	return Result;
+}
+
+internal void
+InitializeSockets()
+{
+	local_persist b32 Initialized = false;
+	if(!Initialized)
+	{
+		WSADATA WSAData;
+		WSAStartup(MAKEWORD(2, 2), &WSAData);
+		Initialized = true;
+	}
+}
+
+internal platform_socket
+ListenOnPort(u16 Port, b32 LoopbackOnly, u16 *BoundPort)
+{
+	InitializeSockets();
+
+	platform_socket Result = socket(AF_INET, SOCK_STREAM, 0);
+	if(Result != InvalidSocket)
+	{
+		sockaddr_in Address = {};
+		Address.sin_family = AF_INET;
+		Address.sin_addr.s_addr = htonl(LoopbackOnly ? INADDR_LOOPBACK : INADDR_ANY);
+		Address.sin_port = htons(Port);
+
+		int AddressSize = sizeof(Address);
+		if((bind(Result, (sockaddr *)&Address, sizeof(Address)) == 0) &&
+		   (listen(Result, 64) == 0) &&
+		   (getsockname(Result, (sockaddr *)&Address, &AddressSize) == 0))
+		{
+			*BoundPort = ntohs(Address.sin_port);
+		}
+		else
+		{
+			closesocket(Result);
+			Result = InvalidSocket;
+		}
+	}
+
+	return Result;
+}
+
+internal void
+ConfigureConnection(platform_socket Socket, u32 ReceiveTimeoutMS)
+{
+	BOOL NoDelay = TRUE;
+	setsockopt(Socket, IPPROTO_TCP, TCP_NODELAY, (char *)&NoDelay, sizeof(NoDelay));
+
+	DWORD Timeout = ReceiveTimeoutMS;
+	setsockopt(Socket, SOL_SOCKET, SO_RCVTIMEO, (char *)&Timeout, sizeof(Timeout));
+}
+
+internal platform_socket
+AcceptConnection(platform_socket Listener, u32 ReceiveTimeoutMS)
+{
+	platform_socket Result = accept(Listener, 0, 0);
+	if(Result != InvalidSocket)
+	{
+		ConfigureConnection(Result, ReceiveTimeoutMS);
+	}
+	return Result;
+}
+
+internal platform_socket
+ConnectToHost(char *Host, u16 Port, u32 ReceiveTimeoutMS)
+{
+	InitializeSockets();
+
+	platform_socket Result = InvalidSocket;
+
+	char PortName[16];
+	_snprintf_s(PortName, sizeof(PortName), _TRUNCATE, "%u", Port);
+
+	addrinfo Hints = {};
+	Hints.ai_family = AF_INET;
+	Hints.ai_socktype = SOCK_STREAM;
+	addrinfo *Addresses = 0;
+	if(getaddrinfo(Host, PortName, &Hints, &Addresses) == 0)
+	{
+		Result = socket(AF_INET, SOCK_STREAM, 0);
+		if(Result != InvalidSocket)
+		{
+			if(connect(Result, Addresses->ai_addr, (int)Addresses->ai_addrlen) == 0)
+			{
+				ConfigureConnection(Result, ReceiveTimeoutMS);
+			}
+			else
+			{
+				closesocket(Result);
+				Result = InvalidSocket;
+			}
+		}
+		freeaddrinfo(Addresses);
+	}
+
+	return Result;
+}
+
+internal void
+CloseConnection(platform_socket Socket)
+{
+	closesocket(Socket);
+}
+
+internal b32
+SendAll(platform_socket Socket, void *Data, u32 Size)
+{
+	char *At = (char *)Data;
+	while(Size)
+	{
+		int Sent = send(Socket, At, (int)Size, 0);
+		if(Sent <= 0)
+		{
+			break;
+		}
+		At += Sent;
+		Size -= (u32)Sent;
+	}
+
+	b32 Result = (Size == 0);
+	return Result;
+}
+
+internal b32
+ReceiveAll(platform_socket Socket, void *Data, u32 Size)
+{
+	char *At = (char *)Data;
+	while(Size)
+	{
+		int Received = recv(Socket, At, (int)Size, 0);
+		if(Received <= 0)
+		{
+			break;
+		}
+		At += Received;
+		Size -= (u32)Received;
+	}
+
+	b32 Result = (Size == 0);
+	return Result;
+}
+
+internal u32
+WaitForReadable(platform_socket *Sockets, b32 *Readable, u32 SocketCount, u32 TimeoutMS)
+{
+	WSAPOLLFD Polls[128];
+	Assert(SocketCount <= ArrayCount(Polls));
+	for(u32 SocketIndex = 0;
+		SocketIndex < SocketCount;
+		++SocketIndex)
+	{
+		Polls[SocketIndex].fd = Sockets[SocketIndex];
+		Polls[SocketIndex].events = POLLRDNORM;
+		Polls[SocketIndex].revents = 0;
+	}
+
+	int ReadyCount = WSAPoll(Polls, SocketCount, (int)TimeoutMS);
+	for(u32 SocketIndex = 0;
+		SocketIndex < SocketCount;
+		++SocketIndex)
+	{
+		// NOTE: Hangups and errors count as readable so the caller's next
+		// receive sees them and drops the connection.
+		Readable[SocketIndex] = (Polls[SocketIndex].revents != 0);
+	}
+
+	u32 Result = (ReadyCount > 0) ? (u32)ReadyCount : 0;
+	return Result;
+}